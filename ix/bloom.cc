@@ -0,0 +1,188 @@
+#include <cmath>
+
+#include "bloom.h"
+
+// words of the blocks on a page of bits, the page has a few bytes left after them
+# define BLOOM_PAGE_WORDS (BLOOM_BLOCKS_PER_PAGE * BLOOM_BLOCK_WORDS)
+
+BloomFilter::BloomFilter() {
+    memset(&header, 0, sizeof(bloomFilterHeader));
+}
+
+BloomFilter::~BloomFilter() {
+    close();
+}
+
+RC BloomFilter::create(const std::string &fileName, unsigned capacity, float falsePositiveRate) {
+    if(falsePositiveRate <= 0 || falsePositiveRate >= 1){
+        // std::cout << "[Error]: BloomFilter::create -> the false positive rate should be in (0, 1)." << std::endl;
+        return -1;
+    }
+    close();
+    PagedFileManager &pfm = PagedFileManager::instance();
+    pfm.destroyFile(fileName);
+    if(pfm.createFile(fileName) != 0 || pfm.openFile(fileName, fileHandle) != 0){
+        // std::cout << "[Error]: BloomFilter::create -> fail to create the file." << std::endl;
+        return -1;
+    }
+
+    // bits per key and number of bits of a key which give the rate, the bits are rounded up to whole pages.
+    // A block of a blocked filter gets more than its share of keys now and then, the pages left over make up for it.
+    capacity = std::max(capacity, (unsigned)BLOOM_MIN_KEYS);
+    double bitsPerKey = -std::log((double)falsePositiveRate) / (M_LN2 * M_LN2);
+    unsigned long long numOfBits = (unsigned long long)std::ceil(capacity * bitsPerKey);
+    unsigned numOfPages = (numOfBits + PAGE_SIZE * 8 - 1) / (PAGE_SIZE * 8);
+    header.numOfHashes = std::min(std::max((int)std::lround(bitsPerKey * M_LN2), 1), BLOOM_MAX_HASHES);
+    header.numOfBlocks = numOfPages * BLOOM_BLOCKS_PER_PAGE;
+    header.capacity = capacity;
+    header.falsePositiveRate = falsePositiveRate;
+    words.reset(new std::atomic<unsigned long long>[(size_t)numOfPages * BLOOM_PAGE_WORDS]);
+    for(size_t i = 0; i < (size_t)numOfPages * BLOOM_PAGE_WORDS; i++){
+        words[i].store(0, std::memory_order_relaxed);
+    }
+
+    // page 0 and the pages of bits, written outside the log like add(...)
+    char *page = (char *)malloc(PAGE_SIZE);
+    memset(page, 0, PAGE_SIZE);
+    memcpy(page, &header, sizeof(bloomFilterHeader));
+    RC rc = fileHandle.writePageWithLSN(0, page, 0);
+    memset(page, 0, PAGE_SIZE);
+    for(unsigned pageNum = 1; pageNum <= numOfPages && rc == 0; pageNum++){
+        rc = fileHandle.writePageWithLSN(pageNum, page, 0);
+    }
+    free(page);
+    if(rc != 0){
+        close();
+    }
+    return rc;
+}
+
+RC BloomFilter::open(const std::string &fileName) {
+    close();
+    if(PagedFileManager::instance().openFile(fileName, fileHandle) != 0){
+        return -1;
+    }
+    char *page = (char *)malloc(PAGE_SIZE);
+    RC rc = fileHandle.readPage(0, page);
+    memcpy(&header, page, sizeof(bloomFilterHeader));
+    unsigned numOfPages = header.numOfBlocks / BLOOM_BLOCKS_PER_PAGE;
+    if(rc != 0 || header.numOfHashes < 1 || header.numOfHashes > BLOOM_MAX_HASHES || numOfPages == 0 ||
+       fileHandle.getNumberOfPages() < numOfPages + 1){
+        // std::cout << "[Error]: BloomFilter::open -> not a Bloom filter file." << std::endl;
+        free(page);
+        close();
+        return -1;
+    }
+    words.reset(new std::atomic<unsigned long long>[(size_t)numOfPages * BLOOM_PAGE_WORDS]);
+    for(unsigned pageNum = 1; pageNum <= numOfPages && rc == 0; pageNum++){
+        rc = fileHandle.readPage(pageNum, page);
+        const unsigned long long *pageWords = (const unsigned long long *)page;
+        for(size_t i = 0; i < BLOOM_PAGE_WORDS; i++){
+            words[(pageNum - 1) * BLOOM_PAGE_WORDS + i].store(pageWords[i], std::memory_order_relaxed);
+        }
+    }
+    free(page);
+    if(rc != 0){
+        close();
+    }
+    return rc;
+}
+
+RC BloomFilter::close() {
+    if(!fileHandle.getFile().is_open()){
+        return 0;
+    }
+    return PagedFileManager::instance().closeFile(fileHandle);
+}
+
+RC BloomFilter::add(unsigned hash) {
+    if(!words){
+        return -1;
+    }
+    unsigned bits[BLOOM_MAX_HASHES];
+    unsigned block = getBits(hash, bits);
+    std::atomic<unsigned long long> *blockWords = &words[(size_t)block * BLOOM_BLOCK_WORDS];
+    bool changed = false;
+    for(int i = 0; i < header.numOfHashes; i++){
+        unsigned long long mask = 1ULL << (bits[i] % 64);
+        if((blockWords[bits[i] / 64].fetch_or(mask) & mask) == 0){
+            changed = true;
+        }
+    }
+    if(!changed){
+        return 0;
+    }
+    return writeBitPage(block / BLOOM_BLOCKS_PER_PAGE + 1);
+}
+
+RC BloomFilter::add(const std::vector<unsigned> &hashes) {
+    if(!words){
+        return -1;
+    }
+    unsigned bits[BLOOM_MAX_HASHES];
+    for(unsigned hash : hashes){
+        unsigned block = getBits(hash, bits);
+        std::atomic<unsigned long long> *blockWords = &words[(size_t)block * BLOOM_BLOCK_WORDS];
+        for(int i = 0; i < header.numOfHashes; i++){
+            blockWords[bits[i] / 64].fetch_or(1ULL << (bits[i] % 64), std::memory_order_relaxed);
+        }
+    }
+    RC rc = 0;
+    for(unsigned pageNum = 1; pageNum <= header.numOfBlocks / BLOOM_BLOCKS_PER_PAGE && rc == 0; pageNum++){
+        rc = writeBitPage(pageNum);
+    }
+    return rc;
+}
+
+bool BloomFilter::mayContain(unsigned hash) const {
+    if(!words){
+        return true;
+    }
+    unsigned bits[BLOOM_MAX_HASHES];
+    unsigned block = getBits(hash, bits);
+    const std::atomic<unsigned long long> *blockWords = &words[(size_t)block * BLOOM_BLOCK_WORDS];
+    for(int i = 0; i < header.numOfHashes; i++){
+        if((blockWords[bits[i] / 64].load(std::memory_order_relaxed) & (1ULL << (bits[i] % 64))) == 0){
+            return false;
+        }
+    }
+    return true;
+}
+
+unsigned BloomFilter::getCapacity() const {
+    return header.capacity;
+}
+
+float BloomFilter::getFalsePositiveRate() const {
+    return header.falsePositiveRate;
+}
+
+unsigned BloomFilter::getBits(unsigned hash, unsigned *bits) const {
+    // the block comes from hash, the bits in it from a 64 bit mix of hash (the finalizer of MurmurHash3), double hashing
+    // h1 + i * h2 with an odd h2 gives numOfHashes different bits
+    unsigned long long mixed = hash;
+    mixed ^= mixed >> 33;
+    mixed *= 0xff51afd7ed558ccdULL;
+    mixed ^= mixed >> 33;
+    mixed *= 0xc4ceb9fe1a85ec53ULL;
+    mixed ^= mixed >> 33;
+    unsigned h1 = (unsigned)mixed, h2 = (unsigned)(mixed >> 32) | 1;
+    for(int i = 0; i < header.numOfHashes; i++){
+        bits[i] = (h1 + i * h2) % BLOOM_BLOCK_BITS;
+    }
+    return hash % header.numOfBlocks;
+}
+
+RC BloomFilter::writeBitPage(PageNum pageNum) {
+    // the page is copied under its latch after the bits are set, so of two adds on one page the one writing last
+    // writes the bits of both
+    ExclusiveLatchGuard guard(fileHandle.getLatch(pageNum));
+    unsigned long long *page = (unsigned long long *)malloc(PAGE_SIZE);
+    memset(page, 0, PAGE_SIZE);
+    for(size_t i = 0; i < BLOOM_PAGE_WORDS; i++){
+        page[i] = words[(pageNum - 1) * BLOOM_PAGE_WORDS + i].load();
+    }
+    RC rc = fileHandle.writePageWithLSN(pageNum, page, 0);
+    free(page);
+    return rc;
+}
@@ -0,0 +1,78 @@
+#ifndef _bloom_h_
+#define _bloom_h_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include "../rbf/pfm.h"
+
+// The Bloom filter of an index is kept in the file named after the index file with this suffix, see IndexManager::createBloomFilter(...)
+# define BLOOM_FILE_SUFFIX ".bloom"
+
+# define BLOOM_FALSE_POSITIVE_RATE 0.01     // default rate of keys not in the index the filter lets through
+# define BLOOM_MIN_KEYS 1024                // a filter is sized for at least this many keys, it takes one page of bits then
+# define BLOOM_MAX_HASHES 16                // most bits set for a key
+
+// The bits of a key are in one block of 64 bytes, so a lookup touches one cache line.
+// Page 0 holds the bloomFilterHeader, the blocks follow from page 1 on, BLOOM_BLOCKS_PER_PAGE of them on each page.
+# define BLOOM_BLOCK_BITS 512
+# define BLOOM_BLOCK_WORDS (BLOOM_BLOCK_BITS / 64)
+# define BLOOM_BLOCKS_PER_PAGE (PAGE_SIZE * 8 / BLOOM_BLOCK_BITS)
+
+typedef struct
+{
+    int numOfHashes;
+    unsigned numOfBlocks;
+    unsigned capacity;              // keys the filter was sized for
+    float falsePositiveRate;        // rate it was sized for
+} bloomFilterHeader;
+
+/*
+ * Blocked Bloom filter over the keys of one index, by the 32 bit hash of the key (HashIndexManager::hashKey(...)).
+ * A key sets numOfHashes bits of the block its hash picks, a key whose bits are not all set is not in the index.
+ *
+ * The bits are kept in memory and read without latches, add(...) sets them and writes their page through to the file.
+ * Bits are only ever set: a key is added before it goes into the index, so the filter never rules out a key of the index;
+ * a deleted key keeps its bits until the filter is built again. The pages are not logged for the same reason, the bits of
+ * an aborted insert do no harm.
+ */
+class BloomFilter {
+public:
+    BloomFilter();
+    ~BloomFilter();
+
+    // Create the filter file fileName for capacity keys at falsePositiveRate, with no bit set, and keep it open.
+    RC create(const std::string &fileName, unsigned capacity, float falsePositiveRate);
+
+    // Open the filter file fileName and read its bits.
+    RC open(const std::string &fileName);
+
+    RC close();
+
+    // Set the bits of hash, the page of its block is written if one of them was not set yet.
+    RC add(unsigned hash);
+
+    // Set the bits of all the hashes, then write every page once, used to fill a new filter.
+    RC add(const std::vector<unsigned> &hashes);
+
+    // Whether all the bits of hash are set, false only if no key with this hash was added.
+    bool mayContain(unsigned hash) const;
+
+    unsigned getCapacity() const;
+    float getFalsePositiveRate() const;
+
+private:
+    // The block of hash and the numOfHashes bits in it.
+    unsigned getBits(unsigned hash, unsigned *bits) const;
+
+    // Write the bits of page pageNum (from 1 on) to the file.
+    RC writeBitPage(PageNum pageNum);
+
+    FileHandle fileHandle;
+    bloomFilterHeader header;
+    std::unique_ptr<std::atomic<unsigned long long>[]> words;   // BLOOM_BLOCK_WORDS for each block
+};
+
+#endif
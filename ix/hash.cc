@@ -0,0 +1,741 @@
+#include <limits>
+
+#include "hash.h"
+
+HashIndexManager &HashIndexManager::instance() {
+    static HashIndexManager _hash_index_manager;
+    return _hash_index_manager;
+}
+
+RC HashIndexManager::createFile(const std::string &fileName) {
+    IndexManager &indexManager = IndexManager::instance();
+    IXFileHandle ixFileHandle;
+    if(indexManager.createFile(fileName) != 0 || indexManager.openFile(fileName, ixFileHandle) != 0){
+        // std::cout << "[Error]: HashIndexManager::createFile -> fail to create the file." << std::endl;
+        return -1;
+    }
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    char *page = (char *)malloc(PAGE_SIZE);
+    PageNum pageNum;
+
+    // page 0 points to the directory on page 1, its single entry to the bucket on page 2
+    memset(page, 0, PAGE_SIZE);
+    hashHeaderDirectory header = {HASH_HEADER_FLAG, 0, 1, 0};
+    unsigned dirPageNum = 1;
+    memcpy(page, &header, HASH_HEADER_SIZE);
+    memcpy(page + HASH_HEADER_SIZE, &dirPageNum, sizeof(unsigned));
+    RC rc = fileHandle.appendPage(page, pageNum);
+
+    memset(page, 0, PAGE_SIZE);
+    unsigned bucketPageNum = 2;
+    memcpy(page, &bucketPageNum, sizeof(unsigned));
+    if(rc == 0){
+        rc = fileHandle.appendPage(page, pageNum);
+    }
+
+    memset(page, 0, PAGE_SIZE);
+    hashBucketDirectory bucket = {HASH_BUCKET_FLAG, 0, 0, PAGE_SIZE - HASH_BUCKET_DIR_SIZE, -1};
+    memcpy(page, &bucket, HASH_BUCKET_DIR_SIZE);
+    if(rc == 0){
+        rc = fileHandle.appendPage(page, pageNum);
+    }
+    free(page);
+    indexManager.closeFile(ixFileHandle);
+    return rc;
+}
+
+RC HashIndexManager::destroyFile(const std::string &fileName) {
+    return IndexManager::instance().destroyFile(fileName);
+}
+
+RC HashIndexManager::openFile(const std::string &fileName, IXFileHandle &ixFileHandle) {
+    return IndexManager::instance().openFile(fileName, ixFileHandle);
+}
+
+RC HashIndexManager::closeFile(IXFileHandle &ixFileHandle) {
+    return IndexManager::instance().closeFile(ixFileHandle);
+}
+
+bool HashIndexManager::isHashIndex(const std::string &fileName) const {
+    size_t suffixLength = strlen(HASH_INDEX_SUFFIX);
+    return fileName.size() > suffixLength && fileName.compare(fileName.size() - suffixLength, suffixLength, HASH_INDEX_SUFFIX) == 0;
+}
+
+RC HashIndexManager::insertEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid) {
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    ExclusiveLatchGuard guard(fileHandle.getLatch(ROOT_PAGE));
+
+    unsigned hash = hashKey(attribute, key);
+    int keyLength = IndexManager::instance().getKeyLength(attribute, key);
+    int entryLength = keyLength + (int)sizeof(RID);
+    if(entryLength > PAGE_SIZE - HASH_BUCKET_DIR_SIZE){
+        // std::cout << "[Error]: HashIndexManager::insertEntry -> the key is too long." << std::endl;
+        return -1;
+    }
+
+    char *header = (char *)malloc(PAGE_SIZE);
+    char *page = (char *)malloc(PAGE_SIZE);
+    hashBucketDirectory bucket;
+    RC rc = -1;
+    while(true){
+        unsigned pageNum;
+        if(readDirectoryPage(ixFileHandle, ROOT_PAGE, header) != 0 || getBucket(ixFileHandle, header, hash, pageNum) != 0){
+            break;
+        }
+
+        // 1. the first page of the chain with room for the entry takes it
+        int curPage = pageNum;
+        unsigned lastPageNum = pageNum;
+        bool failed = false;
+        while(curPage != -1){
+            if(fileHandle.readPage(curPage, page) != 0){
+                failed = true;
+                break;
+            }
+            memcpy(&bucket, page, HASH_BUCKET_DIR_SIZE);
+            if(bucket.freeSpace >= entryLength){
+                break;
+            }
+            lastPageNum = curPage;
+            curPage = bucket.nextPage;
+        }
+        if(failed){
+            break;
+        }
+        if(curPage != -1){
+            int offset = PAGE_SIZE - bucket.freeSpace;
+            memcpy(page + offset, key, keyLength);
+            memcpy(page + offset + keyLength, &rid, sizeof(RID));
+            bucket.numOfEntries += 1;
+            bucket.freeSpace -= entryLength;
+            memcpy(page, &bucket, HASH_BUCKET_DIR_SIZE);
+            rc = fileHandle.writePage(curPage, page);
+            break;
+        }
+
+        // 2. the bucket is full, split it if one of its keys differs from key in a bit of the hash it doesn't use yet
+        int localDepth;
+        std::vector<IndexEntry> entries;
+        std::vector<unsigned> pageNums;
+        if(readBucketEntries(ixFileHandle, attribute, pageNum, localDepth, entries, pageNums) != 0){
+            break;
+        }
+        bool splittable = false;
+        unsigned mask = (1u << HASH_MAX_DEPTH) - 1;
+        for(size_t i = 0; i < entries.size() && localDepth < HASH_MAX_DEPTH && !splittable; i++){
+            splittable = ((hashKey(attribute, entries[i].key.data()) ^ hash) & mask) != 0;
+        }
+        if(splittable){
+            if(splitBucket(ixFileHandle, attribute, hash) != 0){
+                // std::cout << "[Error]: HashIndexManager::insertEntry -> fail to split the bucket." << std::endl;
+                break;
+            }
+            // the bucket of key may still be full, try again
+            continue;
+        }
+
+        // 3. every key of the bucket has the hash of key, a new overflow page at the end of the chain takes it
+        memset(page, 0, PAGE_SIZE);
+        hashBucketDirectory overflow = {HASH_BUCKET_FLAG, localDepth, 1, PAGE_SIZE - HASH_BUCKET_DIR_SIZE - entryLength, -1};
+        memcpy(page, &overflow, HASH_BUCKET_DIR_SIZE);
+        memcpy(page + HASH_BUCKET_DIR_SIZE, key, keyLength);
+        memcpy(page + HASH_BUCKET_DIR_SIZE + keyLength, &rid, sizeof(RID));
+        unsigned newPageNum;
+        rc = allocatePage(ixFileHandle, page, newPageNum);
+        if(rc == 0){
+            rc = fileHandle.readPage(lastPageNum, page);
+        }
+        if(rc == 0){
+            memcpy(&bucket, page, HASH_BUCKET_DIR_SIZE);
+            bucket.nextPage = newPageNum;
+            memcpy(page, &bucket, HASH_BUCKET_DIR_SIZE);
+            rc = fileHandle.writePage(lastPageNum, page);
+        }
+        break;
+    }
+    free(header);
+    free(page);
+
+    // inside a transaction the insert ends in the log while page 0 is still latched.
+    if(rc == 0){
+        rc = LogManager::instance().logEntryOperation(OP_ENTRY_INSERT, fileHandle, attribute, key, keyLength, rid);
+    }
+    return rc;
+}
+
+RC HashIndexManager::deleteEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid) {
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    ExclusiveLatchGuard guard(fileHandle.getLatch(ROOT_PAGE));
+    IndexManager &indexManager = IndexManager::instance();
+
+    char *page = (char *)malloc(PAGE_SIZE);
+    unsigned pageNum;
+    if(readDirectoryPage(ixFileHandle, ROOT_PAGE, page) != 0 || getBucket(ixFileHandle, page, hashKey(attribute, key), pageNum) != 0){
+        free(page);
+        return -1;
+    }
+
+    // walk along the chain until the page with the entry
+    RC rc = -1;
+    int curPage = pageNum, prevPage = -1;
+    hashBucketDirectory bucket;
+    while(curPage != -1 && fileHandle.readPage(curPage, page) == 0){
+        memcpy(&bucket, page, HASH_BUCKET_DIR_SIZE);
+        int offset = HASH_BUCKET_DIR_SIZE;
+        for(int i = 0; i < bucket.numOfEntries; i++){
+            int entryLength = getEntryLength(attribute, page, offset);
+            RID entryRid;
+            memcpy(&entryRid, page + offset + entryLength - sizeof(RID), sizeof(RID));
+            if(entryRid.pageNum == rid.pageNum && entryRid.slotNum == rid.slotNum &&
+               indexManager.compareKey(attribute, page + offset, key) == 0){
+                // the entries after it move forward
+                int dataEnd = PAGE_SIZE - bucket.freeSpace;
+                memmove(page + offset, page + offset + entryLength, dataEnd - offset - entryLength);
+                memset(page + dataEnd - entryLength, 0, entryLength);
+                bucket.numOfEntries -= 1;
+                bucket.freeSpace += entryLength;
+                memcpy(page, &bucket, HASH_BUCKET_DIR_SIZE);
+                rc = 0;
+                break;
+            }
+            offset += entryLength;
+        }
+        if(rc == 0){
+            break;
+        }
+        prevPage = curPage;
+        curPage = bucket.nextPage;
+    }
+    if(rc != 0){
+//        std::cout << "[Error]: HashIndexManager::deleteEntry -> can't find such a <key, rid> pair." << std::endl;
+        free(page);
+        return -1;
+    }
+
+    if(bucket.numOfEntries == 0 && prevPage != -1){
+        // an empty overflow page leaves the chain
+        char *prev = (char *)malloc(PAGE_SIZE);
+        hashBucketDirectory prevBucket;
+        rc = fileHandle.readPage(prevPage, prev);
+        if(rc == 0){
+            memcpy(&prevBucket, prev, HASH_BUCKET_DIR_SIZE);
+            prevBucket.nextPage = bucket.nextPage;
+            memcpy(prev, &prevBucket, HASH_BUCKET_DIR_SIZE);
+            rc = fileHandle.writePage(prevPage, prev);
+        }
+        if(rc == 0){
+            rc = freePage(ixFileHandle, curPage);
+        }
+        free(prev);
+    }
+    else{
+        rc = fileHandle.writePage(curPage, page);
+    }
+    free(page);
+
+    if(rc == 0){
+        rc = LogManager::instance().logEntryOperation(OP_ENTRY_DELETE, fileHandle, attribute, key, indexManager.getKeyLength(attribute, key), rid);
+    }
+    return rc;
+}
+
+RC HashIndexManager::scan(IXFileHandle &ixFileHandle,
+                          const Attribute &attribute,
+                          const void *lowKey,
+                          const void *highKey,
+                          bool lowKeyInclusive,
+                          bool highKeyInclusive,
+                          IX_ScanIterator &ix_ScanIterator) {
+    if(!ixFileHandle.getFileHandle().getFile().is_open()){
+//        std::cout << "[Error]: can't scan a non-existing file." << std::endl;
+        return -1;
+    }
+
+    // no leaf to start from, the iterator takes its entries bucket by bucket from getNextEntry(...)
+    RC rc = ix_ScanIterator.initializeScanIterator(ixFileHandle, attribute, lowKey, highKey, lowKeyInclusive, highKeyInclusive,
+                                                   -1, HASH_BUCKET_DIR_SIZE, 0, 0);
+    if(rc != 0){
+        return -1;
+    }
+    ix_ScanIterator.hashScan = true;
+    ix_ScanIterator.batchEntries.clear();
+    ix_ScanIterator.batchIndex = 0;
+    if(lowKey != NULL && highKey != NULL && lowKeyInclusive && highKeyInclusive &&
+       IndexManager::instance().compareKey(attribute, lowKey, highKey) == 0){
+        // the position of the key, its bucket is the only one to read
+        ix_ScanIterator.hashCursor = reverseBits(hashKey(attribute, lowKey));
+        ix_ScanIterator.hashCursorEnd = ix_ScanIterator.hashCursor + 1;
+    }
+    else{
+        ix_ScanIterator.hashCursor = 0;
+        ix_ScanIterator.hashCursorEnd = 1ull << 32;
+    }
+    return 0;
+}
+
+RC HashIndexManager::getNextEntry(IX_ScanIterator &ix_ScanIterator, RID &rid, void *key) {
+    IX_ScanIterator &it = ix_ScanIterator;
+    while(it.batchIndex >= it.batchEntries.size()){
+        if(it.hashCursor >= it.hashCursorEnd){
+            return IX_EOF;
+        }
+        it.batchEntries.clear();
+        it.batchIndex = 0;
+
+        // read the bucket of the position under the shared latch of page 0, splits wait until it is read
+        IXFileHandle &ixFileHandle = *it.ixFileHandlePtr;
+        std::vector<IndexEntry> entries;
+        std::vector<unsigned> pageNums;
+        int localDepth = 0;
+        unsigned pageNum;
+        RC rc;
+        char *header = (char *)malloc(PAGE_SIZE);
+        {
+            SharedLatchGuard guard(ixFileHandle.getFileHandle().getLatch(ROOT_PAGE));
+            rc = readDirectoryPage(ixFileHandle, ROOT_PAGE, header);
+            if(rc == 0){
+                rc = getBucket(ixFileHandle, header, reverseBits((unsigned)it.hashCursor), pageNum);
+            }
+            if(rc == 0){
+                rc = readBucketEntries(ixFileHandle, it.attribute, pageNum, localDepth, entries, pageNums);
+            }
+        }
+        free(header);
+        if(rc != 0){
+            // std::cout << "[Error]: HashIndexManager::getNextEntry -> fail to read the bucket." << std::endl;
+            it.hashCursor = it.hashCursorEnd;
+            return -1;
+        }
+
+        for(IndexEntry &entry : entries){
+            if(inRange(it.attribute, entry.key.data(), it.lowKey, it.highKey, it.lowKeyInclusive, it.highKeyInclusive)){
+                it.batchEntries.push_back(entry);
+            }
+        }
+        // the bucket covers the positions which start with its localDepth bits, the next range follows
+        unsigned long long rangeSize = 1ull << (32 - localDepth);
+        it.hashCursor = (it.hashCursor / rangeSize + 1) * rangeSize;
+    }
+
+    const IndexEntry &entry = it.batchEntries[it.batchIndex];
+    memcpy(key, entry.key.data(), entry.key.size());
+    rid = entry.rid;
+    it.batchIndex++;
+    return 0;
+}
+
+RC HashIndexManager::probeEntries(IXFileHandle &ixFileHandle, const Attribute &attribute, const std::vector<std::string> &keys,
+                                  std::vector<std::vector<RID>> &rids) {
+    IndexManager &indexManager = IndexManager::instance();
+    rids.assign(keys.size(), std::vector<RID>());
+    SharedLatchGuard guard(ixFileHandle.getFileHandle().getLatch(ROOT_PAGE));
+
+    // the directory doesn't change while page 0 is latched, page 0 is read once
+    char *header = (char *)malloc(PAGE_SIZE);
+    if(readDirectoryPage(ixFileHandle, ROOT_PAGE, header) != 0){
+        free(header);
+        return -1;
+    }
+    RC rc = 0;
+    std::vector<IndexEntry> entries;
+    std::vector<unsigned> pageNums;
+    for(size_t i = 0; i < keys.size() && rc == 0; i++){
+        unsigned pageNum;
+        int localDepth;
+        rc = getBucket(ixFileHandle, header, hashKey(attribute, keys[i].data()), pageNum);
+        if(rc == 0){
+            rc = readBucketEntries(ixFileHandle, attribute, pageNum, localDepth, entries, pageNums);
+        }
+        for(const IndexEntry &entry : entries){
+            if(indexManager.compareKey(attribute, entry.key.data(), keys[i].data()) == 0){
+                rids[i].push_back(entry.rid);
+            }
+        }
+    }
+    free(header);
+    return rc;
+}
+
+RC HashIndexManager::bulkBuild(IXFileHandle &ixFileHandle, const Attribute &attribute, const std::vector<IndexEntry> &entries) {
+    for(const IndexEntry &entry : entries){
+        if(insertEntry(ixFileHandle, attribute, entry.key.data(), entry.rid) != 0){
+            // std::cout << "[Error]: HashIndexManager::bulkBuild -> fail to insert an entry." << std::endl;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+unsigned HashIndexManager::hashKey(const Attribute &attribute, const void *key) const {
+    const char *bytes = (const char *)key;
+    int length = sizeof(int);
+    float value;
+    if(attribute.type == TypeVarChar){
+        memcpy(&length, key, sizeof(int));
+        bytes += sizeof(int);
+    }
+    else if(attribute.type == TypeReal){
+        // -0.0 and 0.0 are equal keys, so are all NaNs (see IndexManager::normalizeKey(...))
+        memcpy(&value, key, sizeof(float));
+        if(value == 0){
+            value = 0;
+        }
+        else if(value != value){
+            value = std::numeric_limits<float>::quiet_NaN();
+        }
+        bytes = (const char *)&value;
+    }
+
+    // FNV-1a over the bytes, then the finalizer of MurmurHash3 so that the low bits the directory uses depend on all of them
+    unsigned hash = 2166136261u;
+    for(int i = 0; i < length; i++){
+        hash ^= (unsigned char)bytes[i];
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+RC HashIndexManager::getGlobalDepth(IXFileHandle &ixFileHandle, int &globalDepth) {
+    SharedLatchGuard guard(ixFileHandle.getFileHandle().getLatch(ROOT_PAGE));
+    char *page = (char *)malloc(PAGE_SIZE);
+    RC rc = readDirectoryPage(ixFileHandle, ROOT_PAGE, page);
+    hashHeaderDirectory header;
+    memcpy(&header, page, HASH_HEADER_SIZE);
+    globalDepth = header.globalDepth;
+    free(page);
+    return rc;
+}
+
+RC HashIndexManager::readDirectoryPage(IXFileHandle &ixFileHandle, PageNum pageNum, void *page) {
+    std::atomic<unsigned> *version = ixFileHandle.getTreeVersion();
+    if(version == nullptr){
+        return ixFileHandle.getFileHandle().readPage(pageNum, page);
+    }
+    // page 0 is latched: whoever changed the directory has started the new version before releasing the latch.
+    unsigned curVersion = version->load();
+    if(ixFileHandle.readCachedNode(pageNum, curVersion, page) == 0){
+        return 0;
+    }
+    if(ixFileHandle.getFileHandle().readPage(pageNum, page) != 0){
+        return -1;
+    }
+    return ixFileHandle.cacheNode(pageNum, curVersion, page);
+}
+
+RC HashIndexManager::writeDirectoryPage(IXFileHandle &ixFileHandle, PageNum pageNum, const void *page) {
+    RC rc = ixFileHandle.getFileHandle().writePage(pageNum, page);
+    std::atomic<unsigned> *version = ixFileHandle.getTreeVersion();
+    if(version != nullptr){
+        version->fetch_add(1);
+    }
+    return rc;
+}
+
+RC HashIndexManager::getBucket(IXFileHandle &ixFileHandle, const void *header, unsigned hash, unsigned &pageNum) {
+    hashHeaderDirectory headerDirectory;
+    memcpy(&headerDirectory, header, HASH_HEADER_SIZE);
+    if(headerDirectory.flag != HASH_HEADER_FLAG){
+        // std::cout << "[Error]: HashIndexManager::getBucket -> not a hash index." << std::endl;
+        return -1;
+    }
+    unsigned index = hash & ((1u << headerDirectory.globalDepth) - 1);
+    unsigned dirPageNum;
+    memcpy(&dirPageNum, (const char *)header + HASH_HEADER_SIZE + (index / HASH_DIR_ENTRIES) * sizeof(unsigned), sizeof(unsigned));
+    char *page = (char *)malloc(PAGE_SIZE);
+    RC rc = readDirectoryPage(ixFileHandle, dirPageNum, page);
+    memcpy(&pageNum, page + (index % HASH_DIR_ENTRIES) * sizeof(unsigned), sizeof(unsigned));
+    free(page);
+    return rc;
+}
+
+RC HashIndexManager::readBucketEntries(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned pageNum, int &localDepth,
+                                       std::vector<IndexEntry> &entries, std::vector<unsigned> &pageNums) {
+    entries.clear();
+    pageNums.clear();
+    char *page = (char *)malloc(PAGE_SIZE);
+    int curPage = pageNum;
+    hashBucketDirectory bucket;
+    RC rc = 0;
+    while(curPage != -1){
+        if(ixFileHandle.getFileHandle().readPage(curPage, page) != 0){
+            rc = -1;
+            break;
+        }
+        memcpy(&bucket, page, HASH_BUCKET_DIR_SIZE);
+        if(bucket.flag != HASH_BUCKET_FLAG){
+            // std::cout << "[Error]: HashIndexManager::readBucketEntries -> not a bucket." << std::endl;
+            rc = -1;
+            break;
+        }
+        if(pageNums.empty()){
+            localDepth = bucket.localDepth;
+        }
+        pageNums.push_back(curPage);
+        int offset = HASH_BUCKET_DIR_SIZE;
+        for(int i = 0; i < bucket.numOfEntries; i++){
+            int entryLength = getEntryLength(attribute, page, offset);
+            IndexEntry entry;
+            entry.key.assign(page + offset, entryLength - sizeof(RID));
+            memcpy(&entry.rid, page + offset + entryLength - sizeof(RID), sizeof(RID));
+            entries.push_back(entry);
+            offset += entryLength;
+        }
+        curPage = bucket.nextPage;
+    }
+    free(page);
+    return rc;
+}
+
+RC HashIndexManager::writeBucketEntries(IXFileHandle &ixFileHandle, int localDepth,
+                                        const std::vector<IndexEntry> &entries, std::vector<unsigned> &pageNums,
+                                        std::vector<unsigned> &freePages) {
+    // 1. pack the entries into pages, the bucket has one page even if it is empty
+    std::vector<std::string> pages;
+    size_t next = 0;
+    do{
+        pages.emplace_back(PAGE_SIZE, '\0');
+        char *page = &pages.back()[0];
+        hashBucketDirectory bucket = {HASH_BUCKET_FLAG, localDepth, 0, PAGE_SIZE - HASH_BUCKET_DIR_SIZE, -1};
+        int offset = HASH_BUCKET_DIR_SIZE;
+        while(next < entries.size() && (int)(entries[next].key.size() + sizeof(RID)) <= bucket.freeSpace){
+            memcpy(page + offset, entries[next].key.data(), entries[next].key.size());
+            memcpy(page + offset + entries[next].key.size(), &entries[next].rid, sizeof(RID));
+            offset += entries[next].key.size() + sizeof(RID);
+            bucket.freeSpace -= entries[next].key.size() + sizeof(RID);
+            bucket.numOfEntries += 1;
+            next++;
+        }
+        memcpy(page, &bucket, HASH_BUCKET_DIR_SIZE);
+    }while(next < entries.size());
+
+    // 2. the pages of the chain, then free pages, then new ones. The pages not needed are free.
+    RC rc = 0;
+    while(pageNums.size() > pages.size()){
+        freePages.push_back(pageNums.back());
+        pageNums.pop_back();
+    }
+    while(pageNums.size() < pages.size() && rc == 0){
+        unsigned pageNum;
+        if(!freePages.empty()){
+            pageNum = freePages.back();
+            freePages.pop_back();
+        }
+        else{
+            rc = allocatePage(ixFileHandle, pages[pageNums.size()].data(), pageNum);
+        }
+        pageNums.push_back(pageNum);
+    }
+
+    // 3. link the pages and write them
+    for(size_t i = 0; i < pages.size() && rc == 0; i++){
+        hashBucketDirectory bucket;
+        memcpy(&bucket, pages[i].data(), HASH_BUCKET_DIR_SIZE);
+        bucket.nextPage = i + 1 < pages.size() ? (int)pageNums[i + 1] : -1;
+        memcpy(&pages[i][0], &bucket, HASH_BUCKET_DIR_SIZE);
+        rc = ixFileHandle.getFileHandle().writePage(pageNums[i], pages[i].data());
+    }
+    return rc;
+}
+
+RC HashIndexManager::splitBucket(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned hash) {
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    char *header = (char *)malloc(PAGE_SIZE);
+    char *page = (char *)malloc(PAGE_SIZE);
+    hashHeaderDirectory headerDirectory;
+    unsigned pageNum;
+    int localDepth = 0;
+    std::vector<IndexEntry> entries;
+    std::vector<unsigned> pageNums;
+    RC rc = readDirectoryPage(ixFileHandle, ROOT_PAGE, header);
+    if(rc == 0){
+        rc = getBucket(ixFileHandle, header, hash, pageNum);
+    }
+    if(rc == 0){
+        rc = readBucketEntries(ixFileHandle, attribute, pageNum, localDepth, entries, pageNums);
+    }
+    memcpy(&headerDirectory, header, HASH_HEADER_SIZE);
+    if(rc == 0 && localDepth >= HASH_MAX_DEPTH){
+        rc = -1;
+    }
+
+    // 1. the bucket uses every bit of the directory, double it: the entries of the new half are copies of the first half
+    if(rc == 0 && localDepth == headerDirectory.globalDepth){
+        unsigned size = 1u << headerDirectory.globalDepth;
+        int numOfDirPages = (2 * size + HASH_DIR_ENTRIES - 1) / HASH_DIR_ENTRIES;
+        // new directory pages come first, allocatePage(...) changes the free list of page 0
+        std::vector<unsigned> newDirPageNums;
+        memset(page, 0, PAGE_SIZE);
+        for(int i = headerDirectory.numOfDirPages; i < numOfDirPages && rc == 0; i++){
+            unsigned dirPageNum;
+            rc = allocatePage(ixFileHandle, page, dirPageNum);
+            newDirPageNums.push_back(dirPageNum);
+        }
+        if(rc == 0){
+            rc = readDirectoryPage(ixFileHandle, ROOT_PAGE, header);
+        }
+        memcpy(&headerDirectory, header, HASH_HEADER_SIZE);
+        for(size_t i = 0; i < newDirPageNums.size(); i++){
+            memcpy(header + HASH_HEADER_SIZE + (headerDirectory.numOfDirPages + i) * sizeof(unsigned), &newDirPageNums[i], sizeof(unsigned));
+        }
+        if(rc == 0 && size < HASH_DIR_ENTRIES){
+            // both halves are on the first directory page
+            unsigned dirPageNum;
+            memcpy(&dirPageNum, header + HASH_HEADER_SIZE, sizeof(unsigned));
+            rc = readDirectoryPage(ixFileHandle, dirPageNum, page);
+            if(rc == 0){
+                memcpy(page + size * sizeof(unsigned), page, size * sizeof(unsigned));
+                rc = writeDirectoryPage(ixFileHandle, dirPageNum, page);
+            }
+        }
+        for(unsigned i = 0; rc == 0 && size >= HASH_DIR_ENTRIES && i < size / HASH_DIR_ENTRIES; i++){
+            // every directory page of the first half is copied to its page in the new half
+            unsigned fromPageNum, toPageNum;
+            memcpy(&fromPageNum, header + HASH_HEADER_SIZE + i * sizeof(unsigned), sizeof(unsigned));
+            memcpy(&toPageNum, header + HASH_HEADER_SIZE + (i + size / HASH_DIR_ENTRIES) * sizeof(unsigned), sizeof(unsigned));
+            rc = readDirectoryPage(ixFileHandle, fromPageNum, page);
+            if(rc == 0){
+                rc = writeDirectoryPage(ixFileHandle, toPageNum, page);
+            }
+        }
+        headerDirectory.globalDepth += 1;
+        headerDirectory.numOfDirPages = numOfDirPages;
+        memcpy(header, &headerDirectory, HASH_HEADER_SIZE);
+        if(rc == 0){
+            rc = writeDirectoryPage(ixFileHandle, ROOT_PAGE, header);
+        }
+    }
+
+    // 2. the entries whose hash has the next bit set go to the new bucket, the pages of the chain are reused
+    std::vector<IndexEntry> lowEntries, highEntries;
+    unsigned bit = 1u << localDepth;
+    for(const IndexEntry &entry : entries){
+        ((hashKey(attribute, entry.key.data()) & bit) ? highEntries : lowEntries).push_back(entry);
+    }
+    std::vector<unsigned> freePages(pageNums.begin() + (pageNums.empty() ? 0 : 1), pageNums.end());
+    std::vector<unsigned> lowPageNums(1, pageNum), highPageNums;
+    if(rc == 0){
+        rc = writeBucketEntries(ixFileHandle, localDepth + 1, lowEntries, lowPageNums, freePages);
+    }
+    if(rc == 0){
+        rc = writeBucketEntries(ixFileHandle, localDepth + 1, highEntries, highPageNums, freePages);
+    }
+    for(size_t i = 0; i < freePages.size() && rc == 0; i++){
+        rc = freePage(ixFileHandle, freePages[i]);
+    }
+
+    // 3. the directory entries of the new half are the ones whose low localDepth + 1 bits are the hash of the bucket and the bit
+    if(rc == 0){
+        rc = readDirectoryPage(ixFileHandle, ROOT_PAGE, header);
+        memcpy(&headerDirectory, header, HASH_HEADER_SIZE);
+    }
+    int dirPageIndex = -1;
+    unsigned dirPageNum = 0;
+    for(unsigned index = (hash & (bit - 1)) | bit; rc == 0 && index < (1u << headerDirectory.globalDepth); index += 2 * bit){
+        if((int)(index / HASH_DIR_ENTRIES) != dirPageIndex){
+            if(dirPageIndex != -1){
+                rc = writeDirectoryPage(ixFileHandle, dirPageNum, page);
+            }
+            dirPageIndex = index / HASH_DIR_ENTRIES;
+            memcpy(&dirPageNum, header + HASH_HEADER_SIZE + dirPageIndex * sizeof(unsigned), sizeof(unsigned));
+            if(rc == 0){
+                rc = fileHandle.readPage(dirPageNum, page);
+            }
+        }
+        memcpy(page + (index % HASH_DIR_ENTRIES) * sizeof(unsigned), &highPageNums[0], sizeof(unsigned));
+    }
+    if(rc == 0 && dirPageIndex != -1){
+        rc = writeDirectoryPage(ixFileHandle, dirPageNum, page);
+    }
+    free(header);
+    free(page);
+    return rc;
+}
+
+RC HashIndexManager::allocatePage(IXFileHandle &ixFileHandle, const void *data, unsigned &pageNum) {
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    char *header = (char *)malloc(PAGE_SIZE);
+    hashHeaderDirectory headerDirectory;
+    RC rc = readDirectoryPage(ixFileHandle, ROOT_PAGE, header);
+    memcpy(&headerDirectory, header, HASH_HEADER_SIZE);
+    if(rc != 0 || headerDirectory.firstFreePage == 0){
+        free(header);
+        return rc == 0 ? fileHandle.appendPage(data, pageNum) : -1;
+    }
+
+    // take the first free page, page 0 points to the one after it
+    char *freePage = (char *)malloc(PAGE_SIZE);
+    pageNum = headerDirectory.firstFreePage;
+    rc = fileHandle.readPage(pageNum, freePage);
+    if(rc == 0){
+        memcpy(&headerDirectory.firstFreePage, freePage + sizeof(int), sizeof(int));
+        memcpy(header, &headerDirectory, HASH_HEADER_SIZE);
+        rc = writeDirectoryPage(ixFileHandle, ROOT_PAGE, header);
+    }
+    if(rc == 0){
+        rc = fileHandle.writePage(pageNum, data);
+    }
+    free(freePage);
+    free(header);
+    return rc;
+}
+
+RC HashIndexManager::freePage(IXFileHandle &ixFileHandle, unsigned pageNum) {
+    char *header = (char *)malloc(PAGE_SIZE);
+    hashHeaderDirectory headerDirectory;
+    RC rc = readDirectoryPage(ixFileHandle, ROOT_PAGE, header);
+    memcpy(&headerDirectory, header, HASH_HEADER_SIZE);
+
+    // the page goes in front of the list
+    char *page = (char *)malloc(PAGE_SIZE);
+    memset(page, 0, PAGE_SIZE);
+    int freeFlag = FREE_FLAG;
+    memcpy(page, &freeFlag, sizeof(int));
+    memcpy(page + sizeof(int), &headerDirectory.firstFreePage, sizeof(int));
+    if(rc == 0){
+        rc = ixFileHandle.getFileHandle().writePage(pageNum, page);
+    }
+    if(rc == 0){
+        headerDirectory.firstFreePage = pageNum;
+        memcpy(header, &headerDirectory, HASH_HEADER_SIZE);
+        rc = writeDirectoryPage(ixFileHandle, ROOT_PAGE, header);
+    }
+    free(page);
+    free(header);
+    return rc;
+}
+
+int HashIndexManager::getEntryLength(const Attribute &attribute, const char *page, int offset) const {
+    return IndexManager::instance().getKeyLength(attribute, page + offset) + sizeof(RID);
+}
+
+unsigned HashIndexManager::reverseBits(unsigned value) const {
+    unsigned reversed = 0;
+    for(int i = 0; i < 32; i++){
+        reversed = (reversed << 1) | (value & 1);
+        value >>= 1;
+    }
+    return reversed;
+}
+
+bool HashIndexManager::inRange(const Attribute &attribute, const void *key, const void *lowKey, const void *highKey,
+                               bool lowKeyInclusive, bool highKeyInclusive) const {
+    IndexManager &indexManager = IndexManager::instance();
+    if(lowKey != NULL){
+        int cmp = indexManager.compareKey(attribute, key, lowKey);
+        if(cmp < 0 || (cmp == 0 && !lowKeyInclusive)){
+            return false;
+        }
+    }
+    if(highKey != NULL){
+        int cmp = indexManager.compareKey(attribute, key, highKey);
+        if(cmp > 0 || (cmp == 0 && !highKeyInclusive)){
+            return false;
+        }
+    }
+    return true;
+}
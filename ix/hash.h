@@ -0,0 +1,187 @@
+#ifndef _hash_h_
+#define _hash_h_
+
+#include <vector>
+#include <string>
+
+#include "ix.h"
+
+// An index file whose name ends with this suffix is a hash index, see HashIndexManager
+# define HASH_INDEX_SUFFIX ".hash"
+
+# define HASH_HEADER_FLAG 7     // page 0 of a hash index
+# define HASH_BUCKET_FLAG 8     // bucket or overflow page of a bucket
+
+// Page 0 is <HASH_HEADER_FLAG, globalDepth, numOfDirPages, first free page> followed by the page numbers of the directory pages.
+// The directory has 2^globalDepth entries, the page number of the bucket of each value of the low globalDepth bits of the hash,
+// HASH_DIR_ENTRIES of them on each directory page. Doubling the directory copies whole directory pages, so HASH_DIR_ENTRIES
+// is a power of two.
+# define HASH_HEADER_SIZE 16
+# define HASH_DIR_ENTRIES 512
+# define HASH_MAX_DIR_PAGES ((PAGE_SIZE - HASH_HEADER_SIZE) / sizeof(unsigned))
+# define HASH_MAX_DEPTH 18      // 2^18 directory entries take 512 directory pages, buckets of this depth only grow overflow pages
+
+// Bucket page: the directory, then its <key, rid> entries packed from the front, keys in the format of insertEntry.
+// A bucket which is full and can't be split (its keys have the same hash) links to overflow pages of the same format.
+# define HASH_BUCKET_DIR_SIZE 20
+
+typedef struct
+{
+    int flag;
+    int globalDepth;
+    int numOfDirPages;
+    int firstFreePage;      // 0 if the free list is empty, free pages are <FREE_FLAG, next free page>
+} hashHeaderDirectory;
+
+typedef struct
+{
+    int flag;
+    int localDepth;         // number of low bits of the hash all the keys of the bucket share
+    int numOfEntries;
+    int freeSpace;
+    int nextPage;           // overflow page, -1 at the end of the chain
+} hashBucketDirectory;
+
+/*
+ * Extendible hashing index for equality lookups, next to the B+ trees of IndexManager.
+ * It uses the same IXFileHandle, IX_ScanIterator and key format, so RelationManager keeps both kinds of index alike.
+ *
+ * Page 0 and the directory pages are read through the copies of IXFileHandle (see IndexManager::readNode(...)), they
+ * change only with a new version of the file, so a lookup reads the page of its bucket and nothing else.
+ * Lookups and scans latch page 0 in shared mode, inserts and deletes in exclusive mode while they change the index.
+ * Inserts and deletes are logged like the ones of the B+ tree (OP_ENTRY_INSERT / OP_ENTRY_DELETE).
+ */
+class HashIndexManager {
+
+public:
+    static HashIndexManager &instance();
+
+    // Create a hash index file: page 0, one directory page and one empty bucket.
+    RC createFile(const std::string &fileName);
+
+    // Delete a hash index file.
+    RC destroyFile(const std::string &fileName);
+
+    // Open a hash index and return an ixFileHandle, see IndexManager::openFile(...)
+    RC openFile(const std::string &fileName, IXFileHandle &ixFileHandle);
+
+    // Close an ixFileHandle for a hash index.
+    RC closeFile(IXFileHandle &ixFileHandle);
+
+    // Whether fileName is the file of a hash index, by its HASH_INDEX_SUFFIX.
+    bool isHashIndex(const std::string &fileName) const;
+
+    /*
+     * Insert <key, rid> into the bucket of the hash of key. A full bucket is split on the next bit of the hash, the directory doubles
+     * first if the bucket uses all of its bits; if all its keys have the hash of key the entry goes to an overflow page instead.
+     */
+    RC insertEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid);
+
+    /*
+     * Delete <key, rid> from its bucket, an overflow page left empty goes to the free list. Buckets are never merged.
+     */
+    RC deleteEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid);
+
+    /*
+     * Initialize an IX_ScanIterator over the entries between lowKey and highKey, like IndexManager::scan(...) but in no order.
+     * An equality scan (lowKey equal to highKey, both inclusive) reads the bucket of the key only, any other scan reads every
+     * bucket and returns the keys within the bounds.
+     * The buckets are visited in the order of their hash bits read backwards (the lowest bit first): a bucket covers one
+     * contiguous range of that order and a split divides it in two, so a scan running next to inserts neither returns an
+     * entry twice nor misses an entry which was in the index all along.
+     */
+    RC scan(IXFileHandle &ixFileHandle,
+            const Attribute &attribute,
+            const void *lowKey,
+            const void *highKey,
+            bool lowKeyInclusive,
+            bool highKeyInclusive,
+            IX_ScanIterator &ix_ScanIterator);
+
+    /*
+     * Look up many keys at once, rids[i] gets the RIDs of keys[i], like IndexManager::probeEntries(...). The keys need not be sorted.
+     */
+    RC probeEntries(IXFileHandle &ixFileHandle, const Attribute &attribute, const std::vector<std::string> &keys,
+                    std::vector<std::vector<RID>> &rids);
+
+    /*
+     * Insert all the entries into an empty hash index, used to build it for the tuples of a table.
+     */
+    RC bulkBuild(IXFileHandle &ixFileHandle, const Attribute &attribute, const std::vector<IndexEntry> &entries);
+
+    /*
+     * 32 bit hash of a key in the format of insertEntry, equal keys (compareKey(...) == 0) have the same hash.
+     */
+    unsigned hashKey(const Attribute &attribute, const void *key) const;
+
+    // Number of low bits of the hash the directory uses.
+    RC getGlobalDepth(IXFileHandle &ixFileHandle, int &globalDepth);
+
+protected:
+    friend class IX_ScanIterator;                                               // gets the entries of a scan, see getNextEntry(...)
+
+    HashIndexManager() = default;                                               // Prevent construction
+    ~HashIndexManager() = default;                                              // Prevent unwanted destruction
+    HashIndexManager(const HashIndexManager &) = default;                       // Prevent construction by copying
+    HashIndexManager &operator=(const HashIndexManager &) = default;            // Prevent assignment
+
+    /*
+     * IX_ScanIterator::getNextEntry(...) of a hash scan: once the entries of a bucket are returned, the bucket of the next position
+     * is read under the shared latch of page 0 and its entries within the bounds are kept by the iterator.
+     */
+    RC getNextEntry(IX_ScanIterator &ix_ScanIterator, RID &rid, void *key);
+
+    /*
+     * Page 0 and the directory pages, read from the copies of ixFileHandle while the file keeps their version.
+     * writeDirectoryPage(...) writes one of them and starts a new version, the caller holds the exclusive latch of page 0.
+     */
+    RC readDirectoryPage(IXFileHandle &ixFileHandle, PageNum pageNum, void *page);
+    RC writeDirectoryPage(IXFileHandle &ixFileHandle, PageNum pageNum, const void *page);
+
+    /*
+     * The page number of the bucket of hash in the directory, header is a copy of page 0.
+     */
+    RC getBucket(IXFileHandle &ixFileHandle, const void *header, unsigned hash, unsigned &pageNum);
+
+    /*
+     * Read every entry of the bucket at pageNum and its overflow pages, pageNums gets the pages of the chain in order.
+     */
+    RC readBucketEntries(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned pageNum, int &localDepth,
+                         std::vector<IndexEntry> &entries, std::vector<unsigned> &pageNums);
+
+    /*
+     * Write entries into a bucket of localDepth on the pages of pageNums in order (the first one is the bucket), more pages are
+     * taken from freePages, then allocated, and the pages which are not needed go to freePages. pageNums gets the chain written.
+     */
+    RC writeBucketEntries(IXFileHandle &ixFileHandle, int localDepth, const std::vector<IndexEntry> &entries,
+                          std::vector<unsigned> &pageNums, std::vector<unsigned> &freePages);
+
+    /*
+     * Split the bucket of hash on its next bit, doubling the directory first if needed, and point the directory entries of the new half to it.
+     */
+    RC splitBucket(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned hash);
+
+    /*
+     * Take a page of the free list for data, or append it. Put a page no bucket uses on the free list.
+     */
+    RC allocatePage(IXFileHandle &ixFileHandle, const void *data, unsigned &pageNum);
+    RC freePage(IXFileHandle &ixFileHandle, unsigned pageNum);
+
+    /*
+     * Length of the entry at offset of a bucket page, its key and its rid.
+     */
+    int getEntryLength(const Attribute &attribute, const char *page, int offset) const;
+
+    /*
+     * The bits of value in reverse order, the position of a hash in the order of a scan.
+     */
+    unsigned reverseBits(unsigned value) const;
+
+    /*
+     * Whether key lies between lowKey and highKey, NULL is unbounded.
+     */
+    bool inRange(const Attribute &attribute, const void *key, const void *lowKey, const void *highKey, bool lowKeyInclusive,
+                 bool highKeyInclusive) const;
+};
+
+#endif
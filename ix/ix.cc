@@ -1,20 +1,46 @@
 #include "ix.h"
+#include "hash.h"
 
 IndexManager &IndexManager::instance() {
-    static IndexManager _index_manager = IndexManager();
+    static IndexManager _index_manager;
     return _index_manager;
 }
 
 RC IndexManager::createFile(const std::string &fileName) {
-    return PagedFileManager::instance().createFile(fileName);
+    RC rc = PagedFileManager::instance().createFile(fileName);
+    if(rc == 0){
+        newTreeVersion(fileName);
+    }
+    return rc;
 }
 
 RC IndexManager::destroyFile(const std::string &fileName) {
-    return PagedFileManager::instance().destroyFile(fileName);
+    RC rc = PagedFileManager::instance().destroyFile(fileName);
+    if(rc == 0){
+        newTreeVersion(fileName);
+        destroyBloomFilter(fileName);
+    }
+    return rc;
 }
 
 RC IndexManager::openFile(const std::string &fileName, IXFileHandle &ixFileHandle) {
-    return PagedFileManager::instance().openFile(fileName, ixFileHandle.getFileHandle());
+    RC rc = PagedFileManager::instance().openFile(fileName, ixFileHandle.getFileHandle());
+    if(rc != 0){
+        return rc;
+    }
+    std::lock_guard<std::mutex> lock(_treeVersionsMutex);
+    std::unique_ptr<std::atomic<unsigned>> &treeVersion = _treeVersions[fileName];
+    if(!treeVersion){
+        treeVersion.reset(new std::atomic<unsigned>(0));
+    }
+    // the copies of a handle opened on the same file again stay, they still belong to their version
+    if(ixFileHandle.getTreeVersion() != treeVersion.get()){
+        ixFileHandle.clearCache();
+        ixFileHandle.setTreeVersion(treeVersion.get());
+    }
+    // the file doesn't tell whether it is a clustered tree, the caller sets it
+    ixFileHandle.setClustered(false);
+    return 0;
 }
 
 RC IndexManager::closeFile(IXFileHandle &ixFileHandle) {
@@ -23,414 +49,1590 @@ RC IndexManager::closeFile(IXFileHandle &ixFileHandle) {
 
 RC IndexManager::insertEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid) {
 
+    if(ixFileHandle.isClustered()){
+        // std::cout << "[Error]: insertEntry -> the leaves of a clustered tree hold rows, see insertRow(...)." << std::endl;
+        return -1;
+    }
+
+    // the key goes into the Bloom filter first, a lookup which finds the entry finds the key in the filter too
+    std::shared_ptr<BloomFilter> filter = getBloomFilter(ixFileHandle.getFileHandle().getFileName());
+    if(filter && filter->add(HashIndexManager::instance().hashKey(attribute, key)) != 0){
+        // std::cout << "[Error]: insertEntry -> fail to add the key to the Bloom filter." << std::endl;
+        return -1;
+    }
+    return insertLeafEntry(ixFileHandle, attribute, key, &rid, sizeof(RID));
+}
+
+RC IndexManager::insertRow(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const void *row, unsigned rowLength) {
+    if(!ixFileHandle.isClustered() || rowLength > IX_MAX_ROW_SIZE){
+        // std::cout << "[Error]: insertRow -> not a clustered tree, or the row is too long." << std::endl;
+        return -1;
+    }
+    return insertLeafEntry(ixFileHandle, attribute, key, row, rowLength);
+}
+
+RC IndexManager::insertLeafEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const void *data, int sizeOfData) {
+
+    bool inserted;
+    RC rc = insertIntoLeaf(ixFileHandle, attribute, key, data, sizeOfData, inserted);
+    if(inserted){
+        return rc;
+    }
+    
+    // the nodes keep the normalized key, the log the key as it is given
+    char normalized[sizeof(unsigned)];
+    const void *nodeKey = normalizeKey(attribute, key, normalized);
+
+    // page 0 is latched first, it decides the shape of the tree and points to the root.
+    std::vector<unsigned> latchedNodes;
+    ixFileHandle.getFileHandle().getLatch(ROOT_PAGE).lockExclusive();
+    latchedNodes.push_back(ROOT_PAGE);
+    
     unsigned numOfPages = ixFileHandle.getFileHandle().getNumberOfPages();
-    RC rc;
 
     if (numOfPages == 0) {
 //        std::cout << "Insert into empty B+ tree" << std::endl;
-        rc = appendRootLeafPage(ixFileHandle, attribute, key, rid);
+        rc = appendRootLeafPage(ixFileHandle, attribute, nodeKey, data, sizeOfData);
         if(rc != 0){
             std::cout << "[Error] insertEntry -> fail to insert into empty B+ tree." << std::endl;
+            unlatchNodes(ixFileHandle, latchedNodes, latchedNodes.size());
             return -1;
         }
     }
-    else if (numOfPages == 1) {
-//        std::cout << "Insert into rootLeaf B+ tree" << std::endl;
-
-        int requiredLength = getRequiredLength(attribute, key, sizeof(rid));
-        if(requiredLength == -1){
-            // std::cout << "[Error] insertEntry -> fail to get the length of key." << std::endl;
-            return -1;
-        }
-        
-        void *page = malloc(PAGE_SIZE);
-        rc = ixFileHandle.getFileHandle().readPage(0, page);
+    else {
+        // page 0 is the root-leaf page or points to the root, it is read into the first page of the path before the root takes it.
+        auto *path = (IndexPath *)malloc(sizeof(IndexPath));
+        char *page = path->pages[0];
+        int pageFlag = EMPTY_FLAG;
+        rc = readNode(ixFileHandle, ROOT_PAGE, page, 0);
+        memcpy(&pageFlag, page, sizeof(int));
         if(rc != 0){
             // std::cout << "[Error] insertEntry -> fail to get the read the root-leaf page." << std::endl;
-            return -1;
         }
-
-        leafPageDirectory leafDirectory;
-        memcpy(&leafDirectory, page, LEAF_DIR_SIZE);
-
-        if (requiredLength <= leafDirectory.freeSpace) {
-            // std::cout << "Insert into root-leaf page." << std::endl;
-            rc = insertEntrytoNodeWithoutSplitting(ixFileHandle, ROOT_PAGE, LEAF_FLAG, page, attribute, key, &rid, sizeof(rid));
-            if(rc != 0 ){
-                // std::cout << "[Error] insertEntry -> fail to insertEntrytoNodeWithoutSplitting." << std::endl;
-                return -1;
+        else if(pageFlag == LEAF_FLAG){
+//            std::cout << "Insert into rootLeaf B+ tree" << std::endl;
+            leafPageDirectory leafDirectory;
+            memcpy(&leafDirectory, page, LEAF_DIR_SIZE);
+            if (getRequiredLength(attribute, nodeKey, getLeafGrowth(ixFileHandle, sizeOfData)) <= leafDirectory.freeSpace) {
+                // std::cout << "Insert into root-leaf page." << std::endl;
+                rc = insertEntrytoNodeWithoutSplitting(ixFileHandle, ROOT_PAGE, LEAF_FLAG, page, attribute, nodeKey, data, sizeOfData);
+            }
+            else {
+                // std::cout << "split the root leaf node and insert." << std::endl;
+                rc = splitRootLeafPage(ixFileHandle, attribute, nodeKey, data, sizeOfData);
             }
         }
         else {
-            // std::cout << "split the root leaf node and insert." << std::endl;
-            rc = splitRootLeafPage(ixFileHandle, attribute, key, rid);
-            if(rc != 0 ){
-                // std::cout << "[Error] insertEntry -> fail to splitRootLeafPage." << std::endl;
-                return -1;
-            }
+//            std::cout << "Insert into normal B+ tree" << std::endl;
+            unsigned rootPageNum = 0;
+            memcpy(&rootPageNum, page + 4, sizeof(unsigned));
+            rc = insertion(ixFileHandle, attribute, rootPageNum, nodeKey, data, sizeOfData, *path, latchedNodes);
         }
+        free(path);
+        if(rc != 0){
+            // std::cout << "[Error]: IndexManager::insertEntry -> fail to insert" << std::endl;
+            unlatchNodes(ixFileHandle, latchedNodes, latchedNodes.size());
+            return -1;
+        }
+    }
 
-        free(page);
+    // every split appends a page and changes inner nodes or page 0, the nodes it changed are still latched.
+    // (a new overflow page of a posting list starts a new version as well, which is harmless)
+    if(ixFileHandle.getFileHandle().getNumberOfPages() != numOfPages){
+        newTreeVersion(ixFileHandle);
     }
-    else {
-//        assert(numOfPages >= 4);
-//        std::cout << "Insert into normal B+ tree" << std::endl;
 
-        // we search from the root
-        void *rootPtr = malloc(PAGE_SIZE);
-        ixFileHandle.getFileHandle().readPage(0, rootPtr);
+    // inside a transaction the insert ends in the log while its nodes are still latched.
+    rc = logLeafInsert(ixFileHandle, attribute, key, data, sizeOfData);
+    unlatchNodes(ixFileHandle, latchedNodes, latchedNodes.size());
+    return rc;
+}
 
-        unsigned rootPageNum = 0;
+int IndexManager::getLeafGrowth(IXFileHandle &ixFileHandle, int sizeOfData) const{
+    return ixFileHandle.isClustered() ? POSTING_HEADER_SIZE + sizeOfData : POSTING_MAX_GROWTH;
+}
 
-        memcpy(&rootPageNum, (char *)rootPtr + 4, sizeof(unsigned));
+RC IndexManager::logLeafInsert(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const void *data, int sizeOfData){
+    if(ixFileHandle.isClustered()){
+        // the key is enough to delete the row again
+        return LogManager::instance().logRowOperation(OP_ROW_INSERT, ixFileHandle.getFileHandle(), attribute, key, getKeyLength(attribute, key));
+    }
+    return LogManager::instance().logEntryOperation(OP_ENTRY_INSERT, ixFileHandle.getFileHandle(), attribute, key,
+                                                    getKeyLength(attribute, key), *(const RID *)data);
+}
 
-        void *splitKey = malloc(PAGE_SIZE);
-        void *splitData = malloc(sizeof(unsigned));
-        void *_key = malloc(PAGE_SIZE);
+RC IndexManager::insertIntoLeaf(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const void *data, int sizeOfData,
+                                bool &inserted){
+    inserted = false;
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    unsigned numOfPages = fileHandle.getNumberOfPages();
+    if(numOfPages == 0){
+        return 0;
+    }
+    
+    char normalized[sizeof(unsigned)];
+    const void *nodeKey = normalizeKey(attribute, key, normalized);
+    auto *page = (char *)malloc(PAGE_SIZE);
+    RC rc = 0;
+    for(int attempt = 0; attempt < IX_OPTIMISTIC_RETRIES && !inserted; attempt++){
+        unsigned pageNum;
+        RWLatch *latch;
+        unsigned long long version;
+        if(descendToLeaf(ixFileHandle, attribute, nodeKey, false, pageNum, page, latch, version) != 0){
+            break;
+        }
+        // the same room insertion(...) asks of a leaf which is not split
+        leafPageDirectory directory;
+        memcpy(&directory, page, LEAF_DIR_SIZE);
+        if(directory.flag != LEAF_FLAG ||
+           directory.freeSpace < getRequiredLength(attribute, key, getLeafGrowth(ixFileHandle, sizeOfData)) - getLeafPrefixLength(page, attribute)){
+            break;
+        }
+        if(!latch->upgrade(version)){
+            // a writer changed the leaf since it was read, it may even hold other keys now
+            latch->unlockExclusive();
+            continue;
+        }
+        rc = insertEntrytoNodeWithoutSplitting(ixFileHandle, pageNum, LEAF_FLAG, page, attribute, nodeKey, data, sizeOfData);
+        // a posting list may have taken an overflow page
+        if(fileHandle.getNumberOfPages() != numOfPages){
+            newTreeVersion(ixFileHandle);
+        }
+        if(rc == 0){
+            rc = logLeafInsert(ixFileHandle, attribute, key, data, sizeOfData);
+        }
+        latch->unlockExclusive();
+        inserted = true;
+    }
+    free(page);
+    return rc;
+}
+
+RC IndexManager::insertion(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned rootPageNum, const void *key,
+        const void *data, int sizeOfData, IndexPath &path, std::vector<unsigned> &latchedNodes){
+    // descend to the leaf with latch crabbing: latch the node, if it can't split the ancestors won't change, release them.
+    unsigned curNode = rootPageNum;
+    int leafGrowth = getLeafGrowth(ixFileHandle, sizeOfData);
+    int pageFlag;
+    path.height = 0;
+    // the separators around the leaf, see LEAF_PREFIX_SIZE. They point into the copies of the path.
+    const char *lowFence = NULL, *highFence = NULL;
+    while(true){
+        if(path.height == IX_MAX_HEIGHT){
+            // std::cout << "[Error] insertion -> the tree is higher than IX_MAX_HEIGHT." << std::endl;
+            return -1;
+        }
+        ixFileHandle.getFileHandle().getLatch(curNode).lockExclusive();
+        latchedNodes.push_back(curNode);
         
-        if(attribute.type == TypeInt || attribute.type == TypeReal){
-            memcpy(_key, key, 4);
+        char *page = path.pages[path.height];
+        path.pageNums[path.height] = curNode;
+        path.height++;
+        if(readNode(ixFileHandle, curNode, page, path.height) != 0){
+            // std::cout << "[Error] Can't read the curNode in insertion()." << std::endl;
+            return -1;
         }
-        else{
-            int length;
-            memcpy(&length, key, sizeof(int));
-            memcpy(_key, key, sizeof(int)+length);
+        if(isSafeNode(attribute, page, leafGrowth)){
+            unlatchNodes(ixFileHandle, latchedNodes, latchedNodes.size() - 1);
         }
         
-        bool splitFlag = true;
-        rc = insertion(ixFileHandle, attribute, rootPageNum, _key, rid, splitKey, splitData, splitFlag);
-        if(rc != 0){
-            // std::cout << "[Error]: IndexManager::insertEntry -> fail to insert" << std::endl;
+        memcpy(&pageFlag, page, sizeof(int));
+        if(pageFlag == LEAF_FLAG){
+            break;
+        }
+        if(pageFlag != IM_FLAG && pageFlag != ROOT_FLAG){
+            // std::cout << "[Error] wrong pageFlag curNode in insertion()." << std::endl;
+            return -1;
+        }
+        // choose subtree
+        int keyIndex, numOfRecords;
+        getNextNode(page, curNode, attribute, key, &keyIndex);
+        memcpy(&numOfRecords, page + 2 * sizeof(int), sizeof(int));
+        if(keyIndex > 0){
+            lowFence = page + getKeyOffset(page, keyIndex - 1);
+        }
+        if(keyIndex < numOfRecords){
+            highFence = page + getKeyOffset(page, keyIndex);
+        }
+    }
+    
+    // insert <key, rid> (<key, row> in a clustered tree) into the leaf, then <split key, new page> into the parent as long as
+    // the child split. A split only reaches latched nodes: the first safe node on the way up has room for it.
+    const void *insertKey = key;
+    const void *insertData = data;
+    for(int i = path.height - 1; i >= 0; i--){
+        char *page = path.pages[i];
+        memcpy(&pageFlag, page, sizeof(int));
+        pageFlag = pageFlag == LEAF_FLAG ? LEAF_FLAG : IM_FLAG;
+        
+        int freeSpace;
+        memcpy(&freeSpace, page + sizeof(int), sizeof(int));
+        int requiredLength = pageFlag == LEAF_FLAG ? getRequiredLength(attribute, insertKey, leafGrowth) - getLeafPrefixLength(page, attribute)
+                                                   : getRequiredLength(attribute, insertKey, sizeOfData);
+        if(freeSpace >= requiredLength){
+            // this node has space, usual case
+            return insertEntrytoNodeWithoutSplitting(ixFileHandle, path.pageNums[i], pageFlag, page, attribute, insertKey,
+                                                     insertData, sizeOfData);
+        }
+        if(i == 0 && pageFlag == IM_FLAG){
+            // the root keeps its page number, it is split in place.
+            return splitRootPage(ixFileHandle, attribute, path.pageNums[i], page, insertKey, insertData);
+        }
+        
+        // split this node, the key and page number to insert into the parent go to the buffers the child has not used
+        char *splitKey = path.splitKeys[i % 2];
+        unsigned &newPageNum = path.newPageNums[i % 2];
+        if(insertEntrytoNodeWithSplitting(ixFileHandle, pageFlag, path.pageNums[i], newPageNum, page, splitKey, attribute,
+                                          insertKey, insertData, sizeOfData, lowFence, highFence) != 0){
+            // std::cout << "[Error] insertion -> insertEntrytoNodeWithSplitting." << std::endl;
             return -1;
         }
+        insertKey = splitKey;
+        insertData = &newPageNum;
+        sizeOfData = sizeof(unsigned);
+    }
+    // only a leaf root lives on page 0, the tree above rootPageNum never splits
+    return -1;
+}
+
 
-        free(rootPtr);
-        free(splitKey);
-        free(splitData);
-        free(_key);
+bool IndexManager::isSafeNode(const Attribute &attribute, const void *page, int leafGrowth) const{
+    int pageFlag, freeSpace;
+    memcpy(&pageFlag, page, sizeof(int));
+    memcpy(&freeSpace, (char *)page + sizeof(int), sizeof(int));
+    
+    int maxKeyLength = attribute.type == TypeVarChar ? (int)(sizeof(int) + attribute.length) : (int)sizeof(int);
+    if(pageFlag == LEAF_FLAG){
+        return freeSpace >= maxKeyLength + leafGrowth + IX_SLOT_SIZE;
     }
+    return freeSpace >= maxKeyLength + (int)sizeof(unsigned) + IX_SLOT_SIZE;
+}
 
+bool IndexManager::isUnderflow(const void *page) const{
+    int pageFlag, freeSpace;
+    memcpy(&pageFlag, page, sizeof(int));
+    memcpy(&freeSpace, (char *)page + sizeof(int), sizeof(int));
+    int usedSpace = PAGE_SIZE - freeSpace - (pageFlag == LEAF_FLAG ? LEAF_DIR_SIZE : IM_DIR_SIZE);
+    return usedSpace < IX_UNDERFLOW;
+}
+
+bool IndexManager::isSafeForDelete(const Attribute &attribute, const void *page, bool isRoot) const{
+    int freeSpace, numOfRecords;
+    memcpy(&freeSpace, (char *)page + sizeof(int), sizeof(int));
+    memcpy(&numOfRecords, (char *)page + 2 * sizeof(int), sizeof(int));
+    
+    int maxKeyLength = attribute.type == TypeVarChar ? (int)(sizeof(int) + attribute.length) : (int)sizeof(int);
+    if(freeSpace < maxKeyLength + IX_SLOT_SIZE){
+        return false;
+    }
+    if(isRoot){
+        return numOfRecords >= 2;
+    }
+    int usedSpace = PAGE_SIZE - freeSpace - IM_DIR_SIZE;
+    return usedSpace - (maxKeyLength + (int)sizeof(unsigned) + IX_SLOT_SIZE) >= IX_UNDERFLOW;
+}
+
+RC IndexManager::forEachPagePointer(void *page, const Attribute &attribute,
+                                      const std::function<void(unsigned &pageNum, bool owned)> &visit) const{
+    int pageFlag;
+    memcpy(&pageFlag, page, sizeof(int));
+    char *data = (char *)page;
+    unsigned pageNum;
+    if(pageFlag == ROOT_PTR_FLAG){
+        memcpy(&pageNum, data+sizeof(int), sizeof(unsigned));
+        visit(pageNum, true);
+        memcpy(data+sizeof(int), &pageNum, sizeof(unsigned));
+    }
+    else if(pageFlag == ROOT_FLAG || pageFlag == IM_FLAG){
+        imPageDirectory directory;
+        memcpy(&directory, page, IM_DIR_SIZE);
+        memcpy(&pageNum, data+IM_DIR_SIZE, sizeof(unsigned));
+        visit(pageNum, true);
+        memcpy(data+IM_DIR_SIZE, &pageNum, sizeof(unsigned));
+        for(int index = 0; index < directory.numOfRecords; index++){
+            int offset = getKeyOffset(page, index);
+            offset += getKeyLength(attribute, data+offset);
+            memcpy(&pageNum, data+offset, sizeof(unsigned));
+            visit(pageNum, true);
+            memcpy(data+offset, &pageNum, sizeof(unsigned));
+        }
+    }
+    else if(pageFlag == LEAF_FLAG){
+        leafPageDirectory directory;
+        memcpy(&directory, page, LEAF_DIR_SIZE);
+        if(directory.nextNode != -1){
+            pageNum = directory.nextNode;
+            visit(pageNum, false);
+            directory.nextNode = pageNum;
+            memcpy(page, &directory, LEAF_DIR_SIZE);
+        }
+        if(directory.prevNode != -1){
+            pageNum = directory.prevNode;
+            visit(pageNum, false);
+            directory.prevNode = pageNum;
+            memcpy(page, &directory, LEAF_DIR_SIZE);
+        }
+        for(int index = 0; index < directory.numOfRecords; index++){
+            int offset = getKeyOffset(page, index);
+            char *posting = data+offset+getKeyLength(attribute, data+offset);
+            unsigned short length;
+            memcpy(&length, posting, POSTING_HEADER_SIZE);
+            if(length == POSTING_OVERFLOW){
+                memcpy(&pageNum, posting+POSTING_HEADER_SIZE, sizeof(unsigned));
+                visit(pageNum, true);
+                memcpy(posting+POSTING_HEADER_SIZE, &pageNum, sizeof(unsigned));
+            }
+        }
+    }
+    else if(pageFlag == POSTING_FLAG){
+        postingPageDirectory directory;
+        memcpy(&directory, page, POSTING_DIR_SIZE);
+        if(directory.nextPage != -1){
+            pageNum = directory.nextPage;
+            visit(pageNum, true);
+            directory.nextPage = pageNum;
+            memcpy(page, &directory, POSTING_DIR_SIZE);
+        }
+    }
     return 0;
 }
 
-RC IndexManager::insertion(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned curNode, const void *key,
-        const RID &rid, void *splitKey, void *splitData, bool &splitFlag){
-    // read this curNode
-    void *page = malloc(PAGE_SIZE);
-    if (ixFileHandle.getFileHandle().readPage(curNode, page) == 0) {
-        int pageFlag;
-        memcpy(&pageFlag, page, sizeof(int));
+RC IndexManager::unlatchNodes(IXFileHandle &ixFileHandle, std::vector<unsigned> &latchedNodes, size_t numOfNodes){
+    for(size_t i = 0; i < numOfNodes; i++){
+        ixFileHandle.getFileHandle().getLatch(latchedNodes[i]).unlockExclusive();
+    }
+    latchedNodes.erase(latchedNodes.begin(), latchedNodes.begin() + numOfNodes);
+    return 0;
+}
 
-        // First, we check this node is leaf or not
-        if (pageFlag == IM_FLAG || pageFlag == ROOT_FLAG) {
-            // choose subtree
-            unsigned nextNode = 0;
-            getNextNode(ixFileHandle, curNode, nextNode, attribute, key);
+/*
+ * This method is used to search the entry in leafNode, that has the value greater or greater-equal to key, given inclusive
+ * return offset as the location.
+ */
+RC IndexManager::searchEntry(IXFileHandle &ixFileHandle, int &pageNum, int &offset, int &recordId,  const Attribute &attribute, const void *key, bool inclusive,
+                             void *leafPage, bool lastLeaf, unsigned long long *leafVersion){
 
-            // recursively, insert entry
-            insertion(ixFileHandle, attribute, nextNode, key, rid, splitKey, splitData, splitFlag);
+    unsigned numOfPages = ixFileHandle.getFileHandle().getNumberOfPages();
 
-            if (!splitFlag) {
-                // usual case; didn't split child
-                free(page);
-                return 0;
+//    std::cout << "We are in searchEntry(). " << std::endl;
+
+    if(numOfPages == 0){
+        // std::cout << "[Error]: search inside a empty B+tree." << std::endl;
+        return -1;
+    }
+    
+    void *page = malloc(PAGE_SIZE);
+    unsigned curNode;
+    RWLatch *latch;
+    unsigned long long version;
+    if(descendToLeaf(ixFileHandle, attribute, key, lastLeaf, curNode, page, latch, version) != 0){
+        // std::cout << "searchEntry():  Can't read the page. " << std::endl;
+        free(page);
+        return -1;
+    }
+    pageNum = curNode;
+
+    RC rc = 0;
+    if(key == NULL && lastLeaf){
+        memcpy(&recordId, (char *)page+2*sizeof(int), sizeof(int));
+        offset = getNodeDataEnd(page);
+    }
+    else{
+        rc = searchInsideLeafNode(page, offset, recordId, attribute, key, inclusive);
+    }
+    if(leafPage != NULL){
+        memcpy(leafPage, page, PAGE_SIZE);
+    }
+    if(leafVersion != NULL){
+        *leafVersion = version;
+    }
+    free(page);
+    
+    if(rc != 0){
+        // std::cout << "[Error]: searchEntry -> can't find a <key, data>." << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+RC IndexManager::descendToLeaf(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, bool lastLeaf, unsigned &pageNum,
+                               void *page, RWLatch *&latch, unsigned long long &version){
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    for(int attempt = 0; attempt <= IX_OPTIMISTIC_RETRIES; attempt++){
+        // the last descent is latch crabbing in shared mode: latch the child, then release the parent.
+        bool shared = attempt == IX_OPTIMISTIC_RETRIES;
+        
+        // page 0 is the root-leaf node, or points to the root
+        unsigned curNode = ROOT_PAGE, nextNode;
+        latch = &fileHandle.getLatch(ROOT_PAGE);
+        if(shared){
+            latch->lockShared();
+        }
+        version = latch->readVersion();
+        RC rc = readNode(ixFileHandle, ROOT_PAGE, page, 0);
+        bool valid = latch->validate(version);
+        int level = 0, pageFlag;
+        memcpy(&pageFlag, page, sizeof(int));
+        while(valid && rc == 0 && (pageFlag == ROOT_PTR_FLAG || getNextNode(page, nextNode, attribute, key) == 0)){
+            if(pageFlag == ROOT_PTR_FLAG){
+                memcpy(&nextNode, (char *)page+4, sizeof(unsigned));
             }
-            else {
-                // we split child, must insert *newchildentry
-                // First, we check if we could put splitkey in this node
-                imPageDirectory imDirectory;
-                memcpy(&imDirectory, page, IM_DIR_SIZE);
-                int requiredLength = getRequiredLength(attribute, splitKey, sizeof(unsigned));
-    
-//                int data, pageNum;
-//                memcpy(&data, splitKey, sizeof(int));
-//                memcpy(&pageNum, splitData, sizeof(int));
-//                std::cout << "Insert into im page" << std::endl;
-//                std::cout << "splitKey is " << data << "; page num is " << pageNum << std::endl;
-
-                if (imDirectory.freeSpace >= requiredLength) {
-                    // this Node has space, put *newchildentry on it, set newchildentry to null, return.
-                    // IM_FLAG OR ROOT_FLAG both OK
-                    splitFlag = false;
-                    insertEntrytoNodeWithoutSplitting(ixFileHandle, curNode, IM_FLAG, page, attribute, splitKey,
-                                                      splitData, sizeof(unsigned));
-                    
-                    free(page);
-                    return 0;
-                }
-                else {
-                    splitFlag = true;
-                    if (pageFlag == ROOT_FLAG) {
-                        splitRootPage(ixFileHandle, attribute, curNode, splitKey, splitData);
-//                        std::cout << "[Warning] We split the root page." << std::endl;
-
-                        // it should be the top one, no need to set childptr.
-                        free(page);
-                        return 0;
-                    }
-                    else {
-                        // IM_PAGE
-                        unsigned newimPageNum = 0;
-                        void *splitImKey = malloc(PAGE_SIZE);
-                        insertEntrytoNodeWithSplitting(ixFileHandle, IM_FLAG, curNode, newimPageNum, page,
-                                                       splitImKey, attribute, splitKey, splitData, sizeof(unsigned));
-
-                        memcpy(splitKey, splitImKey, PAGE_SIZE);
-                        memcpy(splitData, &newimPageNum, sizeof(unsigned));
-    
-//                        memcpy(&data, splitKey, sizeof(int));
-//                        memcpy(&pageNum, splitData, sizeof(int));
-//                        std::cout << "split im page" << std::endl;
-//                        std::cout << "splitKey is " << data << "; curNode is " << curNode << "; new page num is " << pageNum << std::endl;
-                        
-                        free(page);
-                        return 0;
-                    }
-                }
+            else if(key == NULL && lastLeaf){
+                // the last pointer of the node
+                memcpy(&nextNode, (char *)page+getNodeDataEnd(page)-sizeof(unsigned), sizeof(unsigned));
             }
-        }
-        else if (pageFlag == LEAF_FLAG) {
-            // just insert the key and data. First check the freespace.
-            leafPageDirectory leafDirectory;
-            memcpy(&leafDirectory, page, LEAF_DIR_SIZE);
-            int requiredLength = getRequiredLength(attribute, key, sizeof(rid));
-
-            if (leafDirectory.freeSpace >= requiredLength) {
-                splitFlag = false;
-                //put entry on it, set newchildentry to null, and return
-                insertEntrytoNodeWithoutSplitting(ixFileHandle, curNode, LEAF_FLAG, page, attribute, key, &rid,
-                                                  sizeof(rid));
-                
-                free(page);
-                return 0;
-            } else {
-                // split the leaf
-//                std::cout << "***************  Split the leaf node  *******************" << std::endl;
-                splitFlag = true;
-                unsigned newLeafPageNum = 0;
-                insertEntrytoNodeWithSplitting(ixFileHandle, LEAF_FLAG, curNode, newLeafPageNum, page, splitKey,
-                                               attribute, key, &rid, sizeof(rid));
-                
-//                leafPageDirectory tempDirectory;
-//                memcpy(&tempDirectory, page, LEAF_DIR_SIZE);
-//                int data;
-//                memcpy(&data, splitKey, sizeof(int));
-//                std::cout << "Split leaf page" << std::endl;
-//                std::cout << "splitKey is " << data << "; curNode is " << curNode << "; next node is " << tempDirectory.nextNode << "; page num is " << newLeafPageNum << std::endl;
-                
-                memcpy(splitData, &newLeafPageNum, sizeof(unsigned));
-                free(page);
-                return 0;
+            RWLatch *childLatch = &fileHandle.getLatch(nextNode);
+            if(shared){
+                childLatch->lockShared();
+            }
+            unsigned long long childVersion = childLatch->readVersion();
+            valid = latch->validate(version);
+            if(shared){
+                latch->unlockShared();
+            }
+            latch = childLatch;
+            version = childVersion;
+            curNode = nextNode;
+            level++;
+            if(valid){
+                rc = readNode(ixFileHandle, curNode, page, level);
+                valid = latch->validate(version);
+                memcpy(&pageFlag, page, sizeof(int));
             }
         }
-        else {
-            // std::cout << "[Error] wrong pageFlag curNode in insertion()." << std::endl;
+        if(shared){
+            latch->unlockShared();
+        }
+        if(valid){
+            pageNum = curNode;
+            return rc;
+        }
+    }
+    return -1;
+}
+
+RC IndexManager::deleteEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid) {
+    if(ixFileHandle.isClustered()){
+        // std::cout << "[Error]: deleteEntry -> the leaves of a clustered tree hold rows, see deleteRow(...)." << std::endl;
+        return -1;
+    }
+    return removeLeafEntry(ixFileHandle, attribute, key, &rid);
+}
+
+RC IndexManager::deleteRow(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key) {
+    if(!ixFileHandle.isClustered()){
+        // std::cout << "[Error]: deleteRow -> not a clustered tree." << std::endl;
+        return -1;
+    }
+    return removeLeafEntry(ixFileHandle, attribute, key, NULL);
+}
+
+RC IndexManager::readRow(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, void *row, unsigned &rowLength) {
+    if(!ixFileHandle.isClustered() || ixFileHandle.getFileHandle().getNumberOfPages() == 0){
+        // std::cout << "[Error]: readRow -> not a clustered tree, or an empty one." << std::endl;
+        return -1;
+    }
+    char normalized[sizeof(unsigned)];
+    const void *nodeKey = normalizeKey(attribute, key, normalized);
+    
+    // the copy of the leaf of key, the row follows its key like a posting list
+    auto *page = (char *)malloc(PAGE_SIZE);
+    int pageNum, offset, recordId, numOfRecords;
+    RC rc = searchEntry(ixFileHandle, pageNum, offset, recordId, attribute, nodeKey, true, page);
+    memcpy(&numOfRecords, page + 2 * sizeof(int), sizeof(int));
+    if(rc != 0 || recordId >= numOfRecords || compareLeafKey(page, offset, attribute, nodeKey) != 0){
+        // std::cout << "[Error]: readRow -> there is no row of this key." << std::endl;
+        free(page);
+        return -1;
+    }
+    const char *posting = page + offset + getKeyLength(attribute, page + offset);
+    rowLength = getPostingLength(posting) - POSTING_HEADER_SIZE;
+    memcpy(row, posting + POSTING_HEADER_SIZE, rowLength);
+    free(page);
+    return 0;
+}
+
+RC IndexManager::removeLeafEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID *rid) {
+
+    int offset, recordId, pageNum;
+    if(ixFileHandle.getFileHandle().getNumberOfPages() == 0){
+//        std::cout << "[Error]: deleteEntry -> delete from an empty B+ tree." << std::endl;
+        return -1;
+    }
+    
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    auto *page = (char *)malloc(PAGE_SIZE);
+    leafPageDirectory directory;
+    char normalized[sizeof(unsigned)];
+    const void *nodeKey = normalizeKey(attribute, key, normalized);
+    
+    // descendToLeaf gives the leaf where the first <key, rid> pair whose key >= key is, without latching it.
+    // The leaf is latched in exclusive mode, if a writer latched it since it was read it may have been split, the entries
+    // only move to the right, so read and search it again from the start. Page 0 may even stop being the root-leaf, or the
+    // leaf may have been merged away (then the tree has a new version), search the tree again.
+    while(true){
+        unsigned version = getTreeVersion(ixFileHandle);
+        unsigned leafNum;
+        RWLatch *latch;
+        unsigned long long latchVersion;
+        if(descendToLeaf(ixFileHandle, attribute, nodeKey, false, leafNum, page, latch, latchVersion) != 0){
             free(page);
             return -1;
         }
+        pageNum = leafNum;
+        bool current = latch->upgrade(latchVersion);
+        if(!current){
+            fileHandle.readPage(pageNum, page);
+        }
+        memcpy(&directory, page, LEAF_DIR_SIZE);
+        if(directory.flag == LEAF_FLAG && (current || getTreeVersion(ixFileHandle) == version)){
+            break;
+        }
+        latch->unlockExclusive();
     }
-    else {
-        // std::cout << "[Error] Can't read the curNode in insertion()." << std::endl;
+    // binary search the first key >= key in this leaf
+    recordId = searchInsideNode(page, attribute, nodeKey, true);
+    
+    // the leaf may have been split meanwhile and key moved right, walk along the leaves, latch the next leaf before releasing this one.
+    while(recordId >= directory.numOfRecords && directory.nextNode != -1){
+        fileHandle.getLatch(directory.nextNode).lockExclusive();
+        fileHandle.getLatch(pageNum).unlockExclusive();
+        pageNum = directory.nextNode;
+        fileHandle.readPage(pageNum, page);
+        memcpy(&directory, page, LEAF_DIR_SIZE);
+        recordId = searchInsideNode(page, attribute, nodeKey, true);
+    }
+    offset = recordId < directory.numOfRecords ? getKeyOffset(page, recordId) : getNodeDataEnd(page);
+    
+    // remove rid from the posting list of key, then the entry if the list is empty. The row of a clustered tree goes at once.
+    bool empty = rid == NULL;
+    if(recordId >= directory.numOfRecords || compareLeafKey(page, offset, attribute, nodeKey) != 0 ||
+       (rid != NULL && deleteFromPostingList(ixFileHandle, page, recordId, attribute, *rid, empty) != 0)){
+//        std::cout << "[Error]: deleteEntry -> can't find such a <key, rid> pair." << std::endl;
+        fileHandle.getLatch(pageNum).unlockExclusive();
         free(page);
         return -1;
     }
+    // the log keeps the deleted row to insert it again
+    std::string row;
+    if(rid == NULL){
+        const char *posting = page + offset + getKeyLength(attribute, page + offset);
+        row.assign(posting + POSTING_HEADER_SIZE, getPostingLength(posting) - POSTING_HEADER_SIZE);
+    }
+    if(empty){
+        int entryLength = getLeafEntryLength(page, offset, attribute);
+        resizeLeafEntry(page, recordId, offset, entryLength, 0);
+        // the slots after this one move one slot back
+        memcpy(&directory, page, LEAF_DIR_SIZE);
+        for(int index = recordId; index < directory.numOfRecords - 1; index++){
+            setKeyOffset(page, index, getKeyOffset(page, index + 1));
+        }
+        setKeyOffset(page, directory.numOfRecords - 1, 0);
+        directory.freeSpace += IX_SLOT_SIZE;
+        directory.numOfRecords -= 1;
+        memcpy(page, &directory, LEAF_DIR_SIZE);
+    }
+    RC rc = fileHandle.writePage(pageNum, page);
+    if(rc == 0 && rid == NULL){
+        rc = LogManager::instance().logRowOperation(OP_ROW_DELETE, fileHandle, attribute, key, getKeyLength(attribute, key), row.data(),
+                                                    row.size());
+    }
+    else if(rc == 0){
+        rc = LogManager::instance().logEntryOperation(OP_ENTRY_DELETE, fileHandle, attribute, key, getKeyLength(attribute, key), *rid);
+    }
+    bool underflow = pageNum != ROOT_PAGE && isUnderflow(page);
+    fileHandle.getLatch(pageNum).unlockExclusive();
+    
+//    std::cout << "deleteEntry -> Delete " << recordId << "'th entry inside " << pageNum << " RID is : " << rid.pageNum << "; " << rid.slotNum <<  std::endl;
+    free(page);
+    
+    // the leaf is rebalanced from the root down, its latch has to be released first
+    if(rc == 0 && underflow){
+        rc = handleUnderflow(ixFileHandle, attribute, nodeKey);
+    }
+    return rc;
 }
 
+RC IndexManager::handleUnderflow(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key){
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    auto keyAt = [this, &attribute](const char *page, int index){
+        const char *key = page + getKeyOffset(page, index);
+        return std::string(key, getKeyLength(attribute, key));
+    };
+    auto childAt = [this, &attribute](const char *page, int index){
+        unsigned child;
+        int offset = index == 0 ? IM_DIR_SIZE : getKeyOffset(page, index - 1) + getKeyLength(attribute, page + getKeyOffset(page, index - 1));
+        memcpy(&child, page + offset, sizeof(unsigned));
+        return child;
+    };
+    
+    // page 0 only tells where the root is, the root never moves: page 0 is released once the root is latched.
+    auto *path = (IndexPath *)malloc(sizeof(IndexPath));
+    char *page = path->pages[0];
+    int pageFlag = EMPTY_FLAG;
+    fileHandle.getLatch(ROOT_PAGE).lockExclusive();
+    if(readNode(ixFileHandle, ROOT_PAGE, page, 0) == 0){
+        memcpy(&pageFlag, page, sizeof(int));
+    }
+    if(pageFlag != ROOT_PTR_FLAG){
+        // the root-leaf page has no sibling
+        fileHandle.getLatch(ROOT_PAGE).unlockExclusive();
+        free(path);
+        return 0;
+    }
+    unsigned curNode;
+    memcpy(&curNode, page+4, sizeof(unsigned));
+    std::vector<unsigned> latchedNodes;
+    fileHandle.getLatch(curNode).lockExclusive();
+    fileHandle.getLatch(ROOT_PAGE).unlockExclusive();
+    latchedNodes.push_back(curNode);
+    
+    // descend to the leaf of key with latch crabbing: once a node is safe for a delete, its ancestors are released.
+    // childIndex[i] is the pointer of node i taken to node i+1, lowFences[i] and highFences[i] the fence keys of node i (empty if none).
+    int childIndex[IX_MAX_HEIGHT];
+    std::vector<std::string> lowFences(IX_MAX_HEIGHT), highFences(IX_MAX_HEIGHT);
+    RC rc = 0;
+    path->height = 0;
+    while(true){
+        page = path->pages[path->height];
+        path->pageNums[path->height] = curNode;
+        path->height++;
+        if(readNode(ixFileHandle, curNode, page, path->height) != 0){
+            // std::cout << "[Error] handleUnderflow -> fail to read a node." << std::endl;
+            rc = -1;
+            break;
+        }
+        memcpy(&pageFlag, page, sizeof(int));
+        if(pageFlag == LEAF_FLAG){
+            break;
+        }
+        if((pageFlag != IM_FLAG && pageFlag != ROOT_FLAG) || path->height == IX_MAX_HEIGHT){
+            // std::cout << "[Error] handleUnderflow -> wrong pageFlag." << std::endl;
+            rc = -1;
+            break;
+        }
+        if(isSafeForDelete(attribute, page, path->height == 1)){
+            unlatchNodes(ixFileHandle, latchedNodes, latchedNodes.size() - 1);
+        }
+        
+        int level = path->height - 1, numOfRecords;
+        memcpy(&numOfRecords, page + 2 * sizeof(int), sizeof(int));
+        getNextNode(page, curNode, attribute, key, &childIndex[level]);
+        lowFences[level+1] = childIndex[level] > 0 ? keyAt(page, childIndex[level] - 1) : lowFences[level];
+        highFences[level+1] = childIndex[level] < numOfRecords ? keyAt(page, childIndex[level]) : highFences[level];
+        fileHandle.getLatch(curNode).lockExclusive();
+        latchedNodes.push_back(curNode);
+    }
+    
+    // walk the path back up while a node underflows, each one is merged with a sibling or takes entries from it
+    char *sibling = (char *)malloc(PAGE_SIZE);
+    bool changed = false;
+    for(int i = path->height - 1; i > 0 && rc == 0; i--){
+        page = path->pages[i];
+        char *parent = path->pages[i-1];
+        int numOfKeys;
+        memcpy(&numOfKeys, parent + 2 * sizeof(int), sizeof(int));
+        if(!isUnderflow(page) || numOfKeys == 0){
+            // the only child of the root has no sibling
+            break;
+        }
+        int position = childIndex[i-1];
+        bool rightSibling = position < numOfKeys;
+        int sepIndex = rightSibling ? position : position - 1;
+        unsigned siblingNum = childAt(parent, rightSibling ? position + 1 : position - 1);
+        
+        // siblings are latched from left to right like deleteEntry walks the leaves, the parent keeps them from splitting meanwhile.
+        // A leaf may still have changed while it was not latched.
+        if(!rightSibling){
+            fileHandle.getLatch(path->pageNums[i]).unlockExclusive();
+            fileHandle.getLatch(siblingNum).lockExclusive();
+            fileHandle.getLatch(path->pageNums[i]).lockExclusive();
+            fileHandle.readPage(path->pageNums[i], page);
+        }
+        else{
+            fileHandle.getLatch(siblingNum).lockExclusive();
+        }
+        latchedNodes.push_back(siblingNum);
+        if(!isUnderflow(page) || fileHandle.readPage(siblingNum, sibling) != 0){
+            break;
+        }
+        
+        unsigned leftPageNum = rightSibling ? path->pageNums[i] : siblingNum;
+        unsigned rightPageNum = rightSibling ? siblingNum : path->pageNums[i];
+        char *leftPage = rightSibling ? page : sibling;
+        char *rightPage = rightSibling ? sibling : page;
+        std::string lowFence = rightSibling ? lowFences[i] : (sepIndex > 0 ? keyAt(parent, sepIndex - 1) : lowFences[i-1]);
+        std::string highFence = !rightSibling ? highFences[i] : (sepIndex + 1 < numOfKeys ? keyAt(parent, sepIndex + 1) : highFences[i-1]);
+        bool merged = false;
+        rc = rebalanceNodes(ixFileHandle, attribute, path->pageNums[i-1], parent, sepIndex, leftPageNum, leftPage, rightPageNum, rightPage,
+                            lowFence.empty() ? NULL : lowFence.data(), highFence.empty() ? NULL : highFence.data(), merged);
+        changed = true;
+        if(!merged){
+            break;
+        }
+        
+        // the root keeps its page number: left with a single intermediate child, it takes over its entries and the tree gets lower.
+        memcpy(&numOfKeys, parent + 2 * sizeof(int), sizeof(int));
+        memcpy(&pageFlag, leftPage, sizeof(int));
+        if(i == 1 && numOfKeys == 0 && pageFlag != LEAF_FLAG && rc == 0){
+            std::vector<std::string> keys, data;
+            int link;
+            readNodeEntries(leftPage, attribute, keys, data, link);
+            rc = writeNodeEntries(ROOT_FLAG, parent, attribute, keys, data, 0, keys.size(), link, NULL, 0);
+            if(rc == 0){
+                rc = fileHandle.writePage(path->pageNums[0], parent);
+            }
+            if(rc == 0){
+                rc = freePage(ixFileHandle, leftPageNum);
+            }
+        }
+    }
+    
+    // the nodes are still latched when the copies of the tree become stale
+    if(changed){
+        newTreeVersion(ixFileHandle);
+    }
+    unlatchNodes(ixFileHandle, latchedNodes, latchedNodes.size());
+    free(sibling);
+    free(path);
+    return rc;
+}
 
-/*
- * This method is used to search the entry in leafNode, that has the value greater or greater-equal to key, given inclusive
- * return offset as the location.
- */
-RC IndexManager::searchEntry(IXFileHandle &ixFileHandle, int &pageNum, int &offset, int &recordId,  const Attribute &attribute, const void *key, bool inclusive){
+RC IndexManager::rebalanceNodes(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned parentPageNum, void *parent, int sepIndex,
+                                unsigned leftPageNum, void *leftPage, unsigned rightPageNum, void *rightPage,
+                                const void *lowFence, const void *highFence, bool &merged){
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    int pageFlag, parentFlag;
+    memcpy(&pageFlag, leftPage, sizeof(int));
+    memcpy(&parentFlag, parent, sizeof(int));
+    bool leaf = pageFlag == LEAF_FLAG;
+    bool varChar = leaf && attribute.type == TypeVarChar;
+    
+    // all the entries of both nodes in key order, in an im node the separator comes down between them with P0 of the right node
+    std::vector<std::string> keys, data, rightKeys, rightData, parentKeys, parentData;
+    int leftLink, rightLink, parentLink;
+    readNodeEntries(leftPage, attribute, keys, data, leftLink);
+    readNodeEntries(rightPage, attribute, rightKeys, rightData, rightLink);
+    readNodeEntries(parent, attribute, parentKeys, parentData, parentLink);
+    if(!leaf){
+        keys.push_back(parentKeys[sepIndex]);
+        data.emplace_back((char *)&rightLink, sizeof(unsigned));
+    }
+    keys.insert(keys.end(), rightKeys.begin(), rightKeys.end());
+    data.insert(data.end(), rightData.begin(), rightData.end());
+    
+    char *newLeft = (char *)malloc(PAGE_SIZE);
+    char *newRight = (char *)malloc(PAGE_SIZE);
+    char *newParent = (char *)malloc(PAGE_SIZE);
+    RC rc = 0;
+    merged = false;
+    leafPageDirectory leftDirectory;
+    memcpy(&leftDirectory, leftPage, LEAF_DIR_SIZE);
+    int leftPrevLink = leaf ? leftDirectory.prevNode : -1;
+    
+    // 1. merge: the entries fit in the left node, the parent loses the separator and the pointer to the right node.
+    // A merged VARCHAR leaf lies between the fences of both, its prefix is their common prefix.
+    int prefixLength = varChar ? getCommonPrefixLength(lowFence, highFence) : 0;
+    const char *prefix = prefixLength > 0 ? (const char *)lowFence + sizeof(int) : NULL;
+    if(writeNodeEntries(pageFlag, newLeft, attribute, keys, data, 0, keys.size(), leaf ? rightLink : leftLink, prefix, prefixLength,
+                        leftPrevLink) == 0){
+        parentKeys.erase(parentKeys.begin() + sepIndex);
+        parentData.erase(parentData.begin() + sepIndex);
+        rc = writeNodeEntries(parentFlag, newParent, attribute, parentKeys, parentData, 0, parentKeys.size(), parentLink, NULL, 0);
+        if(rc == 0){
+            memcpy(leftPage, newLeft, PAGE_SIZE);
+            memcpy(parent, newParent, PAGE_SIZE);
+            rc = fileHandle.writePage(leftPageNum, leftPage);
+        }
+        if(rc == 0){
+            rc = fileHandle.writePage(parentPageNum, parent);
+        }
+        if(rc == 0 && leaf && rightLink != -1){
+            // the leaf after the right one now comes after the left one
+            rc = setPrevNode(ixFileHandle, rightLink, leftPageNum);
+        }
+        if(rc == 0){
+            rc = freePage(ixFileHandle, rightPageNum);
+        }
+        merged = true;
+        free(newLeft);
+        free(newRight);
+        free(newParent);
+        return rc;
+    }
+    
+    // 2. redistribute: split the entries where both halves get about the same bytes,
+    // the entry at split goes up as the new separator of an im node, a leaf pushes up a short separator before it.
+    size_t numOfEntries = keys.size();
+    size_t first = 1, last = leaf ? numOfEntries - 1 : numOfEntries - 2;
+    if(numOfEntries < 3 || last < first){
+        free(newLeft);
+        free(newRight);
+        free(newParent);
+        return 0;
+    }
+    std::vector<int> sizes(numOfEntries);
+    int total = 0;
+    for(size_t i = 0; i < numOfEntries; i++){
+        sizes[i] = keys[i].size() + data[i].size() + IX_SLOT_SIZE;
+        total += sizes[i];
+    }
+    size_t split = first;
+    int leftSize = 0, bestDifference = INT_MAX;
+    for(size_t i = 0; i <= last; i++){
+        int rightSize = total - leftSize - (leaf ? 0 : sizes[i]);
+        if(i >= first && std::abs(leftSize - rightSize) < bestDifference){
+            bestDifference = std::abs(leftSize - rightSize);
+            split = i;
+        }
+        leftSize += sizes[i];
+    }
+    std::string separator = keys[split];
+    if(varChar){
+        separator.resize(PAGE_SIZE);
+        getShortSeparator(keys[split-1].data(), keys[split].data(), &separator[0]);
+        separator.resize(getKeyLength(attribute, separator.data()));
+    }
+    int leftPrefixLength = varChar ? getCommonPrefixLength(lowFence, separator.data()) : 0;
+    int rightPrefixLength = varChar ? getCommonPrefixLength(separator.data(), highFence) : 0;
+    size_t rightBegin = leaf ? split : split + 1;
+    int newRightLink = rightLink;
+    if(!leaf){
+        memcpy(&newRightLink, data[split].data(), sizeof(unsigned));
+    }
+    parentKeys[sepIndex] = separator;
+    if(writeNodeEntries(pageFlag, newLeft, attribute, keys, data, 0, split, leftLink, separator.data() + sizeof(int), leftPrefixLength,
+                        leftPrevLink) == 0 &&
+       writeNodeEntries(pageFlag, newRight, attribute, keys, data, rightBegin, numOfEntries, newRightLink,
+                        separator.data() + sizeof(int), rightPrefixLength, leftPageNum) == 0 &&
+       writeNodeEntries(parentFlag, newParent, attribute, parentKeys, parentData, 0, parentKeys.size(), parentLink, NULL, 0) == 0){
+        memcpy(leftPage, newLeft, PAGE_SIZE);
+        memcpy(rightPage, newRight, PAGE_SIZE);
+        memcpy(parent, newParent, PAGE_SIZE);
+        rc = fileHandle.writePage(leftPageNum, leftPage);
+        if(rc == 0){
+            rc = fileHandle.writePage(rightPageNum, rightPage);
+        }
+        if(rc == 0){
+            rc = fileHandle.writePage(parentPageNum, parent);
+        }
+    }
+    free(newLeft);
+    free(newRight);
+    free(newParent);
+    return rc;
+}
 
-    unsigned numOfPages = ixFileHandle.getFileHandle().getNumberOfPages();
+RC IndexManager::scan(IXFileHandle &ixFileHandle,
+                      const Attribute &attribute,
+                      const void *lowKey,
+                      const void *highKey,
+                      bool lowKeyInclusive,
+                      bool highKeyInclusive,
+                      IX_ScanIterator &ix_ScanIterator,
+                      bool reverse) {
 
-//    std::cout << "We are in searchEntry(). " << std::endl;
+    int pageNum, recordId,  offset = 0;
+    
+    if(!ixFileHandle.getFileHandle().getFile().is_open()){
+//        std::cout << "[Error]: can't scan a non-existing file." << std::endl;
+        return -1;
+    }
+    
+    // a scan of one key the Bloom filter rules out returns IX_EOF directly, like one of an empty B+ tree
+    bool ruledOut = false;
+    if(lowKey != NULL && highKey != NULL && lowKeyInclusive && highKeyInclusive && compareKey(attribute, lowKey, highKey) == 0){
+        std::shared_ptr<BloomFilter> filter = getBloomFilter(ixFileHandle.getFileHandle().getFileName());
+        ruledOut = filter && !filter->mayContain(HashIndexManager::instance().hashKey(attribute, lowKey));
+    }
+    
+    // INT and REAL bounds are searched for and kept by the iterator normalized, like the keys of the nodes
+    if(attribute.type != TypeVarChar){
+        char normalized[sizeof(unsigned)];
+        if(lowKey != NULL){
+            ix_ScanIterator.lowBound.assign((char *)normalizeKey(attribute, lowKey, normalized), sizeof(unsigned));
+            lowKey = ix_ScanIterator.lowBound.data();
+        }
+        if(highKey != NULL){
+            ix_ScanIterator.highBound.assign((char *)normalizeKey(attribute, highKey, normalized), sizeof(unsigned));
+            highKey = ix_ScanIterator.highBound.data();
+        }
+    }
+    if(ruledOut || ixFileHandle.getFileHandle().getNumberOfPages() == 0){
+        // empty B+ tree, the scan returns IX_EOF directly.
+        return ix_ScanIterator.initializeScanIterator(ixFileHandle, attribute, lowKey, highKey, lowKeyInclusive,
+                                                      highKeyInclusive, -1, LEAF_DIR_SIZE, 0, 0);
+    }
+    
+    // If we can't find a <key, rid> that satisfies the comparision
+    // we set the recordId = numOfRecords and offset is end of valid data which is the start of free space.
+    // version is the version of the latch of the leaf its copy belongs to.
+    void *leafPage = malloc(PAGE_SIZE);
+    unsigned long long version = 0;
+    if(!reverse){
+        searchEntry(ixFileHandle, pageNum, offset, recordId, attribute, lowKey, lowKeyInclusive, leafPage, false, &version);
+    }
+    else{
+        // the last key of the range is the one before the first key past highKey, it may be in the leaf before
+        searchEntry(ixFileHandle, pageNum, offset, recordId, attribute, highKey, !highKeyInclusive, leafPage, true, &version);
+        recordId--;
+    }
+    
+    // initialize the scanIterator with pageNum, offset and recordId which shows from where the scan should start,
+    // the scan starts from the copy of the leaf searchEntry has read.
+    RC rc = ix_ScanIterator.initializeScanIterator(ixFileHandle, attribute, lowKey, highKey, lowKeyInclusive,
+                                           highKeyInclusive, pageNum, offset, recordId, version, leafPage);
+    ix_ScanIterator.reverse = reverse;
+    free(leafPage);
+    
+    if(rc != 0){
+        // std::cout << "[Error]: scan -> initializeScanIterator" << std::endl;
+        return -1;
+    }
+    
+    return 0;
+    
+}
 
-    if(numOfPages == 0){
-        // std::cout << "[Error]: search inside a empty B+tree." << std::endl;
+RC IndexManager::prefixScan(IXFileHandle &ixFileHandle,
+                            const std::vector<Attribute> &attributes,
+                            const void *prefix,
+                            unsigned numOfPrefixAttributes,
+                            const void *lowKey,
+                            const void *highKey,
+                            bool lowKeyInclusive,
+                            bool highKeyInclusive,
+                            IX_ScanIterator &ix_ScanIterator){
+    if(numOfPrefixAttributes > attributes.size() ||
+       (numOfPrefixAttributes == attributes.size() && (lowKey != NULL || highKey != NULL))){
+        // std::cout << "[Error]: prefixScan -> no attribute after the prefix to bound." << std::endl;
+        return -1;
+    }
+    
+    // 1. encode the prefix, the keys which start with it lie between it and it followed by 0xFF
+    char *buffer = (char *)malloc(PAGE_SIZE);
+    int prefixLength = 0;
+    if(numOfPrefixAttributes > 0){
+        std::vector<Attribute> prefixAttributes(attributes.begin(), attributes.begin() + numOfPrefixAttributes);
+        encodeCompositeKey(prefixAttributes, prefix, buffer);
+        memcpy(&prefixLength, buffer, sizeof(int));
+    }
+    std::string low(buffer + sizeof(int), prefixLength);
+    std::string high = low;
+    
+    // 2. bound the next attribute, 0xFF after a value is above every key which has it
+    if(lowKey != NULL){
+        int length = encodeCompositeValue(attributes[numOfPrefixAttributes], lowKey, buffer);
+        low.append(buffer, length);
+        if(!lowKeyInclusive){
+            low.push_back((char) 0xFF);
+        }
+    }
+    if(highKey != NULL){
+        int length = encodeCompositeValue(attributes[numOfPrefixAttributes], highKey, buffer);
+        high.append(buffer, length);
+    }
+    if(highKey == NULL || highKeyInclusive){
+        high.push_back((char) 0xFF);
+    }
+    free(buffer);
+    
+    // 3. the bounds live in the iterator as VARCHAR keys, an empty low bound and a lone 0xFF are no bounds.
+    // No key has 0xFF after a whole value, so the low bound is inclusive and the high one exclusive.
+    int length = low.size();
+    ix_ScanIterator.lowBound.assign((char *)&length, sizeof(int));
+    ix_ScanIterator.lowBound += low;
+    length = high.size();
+    ix_ScanIterator.highBound.assign((char *)&length, sizeof(int));
+    ix_ScanIterator.highBound += high;
+    bool lowBounded = !low.empty();
+    bool highBounded = high.size() > 1;
+    return scan(ixFileHandle, getCompositeAttribute(attributes),
+                lowBounded ? ix_ScanIterator.lowBound.data() : NULL,
+                highBounded ? ix_ScanIterator.highBound.data() : NULL,
+                true, false, ix_ScanIterator);
+}
+
+RC IndexManager::probeEntries(IXFileHandle &ixFileHandle, const Attribute &attribute, const std::vector<std::string> &keys,
+                              std::vector<std::vector<RID>> &rids){
+    
+    if(!ixFileHandle.getFileHandle().getFile().is_open()){
+//        std::cout << "[Error]: can't probe a non-existing file." << std::endl;
+        return -1;
+    }
+    for(size_t i = 1; i < keys.size(); i++){
+        if(compareKey(attribute, keys[i-1].data(), keys[i].data()) > 0){
+            // std::cout << "[Error]: probeEntries -> the keys are not sorted." << std::endl;
+            return -1;
+        }
+    }
+    rids.assign(keys.size(), std::vector<RID>());
+    if(ixFileHandle.getFileHandle().getNumberOfPages() == 0){
+        return 0;
+    }
+    
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    std::shared_ptr<BloomFilter> filter = getBloomFilter(fileHandle.getFileName());
+    HashIndexManager &hashIndexManager = HashIndexManager::instance();
+    char *leafPage = (char *)malloc(PAGE_SIZE);
+    leafPageDirectory directory;
+    int pageNum = -1, offset, recordId, numOfWalks = 0;
+    unsigned version = 0;
+    bool searched = false;
+    RC rc = 0;
+    size_t i = 0;
+    char normalized[sizeof(unsigned)];
+    while(i < keys.size() && rc == 0){
+        if(filter && !filter->mayContain(hashIndexManager.hashKey(attribute, keys[i].data()))){
+            // absent, the copy of the leaf stays for the next key
+            i++;
+            continue;
+        }
+        const void *key = normalizeKey(attribute, keys[i].data(), normalized);
+        if(pageNum == -1){
+            // the version is taken before the search, like in scan(...)
+            version = getTreeVersion(ixFileHandle);
+            searchEntry(ixFileHandle, pageNum, offset, recordId, attribute, key, true, leafPage);
+            numOfWalks = 0;
+            searched = true;
+        }
+        else{
+            recordId = searchInsideNode(leafPage, attribute, key, true);
+        }
+        memcpy(&directory, leafPage, LEAF_DIR_SIZE);
+        if(directory.flag == LEAF_FLAG && recordId < directory.numOfRecords){
+            offset = getKeyOffset(leafPage, recordId);
+            if(compareLeafKey(leafPage, offset, attribute, key) == 0){
+                rc = readPostingList(ixFileHandle, leafPage + offset + getKeyLength(attribute, leafPage + offset), rids[i]);
+            }
+            searched = false;
+            i++;
+            continue;
+        }
+        if(searched || directory.flag != LEAF_FLAG || directory.nextNode == -1){
+            // the key is past the last key of the leaf the tree leads it to, or of the last leaf: it is absent
+            searched = false;
+            i++;
+            continue;
+        }
+        
+        // the key is past this leaf, walk to the next one while the copy may be followed
+        if(numOfWalks < IX_PROBE_MAX_WALK){
+            unsigned nextVersion;
+            pageNum = directory.nextNode;
+            {
+                SharedLatchGuard guard(fileHandle.getLatch(pageNum));
+                rc = fileHandle.readPage(pageNum, leafPage);
+                nextVersion = getTreeVersion(ixFileHandle);
+            }
+            numOfWalks++;
+            if(nextVersion == version){
+                continue;
+            }
+        }
+        pageNum = -1;
+    }
+    free(leafPage);
+    return rc;
+}
+
+RC IndexManager::bulkBuild(IXFileHandle &ixFileHandle, const Attribute &attribute, std::vector<IndexEntry> &entries,
+                           float fillFactor, unsigned numOfThreads){
+    
+    if(ixFileHandle.getFileHandle().getNumberOfPages() != 0){
+        // std::cout << "[Error]: bulkBuild -> the index file is not empty." << std::endl;
+        return -1;
+    }
+    if(fillFactor <= 0 || fillFactor > 1){
+        // std::cout << "[Error]: bulkBuild -> fill factor should be in (0, 1]." << std::endl;
+        return -1;
+    }
+    if(entries.empty()){
+        return 0;
+    }
+    
+    sortEntries(attribute, entries, numOfThreads);
+    IX_VectorEntryIterator iterator(entries);
+    return bulkLoad(ixFileHandle, attribute, iterator, fillFactor);
+}
+
+RC IndexManager::bulkLoad(IXFileHandle &ixFileHandle, const Attribute &attribute, IX_EntryIterator &entries, float fillFactor){
+    
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    if(fileHandle.getNumberOfPages() != 0){
+        // std::cout << "[Error]: bulkLoad -> the index file is not empty." << std::endl;
+        return -1;
+    }
+    if(fillFactor <= 0 || fillFactor > 1){
+        // std::cout << "[Error]: bulkLoad -> fill factor should be in (0, 1]." << std::endl;
+        return -1;
+    }
+    
+    // 1. a group is a key with all of its RIDs, the pairs are read one group ahead: whether a key still fits in its leaf
+    // depends on the prefix the leaf would get if it ended there, that is on the next key.
+    IndexEntry entry;
+    bool hasEntry = entries.getNextEntry(entry) == 0;
+    if(!hasEntry){
+        return 0;
+    }
+    bool sorted = true;
+    // the hashes of the keys for the Bloom filter, if the file has one
+    std::shared_ptr<BloomFilter> filter = getBloomFilter(fileHandle.getFileName());
+    std::vector<unsigned> hashes;
+    auto readGroup = [&](std::string &key, std::vector<RID> &rids){
+        if(!hasEntry){
+            return false;
+        }
+        key = entry.key;
+        if(filter){
+            hashes.push_back(HashIndexManager::instance().hashKey(attribute, key.data()));
+        }
+        rids.clear();
+        while(hasEntry && compareKey(attribute, entry.key.data(), key.data()) == 0){
+            rids.push_back(entry.rid);
+            hasEntry = entries.getNextEntry(entry) == 0;
+        }
+        if(hasEntry && compareKey(attribute, entry.key.data(), key.data()) < 0){
+            sorted = false;
+        }
+        // the leaves get the normalized key
+        if(attribute.type != TypeVarChar){
+            char normalized[sizeof(unsigned)];
+            key.assign((const char *)normalizeKey(attribute, key.data(), normalized), sizeof(unsigned));
+        }
+        std::sort(rids.begin(), rids.end(), [](const RID &a, const RID &b){
+            return a.pageNum != b.pageNum ? a.pageNum < b.pageNum : a.slotNum < b.slotNum;
+        });
+        return true;
+    };
+    
+    // page 0 is kept for the root, the leaves follow it
+    char *page = (char *)malloc(PAGE_SIZE);
+    memset(page, 0, PAGE_SIZE);
+    if(fileHandle.appendPage(page) != 0){
+        // std::cout << "[Error]: bulkLoad -> fail to append page 0." << std::endl;
+        free(page);
         return -1;
     }
-    else if(numOfPages == 1){
-        pageNum = 0;
-        RC rc = searchInsideLeafNode(ixFileHandle, pageNum, offset, recordId, attribute, key, inclusive);
-        if(rc != 0){
-//            std::cout << "[Error]: searchEntry -> can't find a <key, data> inside a root-leaf node." << std::endl;
-            return -1;
+    
+    // 2. fill the leaf with the keys while they fit, it is written when the next one doesn't. lowFence is the separator pushed up
+    // for the leaf (none for the first one), prefixLength the prefix of the leaf if it ends with its last key.
+    // A long posting list keeps the index of its RIDs in longLists instead of its first overflow page for now.
+    bool varChar = attribute.type == TypeVarChar;
+    int capacity = (int)((PAGE_SIZE - LEAF_DIR_SIZE) * fillFactor);
+    std::string key, nextKey, lowFence, separator(PAGE_SIZE, '\0');
+    std::vector<RID> rids, nextRids;
+    std::vector<std::string> keys, postings;
+    std::vector<std::vector<RID>> longLists;
+    std::vector<unsigned> leavesWithLongLists;
+    std::vector<std::pair<std::string, unsigned>> level;
+    bool hasNext = readGroup(nextKey, nextRids), hasLongList = false;
+    int usedSpace = 0, prefixLength = 0;
+    RC rc = 0;
+    
+    // write the leaf, the only one is the root-leaf page 0. The leaf before it is the last one of level.
+    auto writeLeaf = [&](int nextNode){
+        unsigned pageNum = nextNode == -1 && level.empty() ? ROOT_PAGE : fileHandle.getNumberOfPages();
+        const char *prefix = lowFence.empty() ? NULL : lowFence.data() + sizeof(int);
+        int prevNode = level.empty() ? -1 : (int)level.back().second;
+        if(writeNodeEntries(LEAF_FLAG, page, attribute, keys, postings, 0, keys.size(), nextNode, prefix, prefixLength, prevNode) != 0){
+            return -1;
+        }
+        RC rc = pageNum == ROOT_PAGE ? fileHandle.writePage(ROOT_PAGE, page) : fileHandle.appendPage(page);
+        if(hasLongList){
+            leavesWithLongLists.push_back(pageNum);
+        }
+        level.emplace_back(lowFence.empty() ? keys[0] : lowFence, pageNum);
+        return rc;
+    };
+    
+    while(hasNext && rc == 0){
+        key.swap(nextKey);
+        rids.swap(nextRids);
+        hasNext = readGroup(nextKey, nextRids);
+        
+        std::string posting(POSTING_HEADER_SIZE, '\0');
+        int length = encodeRids(rids.data(), rids.size(), NULL);
+        bool longList = length > POSTING_INLINE_MAX;
+        unsigned short header = length;
+        if(!longList){
+            memcpy(&posting[0], &header, POSTING_HEADER_SIZE);
+            posting.resize(POSTING_HEADER_SIZE + length);
+            encodeRids(rids.data(), rids.size(), &posting[POSTING_HEADER_SIZE]);
+        }
+        else{
+            header = POSTING_OVERFLOW;
+            unsigned index = longLists.size();
+            memcpy(&posting[0], &header, POSTING_HEADER_SIZE);
+            posting.append((char *)&index, sizeof(unsigned));
+            longLists.push_back(rids);
+        }
+        
+        // the first and the last leaves have no prefix
+        int entryLength = key.size() + posting.size() + IX_SLOT_SIZE;
+        int newPrefixLength = varChar && !lowFence.empty() && hasNext ? getCommonPrefixLength(lowFence.data(), nextKey.data()) : 0;
+        int prefixSpace = varChar ? LEAF_PREFIX_SIZE + newPrefixLength - (int)(keys.size() + 1) * newPrefixLength : 0;
+        if(!keys.empty() && usedSpace + entryLength + prefixSpace > capacity){
+            // the leaf ends before key, the next leaf starts with key
+            rc = writeLeaf(fileHandle.getNumberOfPages() + 1);
+            if(varChar){
+                getShortSeparator(keys.back().data(), key.data(), &separator[0]);
+                lowFence.assign(separator.data(), getKeyLength(attribute, separator.data()));
+            }
+            else{
+                lowFence = key;
+            }
+            keys.clear();
+            postings.clear();
+            usedSpace = 0;
+            hasLongList = false;
+            newPrefixLength = varChar && hasNext ? getCommonPrefixLength(lowFence.data(), nextKey.data()) : 0;
+        }
+        keys.push_back(key);
+        postings.push_back(posting);
+        usedSpace += entryLength;
+        prefixLength = newPrefixLength;
+        hasLongList = hasLongList || longList;
+    }
+    if(rc == 0){
+        rc = writeLeaf(-1);
+    }
+    if(rc != 0 || !sorted){
+        // std::cout << "[Error]: bulkLoad -> the entries are not sorted or a leaf can't be written." << std::endl;
+        free(page);
+        return -1;
+    }
+    
+    // the Bloom filter is built again for the keys loaded, at the rate it had
+    if(filter){
+        rc = buildBloomFilter(fileHandle.getFileName(), hashes, filter->getFalsePositiveRate());
+    }
+    
+    // 3. the long posting lists go to overflow pages after the leaves, which get the first pages of their lists
+    std::vector<unsigned> firstPageNums(longLists.size());
+    for(size_t i = 0; i < longLists.size() && rc == 0; i++){
+        rc = appendPostingPages(ixFileHandle, longLists[i].data(), longLists[i].size(), fillFactor, firstPageNums[i]);
+    }
+    for(size_t i = 0; i < leavesWithLongLists.size() && rc == 0; i++){
+        rc = fileHandle.readPage(leavesWithLongLists[i], page);
+        if(rc == 0){
+            forEachPagePointer(page, attribute, [&firstPageNums](unsigned &pageNum, bool owned){
+                if(owned){
+                    pageNum = firstPageNums[pageNum];
+                }
+            });
+            rc = fileHandle.writePage(leavesWithLongLists[i], page);
+        }
+    }
+    if(rc != 0 || level.size() == 1){
+        free(page);
+        newTreeVersion(ixFileHandle);
+        return rc;
+    }
+    
+    // 4. build the intermediate levels until there is only the root.
+    while(level.size() > 1){
+        if(buildUpperLevel(ixFileHandle, attribute, level, fillFactor) != 0){
+            // std::cout << "[Error]: bulkLoad -> fail to build intermediate level." << std::endl;
+            free(page);
+            return -1;
+        }
+    }
+    
+    // 5. page 0 points to the root page.
+    memset(page, 0, PAGE_SIZE);
+    int rootPtrFlag = ROOT_PTR_FLAG;
+    memcpy(page, &rootPtrFlag, sizeof(int));
+    memcpy((char *)page+4, &level[0].second, sizeof(unsigned));
+    rc = fileHandle.writePage(0, page);
+    free(page);
+    newTreeVersion(ixFileHandle);
+    return rc;
+}
+
+RC IndexManager::sortEntries(const Attribute &attribute, std::vector<IndexEntry> &entries, unsigned numOfThreads){
+    
+    auto lessThan = [this, &attribute](const IndexEntry &a, const IndexEntry &b){
+        int cmp = compareKey(attribute, a.key.data(), b.key.data());
+        if(cmp != 0){
+            return cmp < 0;
+        }
+        if(a.rid.pageNum != b.rid.pageNum){
+            return a.rid.pageNum < b.rid.pageNum;
+        }
+        return a.rid.slotNum < b.rid.slotNum;
+    };
+    
+    numOfThreads = std::max(1u, std::min(numOfThreads, (unsigned)entries.size()));
+    if(numOfThreads == 1){
+        std::sort(entries.begin(), entries.end(), lessThan);
+        return 0;
+    }
+    
+    // i'th chunk is entries[chunkStart[i], chunkStart[i+1])
+    std::vector<size_t> chunkStart;
+    for(unsigned i = 0; i <= numOfThreads; i++){
+        chunkStart.push_back(entries.size() * i / numOfThreads);
+    }
+    
+    std::vector<std::thread> threads;
+    for(unsigned i = 0; i < numOfThreads; i++){
+        threads.emplace_back([&, i](){
+            std::sort(entries.begin()+chunkStart[i], entries.begin()+chunkStart[i+1], lessThan);
+        });
+    }
+    for(auto &thread : threads){
+        thread.join();
+    }
+    
+    // merge neighbouring sorted runs, every merge of one round runs in its own thread.
+    for(unsigned width = 1; width < numOfThreads; width *= 2){
+        threads.clear();
+        for(unsigned i = 0; i + width < numOfThreads; i += 2 * width){
+            unsigned last = std::min(i + 2 * width, numOfThreads);
+            threads.emplace_back([&, i, width, last](){
+                std::inplace_merge(entries.begin()+chunkStart[i], entries.begin()+chunkStart[i+width],
+                                   entries.begin()+chunkStart[last], lessThan);
+            });
+        }
+        for(auto &thread : threads){
+            thread.join();
         }
     }
-    else{
-//        std::cout << "searchEntry():  numOfPages > 1. " << std::endl;
-        void *rootPtr = malloc(PAGE_SIZE);
+    return 0;
+}
 
-        if(ixFileHandle.getFileHandle().readPage(0, rootPtr) != 0){
-            // std::cout << "searchEntry():  Can't read the page. " << std::endl;
-            return -1;
+RC IndexManager::buildUpperLevel(IXFileHandle &ixFileHandle, const Attribute &attribute, std::vector<std::pair<std::string, unsigned>> &level, float fillFactor){
+    
+    // 1. i'th node has children level[nodeStart[i], nodeStart[i+1]), the first child is P0 which doesn't carry a key.
+    int capacity = (int)((PAGE_SIZE - IM_DIR_SIZE - sizeof(unsigned)) * fillFactor);
+    int maxSpace = PAGE_SIZE - IM_DIR_SIZE - sizeof(unsigned);
+    std::vector<size_t> nodeStart;
+    std::vector<int> nodeSpace;
+    for(size_t i = 0; i < level.size(); i++){
+        int entryLength = level[i].first.size() + sizeof(unsigned) + IX_SLOT_SIZE;
+        // every node holds at least one key, so the level always shrinks
+        if(nodeStart.empty() || (i - nodeStart.back() >= 2 && nodeSpace.back() + entryLength > capacity)){
+            nodeStart.push_back(i);
+            nodeSpace.push_back(0);
+            continue;
         }
-
-        unsigned rootPageNum, curNode, nextNode;
-
-        memcpy(&rootPageNum, (char *)rootPtr+4, sizeof(int));
-        curNode = rootPageNum;
-
-        while(getNextNode(ixFileHandle, curNode, nextNode, attribute, key) == 0){
-            curNode = nextNode;
-            pageNum = nextNode;
+        nodeSpace.back() += entryLength;
+    }
+    if(nodeStart.size() > 1 && nodeStart.back() == level.size() - 1){
+        // the last node only has P0, merge it into the previous node, or take the last child of the previous node.
+        int entryLength = level.back().first.size() + sizeof(unsigned) + IX_SLOT_SIZE;
+        nodeStart.pop_back();
+        nodeSpace.pop_back();
+        if(nodeSpace.back() + entryLength > maxSpace){
+            nodeStart.push_back(level.size() - 2);
         }
-
-        RC rc = searchInsideLeafNode(ixFileHandle, curNode, offset, recordId, attribute, key, inclusive);
+    }
+    nodeStart.push_back(level.size());
     
-        free(rootPtr);
+    // 2. write the nodes, the only node of the top level is the root.
+    int pageFlag = (nodeStart.size() == 2) ? ROOT_FLAG : IM_FLAG;
+    std::vector<std::pair<std::string, unsigned>> upperLevel;
+    void *page = malloc(PAGE_SIZE);
+    for(size_t node = 0; node + 1 < nodeStart.size(); node++){
+        memset(page, 0, PAGE_SIZE);
+        imPageDirectory directory = {pageFlag, PAGE_SIZE-IM_DIR_SIZE, 0};
+        int offset = IM_DIR_SIZE;
+        memcpy((char *)page+offset, &level[nodeStart[node]].second, sizeof(unsigned));
+        offset += sizeof(unsigned);
+        for(size_t i = nodeStart[node] + 1; i < nodeStart[node+1]; i++){
+            memcpy((char *)page+offset, level[i].first.data(), level[i].first.size());
+            offset += level[i].first.size();
+            memcpy((char *)page+offset, &level[i].second, sizeof(unsigned));
+            offset += sizeof(unsigned);
+            directory.numOfRecords++;
+        }
+        directory.freeSpace = PAGE_SIZE - offset - directory.numOfRecords * IX_SLOT_SIZE;
+        memcpy(page, &directory, IM_DIR_SIZE);
+        buildSlotArray(pageFlag, page, attribute);
         
-        if(rc != 0){
-            // std::cout << "[Error]: searchEntry -> can't find a <key, data>." << std::endl;
+        if(ixFileHandle.getFileHandle().appendPage(page) != 0){
+            // std::cout << "[Error]: buildUpperLevel -> fail to append page." << std::endl;
+            free(page);
             return -1;
         }
+        upperLevel.emplace_back(level[nodeStart[node]].first, ixFileHandle.getFileHandle().getNumberOfPages() - 1);
     }
+    free(page);
+    
+    level.swap(upperLevel);
     return 0;
 }
 
-RC IndexManager::deleteEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid) {
-
-    int offset, recordId, pageNum;
-    RID tempRid;
-    if(searchEntry(ixFileHandle, pageNum, offset, recordId, attribute, key, true) == 0){
-        auto *page = (char *)malloc(PAGE_SIZE);
-        ixFileHandle.getFileHandle().readPage(pageNum, page);
-        leafPageDirectory directory;
-        memcpy(&directory, page, LEAF_DIR_SIZE);
-
-        switch (attribute.type){
-            case TypeInt:{
-                int data, tempData;
-                memcpy(&tempData, page+offset, sizeof(int));
-                memcpy(&data, key, sizeof(int));
-                memcpy(&tempRid, page+offset+ sizeof(int), sizeof(RID));
-                if(data == tempData && rid.pageNum == tempRid.pageNum && rid.slotNum == tempRid.slotNum){
-                    memmove(page+offset, page+offset+ sizeof(int)+ sizeof(RID), PAGE_SIZE-directory.freeSpace-offset-(sizeof(int)+
-                                                                                                                      sizeof(RID)));
-                    directory.freeSpace += (sizeof(int)+ sizeof(RID));
-                    directory.numOfRecords -= 1;
-                    memcpy(page, &directory, LEAF_DIR_SIZE);
-                    ixFileHandle.getFileHandle().writePage(pageNum, page);
-                    
-//                    std::cout << "deleteEntry -> Delete " << recordId << "'th entry inside " << pageNum << " RID is : " << rid.pageNum << "; " << rid.slotNum <<  std::endl;
-                    free(page);
-                    return 0;
-                }
-                else{
-//                    std::cout << "[Error]: deleteEntry -> can't find such a <key, rid> pair." << std::endl;
-                    free(page);
-                    return -1;
-                }
-            }
-            case TypeReal:{
-                float data, tempData;
-                memcpy(&tempData, page+offset, sizeof(float));
-                memcpy(&data, key, sizeof(float));
-                memcpy(&tempRid, page+offset+ sizeof(float), sizeof(RID));
-                if(data == tempData && rid.pageNum == tempRid.pageNum && rid.slotNum == tempRid.slotNum){
-                    memmove(page+offset, page+offset+ sizeof(float)+ sizeof(RID), PAGE_SIZE-directory.freeSpace-offset-(sizeof(float)+
-                                                                                                                      sizeof(RID)));
-                    directory.freeSpace += (sizeof(float)+ sizeof(RID));
-                    directory.numOfRecords -= 1;
-                    memcpy(page, &directory, LEAF_DIR_SIZE);
-                    ixFileHandle.getFileHandle().writePage(pageNum, page);
-    
-//                    std::cout << "deleteEntry -> Delete " << recordId << "'th entry inside " << pageNum << " RID is : " << rid.pageNum << "; " << rid.slotNum <<  std::endl;
-                    free(page);
-                    return 0;
-                }
-                else{
-//                    std::cout << "[Error]:  deleteEntry -> can't find such a <key, rid> pair." << std::endl;
-                    free(page);
-                    return -1;
-                }
+RC IndexManager::shrinkFile(IXFileHandle &ixFileHandle, const Attribute &attribute){
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    if(fileHandle.getNumberOfPages() == 0){
+        return 0;
+    }
+    
+    // latch the tree level by level, left to right: no operation enters it once page 0 is latched,
+    // the ones already inside finish before their nodes are latched. Overflow pages come after their leaves.
+    char *page = (char *)malloc(PAGE_SIZE);
+    std::vector<unsigned> latchedNodes;
+    std::set<unsigned> usedPages;
+    std::vector<unsigned> level{ROOT_PAGE};
+    RC rc = 0;
+    while(!level.empty() && rc == 0){
+        std::vector<unsigned> nextLevel;
+        for(unsigned pageNum : level){
+            fileHandle.getLatch(pageNum).lockExclusive();
+            latchedNodes.push_back(pageNum);
+            usedPages.insert(pageNum);
+            if(fileHandle.readPage(pageNum, page) != 0){
+                // std::cout << "[Error] shrinkFile -> fail to read a page." << std::endl;
+                rc = -1;
                 break;
             }
-            case TypeVarChar:{
-
-                int length, tempLength;
-                memcpy(&tempLength, page+offset, sizeof(int));
-                memcpy(&length, key, sizeof(int));
-
-                auto *tempData = (char *)malloc(tempLength+1);
-                auto *data = (char *)malloc(length+1);
-
-//                std::cout << "offset" << offset << ", " << tempLength << ", " << length << std::endl;
-
-                memcpy(tempData, page+offset+ sizeof(int), tempLength);
-                memcpy(data, (char *)key+sizeof(int), length);
-                memcpy(&tempRid, page+offset+ sizeof(int)+ tempLength, sizeof(RID));
-
-                tempData[tempLength] = '\0';
-                data[length] = '\0';
-
-                if(strcmp(data, tempData) == 0 && rid.pageNum == tempRid.pageNum && rid.slotNum == tempRid.slotNum){
-                    memmove(page+offset, page+offset+ sizeof(int)+tempLength+sizeof(RID), PAGE_SIZE-directory.freeSpace-offset-(sizeof(int)+tempLength+
-                                                                                                                        sizeof(RID)));
-                    directory.freeSpace += (sizeof(int)+tempLength+sizeof(RID));
-                    directory.numOfRecords -= 1;
-                    memcpy(page, &directory, LEAF_DIR_SIZE);
-                    ixFileHandle.getFileHandle().writePage(pageNum, page);
-    
-                    // std::cout << "deleteEntry -> Delete " << recordId << "'th entry inside " << pageNum << std::endl;
-                    free(tempData);
-                    free(data);
-                    free(page);
-                    return 0;
-                }
-                else{
-//                    std::cout << "[Error]: deleteEntry -> can't find such a <key, rid> pair." << std::endl;
-                    free(tempData);
-                    free(data);
-                    free(page);
-                    return -1;
+            forEachPagePointer(page, attribute, [&nextLevel](unsigned &child, bool owned){
+                if(owned){
+                    nextLevel.push_back(child);
                 }
-                break;
+            });
+        }
+        level.swap(nextLevel);
+    }
+    fileHandle.getLatch(FREE_LIST_LATCH).lockExclusive();
+    
+    // every used page past the end of the shrunk file moves into the first unused page before it
+    unsigned numOfPages = fileHandle.getNumberOfPages();
+    unsigned newNumOfPages = usedPages.size();
+    std::map<unsigned, unsigned> movedPages;
+    unsigned freePageNum = 0;
+    for(auto it = usedPages.lower_bound(newNumOfPages); it != usedPages.end() && rc == 0; it++){
+        while(usedPages.count(freePageNum) != 0){
+            freePageNum++;
+        }
+        movedPages[*it] = freePageNum;
+        fileHandle.getLatch(freePageNum).lockExclusive();
+        latchedNodes.push_back(freePageNum);
+        rc = fileHandle.readPage(*it, page);
+        if(rc == 0){
+            rc = fileHandle.writePage(freePageNum, page);
+        }
+        freePageNum++;
+    }
+    
+    // the pages pointing to a moved page are changed where they are now, page 0 forgets the free pages
+    for(auto it = usedPages.begin(); it != usedPages.end() && rc == 0; it++){
+        unsigned pageNum = movedPages.count(*it) != 0 ? movedPages[*it] : *it;
+        rc = fileHandle.readPage(pageNum, page);
+        if(rc != 0){
+            break;
+        }
+        bool changed = false;
+        forEachPagePointer(page, attribute, [&movedPages, &changed](unsigned &child, bool){
+            auto moved = movedPages.find(child);
+            if(moved != movedPages.end()){
+                child = moved->second;
+                changed = true;
             }
-            default:
-                break;
+        });
+        int pageFlag;
+        memcpy(&pageFlag, page, sizeof(int));
+        if(pageNum == ROOT_PAGE && pageFlag == ROOT_PTR_FLAG){
+            unsigned firstFreePage = 0;
+            memcpy(page+FREE_LIST_OFFSET, &firstFreePage, sizeof(unsigned));
+            changed = true;
+        }
+        if(changed){
+            rc = fileHandle.writePage(pageNum, page);
         }
     }
-    else{
-//        std::cout << "[Error]: deleteEntry -> can't find such a rid." << std::endl;
-        return -1;
+    if(rc == 0 && newNumOfPages < numOfPages){
+        rc = fileHandle.truncateFile(newNumOfPages);
     }
-
-    return 0;
+    
+    // copies of the tree have the old page numbers
+    newTreeVersion(ixFileHandle);
+    fileHandle.getLatch(FREE_LIST_LATCH).unlockExclusive();
+    unlatchNodes(ixFileHandle, latchedNodes, latchedNodes.size());
+    free(page);
+    return rc;
 }
 
-RC IndexManager::scan(IXFileHandle &ixFileHandle,
-                      const Attribute &attribute,
-                      const void *lowKey,
-                      const void *highKey,
-                      bool lowKeyInclusive,
-                      bool highKeyInclusive,
-                      IX_ScanIterator &ix_ScanIterator) {
-
-    int pageNum, recordId,  offset = 0;
+RC IndexManager::createBloomFilter(IXFileHandle &ixFileHandle, const Attribute &attribute, float falsePositiveRate){
     
-    if(!ixFileHandle.getFileHandle().getFile().is_open()){
-//        std::cout << "[Error]: can't scan a non-existing file." << std::endl;
+    const std::string fileName = ixFileHandle.getFileHandle().getFileName();
+    if(!ixFileHandle.getFileHandle().getFile().is_open() || HashIndexManager::instance().isHashIndex(fileName)){
+        // std::cout << "[Error]: createBloomFilter -> not an open B+ tree index." << std::endl;
         return -1;
     }
     
-    // If we can't find a <key, rid> that satisfies the comparision
-    // we set the recordId = numOfRecords and offset is end of valid data which is the start of free space.
-    searchEntry(ixFileHandle, pageNum, offset, recordId, attribute, lowKey, lowKeyInclusive);
-    
-    // initialize the scanIterator with pageNum, offset and recordId which shows from where the scan should start.
-    RC rc = ix_ScanIterator.initializeScanIterator(ixFileHandle, attribute, lowKey, highKey, lowKeyInclusive,
-                                           highKeyInclusive, pageNum, offset, recordId);
-    
-    if(rc != 0){
-        // std::cout << "[Error]: scan -> initializeScanIterator" << std::endl;
+    // the hashes of the keys, a scan returns the RIDs of a key one after the other. It closes its own handle.
+    IXFileHandle scanHandle;
+    IX_ScanIterator ix_ScanIterator;
+    if(openFile(fileName, scanHandle) != 0 ||
+       scan(scanHandle, attribute, NULL, NULL, true, true, ix_ScanIterator) != 0){
+        // std::cout << "[Error]: createBloomFilter -> fail to scan the index." << std::endl;
+        closeFile(scanHandle);
         return -1;
     }
-    
+    HashIndexManager &hashIndexManager = HashIndexManager::instance();
+    std::vector<unsigned> hashes;
+    char *key = (char *)malloc(PAGE_SIZE);
+    std::string lastKey;
+    RID rid;
+    while(ix_ScanIterator.getNextEntry(rid, key) == 0){
+        if(hashes.empty() || compareKey(attribute, lastKey.data(), key) != 0){
+            lastKey.assign(key, getKeyLength(attribute, key));
+            hashes.push_back(hashIndexManager.hashKey(attribute, key));
+        }
+    }
+    ix_ScanIterator.close();
+    free(key);
+    return buildBloomFilter(fileName, hashes, falsePositiveRate);
+}
+
+RC IndexManager::destroyBloomFilter(const std::string &fileName){
+    std::lock_guard<std::mutex> lock(_bloomFiltersMutex);
+    // lookups which still hold the filter keep it until they are done, the file has none from now on
+    _bloomFilters[fileName].reset();
+    PagedFileManager::instance().destroyFile(fileName + BLOOM_FILE_SUFFIX);
     return 0;
-    
+}
+
+std::shared_ptr<BloomFilter> IndexManager::getBloomFilter(const std::string &fileName){
+    std::lock_guard<std::mutex> lock(_bloomFiltersMutex);
+    auto it = _bloomFilters.find(fileName);
+    if(it != _bloomFilters.end()){
+        return it->second;
+    }
+    // first use of the file, read its filter if it has one
+    std::shared_ptr<BloomFilter> filter(new BloomFilter());
+    if(filter->open(fileName + BLOOM_FILE_SUFFIX) != 0){
+        filter.reset();
+    }
+    _bloomFilters[fileName] = filter;
+    return filter;
+}
+
+RC IndexManager::reloadFile(const std::string &fileName){
+    newTreeVersion(fileName);
+    std::lock_guard<std::mutex> lock(_bloomFiltersMutex);
+    _bloomFilters.erase(fileName);
+    return 0;
+}
+
+RC IndexManager::buildBloomFilter(const std::string &fileName, const std::vector<unsigned> &hashes, float falsePositiveRate){
+    std::lock_guard<std::mutex> lock(_bloomFiltersMutex);
+    // the new filter replaces the file of the old one, lookups which still hold the old one read its bits in memory
+    std::shared_ptr<BloomFilter> filter(new BloomFilter());
+    RC rc = filter->create(fileName + BLOOM_FILE_SUFFIX, hashes.size(), falsePositiveRate);
+    if(rc == 0){
+        rc = filter->add(hashes);
+    }
+    if(rc != 0){
+        // std::cout << "[Error]: buildBloomFilter -> fail to write the filter." << std::endl;
+        filter.reset();
+        PagedFileManager::instance().destroyFile(fileName + BLOOM_FILE_SUFFIX);
+    }
+    _bloomFilters[fileName] = filter;
+    return rc;
 }
 
 void IndexManager::printBtree(IXFileHandle &ixFileHandle, const Attribute &attribute) const {
@@ -440,27 +1642,27 @@ void IndexManager::printBtree(IXFileHandle &ixFileHandle, const Attribute &attri
         // std::cerr << "Empty B+ tree" << std::endl;
         return;
     }
-    else if(numOfPages == 1){
+    
+    // page 0 is the root-leaf page, or points to the root
+    void *rootPtr = malloc(PAGE_SIZE);
+    ixFileHandle.getFileHandle().readPage(0, rootPtr);
+    int pageFlag, rootPageNum;
+    memcpy(&pageFlag, rootPtr, sizeof(int));
+    if(pageFlag == LEAF_FLAG){
         printNormalBtree(ixFileHandle, 0, 1, attribute, true);
     }
     else{
-        void *rootPtr = malloc(PAGE_SIZE);
-        ixFileHandle.getFileHandle().readPage(0, rootPtr);
-        int rootPageNum;
-
         memcpy(&rootPageNum, (char *)rootPtr+4, sizeof(int));
-
         printNormalBtree(ixFileHandle, rootPageNum, 1, attribute, true);
-        
-        free(rootPtr);
     }
+    free(rootPtr);
 }
 
 int IndexManager::getRequiredLength(const Attribute &attribute, const void *key, int sizeOfData){
     // get the required length for insertion
     int requiredLength = 0;
 
-    // In this case, we use length(key) + length(rid)
+    // In this case, we use length(key) + length(rid) + the slot of the key
     switch (attribute.type){
         // For INT and REAL: use 4 bytes
         case TypeInt:{
@@ -483,186 +1685,104 @@ int IndexManager::getRequiredLength(const Attribute &attribute, const void *key,
             return -1;
         }
     }
-    return requiredLength;
+    return requiredLength + IX_SLOT_SIZE;
 }
 
-RC IndexManager::insertEntryToNode(int pageFlag, void *page, const Attribute &attribute, const void *key, const void *data, int sizeOfData){
-
-    int offset;
-    int freeSpace, numOfRecords;
-    leafPageDirectory leaf_directory;
-    imPageDirectory im_directory;
-
-    // initialize freeSpace and numOfRecords
-    if(pageFlag == LEAF_FLAG){
-        // read from *page
-        memcpy(&leaf_directory, page, LEAF_DIR_SIZE);
-
-        freeSpace = leaf_directory.freeSpace;
-        numOfRecords = leaf_directory.numOfRecords;
-        
-        offset = LEAF_DIR_SIZE;
-    }
-    else if(pageFlag == IM_FLAG || pageFlag == ROOT_FLAG){
-        // read
-        memcpy(&im_directory, page, IM_DIR_SIZE);
+RC IndexManager::insertEntryToNode(IXFileHandle &ixFileHandle, int pageFlag, void *page, const Attribute &attribute, const void *key, const void *data, int sizeOfData){
 
-        freeSpace = im_directory.freeSpace;
-        numOfRecords = im_directory.numOfRecords;
-        // extra 4 bytes to store the P0 pointer(pageNum).
-        offset = IM_DIR_SIZE + sizeof(unsigned);
-    }
-    else{
+    if(pageFlag != LEAF_FLAG && pageFlag != IM_FLAG && pageFlag != ROOT_FLAG){
         // std::cout << "[Error]: insertInNode -> wrong flag" << std::endl;
         return -1;
     }
-
-    // sizeofData should be the length of RID
-    switch (attribute.type){
-        case TypeInt:{
-            // this should not happen
-            if(freeSpace < (4 + sizeOfData)){
-                // std::cout << "[Error]: insertInsideLeafNode -> can't fit the new insert key." << std::endl;
-                return -1;
-            }
-
-            int dataInt, tempData;
-            int index;
-
-            // get the actual key data to the dataInt
-            memcpy(&dataInt, key, 4);
-
-            // find a location to put this entry
-            for(index = 0; index < numOfRecords; index++){
-                memcpy(&tempData, (char *)page+offset, 4);
-                if(dataInt <= tempData)
-                    // keep the order that key_n <= key_n+1
-                    break;
-                offset += (4 + sizeOfData);
-            }
-
-            // shift with memory overlap
-            memmove((char *)page+offset+4+sizeOfData, (char *)page+offset, PAGE_SIZE-freeSpace-offset);
-            // insert the new entry
-            memcpy((char *)page+offset, key, 4);
-            memcpy((char *)page+offset+4, (char *)data, sizeOfData);
-
-            freeSpace -= (4+sizeOfData);
-            numOfRecords += 1;
-
-            break;
-        }
-        case TypeReal:{
-            // this should not happen
-            if(freeSpace < (4+sizeOfData)){
-                // std::cout << "[Error]: insertInsideLeafNode -> can't fit the new insert key." << std::endl;
-                return -1;
-            }
-
-            float dataReal, tempData;
-            int index;
-
-            // get the actual key data to the dataReal
-            memcpy(&dataReal, key, 4);
-
-            for(index = 0; index < numOfRecords; index++){
-                memcpy(&tempData, (char *)page+offset, 4);
-                if(dataReal <= tempData)
-                    // keep the order that key_n <= key_n+1
-                    break;
-                offset+= (4+sizeOfData);
-            }
-
-            // shift with memory overlap
-            memmove((char *)page+offset+4+sizeOfData, (char *)page+offset, PAGE_SIZE-freeSpace-offset);
-            // insert the new entry
-            memcpy((char *)page+offset, key, 4);
-            memcpy((char *)page+offset+4, (char *)data, sizeOfData);
-
-            freeSpace -= (4+sizeOfData);
-            numOfRecords += 1;
-
-            break;
+    
+    // leaf and im directories both start with flag, freeSpace and numOfRecords
+    imPageDirectory directory;
+    memcpy(&directory, page, IM_DIR_SIZE);
+    
+    // a VARCHAR leaf stores the key without its prefix
+    int keyLength = getKeyLength(attribute, key);
+    int prefixLength = getLeafPrefixLength(page, attribute);
+    if(prefixLength > 0 && (keyLength < (int)sizeof(int) + prefixLength ||
+                            memcmp((char *)key+sizeof(int), (char *)page+LEAF_DIR_SIZE+LEAF_PREFIX_SIZE, prefixLength) != 0)){
+        // std::cout << "[Error]: insertEntryToNode -> the key doesn't have the prefix of the leaf." << std::endl;
+        return -1;
+    }
+    keyLength -= prefixLength;
+    
+    // keep the order that key_n < key_n+1: the new entry goes before the first key >= key
+    int index = searchInsideNode(page, attribute, key, true);
+    
+    // a leaf entry is the key with the posting list of its RIDs, in a clustered tree the key with its row
+    char posting[POSTING_HEADER_SIZE + POSTING_MAX_RID_SIZE];
+    std::string row;
+    if(pageFlag == LEAF_FLAG && ixFileHandle.isClustered()){
+        if(index < directory.numOfRecords && compareLeafKey(page, getKeyOffset(page, index), attribute, key) == 0){
+            // std::cout << "[Error]: insertEntryToNode -> the key of the row is in the tree already." << std::endl;
+            return -1;
         }
-        case TypeVarChar:{
-            int length, tempLength;
-            int index;
-
-            memcpy(&length, key, 4);
-            auto *dataVarChar = (char *)malloc(length+1);
-            memcpy(dataVarChar, (char *)key+4, length);
-            dataVarChar[length] = '\0';
-            // std::cout << "length is " << length << "; data is " << dataVarChar << std::endl;
-
-            // this should not happen
-            if(freeSpace < (4+length+sizeOfData)){
-                // std::cout << "[Error]: insertInsideLeafNode -> can't fit the new insert key." << std::endl;
-                return -1;
-            }
-
-            for(index = 0; index < numOfRecords; index++){
-                memcpy(&tempLength, (char *)page+offset, 4);
-                auto *tempData = (char *)malloc(tempLength+1);
-                memcpy(tempData, (char *)page+offset+4, tempLength);
-                tempData[tempLength] = '\0';
-                // std::cout << "tempLength is " << tempLength  << "; tempData is" << tempData << std::endl;
-
-                if(strcmp(dataVarChar, tempData) <= 0){
-                    // keep the order that key_n <= key_n+1
-                    free(tempData);
-                    break;
-                }
-
-                offset += (4+tempLength+sizeOfData);
-                free(tempData);
-            }
-
-            // shift with memory overlap
-            memmove((char *)page+offset+4+length+sizeOfData, (char *)page+offset, PAGE_SIZE-freeSpace-offset);
-            // insert the new entry
-            memcpy((char *)page+offset, key, 4+length);
-            memcpy((char *)page+offset+4+length, (char *)data, sizeOfData);
-
-            freeSpace -= (4+length+sizeOfData);
-            numOfRecords += 1;
-            free(dataVarChar);
-
-            break;
+        unsigned short length = sizeOfData;
+        row.assign((const char *)&length, POSTING_HEADER_SIZE);
+        row.append((const char *)data, sizeOfData);
+        data = row.data();
+        sizeOfData = row.size();
+    }
+    else if(pageFlag == LEAF_FLAG){
+        if(index < directory.numOfRecords && compareLeafKey(page, getKeyOffset(page, index), attribute, key) == 0){
+            return insertIntoPostingList(ixFileHandle, page, index, attribute, *(const RID *)data);
         }
-        default:
-            break;
+        unsigned short length = encodeRids((const RID *)data, 1, posting + POSTING_HEADER_SIZE);
+        memcpy(posting, &length, POSTING_HEADER_SIZE);
+        data = posting;
+        sizeOfData = POSTING_HEADER_SIZE + length;
     }
-
-    // update freespace and numOfRecords
-    if(pageFlag == LEAF_FLAG){
-        // write back to *page
-        leaf_directory.freeSpace = freeSpace;
-        leaf_directory.numOfRecords = numOfRecords;
-
-        memcpy(page, &leaf_directory, LEAF_DIR_SIZE);
-
+    
+    int entryLength = keyLength + sizeOfData;
+    if(directory.freeSpace < entryLength + IX_SLOT_SIZE){
+        // this should not happen
+        // std::cout << "[Error]: insertInsideLeafNode -> can't fit the new insert key." << std::endl;
+        return -1;
     }
-    else if(pageFlag == IM_FLAG || pageFlag == ROOT_FLAG){
-        // write back to *page
-        im_directory.freeSpace = freeSpace;
-        im_directory.numOfRecords = numOfRecords;
-
-        memcpy(page, &im_directory, IM_DIR_SIZE);
+    int dataEnd = getNodeDataEnd(page);
+    int offset = index < directory.numOfRecords ? getKeyOffset(page, index) : dataEnd;
+    
+    // shift with memory overlap
+    memmove((char *)page+offset+entryLength, (char *)page+offset, dataEnd-offset);
+    // insert the new entry
+    if(prefixLength > 0){
+        int suffixLength = keyLength - sizeof(int);
+        memcpy((char *)page+offset, &suffixLength, sizeof(int));
+        memcpy((char *)page+offset+sizeof(int), (char *)key+sizeof(int)+prefixLength, suffixLength);
+    }
+    else{
+        memcpy((char *)page+offset, key, keyLength);
+    }
+    memcpy((char *)page+offset+keyLength, data, sizeOfData);
+    
+    // slots from index on move one slot towards the front of the page, their entries moved by entryLength
+    char *slots = (char *)page + PAGE_SIZE - directory.numOfRecords * IX_SLOT_SIZE;
+    memmove(slots - IX_SLOT_SIZE, slots, (directory.numOfRecords - index) * IX_SLOT_SIZE);
+    for(int i = directory.numOfRecords; i > index; i--){
+        setKeyOffset(page, i, getKeyOffset(page, i) + entryLength);
     }
+    setKeyOffset(page, index, offset);
+    
+    // update freespace and numOfRecords, nextNode of a leaf stays as it is
+    directory.freeSpace -= entryLength + IX_SLOT_SIZE;
+    directory.numOfRecords += 1;
+    memcpy(page, &directory, IM_DIR_SIZE);
 
     return 0;
 }
 
-RC IndexManager::getSplitInNode(int pageFlag, void *page, const Attribute &attribute, int &splitOffset, int &splitNumOfRecords, void *splitKey, int sizeOfData){
+RC IndexManager::getSplitInNode(int pageFlag, void *page, const Attribute &attribute, int &splitOffset, int &splitNumOfRecords, void *splitKey){
 
-    int startOffset, numOfRecords, freeSpace;
+    int startOffset, numOfRecords;
     // get the info about this page
     if(pageFlag == LEAF_FLAG){
-        startOffset = LEAF_DIR_SIZE;
+        startOffset = getNodeDataStart(page, attribute);
         leafPageDirectory directory;
         memcpy(&directory, page, LEAF_DIR_SIZE);
         numOfRecords = directory.numOfRecords;
-        freeSpace = directory.freeSpace;
     }
     else if(pageFlag == IM_FLAG || pageFlag == ROOT_FLAG){
         // extra 4 bytes to store the P0 pointer(pageNum).
@@ -670,57 +1790,50 @@ RC IndexManager::getSplitInNode(int pageFlag, void *page, const Attribute &attri
         imPageDirectory directory;
         memcpy(&directory, page, IM_DIR_SIZE);
         numOfRecords = directory.numOfRecords;
-        freeSpace = directory.freeSpace;
     }
     else{
         // std::cout << "[Error]: getSplitInNode -> wrong flag." << std::endl;
         return -1;
     }
 
-    switch (attribute.type){
-        // we need to make sure the splitOffset is the beginning of an entry which is also the end of the previous entry.
-        case TypeInt:{
-
-            splitOffset = (PAGE_SIZE-startOffset-freeSpace) / (4+sizeOfData) / 2 * (4+sizeOfData) + startOffset;
-            splitNumOfRecords = (PAGE_SIZE-startOffset-freeSpace) / (4+sizeOfData) / 2;
-            memcpy(splitKey, (char *)page+splitOffset, 4);
-
-            break;
-        }
-        case TypeReal:{
-
-            splitOffset = (PAGE_SIZE-startOffset-freeSpace) / (4+sizeOfData) / 2 * (4+sizeOfData) + startOffset;
-            splitNumOfRecords = (PAGE_SIZE-startOffset-freeSpace) / (4+sizeOfData) / 2;
-            memcpy(splitKey, (char *)page+splitOffset, 4);
-
-            break;
-        }
-        case TypeVarChar:{
-            splitOffset = startOffset;
-            int index, tempLength;
-            splitNumOfRecords = 0;
-            int pivot = (PAGE_SIZE-startOffset-freeSpace) / 2 + startOffset;
-
-            for(index = 0; index < numOfRecords; index++){
-
-                if(splitOffset > pivot)
-                    break;
-
-                memcpy(&tempLength, (char *)page + splitOffset, 4);
-                // 4: length of varchar, tempLength: key.
-                splitOffset += (4 + tempLength + sizeOfData);
-                splitNumOfRecords++;
+    // we need to make sure the splitOffset is the beginning of an entry which is also the end of the previous entry.
+    if(pageFlag != LEAF_FLAG && attribute.type != TypeVarChar){
+        // entries have the same length, split in the middle one
+        splitNumOfRecords = numOfRecords / 2;
+    }
+    else{
+        // VARCHAR keys and posting lists have different lengths:
+        // the entries which start before the middle of the data stay, binary search the slots for the first one after it.
+        int pivot = (getNodeDataEnd(page) - startOffset) / 2 + startOffset;
+        int low = 0, high = numOfRecords;
+        while(low < high){
+            int mid = (low + high) / 2;
+            if(getKeyOffset(page, mid) > pivot){
+                high = mid;
+            }
+            else{
+                low = mid + 1;
             }
-
-            int length;
-            memcpy(&length, (char *)page+splitOffset, 4);
-            memcpy(splitKey, &length, 4);
-            memcpy((char *)splitKey+4, (char *)page+splitOffset+4, length);
-
-            break;
         }
-        default:
-            break;
+        splitNumOfRecords = low;
+        if(pageFlag == LEAF_FLAG && numOfRecords >= 2){
+            // both leaves keep an entry, a key has to move to the new leaf with its posting list
+            splitNumOfRecords = std::max(1, std::min(low, numOfRecords - 1));
+        }
+    }
+    splitOffset = splitNumOfRecords < numOfRecords ? getKeyOffset(page, splitNumOfRecords) : getNodeDataEnd(page);
+    if(pageFlag != LEAF_FLAG){
+        memcpy(splitKey, (char *)page+splitOffset, getKeyLength(attribute, (char *)page+splitOffset));
+        return 0;
+    }
+    getLeafKey(page, splitOffset, attribute, splitKey);
+    
+    // suffix truncation: the key pushed up only has to separate the last key of the old page from the first one of the new page
+    if(attribute.type == TypeVarChar && splitNumOfRecords > 0 && splitNumOfRecords < numOfRecords){
+        void *leftKey = malloc(PAGE_SIZE);
+        getLeafKey(page, getKeyOffset(page, splitNumOfRecords - 1), attribute, leftKey);
+        getShortSeparator(leftKey, splitKey, splitKey);
+        free(leftKey);
     }
     return 0;
 }
@@ -729,82 +1842,34 @@ RC IndexManager::getSplitInNode(int pageFlag, void *page, const Attribute &attri
  * Compare splitKey and key to determine which page the <key, data> should be in.
  * This function calls insertEntryToNode to write into page.
 */
-RC IndexManager::compareAndInsertToNode(int pageFlag, void *oldPage, void *newPage, const Attribute &attribute, const void *key, void *splitKey, const void *data, int sizeOfData){
+RC IndexManager::compareAndInsertToNode(IXFileHandle &ixFileHandle, int pageFlag, void *oldPage, void *newPage, const Attribute &attribute, const void *key, void *splitKey, const void *data, int sizeOfData){
 
-    switch (attribute.type){
-        case TypeInt:{
-            int dataInt, tempDataInt;
-            memcpy(&tempDataInt, (char *)splitKey, 4);
-            memcpy(&dataInt, key, sizeof(int));
-            // insert the new key into newPage or the oldPage if key is LE the splitKey
-            if(tempDataInt <= dataInt)
-                insertEntryToNode(pageFlag, newPage, attribute, key, data, sizeOfData);
-            else
-                insertEntryToNode(pageFlag, oldPage, attribute, key, data, sizeOfData);
-            break;
-        }
-        case TypeReal:{
-            float dataFloat, tempDataReal;
-            memcpy(&tempDataReal, (char *)splitKey, 4);
-            memcpy(&dataFloat, key, sizeof(float));
-            // insert the new key into newPage or the oldPage if key is LE the splitKey
-            if(tempDataReal <= dataFloat)
-                insertEntryToNode(pageFlag, newPage, attribute, key, data, sizeOfData);
-            else
-                insertEntryToNode(pageFlag, oldPage, attribute, key, data, sizeOfData);
-            break;
-        }
-        case TypeVarChar:{
-            int length, tempLength;
-            memcpy(&length, key, 4);
-            auto *dataVarChar = (char *)malloc(length+1);
-            memcpy(dataVarChar, (char *)key+4, length);
-            dataVarChar[length] = '\0';
-
-            memcpy(&tempLength, (char *)splitKey, 4);
-            auto *tempDataVarChar = (char *)malloc(tempLength+1);
-            memcpy(tempDataVarChar, (char *)splitKey+4, tempLength);
-            tempDataVarChar[tempLength] = '\0';
-            // insert the new key into newPage or the oldPage if key is LE the splitKey
-            if(strcmp(tempDataVarChar, dataVarChar) <= 0){
-                insertEntryToNode(pageFlag, newPage, attribute, key, data, sizeOfData);
-            }
-            else{
-                insertEntryToNode(pageFlag, oldPage, attribute, key, data, sizeOfData);
-            }
-            free(dataVarChar);
-            free(tempDataVarChar);
-            break;
-        }
-        default:{
-            return -1;
-        }
+    // insert the new key into newPage or the oldPage if key is LE the splitKey,
+    // compareNormalizedKey(...) and not strcmp, VARCHAR keys (composite ones above all) may hold 0 bytes
+    if(compareNormalizedKey(attribute, splitKey, key) <= 0){
+        return insertEntryToNode(ixFileHandle, pageFlag, newPage, attribute, key, data, sizeOfData);
     }
-
-    return 0;
+    return insertEntryToNode(ixFileHandle, pageFlag, oldPage, attribute, key, data, sizeOfData);
 }
 
-RC IndexManager::redistributeNode(IXFileHandle &ixFileHandle, int pageFlag, void *oldPage, void *newPage, int splitOffset, int splitNumOfRecords, const Attribute &attribute){
+RC IndexManager::redistributeNode(int pageFlag, void *oldPage, void *newPage, int splitOffset, int splitNumOfRecords, const Attribute &attribute){
 
+    int dataEnd = getNodeDataEnd(oldPage);
     if(pageFlag == IM_FLAG || pageFlag == ROOT_FLAG){
         imPageDirectory oldImDirectory;
         memcpy(&oldImDirectory, (char *)oldPage, IM_DIR_SIZE);
-        int splitKeyLength;
-        if(attribute.type == TypeVarChar){
-            memcpy(&splitKeyLength, (char *)oldPage+splitOffset, 4);
-            splitKeyLength += 4;
-        } else
-            splitKeyLength = 4;
-
+        int splitKeyLength = getKeyLength(attribute, (char *)oldPage+splitOffset);
 
         // split the content of old page into two pages
         // start from the pointer of the <k,p>
-        memcpy((char *)newPage+IM_DIR_SIZE, (char *)oldPage+splitOffset+splitKeyLength, PAGE_SIZE-oldImDirectory.freeSpace-splitOffset-splitKeyLength);
+        int newDataLength = dataEnd-splitOffset-splitKeyLength;
+        memcpy((char *)newPage+IM_DIR_SIZE, (char *)oldPage+splitOffset+splitKeyLength, newDataLength);
         memset((char *)oldPage+splitOffset, 0, PAGE_SIZE-splitOffset);
 
         // -1 for only remain the pointer of the split key
-        imPageDirectory newImDirectory = {oldImDirectory.flag, PAGE_SIZE-(PAGE_SIZE-oldImDirectory.freeSpace-splitOffset-splitKeyLength+IM_DIR_SIZE), oldImDirectory.numOfRecords-splitNumOfRecords-1};
-        oldImDirectory.freeSpace = PAGE_SIZE-splitOffset;
+        int newNumOfRecords = oldImDirectory.numOfRecords-splitNumOfRecords-1;
+        imPageDirectory newImDirectory = {oldImDirectory.flag, PAGE_SIZE-IM_DIR_SIZE-newDataLength-newNumOfRecords*IX_SLOT_SIZE, newNumOfRecords};
+        oldImDirectory.freeSpace = PAGE_SIZE-splitOffset-splitNumOfRecords*IX_SLOT_SIZE;
         oldImDirectory.numOfRecords = splitNumOfRecords;
 
         memcpy(newPage, &newImDirectory, IM_DIR_SIZE);
@@ -815,25 +1880,34 @@ RC IndexManager::redistributeNode(IXFileHandle &ixFileHandle, int pageFlag, void
         leafPageDirectory oldLeafDirectory;
         memcpy(&oldLeafDirectory, (char *)oldPage, LEAF_DIR_SIZE);
 
-        // split the content of old page into two pages
-        memcpy((char *)newPage+LEAF_DIR_SIZE, (char *)oldPage+splitOffset, PAGE_SIZE-oldLeafDirectory.freeSpace-splitOffset);
+        // split the content of old page into two pages, the new page starts with the same prefix
+        int dataStart = getNodeDataStart(oldPage, attribute);
+        int newDataLength = dataEnd-splitOffset;
+        memcpy((char *)newPage+LEAF_DIR_SIZE, (char *)oldPage+LEAF_DIR_SIZE, dataStart-LEAF_DIR_SIZE);
+        memcpy((char *)newPage+dataStart, (char *)oldPage+splitOffset, newDataLength);
         memset((char *)oldPage+splitOffset, 0, PAGE_SIZE-splitOffset);
 
         // initialize newLeafDirectory
-        leafPageDirectory newLeafDirectory = {LEAF_FLAG, PAGE_SIZE-(PAGE_SIZE-oldLeafDirectory.freeSpace-splitOffset+LEAF_DIR_SIZE), oldLeafDirectory.numOfRecords-splitNumOfRecords, oldLeafDirectory.nextNode};
+        int newNumOfRecords = oldLeafDirectory.numOfRecords-splitNumOfRecords;
+        leafPageDirectory newLeafDirectory = {LEAF_FLAG, PAGE_SIZE-dataStart-newDataLength-newNumOfRecords*IX_SLOT_SIZE, newNumOfRecords,
+                                              oldLeafDirectory.nextNode, -1};
         // update oldLeafDirectory
-        oldLeafDirectory.freeSpace = PAGE_SIZE-splitOffset;
+        oldLeafDirectory.freeSpace = PAGE_SIZE-splitOffset-splitNumOfRecords*IX_SLOT_SIZE;
         oldLeafDirectory.numOfRecords = splitNumOfRecords;
 
         memcpy(newPage, &newLeafDirectory, LEAF_DIR_SIZE);
         memcpy(oldPage, &oldLeafDirectory, LEAF_DIR_SIZE);
     }
-
+    
+    // the memset above cleared the slots of old page, new page has none yet
+    buildSlotArray(pageFlag, oldPage, attribute);
+    buildSlotArray(pageFlag, newPage, attribute);
 
     return 0;
 }
 
-RC IndexManager::insertEntrytoNodeWithSplitting(IXFileHandle &ixFileHandle, int pageFlag, unsigned pageNum, unsigned &newPageNum, void *page, void *splitKey, const Attribute &attribute, const void *key, const void *data, int sizeOfData){
+RC IndexManager::insertEntrytoNodeWithSplitting(IXFileHandle &ixFileHandle, int pageFlag, unsigned pageNum, unsigned &newPageNum, void *page, void *splitKey, const Attribute &attribute, const void *key, const void *data, int sizeOfData,
+                                                 const void *lowKey, const void *highKey){
 
     RC rc;
     int splitOffset, splitNumOfRecords;
@@ -842,28 +1916,47 @@ RC IndexManager::insertEntrytoNodeWithSplitting(IXFileHandle &ixFileHandle, int
 
     // split and insert
     
-    rc = getSplitInNode(pageFlag, page, attribute, splitOffset, splitNumOfRecords, splitKey, sizeOfData);
+    rc = getSplitInNode(pageFlag, page, attribute, splitOffset, splitNumOfRecords, splitKey);
     if(rc != 0){
         // std::cout << "[Error] insertEntrytoNodeWithSplitting -> getSplitInNode." << std::endl;
         free(newPage);
         return -1;
     }
-    rc = redistributeNode(ixFileHandle, pageFlag, page, newPage, splitOffset, splitNumOfRecords, attribute);
+    rc = redistributeNode(pageFlag, page, newPage, splitOffset, splitNumOfRecords, attribute);
     if(rc != 0){
         // std::cout << "[Error] insertEntrytoNodeWithSplitting -> redistributeNode." << std::endl;
         free(newPage);
         return -1;
     }
-    rc = compareAndInsertToNode(pageFlag, page, newPage, attribute, key, splitKey, data, sizeOfData);
+    if(pageFlag == LEAF_FLAG && attribute.type == TypeVarChar){
+        // splitKey is the new fence between the halves, their prefixes only grow
+        rc = setLeafPrefix(page, attribute, (char *)splitKey+sizeof(int), getCommonPrefixLength(lowKey, splitKey));
+        if(rc == 0){
+            rc = setLeafPrefix(newPage, attribute, (char *)splitKey+sizeof(int), getCommonPrefixLength(splitKey, highKey));
+        }
+        if(rc != 0){
+            // std::cout << "[Error] insertEntrytoNodeWithSplitting -> setLeafPrefix." << std::endl;
+            free(newPage);
+            return -1;
+        }
+    }
+    rc = compareAndInsertToNode(ixFileHandle, pageFlag, page, newPage, attribute, key, splitKey, data, sizeOfData);
     if(rc != 0){
         // std::cout << "[Error] insertEntrytoNodeWithSplitting -> compareAndInsertToNode." << std::endl;
         free(newPage);
         return -1;
     }
 
-    // append the new page
-    if(ixFileHandle.getFileHandle().appendPage(newPage) == 0){
-        newPageNum = ixFileHandle.getFileHandle().getNumberOfPages()-1;
+    // the new leaf comes after this one
+    leafPageDirectory newDirectory;
+    if(pageFlag == LEAF_FLAG){
+        memcpy(&newDirectory, newPage, LEAF_DIR_SIZE);
+        newDirectory.prevNode = (int)pageNum;
+        memcpy(newPage, &newDirectory, LEAF_DIR_SIZE);
+    }
+    
+    // take a free page or append one, other threads may take pages at the same time, so use the page number allocatePage(...) gives.
+    if(allocatePage(ixFileHandle, newPage, newPageNum) == 0){
 //        std::cout << "new Page number -> " << newPageNum << std::endl;
     }
     else{
@@ -872,13 +1965,18 @@ RC IndexManager::insertEntrytoNodeWithSplitting(IXFileHandle &ixFileHandle, int
         return -1;
     }
     
-    //update oldPage for leafNode -> directory.nextNode = newPageNum;
+    //update oldPage for leafNode -> directory.nextNode = newPageNum, and the leaf after it points back to the new one.
     if(pageFlag == LEAF_FLAG){
         leafPageDirectory directory;
         memcpy(&directory, page, LEAF_DIR_SIZE);
         directory.nextNode = (int)newPageNum;
         memcpy(page, &directory, LEAF_DIR_SIZE);
 //        std::cout << "directory.nextNode: " << directory.nextNode << std::endl;
+        if(newDirectory.nextNode != -1 && setPrevNode(ixFileHandle, newDirectory.nextNode, (int)newPageNum) != 0){
+            // std::cout << "[Error] insertEntrytoNodeWithSplitting() set prevNode of the next leaf" << std::endl;
+            free(newPage);
+            return -1;
+        }
     }
 
     if(ixFileHandle.getFileHandle().writePage(pageNum, page) == 0){
@@ -898,7 +1996,7 @@ RC IndexManager::insertEntrytoNodeWithSplitting(IXFileHandle &ixFileHandle, int
 */
 RC IndexManager::insertEntrytoNodeWithoutSplitting(IXFileHandle &ixFileHandle, unsigned pageNum, int pageFlag, void *page, const Attribute &attribute, const void *key, const void *data, int sizeOfData){
     RC rc;
-    rc = insertEntryToNode(pageFlag, page, attribute, key, data, sizeOfData);
+    rc = insertEntryToNode(ixFileHandle, pageFlag, page, attribute, key, data, sizeOfData);
     if(rc != 0){
         // std::cout << "[Error] insertEntrytoNodeWithoutSplitting -> fail to insertEntryToNode" << std::endl;
         return -1;
@@ -911,14 +2009,18 @@ RC IndexManager::insertEntrytoNodeWithoutSplitting(IXFileHandle &ixFileHandle, u
     return 0;
 }
 
-RC IndexManager::appendRootLeafPage(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid){
+RC IndexManager::appendRootLeafPage(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const void *data, int sizeOfData){
 
     void *page = malloc(PAGE_SIZE);
-    leafPageDirectory directory = {LEAF_FLAG, PAGE_SIZE-LEAF_DIR_SIZE, 0, -1};
+    leafPageDirectory directory = {LEAF_FLAG, PAGE_SIZE-LEAF_DIR_SIZE, 0, -1, -1};
+    if(attribute.type == TypeVarChar){
+        // no prefix: the root-leaf has no fence keys
+        directory.freeSpace -= LEAF_PREFIX_SIZE;
+    }
     memset(page, 0, PAGE_SIZE);
     memcpy(page, &directory, LEAF_DIR_SIZE);
 
-    RC rc = insertEntryToNode(LEAF_FLAG, page, attribute, key, &rid, sizeof(rid));
+    RC rc = insertEntryToNode(ixFileHandle, LEAF_FLAG, page, attribute, key, data, sizeOfData);
     if(rc != 0){
         // std::cout << "[Error] appendRootLeafPage -> insertEntryToNode" << std::endl;
         return -1;
@@ -929,7 +2031,7 @@ RC IndexManager::appendRootLeafPage(IXFileHandle &ixFileHandle, const Attribute
     return 0;
 }
 
-RC IndexManager::splitRootLeafPage(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid){
+RC IndexManager::splitRootLeafPage(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const void *data, int sizeOfData){
 
     void *leftPage = malloc(PAGE_SIZE);
     void *rootPage = malloc(PAGE_SIZE);
@@ -942,17 +2044,16 @@ RC IndexManager::splitRootLeafPage(IXFileHandle &ixFileHandle, const Attribute &
     
     RC rc;
 
+    unsigned leftPageNum, rightageNum, rootPageNum;
     ixFileHandle.getFileHandle().readPage(0, leftPage);
-    ixFileHandle.getFileHandle().appendPage(leftPage);
+    ixFileHandle.getFileHandle().appendPage(leftPage, leftPageNum);
 
-    int leftPageNum = (int)(ixFileHandle.getFileHandle().getNumberOfPages()-1);
-     unsigned rightageNum, rootPageNum;
 
     // pageNum should be 1.
 //    std::cout<< "leftPageNum is " << leftPageNum << std::endl;
 
-    rc = insertEntrytoNodeWithSplitting(ixFileHandle, LEAF_FLAG, leftPageNum, rightageNum, leftPage, splitKey, attribute, key, &rid,
-                                   sizeof(rid));
+    rc = insertEntrytoNodeWithSplitting(ixFileHandle, LEAF_FLAG, leftPageNum, rightageNum, leftPage, splitKey, attribute, key, data,
+                                   sizeOfData);
     if(rc != 0){
         // std::cout << "[Error] splitRootLeafPage -> insertEntrytoNodeWithSplitting." << std::endl;
         return -1;
@@ -965,8 +2066,7 @@ RC IndexManager::splitRootLeafPage(IXFileHandle &ixFileHandle, const Attribute &
     }
     
     // write the rootPage back into disk.
-    ixFileHandle.getFileHandle().appendPage(rootPage);
-    rootPageNum = ixFileHandle.getFileHandle().getNumberOfPages()-1;
+    ixFileHandle.getFileHandle().appendPage(rootPage, rootPageNum);
 
     // we add a ROOT_PTR page which always points to the root page.
     int rootPtrFlag = ROOT_PTR_FLAG;
@@ -986,39 +2086,34 @@ RC IndexManager::splitRootLeafPage(IXFileHandle &ixFileHandle, const Attribute &
 }
 
 
-RC IndexManager::splitRootPage(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned rootPageNum, const void *key, const void *data){
+RC IndexManager::splitRootPage(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned rootPageNum, void *rootPage, const void *key, const void *data){
 
-    void *leftPage = malloc(PAGE_SIZE);
-    void *rootPage = malloc(PAGE_SIZE);
+    void *leftPage = rootPage;
     void *splitRootKey = malloc(PAGE_SIZE);
-    
-    memset(leftPage, 0, PAGE_SIZE);
-    memset(rootPage, 0, PAGE_SIZE);
     memset(splitRootKey, 0, PAGE_SIZE);
     
-    ixFileHandle.getFileHandle().readPage(rootPageNum, leftPage);
     // convert the leftPage from root to imNode
     imPageDirectory imDirectory;
     memcpy(&imDirectory, (char *)leftPage, IM_DIR_SIZE);
     imDirectory.flag = IM_FLAG;
-    ixFileHandle.getFileHandle().appendPage(leftPage);
-    int leftPageNum = (int)(ixFileHandle.getFileHandle().getNumberOfPages()-1);
+    memcpy((char *)leftPage, &imDirectory, IM_DIR_SIZE);
+    unsigned leftPageNum, newimPageNum;
+    allocatePage(ixFileHandle, leftPage, leftPageNum);
 
-    unsigned newimPageNum;
     insertEntrytoNodeWithSplitting(ixFileHandle, IM_FLAG, leftPageNum, newimPageNum, leftPage, splitRootKey, attribute, key, data,
                                    sizeof(unsigned));
 
     // generate a new root page, which stores two pointers pointing to upper left and right pages.
+    // the left page is written already, its buffer now takes the new root.
+    memset(rootPage, 0, PAGE_SIZE);
     generateNewRootNode(ixFileHandle, leftPageNum, newimPageNum, rootPage, attribute, splitRootKey);
 
     // re-write the root page
-    ixFileHandle.getFileHandle().writePage(rootPageNum, rootPage);
+    RC rc = ixFileHandle.getFileHandle().writePage(rootPageNum, rootPage);
 
-    free(leftPage);
-    free(rootPage);
     free(splitRootKey);
 
-    return 0;
+    return rc;
 }
 
 
@@ -1031,7 +2126,7 @@ RC IndexManager::generateNewRootNode(IXFileHandle &ixFileHandle, unsigned leftPa
     memcpy((char *)rootPage, &rootImDirectory, IM_DIR_SIZE);
 
     // std::cout << "insert into root node" << std::endl;
-    RC rc = insertEntryToNode(ROOT_FLAG, rootPage, attribute, splitkey, &rightPageNum, sizeof(rightPageNum));
+    RC rc = insertEntryToNode(ixFileHandle, ROOT_FLAG, rootPage, attribute, splitkey, &rightPageNum, sizeof(rightPageNum));
     if(rc != 0){
         // std::cout << "[Error] generateNewRootNode -> insertEntryToNode." << std::endl;
         return -1;
@@ -1045,211 +2140,1048 @@ RC IndexManager::generateNewRootNode(IXFileHandle &ixFileHandle, unsigned leftPa
  * get the NextNode(pageNum) when traversing the B+tree.
  * This function is for im Node.
 */
-RC IndexManager::getNextNode(IXFileHandle &ixFileHandle, unsigned curNode, unsigned &nextNode, const Attribute &attribute, const void *key){
-    void *imPage = malloc(PAGE_SIZE);
-    ixFileHandle.getFileHandle().readPage(curNode, imPage);
-
+RC IndexManager::getNextNode(const void *imPage, unsigned &nextNode, const Attribute &attribute, const void *key, int *keyIndex) const{
     int pageFlag;
     memcpy(&pageFlag, imPage, sizeof(int));
 
     if(pageFlag == LEAF_FLAG){
 //        std::cout << "[Warning] getNextNode -> arrive leaf node." << std::endl;
-        free(imPage);
         return 1;
     }
 
-    imPageDirectory directory;
-    memcpy(&directory, imPage, IM_DIR_SIZE);
-    // P0 ptr which is a pageNum
-    int startOffset = IM_DIR_SIZE + sizeof(unsigned);
-    
-    if(key == NULL){
-        memcpy(&nextNode, (char *)imPage+IM_DIR_SIZE, sizeof(unsigned));
-//        std::cout << "nextNode is " << nextNode << std::endl;
-        free(imPage);
-        return 0;
+    imPageDirectory directory;
+    memcpy(&directory, imPage, IM_DIR_SIZE);
+    
+    if(key == NULL){
+        // P0 ptr which is a pageNum
+        memcpy(&nextNode, (char *)imPage+IM_DIR_SIZE, sizeof(unsigned));
+//        std::cout << "nextNode is " << nextNode << std::endl;
+        return 0;
+    }
+
+    // get the left pointer of the first key > key, or the last pointer if there is no such key.
+    int index = searchInsideNode(imPage, attribute, key, false);
+    int offset = index < directory.numOfRecords ? getKeyOffset(imPage, index) : getNodeDataEnd(imPage);
+    memcpy(&nextNode, (char *)imPage+offset-sizeof(unsigned), sizeof(unsigned));
+    if(keyIndex != NULL){
+        *keyIndex = index;
+    }
+    return 0;
+}
+
+RC IndexManager::readNode(IXFileHandle &ixFileHandle, unsigned pageNum, void *page, int level){
+    std::atomic<unsigned> *treeVersion = ixFileHandle.getTreeVersion();
+    if(level > IX_CACHED_LEVELS || treeVersion == nullptr){
+        return ixFileHandle.getFileHandle().readPage(pageNum, page);
+    }
+    // the node is latched: whoever changed it has started the new version before releasing the latch.
+    unsigned version = treeVersion->load();
+    if(ixFileHandle.readCachedNode(pageNum, version, page) == 0){
+        return 0;
+    }
+    if(ixFileHandle.getFileHandle().readPage(pageNum, page) != 0){
+        return -1;
+    }
+    int pageFlag;
+    memcpy(&pageFlag, page, sizeof(int));
+    if(pageFlag != LEAF_FLAG){
+        ixFileHandle.cacheNode(pageNum, version, page);
+    }
+    return 0;
+}
+
+RC IndexManager::newTreeVersion(IXFileHandle &ixFileHandle){
+    std::atomic<unsigned> *treeVersion = ixFileHandle.getTreeVersion();
+    if(treeVersion != nullptr){
+        treeVersion->fetch_add(1);
+    }
+    return 0;
+}
+
+RC IndexManager::newTreeVersion(const std::string &fileName){
+    std::lock_guard<std::mutex> lock(_treeVersionsMutex);
+    auto it = _treeVersions.find(fileName);
+    if(it != _treeVersions.end()){
+        it->second->fetch_add(1);
+    }
+    return 0;
+}
+
+unsigned IndexManager::getTreeVersion(IXFileHandle &ixFileHandle) const{
+    std::atomic<unsigned> *treeVersion = ixFileHandle.getTreeVersion();
+    return treeVersion == nullptr ? 0 : treeVersion->load();
+}
+
+RC IndexManager::allocatePage(IXFileHandle &ixFileHandle, const void *data, unsigned &pageNum){
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    ExclusiveLatchGuard guard(fileHandle.getLatch(FREE_LIST_LATCH));
+    
+    // page 0 is read from the file, its copies may have an old free list
+    char *page = (char *)malloc(PAGE_SIZE);
+    int pageFlag = EMPTY_FLAG;
+    unsigned firstFreePage = 0;
+    if(fileHandle.getNumberOfPages() > 0 && fileHandle.readPage(ROOT_PAGE, page) == 0){
+        memcpy(&pageFlag, page, sizeof(int));
+        memcpy(&firstFreePage, page+FREE_LIST_OFFSET, sizeof(unsigned));
+    }
+    if(pageFlag != ROOT_PTR_FLAG || firstFreePage == 0){
+        free(page);
+        return fileHandle.appendPage(data, pageNum);
+    }
+    
+    // take the first free page, page 0 points to the one after it
+    char *freePage = (char *)malloc(PAGE_SIZE);
+    RC rc = fileHandle.readPage(firstFreePage, freePage);
+    if(rc == 0){
+        memcpy(page+FREE_LIST_OFFSET, freePage+sizeof(int), sizeof(unsigned));
+        rc = fileHandle.writePage(ROOT_PAGE, page);
+    }
+    if(rc == 0){
+        ExclusiveLatchGuard pageGuard(fileHandle.getLatch(firstFreePage));
+        rc = fileHandle.writePage(firstFreePage, data);
+    }
+    pageNum = firstFreePage;
+    newTreeVersion(ixFileHandle);
+    free(freePage);
+    free(page);
+    return rc;
+}
+
+RC IndexManager::freePage(IXFileHandle &ixFileHandle, unsigned pageNum){
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    ExclusiveLatchGuard guard(fileHandle.getLatch(FREE_LIST_LATCH));
+    
+    char *page = (char *)malloc(PAGE_SIZE);
+    int pageFlag = EMPTY_FLAG;
+    unsigned firstFreePage = 0;
+    if(fileHandle.readPage(ROOT_PAGE, page) == 0){
+        memcpy(&pageFlag, page, sizeof(int));
+        memcpy(&firstFreePage, page+FREE_LIST_OFFSET, sizeof(unsigned));
+    }
+    if(pageFlag != ROOT_PTR_FLAG){
+        // the root-leaf page has no free list, the page stays unused
+        free(page);
+        return 0;
+    }
+    
+    // the page goes in front of the list
+    char *freePage = (char *)malloc(PAGE_SIZE);
+    memset(freePage, 0, PAGE_SIZE);
+    int freeFlag = FREE_FLAG;
+    memcpy(freePage, &freeFlag, sizeof(int));
+    memcpy(freePage+sizeof(int), &firstFreePage, sizeof(unsigned));
+    RC rc = fileHandle.writePage(pageNum, freePage);
+    if(rc == 0){
+        memcpy(page+FREE_LIST_OFFSET, &pageNum, sizeof(unsigned));
+        rc = fileHandle.writePage(ROOT_PAGE, page);
+    }
+    newTreeVersion(ixFileHandle);
+    free(freePage);
+    free(page);
+    return rc;
+}
+
+RC IndexManager::searchInsideLeafNode(const void *page, int &offset, int &recordId, const Attribute &attribute, const void *key, bool inclusiveKey) const{
+
+//    std::cout << "We are in searchInsideLeafNode(). " << std::endl;
+
+    int pageFlag;
+    memcpy(&pageFlag, page, sizeof(int));
+    if(pageFlag != LEAF_FLAG){
+//        std::cout << "[Error]: searchInsideLeafNode -> this node is not a leaf node." << std::endl;
+        return -1;
+    }
+
+    leafPageDirectory directory;
+    memcpy(&directory, page, LEAF_DIR_SIZE);
+    int numOfRecords = directory.numOfRecords;
+    
+    if(key == NULL){
+        offset = getNodeDataStart(page, attribute);
+        recordId = 0;
+        return 0;
+    }
+
+    // the first <newKey, rid> pair with key <= newKey (inclusive) or key < newKey
+    recordId = searchInsideNode(page, attribute, key, inclusiveKey);
+    if(recordId < numOfRecords){
+        offset = getKeyOffset(page, recordId);
+        return 0;
+    }
+    offset = getNodeDataEnd(page);
+//    std::cout << "[Error]: searchInsideLeafNode -> can't find a value." << std::endl;
+    return -1;
+}
+
+int IndexManager::searchInsideNode(const void *page, const Attribute &attribute, const void *key, bool inclusiveKey) const{
+    int numOfRecords;
+    memcpy(&numOfRecords, (char *)page+2*sizeof(int), sizeof(int));
+    int low = 0, high = numOfRecords;
+    while(low < high){
+        int mid = (low + high) / 2;
+        int cmp = compareLeafKey(page, getKeyOffset(page, mid), attribute, key);
+        if(cmp < 0 || (cmp == 0 && !inclusiveKey)){
+            low = mid + 1;
+        }
+        else{
+            high = mid;
+        }
+    }
+    return low;
+}
+
+int IndexManager::getKeyOffset(const void *page, int index) const{
+    unsigned short offset;
+    memcpy(&offset, (char *)page+PAGE_SIZE-(index+1)*IX_SLOT_SIZE, IX_SLOT_SIZE);
+    return offset;
+}
+
+void IndexManager::setKeyOffset(void *page, int index, int offset) const{
+    unsigned short slot = offset;
+    memcpy((char *)page+PAGE_SIZE-(index+1)*IX_SLOT_SIZE, &slot, IX_SLOT_SIZE);
+}
+
+int IndexManager::getNodeDataEnd(const void *page) const{
+    // leaf and im directories both start with flag, freeSpace and numOfRecords
+    imPageDirectory directory;
+    memcpy(&directory, page, IM_DIR_SIZE);
+    return PAGE_SIZE - directory.freeSpace - directory.numOfRecords * IX_SLOT_SIZE;
+}
+
+RC IndexManager::buildSlotArray(int pageFlag, void *page, const Attribute &attribute) const{
+    imPageDirectory directory;
+    memcpy(&directory, page, IM_DIR_SIZE);
+    int offset = getNodeDataStart(page, attribute);
+    for(int index = 0; index < directory.numOfRecords; index++){
+        setKeyOffset(page, index, offset);
+        offset += (pageFlag == LEAF_FLAG) ? getLeafEntryLength(page, offset, attribute)
+                                          : getKeyLength(attribute, (char *)page+offset) + (int)sizeof(unsigned);
+    }
+    return 0;
+}
+
+RC IndexManager::readNodeEntries(const void *page, const Attribute &attribute, std::vector<std::string> &keys,
+                                 std::vector<std::string> &data, int &link) const{
+    imPageDirectory directory;
+    memcpy(&directory, page, IM_DIR_SIZE);
+    keys.clear();
+    data.clear();
+    std::string key(PAGE_SIZE, '\0');
+    if(directory.flag == LEAF_FLAG){
+        leafPageDirectory leafDirectory;
+        memcpy(&leafDirectory, page, LEAF_DIR_SIZE);
+        link = leafDirectory.nextNode;
+        for(int index = 0; index < directory.numOfRecords; index++){
+            int offset = getKeyOffset(page, index);
+            getLeafKey(page, offset, attribute, &key[0]);
+            keys.emplace_back(key.data(), getKeyLength(attribute, key.data()));
+            const char *posting = (char *)page+offset+getKeyLength(attribute, (char *)page+offset);
+            data.emplace_back(posting, getPostingLength(posting));
+        }
+        return 0;
+    }
+    memcpy(&link, (char *)page+IM_DIR_SIZE, sizeof(unsigned));
+    for(int index = 0; index < directory.numOfRecords; index++){
+        int offset = getKeyOffset(page, index);
+        int keyLength = getKeyLength(attribute, (char *)page+offset);
+        keys.emplace_back((char *)page+offset, keyLength);
+        data.emplace_back((char *)page+offset+keyLength, sizeof(unsigned));
+    }
+    return 0;
+}
+
+RC IndexManager::writeNodeEntries(int pageFlag, void *page, const Attribute &attribute, const std::vector<std::string> &keys,
+                                  const std::vector<std::string> &data, size_t begin, size_t end, int link, const char *prefix, int prefixLength,
+                                  int prevLink) const{
+    bool leaf = pageFlag == LEAF_FLAG;
+    if(!leaf){
+        prefixLength = 0;
+    }
+    int dataStart = !leaf ? IM_DIR_SIZE + sizeof(unsigned) :
+                    attribute.type == TypeVarChar ? LEAF_DIR_SIZE + LEAF_PREFIX_SIZE + prefixLength : LEAF_DIR_SIZE;
+    int length = dataStart;
+    for(size_t i = begin; i < end; i++){
+        if(prefixLength > 0 && (keys[i].size() < sizeof(int) + prefixLength || keys[i].compare(sizeof(int), prefixLength, prefix, prefixLength) != 0)){
+            // std::cout << "[Error]: writeNodeEntries -> a key doesn't have the prefix." << std::endl;
+            return -1;
+        }
+        length += keys[i].size() - prefixLength + data[i].size() + IX_SLOT_SIZE;
+    }
+    if(length > PAGE_SIZE){
+        return -1;
+    }
+    
+    int numOfRecords = end - begin;
+    memset(page, 0, PAGE_SIZE);
+    if(leaf){
+        leafPageDirectory directory = {LEAF_FLAG, PAGE_SIZE - length, numOfRecords, link, prevLink};
+        memcpy(page, &directory, LEAF_DIR_SIZE);
+        if(attribute.type == TypeVarChar){
+            memcpy((char *)page+LEAF_DIR_SIZE, &prefixLength, LEAF_PREFIX_SIZE);
+            memcpy((char *)page+LEAF_DIR_SIZE+LEAF_PREFIX_SIZE, prefix, prefixLength);
+        }
+    }
+    else{
+        imPageDirectory directory = {pageFlag, PAGE_SIZE - length, numOfRecords};
+        memcpy(page, &directory, IM_DIR_SIZE);
+        memcpy((char *)page+IM_DIR_SIZE, &link, sizeof(unsigned));
+    }
+    int offset = dataStart;
+    for(size_t i = begin; i < end; i++){
+        if(prefixLength > 0){
+            int suffixLength = keys[i].size() - sizeof(int) - prefixLength;
+            memcpy((char *)page+offset, &suffixLength, sizeof(int));
+            memcpy((char *)page+offset+sizeof(int), keys[i].data()+sizeof(int)+prefixLength, suffixLength);
+            offset += sizeof(int) + suffixLength;
+        }
+        else{
+            memcpy((char *)page+offset, keys[i].data(), keys[i].size());
+            offset += keys[i].size();
+        }
+        memcpy((char *)page+offset, data[i].data(), data[i].size());
+        offset += data[i].size();
+    }
+    return buildSlotArray(pageFlag, page, attribute);
+}
+
+RC IndexManager::setPrevNode(IXFileHandle &ixFileHandle, unsigned pageNum, int prevNode){
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    char *page = (char *)malloc(PAGE_SIZE);
+    leafPageDirectory directory;
+    fileHandle.getLatch(pageNum).lockExclusive();
+    RC rc = fileHandle.readPage(pageNum, page);
+    memcpy(&directory, page, LEAF_DIR_SIZE);
+    if(rc == 0 && directory.flag == LEAF_FLAG){
+        directory.prevNode = prevNode;
+        memcpy(page, &directory, LEAF_DIR_SIZE);
+        rc = fileHandle.writePage(pageNum, page);
+    }
+    else{
+        // std::cout << "[Error]: setPrevNode -> page is not a leaf." << std::endl;
+        rc = -1;
+    }
+    fileHandle.getLatch(pageNum).unlockExclusive();
+    free(page);
+    return rc;
+}
+
+int IndexManager::compareKey(const Attribute &attribute, const void *key1, const void *key2) const{
+    switch (attribute.type){
+        case TypeInt:{
+            int data1, data2;
+            memcpy(&data1, key1, sizeof(int));
+            memcpy(&data2, key2, sizeof(int));
+            return (data1 > data2) - (data1 < data2);
+        }
+        case TypeReal:{
+            char normalized1[sizeof(unsigned)], normalized2[sizeof(unsigned)];
+            return memcmp(normalizeKey(attribute, key1, normalized1), normalizeKey(attribute, key2, normalized2), sizeof(unsigned));
+        }
+        case TypeVarChar:{
+            int length1, length2;
+            memcpy(&length1, key1, sizeof(int));
+            memcpy(&length2, key2, sizeof(int));
+            int cmp = memcmp((char *)key1+sizeof(int), (char *)key2+sizeof(int), std::min(length1, length2));
+            if(cmp != 0){
+                return cmp;
+            }
+            return (length1 > length2) - (length1 < length2);
+        }
+        default:
+            break;
+    }
+    return 0;
+}
+
+const void *IndexManager::normalizeKey(const Attribute &attribute, const void *key, void *normalized) const{
+    if(attribute.type == TypeVarChar){
+        return key;
+    }
+    unsigned bits;
+    memcpy(&bits, key, sizeof(unsigned));
+    if(attribute.type == TypeReal){
+        float value;
+        memcpy(&value, key, sizeof(float));
+        if(value == 0){
+            bits = 0;       // -0.0 == 0.0
+        }
+        else if(value != value){
+            bits = 0x7FC00000u;     // the quiet NaN, above +infinity
+        }
+    }
+    if(attribute.type == TypeReal && (bits & 0x80000000u)){
+        bits = ~bits;
+    }
+    else{
+        bits ^= 0x80000000u;
+    }
+    for(int i = 0; i < (int)sizeof(unsigned); i++){
+        ((char *)normalized)[i] = (char) (bits >> (24 - CHAR_BIT * i));
+    }
+    return normalized;
+}
+
+RC IndexManager::denormalizeKey(const Attribute &attribute, const void *normalized, void *key) const{
+    if(attribute.type == TypeVarChar){
+        memcpy(key, normalized, getKeyLength(attribute, normalized));
+        return 0;
+    }
+    unsigned bits = 0;
+    for(int i = 0; i < (int)sizeof(unsigned); i++){
+        bits = bits << CHAR_BIT | ((const unsigned char *)normalized)[i];
+    }
+    if(attribute.type == TypeReal && !(bits & 0x80000000u)){
+        bits = ~bits;
+    }
+    else{
+        bits ^= 0x80000000u;
+    }
+    memcpy(key, &bits, sizeof(unsigned));
+    return 0;
+}
+
+int IndexManager::compareNormalizedKey(const Attribute &attribute, const void *key1, const void *key2) const{
+    if(attribute.type != TypeVarChar){
+        return memcmp(key1, key2, sizeof(unsigned));
+    }
+    return compareKey(attribute, key1, key2);
+}
+
+int IndexManager::getKeyLength(const Attribute &attribute, const void *key) const{
+    if(attribute.type == TypeVarChar){
+        int length;
+        memcpy(&length, key, sizeof(int));
+        return sizeof(int) + length;
+    }
+    return 4;
+}
+
+Attribute IndexManager::getCompositeAttribute(const std::vector<Attribute> &attributes) const{
+    Attribute attribute;
+    attribute.type = TypeVarChar;
+    attribute.length = 0;
+    for(size_t i = 0; i < attributes.size(); i++){
+        if(i > 0){
+            attribute.name += COMPOSITE_KEY_SEPARATOR;
+        }
+        attribute.name += attributes[i].name;
+        // the marker byte, then a VARCHAR of 0 bytes only which are all escaped and its end, or 4 bytes
+        attribute.length += 1 + (attributes[i].type == TypeVarChar ? 2 * attributes[i].length + 2 : (int)sizeof(int));
+    }
+    return attribute;
+}
+
+int IndexManager::encodeCompositeValue(const Attribute &attribute, const void *value, char *key) const{
+    if(value == NULL){
+        key[0] = COMPOSITE_NULL;
+        return 1;
+    }
+    key[0] = COMPOSITE_NOT_NULL;
+    if(attribute.type == TypeVarChar){
+        int length, offset = 1;
+        memcpy(&length, value, sizeof(int));
+        const char *chars = (const char *)value + sizeof(int);
+        for(int i = 0; i < length; i++){
+            key[offset++] = chars[i];
+            if(chars[i] == 0){
+                key[offset++] = (char) 0xFF;
+            }
+        }
+        key[offset++] = 0;
+        key[offset++] = 0;
+        return offset;
+    }
+    
+    // INT and REAL values are normalized like the keys of the nodes
+    normalizeKey(attribute, value, key + 1);
+    return 1 + sizeof(unsigned);
+}
+
+RC IndexManager::encodeCompositeKey(const std::vector<Attribute> &attributes, const void *data, void *key) const{
+    int nullIndicatorSize = (attributes.size() + CHAR_BIT - 1) / CHAR_BIT;
+    const char *value = (const char *)data + nullIndicatorSize;
+    char *bytes = (char *)key + sizeof(int);
+    int length = 0;
+    for(size_t i = 0; i < attributes.size(); i++){
+        if(((const unsigned char *)data)[i / CHAR_BIT] & (unsigned) 1 << (unsigned) (7 - i % CHAR_BIT)){
+            length += encodeCompositeValue(attributes[i], NULL, bytes + length);
+            continue;
+        }
+        length += encodeCompositeValue(attributes[i], value, bytes + length);
+        value += getKeyLength(attributes[i], value);
+    }
+    memcpy(key, &length, sizeof(int));
+    return 0;
+}
+
+RC IndexManager::decodeCompositeKey(const std::vector<Attribute> &attributes, const void *key, void *data) const{
+    int length;
+    memcpy(&length, key, sizeof(int));
+    const unsigned char *bytes = (const unsigned char *)key + sizeof(int);
+    int nullIndicatorSize = (attributes.size() + CHAR_BIT - 1) / CHAR_BIT;
+    memset(data, 0, nullIndicatorSize);
+    char *value = (char *)data + nullIndicatorSize;
+    
+    int offset = 0;
+    for(size_t i = 0; i < attributes.size(); i++){
+        if(offset >= length){
+            // std::cout << "[Error]: decodeCompositeKey -> the key is too short." << std::endl;
+            return -1;
+        }
+        if(bytes[offset++] == COMPOSITE_NULL){
+            ((unsigned char *)data)[i / CHAR_BIT] |= (unsigned) 1 << (unsigned) (7 - i % CHAR_BIT);
+            continue;
+        }
+        if(attributes[i].type == TypeVarChar){
+            int valueLength = 0;
+            while(offset + 1 < length && (bytes[offset] != 0 || bytes[offset + 1] != 0)){
+                value[sizeof(int) + valueLength++] = bytes[offset];
+                offset += bytes[offset] == 0 ? 2 : 1;
+            }
+            if(offset + 1 >= length){
+                return -1;
+            }
+            offset += 2;
+            memcpy(value, &valueLength, sizeof(int));
+            value += sizeof(int) + valueLength;
+            continue;
+        }
+        if(offset + (int)sizeof(unsigned) > length){
+            return -1;
+        }
+        denormalizeKey(attributes[i], bytes + offset, value);
+        offset += sizeof(unsigned);
+        value += sizeof(unsigned);
+    }
+    return 0;
+}
+
+int IndexManager::getLeafPrefixLength(const void *page, const Attribute &attribute) const{
+    int pageFlag;
+    memcpy(&pageFlag, page, sizeof(int));
+    if(pageFlag != LEAF_FLAG || attribute.type != TypeVarChar){
+        return 0;
+    }
+    int prefixLength;
+    memcpy(&prefixLength, (char *)page+LEAF_DIR_SIZE, LEAF_PREFIX_SIZE);
+    return prefixLength;
+}
+
+int IndexManager::getNodeDataStart(const void *page, const Attribute &attribute) const{
+    int pageFlag;
+    memcpy(&pageFlag, page, sizeof(int));
+    if(pageFlag != LEAF_FLAG){
+        // extra 4 bytes to store the P0 pointer(pageNum).
+        return IM_DIR_SIZE + sizeof(unsigned);
+    }
+    if(attribute.type != TypeVarChar){
+        return LEAF_DIR_SIZE;
+    }
+    return LEAF_DIR_SIZE + LEAF_PREFIX_SIZE + getLeafPrefixLength(page, attribute);
+}
+
+RC IndexManager::getLeafKey(const void *page, int offset, const Attribute &attribute, void *key) const{
+    int prefixLength = getLeafPrefixLength(page, attribute);
+    if(prefixLength == 0){
+        memcpy(key, (char *)page+offset, getKeyLength(attribute, (char *)page+offset));
+        return 0;
+    }
+    int suffixLength;
+    memcpy(&suffixLength, (char *)page+offset, sizeof(int));
+    int length = prefixLength + suffixLength;
+    memcpy(key, &length, sizeof(int));
+    memcpy((char *)key+sizeof(int), (char *)page+LEAF_DIR_SIZE+LEAF_PREFIX_SIZE, prefixLength);
+    memcpy((char *)key+sizeof(int)+prefixLength, (char *)page+offset+sizeof(int), suffixLength);
+    return 0;
+}
+
+int IndexManager::compareLeafKey(const void *page, int offset, const Attribute &attribute, const void *key) const{
+    int prefixLength = getLeafPrefixLength(page, attribute);
+    if(prefixLength == 0){
+        return compareNormalizedKey(attribute, (char *)page+offset, key);
+    }
+    // the prefix decides unless key starts with it, then the rest of both keys does.
+    int length;
+    memcpy(&length, key, sizeof(int));
+    const char *data = (const char *)key+sizeof(int);
+    int cmp = memcmp((char *)page+LEAF_DIR_SIZE+LEAF_PREFIX_SIZE, data, std::min(prefixLength, length));
+    if(cmp != 0){
+        return cmp;
+    }
+    if(length < prefixLength){
+        return 1;
+    }
+    int suffixLength, restLength = length - prefixLength;
+    memcpy(&suffixLength, (char *)page+offset, sizeof(int));
+    cmp = memcmp((char *)page+offset+sizeof(int), data+prefixLength, std::min(suffixLength, restLength));
+    if(cmp != 0){
+        return cmp;
+    }
+    return (suffixLength > restLength) - (suffixLength < restLength);
+}
+
+int IndexManager::getCommonPrefixLength(const void *key1, const void *key2) const{
+    if(key1 == NULL || key2 == NULL){
+        return 0;
+    }
+    int length1, length2;
+    memcpy(&length1, key1, sizeof(int));
+    memcpy(&length2, key2, sizeof(int));
+    const char *data1 = (const char *)key1+sizeof(int), *data2 = (const char *)key2+sizeof(int);
+    int length = 0;
+    while(length < std::min(length1, length2) && data1[length] == data2[length]){
+        length++;
+    }
+    return length;
+}
+
+RC IndexManager::getShortSeparator(const void *leftKey, const void *rightKey, void *separator) const{
+    // up to the first character where rightKey is larger than leftKey
+    int rightLength;
+    memcpy(&rightLength, rightKey, sizeof(int));
+    int length = std::min(getCommonPrefixLength(leftKey, rightKey) + 1, rightLength);
+    memmove((char *)separator+sizeof(int), (char *)rightKey+sizeof(int), length);
+    memcpy(separator, &length, sizeof(int));
+    return 0;
+}
+
+int IndexManager::getPostingLength(const void *posting) const{
+    unsigned short length;
+    memcpy(&length, posting, POSTING_HEADER_SIZE);
+    if(length == POSTING_OVERFLOW){
+        return POSTING_HEADER_SIZE + sizeof(unsigned);
     }
+    return POSTING_HEADER_SIZE + length;
+}
 
-    switch (attribute.type){
-        case TypeInt:{
-            int data, tempData;
-            int index;
-            memcpy(&data, key, sizeof(data));
-            for(index = 0; index < directory.numOfRecords; index++){
-                memcpy(&tempData, (char *)imPage+startOffset, sizeof(tempData));
-                if(data <= tempData){
-                    // get the left pointer if data if less than the tempData
-                    memcpy(&nextNode, (char *)imPage+startOffset-sizeof(unsigned), sizeof(unsigned));
-                    free(imPage);
-                    return 0;
-                }
-                // key: 4B, ptr: 4B
-                startOffset += (sizeof(int) + sizeof(unsigned));
+int IndexManager::getLeafEntryLength(const void *page, int offset, const Attribute &attribute) const{
+    int keyLength = getKeyLength(attribute, (char *)page+offset);
+    return keyLength + getPostingLength((char *)page+offset+keyLength);
+}
+
+int IndexManager::encodeRid(const RID *previous, const RID &rid, char *data) const{
+    int length = 0;
+    auto putVarint = [&](unsigned value){
+        while(value >= 0x80){
+            if(data != NULL){
+                data[length] = (char)(value | 0x80);
             }
-            memcpy(&nextNode, (char *)imPage+startOffset-sizeof(unsigned), sizeof(unsigned));
-            free(imPage);
-            return 0;
+            length++;
+            value >>= 7;
         }
-        case TypeReal:{
-            float data, tempData;
-            int index;
-            memcpy(&data, key, sizeof(data));
-            for(index = 0; index < directory.numOfRecords; index++){
-                memcpy(&tempData, (char *)imPage+startOffset, sizeof(tempData));
-                if(data <= tempData){
-                    memcpy(&nextNode, (char *)imPage+startOffset-sizeof(unsigned), sizeof(unsigned));
-                    free(imPage);
-                    return 0;
-                }
-                // key: 4B, ptr: 4B
-                startOffset += (sizeof(int) + sizeof(unsigned));
-            }
-            memcpy(&nextNode, (char *)imPage+startOffset-sizeof(unsigned), sizeof(unsigned));
-            free(imPage);
-            return 0;
+        if(data != NULL){
+            data[length] = (char)value;
         }
-        case TypeVarChar:{
-            int index, length, tempLength;
-            memcpy(&length, key, 4);
-            auto *data = (char *)malloc(length+1);
-            memcpy(data, (char *)key+4, length);
-            data[length] = '\0';
-
-            for(index = 0; index < directory.numOfRecords; index++){
-                memcpy(&tempLength, (char *)imPage+startOffset, 4);
-                auto *tempData = (char *)malloc(tempLength+1);
-                memcpy(tempData, (char *)imPage+startOffset+4, tempLength);
-                tempData[tempLength] = '\0';
-
-                if(strcmp(data, tempData) <= 0){
-                    memcpy(&nextNode, (char *)imPage+startOffset-4, 4);
-                    free(tempData);
-                    free(data);
-                    free(imPage);
-                    return 0;
-                }
-                startOffset += (4+tempLength+4);
-                free(tempData);
+        length++;
+    };
+    if(previous == NULL){
+        putVarint(rid.pageNum);
+        putVarint(rid.slotNum);
+        return length;
+    }
+    unsigned pageDelta = rid.pageNum - previous->pageNum;
+    putVarint(pageDelta);
+    putVarint(pageDelta == 0 ? rid.slotNum - previous->slotNum : rid.slotNum);
+    return length;
+}
+
+int IndexManager::encodeRids(const RID *rids, size_t numOfRids, char *data) const{
+    int length = 0;
+    for(size_t i = 0; i < numOfRids; i++){
+        length += encodeRid(i == 0 ? NULL : &rids[i-1], rids[i], data == NULL ? NULL : data+length);
+    }
+    return length;
+}
+
+RC IndexManager::decodeRids(const char *data, int length, std::vector<RID> &rids) const{
+    int offset = 0;
+    auto getVarint = [&](){
+        unsigned value = 0;
+        for(int shift = 0; offset < length; shift += 7){
+            unsigned char byte = data[offset++];
+            value |= (unsigned)(byte & 0x7F) << shift;
+            if(!(byte & 0x80)){
+                break;
             }
-            memcpy(&nextNode, (char *)imPage+startOffset-4, 4);
-            free(data);
-            free(imPage);
-            return 0;
         }
+        return value;
+    };
+    bool first = true;
+    while(offset < length){
+        RID rid;
+        unsigned pageNum = getVarint();
+        unsigned slotNum = getVarint();
+        if(first){
+            rid.pageNum = pageNum;
+            rid.slotNum = slotNum;
+            first = false;
+        }
+        else{
+            rid.pageNum = rids.back().pageNum + pageNum;
+            rid.slotNum = pageNum == 0 ? rids.back().slotNum + slotNum : slotNum;
+        }
+        rids.push_back(rid);
     }
-    free(imPage);
     return 0;
 }
 
-RC IndexManager::searchInsideLeafNode(IXFileHandle &ixFileHandle, unsigned curNode, int &offset, int &recordId, const Attribute &attribute, const void *key, bool inclusiveKey){
-
-//    std::cout << "We are in searchInsideLeafNode(). " << std::endl;
-
-    int pageFlag;
-    auto *page = (char *)malloc(PAGE_SIZE);
-    ixFileHandle.getFileHandle().readPage(curNode, page);
-    memcpy(&pageFlag, page, sizeof(int));
-    if(pageFlag != LEAF_FLAG){
-//        std::cout << "[Error]: searchInsideLeafNode -> this node is not a leaf node." << std::endl;
-        return -1;
+RC IndexManager::readPostingList(IXFileHandle &ixFileHandle, const void *posting, std::vector<RID> &rids) const{
+    unsigned short length;
+    memcpy(&length, posting, POSTING_HEADER_SIZE);
+    if(length != POSTING_OVERFLOW){
+        return decodeRids((const char *)posting+POSTING_HEADER_SIZE, length, rids);
+    }
+    
+    // follow the chain of overflow pages, every page is read under its shared latch
+    int pageNum;
+    memcpy(&pageNum, (const char *)posting+POSTING_HEADER_SIZE, sizeof(unsigned));
+    char *page = (char *)malloc(PAGE_SIZE);
+    while(pageNum != -1){
+        {
+            SharedLatchGuard guard(ixFileHandle.getFileHandle().getLatch(pageNum));
+            if(ixFileHandle.getFileHandle().readPage(pageNum, page) != 0){
+                // std::cout << "[Error]: readPostingList -> fail to read an overflow page." << std::endl;
+                free(page);
+                return -1;
+            }
+        }
+        postingPageDirectory directory;
+        memcpy(&directory, page, POSTING_DIR_SIZE);
+        if(directory.flag != POSTING_FLAG){
+            // the list lost its pages after the leaf was read
+            break;
+        }
+        decodeRids(page+POSTING_DIR_SIZE, directory.length, rids);
+        pageNum = directory.nextPage;
     }
+    free(page);
+    return 0;
+}
 
+RC IndexManager::resizeLeafEntry(void *page, int index, int offset, int oldLength, int newLength) const{
     leafPageDirectory directory;
     memcpy(&directory, page, LEAF_DIR_SIZE);
+    int delta = newLength - oldLength;
+    if(delta > directory.freeSpace){
+        // std::cout << "[Error]: resizeLeafEntry -> the entry doesn't fit." << std::endl;
+        return -1;
+    }
+    int dataEnd = getNodeDataEnd(page);
+    memmove((char *)page+offset+newLength, (char *)page+offset+oldLength, dataEnd-offset-oldLength);
+    if(delta < 0){
+        memset((char *)page+dataEnd+delta, 0, -delta);
+    }
+    for(int i = index + 1; i < directory.numOfRecords; i++){
+        setKeyOffset(page, i, getKeyOffset(page, i) + delta);
+    }
+    directory.freeSpace -= delta;
+    memcpy(page, &directory, LEAF_DIR_SIZE);
+    return 0;
+}
 
-    int startOffset = LEAF_DIR_SIZE;
-    int numOfRecords = directory.numOfRecords;
+RC IndexManager::insertIntoPostingList(IXFileHandle &ixFileHandle, void *page, int index, const Attribute &attribute, const RID &rid){
+    int offset = getKeyOffset(page, index);
+    int postingOffset = offset + getKeyLength(attribute, (char *)page+offset);
+    char *posting = (char *)page + postingOffset;
+    unsigned short length;
+    memcpy(&length, posting, POSTING_HEADER_SIZE);
+    if(length == POSTING_OVERFLOW){
+        unsigned firstPageNum;
+        memcpy(&firstPageNum, posting+POSTING_HEADER_SIZE, sizeof(unsigned));
+        return insertIntoPostingPages(ixFileHandle, firstPageNum, rid);
+    }
+    
+    std::vector<RID> rids;
+    decodeRids(posting+POSTING_HEADER_SIZE, length, rids);
+    auto position = std::upper_bound(rids.begin(), rids.end(), rid, [](const RID &a, const RID &b){
+        return a.pageNum != b.pageNum ? a.pageNum < b.pageNum : a.slotNum < b.slotNum;
+    });
+    rids.insert(position, rid);
+    
+    RC rc;
+    int newLength = encodeRids(rids.data(), rids.size(), NULL);
+    if(newLength <= POSTING_INLINE_MAX){
+        rc = resizeLeafEntry(page, index, postingOffset, POSTING_HEADER_SIZE+length, POSTING_HEADER_SIZE+newLength);
+        if(rc == 0){
+            unsigned short newHeader = newLength;
+            memcpy(posting, &newHeader, POSTING_HEADER_SIZE);
+            encodeRids(rids.data(), rids.size(), posting+POSTING_HEADER_SIZE);
+        }
+        return rc;
+    }
+    
+    // too long to stay in the leaf, the list moves to an overflow page
+    unsigned firstPageNum;
+    rc = appendPostingPages(ixFileHandle, rids.data(), rids.size(), 1, firstPageNum);
+    if(rc == 0){
+        rc = resizeLeafEntry(page, index, postingOffset, POSTING_HEADER_SIZE+length, POSTING_HEADER_SIZE+sizeof(unsigned));
+    }
+    if(rc == 0){
+        unsigned short newHeader = POSTING_OVERFLOW;
+        memcpy(posting, &newHeader, POSTING_HEADER_SIZE);
+        memcpy(posting+POSTING_HEADER_SIZE, &firstPageNum, sizeof(unsigned));
+    }
+    return rc;
+}
 
-//    std::cout << "In searchInsideLeafNode(): numOfRecords: " << numOfRecords << std::endl;
+RC IndexManager::deleteFromPostingList(IXFileHandle &ixFileHandle, void *page, int index, const Attribute &attribute, const RID &rid, bool &empty){
+    int offset = getKeyOffset(page, index);
+    int postingOffset = offset + getKeyLength(attribute, (char *)page+offset);
+    char *posting = (char *)page + postingOffset;
+    unsigned short length;
+    memcpy(&length, posting, POSTING_HEADER_SIZE);
+    if(length == POSTING_OVERFLOW){
+        unsigned firstPageNum;
+        memcpy(&firstPageNum, posting+POSTING_HEADER_SIZE, sizeof(unsigned));
+        return deleteFromPostingPages(ixFileHandle, firstPageNum, rid, empty);
+    }
     
-    if(key == NULL){
-        offset = startOffset;
-        recordId = 0;
-        free(page);
+    std::vector<RID> rids;
+    decodeRids(posting+POSTING_HEADER_SIZE, length, rids);
+    auto position = std::find_if(rids.begin(), rids.end(), [&rid](const RID &a){
+        return a.pageNum == rid.pageNum && a.slotNum == rid.slotNum;
+    });
+    if(position == rids.end()){
+//        std::cout << "[Error]: deleteFromPostingList -> can't find such a <key, rid> pair." << std::endl;
+        return -1;
+    }
+    rids.erase(position);
+    empty = rids.empty();
+    if(empty){
         return 0;
     }
+    
+    // the list never gets longer without a RID
+    int newLength = encodeRids(rids.data(), rids.size(), NULL);
+    unsigned short newHeader = newLength;
+    memcpy(posting, &newHeader, POSTING_HEADER_SIZE);
+    encodeRids(rids.data(), rids.size(), posting+POSTING_HEADER_SIZE);
+    return resizeLeafEntry(page, index, postingOffset+POSTING_HEADER_SIZE+newLength, length-newLength, 0);
+}
 
-    switch (attribute.type){
-        case TypeInt:{
-            int data = 0;
-            int tempData = 0;
-            int index = 0;
-            
-            memcpy(&data, key, sizeof(int));
-            for(index = 0; index < numOfRecords; index++){
-                memcpy(&tempData, (char *)page+startOffset, sizeof(tempData));
-                if((inclusiveKey && data <= tempData) || data < tempData){
-                    // get the left pointer if data if less than or equal to the tempData
-                    offset = startOffset;
-                    recordId = index;
-                    free(page);
-                    return 0;
-                }
-                startOffset += (4+ sizeof(RID));
+RC IndexManager::appendPostingPages(IXFileHandle &ixFileHandle, const RID *rids, size_t numOfRids, float fillFactor, unsigned &firstPageNum,
+                                    int nextPage){
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    int capacity = (int)((PAGE_SIZE - POSTING_DIR_SIZE) * fillFactor);
+    char *page = (char *)malloc(PAGE_SIZE);
+    
+    // pages are appended in the order of the chain, each one expects the next to get the following page number,
+    // if another thread appends a page in between or a free page is taken, the link is written again.
+    postingPageDirectory directory = {POSTING_FLAG, 0, 0, -1};
+    unsigned prevPageNum = 0;
+    size_t begin = 0;
+    while(begin < numOfRids){
+        size_t end = begin;
+        int length = 0;
+        while(end < numOfRids){
+            int ridLength = encodeRid(end == begin ? NULL : &rids[end-1], rids[end], NULL);
+            if(end > begin && length + ridLength > capacity){
+                break;
             }
-            break;
+            length += ridLength;
+            end++;
         }
-        case TypeReal:{
-            float data, tempData;
-            int index;
-            memcpy(&data, key, 4);
-            for(index = 0; index < numOfRecords; index++){
-                memcpy(&tempData, (char *)page+startOffset, 4);
-                if((inclusiveKey && data <= tempData) || data < tempData){
-                    // get the left pointer if data if less than or equal to the tempData
-                    offset = startOffset;
-                    recordId = index;
-                    free(page);
-                    return 0;
-                }
-                startOffset += (4+ sizeof(RID));
-            }
-            break;
+        
+        memset(page, 0, PAGE_SIZE);
+        directory.length = encodeRids(rids+begin, end-begin, page+POSTING_DIR_SIZE);
+        directory.numOfRids = end - begin;
+        directory.nextPage = end < numOfRids ? (int)fileHandle.getNumberOfPages() + 1 : nextPage;
+        memcpy(page, &directory, POSTING_DIR_SIZE);
+        unsigned pageNum;
+        if(allocatePage(ixFileHandle, page, pageNum) != 0){
+            // std::cout << "[Error]: appendPostingPages -> fail to append a page." << std::endl;
+            free(page);
+            return -1;
         }
-        case TypeVarChar:{
-            int index, length, tempLength;
-            memcpy(&length, key, 4);
-            auto *data = (char *)malloc(length+1);
-            memcpy(data, (char *)key+4, length);
-            data[length] = '\0';
-
-            for(index = 0; index < numOfRecords; index++){
-                memcpy(&tempLength, (char *)page+startOffset, 4);
-                auto *tempData = (char *)malloc(tempLength+1);
-                memcpy(tempData, (char *)page+startOffset+4, tempLength);
-                tempData[tempLength] = '\0';
-
-                if((inclusiveKey && strcmp(data, tempData) <= 0) || strcmp(data, tempData) < 0){
-                    // get the left pointer if data if less than or equal to the tempData
-                    offset = startOffset;
-                    recordId = index;
-                    free(tempData);
-                    free(data);
-                    free(page);
-                    return 0;
-                }
-                
-                startOffset += (4+tempLength+ sizeof(RID));
-                free(tempData);
-            }
+        if(begin == 0){
+            firstPageNum = pageNum;
+        }
+        else if(pageNum != prevPageNum + 1){
+            fileHandle.readPage(prevPageNum, page);
+            memcpy(&directory, page, POSTING_DIR_SIZE);
+            directory.nextPage = pageNum;
+            memcpy(page, &directory, POSTING_DIR_SIZE);
+            ExclusiveLatchGuard guard(fileHandle.getLatch(prevPageNum));
+            fileHandle.writePage(prevPageNum, page);
+        }
+        prevPageNum = pageNum;
+        begin = end;
+    }
+    free(page);
+    return 0;
+}
+
+RC IndexManager::insertIntoPostingPages(IXFileHandle &ixFileHandle, unsigned firstPageNum, const RID &rid){
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    char *page = (char *)malloc(PAGE_SIZE);
+    postingPageDirectory directory;
+    std::vector<RID> rids;
+    
+    // the last page whose RIDs start before rid, a RID past the end of a page goes into the page itself
+    unsigned pageNum = firstPageNum;
+    while(true){
+        fileHandle.readPage(pageNum, page);
+        memcpy(&directory, page, POSTING_DIR_SIZE);
+        rids.clear();
+        decodeRids(page+POSTING_DIR_SIZE, directory.length, rids);
+        if(directory.nextPage == -1 || rids.empty() || rid.pageNum < rids.back().pageNum ||
+           (rid.pageNum == rids.back().pageNum && rid.slotNum <= rids.back().slotNum)){
             break;
         }
-        default:
+        pageNum = directory.nextPage;
+    }
+    auto position = std::upper_bound(rids.begin(), rids.end(), rid, [](const RID &a, const RID &b){
+        return a.pageNum != b.pageNum ? a.pageNum < b.pageNum : a.slotNum < b.slotNum;
+    });
+    rids.insert(position, rid);
+    
+    RC rc = 0;
+    if(encodeRids(rids.data(), rids.size(), NULL) > PAGE_SIZE - POSTING_DIR_SIZE){
+        // split the page, the second half goes to a new page linked after it
+        size_t half = rids.size() / 2;
+        unsigned newPageNum = 0;
+        rc = appendPostingPages(ixFileHandle, rids.data()+half, rids.size()-half, 1, newPageNum, directory.nextPage);
+        rids.resize(half);
+        directory.nextPage = newPageNum;
+    }
+    if(rc == 0){
+        memset(page, 0, PAGE_SIZE);
+        directory.length = encodeRids(rids.data(), rids.size(), page+POSTING_DIR_SIZE);
+        directory.numOfRids = rids.size();
+        memcpy(page, &directory, POSTING_DIR_SIZE);
+        ExclusiveLatchGuard guard(fileHandle.getLatch(pageNum));
+        rc = fileHandle.writePage(pageNum, page);
+    }
+    free(page);
+    return rc;
+}
+
+RC IndexManager::deleteFromPostingPages(IXFileHandle &ixFileHandle, unsigned firstPageNum, const RID &rid, bool &empty){
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    char *page = (char *)malloc(PAGE_SIZE);
+    postingPageDirectory directory;
+    std::vector<RID> rids;
+    
+    int pageNum = firstPageNum, prevPageNum = -1;
+    std::vector<RID>::iterator position;
+    while(true){
+        fileHandle.readPage(pageNum, page);
+        memcpy(&directory, page, POSTING_DIR_SIZE);
+        rids.clear();
+        decodeRids(page+POSTING_DIR_SIZE, directory.length, rids);
+        position = std::find_if(rids.begin(), rids.end(), [&rid](const RID &a){
+            return a.pageNum == rid.pageNum && a.slotNum == rid.slotNum;
+        });
+        if(position != rids.end()){
             break;
+        }
+        if(directory.nextPage == -1){
+//            std::cout << "[Error]: deleteFromPostingPages -> can't find such a <key, rid> pair." << std::endl;
+            free(page);
+            return -1;
+        }
+        prevPageNum = pageNum;
+        pageNum = directory.nextPage;
+    }
+    rids.erase(position);
+    
+    // an empty page leaves the chain, the first page takes the content of the second one so the leaf keeps pointing to it.
+    // The page which leaves goes to the free list.
+    RC rc = 0;
+    int freedPageNum = -1;
+    empty = false;
+    if(!rids.empty()){
+        memset(page+POSTING_DIR_SIZE, 0, PAGE_SIZE-POSTING_DIR_SIZE);
+        directory.length = encodeRids(rids.data(), rids.size(), page+POSTING_DIR_SIZE);
+        directory.numOfRids = rids.size();
+        memcpy(page, &directory, POSTING_DIR_SIZE);
+    }
+    else if(prevPageNum != -1){
+        freedPageNum = pageNum;
+        pageNum = prevPageNum;
+        fileHandle.readPage(pageNum, page);
+        postingPageDirectory prevDirectory;
+        memcpy(&prevDirectory, page, POSTING_DIR_SIZE);
+        prevDirectory.nextPage = directory.nextPage;
+        memcpy(page, &prevDirectory, POSTING_DIR_SIZE);
+    }
+    else if(directory.nextPage != -1){
+        freedPageNum = directory.nextPage;
+        fileHandle.readPage(directory.nextPage, page);
+    }
+    else{
+        empty = true;
+        free(page);
+        ExclusiveLatchGuard guard(fileHandle.getLatch(pageNum));
+        return freePage(ixFileHandle, pageNum);
+    }
+    {
+        ExclusiveLatchGuard guard(fileHandle.getLatch(pageNum));
+        rc = fileHandle.writePage(pageNum, page);
+    }
+    if(rc == 0 && freedPageNum != -1){
+        ExclusiveLatchGuard guard(fileHandle.getLatch(freedPageNum));
+        rc = freePage(ixFileHandle, freedPageNum);
     }
-    offset = startOffset;
-    recordId = numOfRecords;
     free(page);
-//    std::cout << "[Error]: searchInsideLeafNode -> can't find a value." << std::endl;
-    return -1;
+    return rc;
+}
+
+RC IndexManager::setLeafPrefix(void *page, const Attribute &attribute, const char *prefix, int prefixLength) const{
+    leafPageDirectory directory;
+    memcpy(&directory, page, LEAF_DIR_SIZE);
+    
+    // take the whole keys and the posting lists out, prefix may point into page
+    std::string newPrefix(prefix, prefixLength);
+    std::vector<std::string> keys(directory.numOfRecords);
+    std::vector<std::string> postings(directory.numOfRecords);
+    void *key = malloc(PAGE_SIZE);
+    int usedSpace = LEAF_DIR_SIZE + LEAF_PREFIX_SIZE + prefixLength;
+    for(int index = 0; index < directory.numOfRecords; index++){
+        int offset = getKeyOffset(page, index);
+        getLeafKey(page, offset, attribute, key);
+        keys[index].assign((char *)key, getKeyLength(attribute, key));
+        char *posting = (char *)page+offset+getKeyLength(attribute, (char *)page+offset);
+        postings[index].assign(posting, getPostingLength(posting));
+        if((int)keys[index].size() < (int)sizeof(int) + prefixLength || keys[index].compare(sizeof(int), prefixLength, newPrefix) != 0){
+            // std::cout << "[Error]: setLeafPrefix -> a key doesn't have the prefix." << std::endl;
+            free(key);
+            return -1;
+        }
+        usedSpace += keys[index].size() - prefixLength + postings[index].size() + IX_SLOT_SIZE;
+    }
+    free(key);
+    if(usedSpace > PAGE_SIZE){
+        return -1;
+    }
+    
+    // write them back without the new prefix
+    memset((char *)page+LEAF_DIR_SIZE, 0, PAGE_SIZE-LEAF_DIR_SIZE);
+    memcpy((char *)page+LEAF_DIR_SIZE, &prefixLength, LEAF_PREFIX_SIZE);
+    memcpy((char *)page+LEAF_DIR_SIZE+LEAF_PREFIX_SIZE, newPrefix.data(), prefixLength);
+    int offset = LEAF_DIR_SIZE + LEAF_PREFIX_SIZE + prefixLength;
+    for(int index = 0; index < directory.numOfRecords; index++){
+        int suffixLength = keys[index].size() - sizeof(int) - prefixLength;
+        memcpy((char *)page+offset, &suffixLength, sizeof(int));
+        memcpy((char *)page+offset+sizeof(int), keys[index].data()+sizeof(int)+prefixLength, suffixLength);
+        offset += sizeof(int) + suffixLength;
+        memcpy((char *)page+offset, postings[index].data(), postings[index].size());
+        offset += postings[index].size();
+    }
+    directory.freeSpace = PAGE_SIZE - offset - directory.numOfRecords * IX_SLOT_SIZE;
+    memcpy(page, &directory, LEAF_DIR_SIZE);
+    return buildSlotArray(LEAF_FLAG, page, attribute);
 }
 
 /*
  * Print current Node specified by pageFlag
  */
-RC IndexManager::printNode(IXFileHandle &ixFileHandle, int pageFlag, void *page, int numOfRecords, int level, const Attribute &attribute) const{
-    int startOffset = (pageFlag == LEAF_FLAG)? LEAF_DIR_SIZE : (IM_DIR_SIZE+4);
-    int sizeOfData = (pageFlag == LEAF_FLAG) ? sizeof(RID) : sizeof(int);
+RC IndexManager::printNode(IXFileHandle &ixFileHandle, int pageFlag, void *page, int numOfRecords, const Attribute &attribute) const{
+    int startOffset = getNodeDataStart(page, attribute);
+    int sizeOfData = sizeof(int);
+    // keys of a VARCHAR leaf are printed with the prefix of the leaf
+    int prefixLength = getLeafPrefixLength(page, attribute);
+    std::string prefix((char *)page+LEAF_DIR_SIZE+LEAF_PREFIX_SIZE, prefixLength);
 
 //    auto *indent = (char *)malloc(level);
 //    memset(indent, 9, level-1);
@@ -1261,14 +3193,14 @@ RC IndexManager::printNode(IXFileHandle &ixFileHandle, int pageFlag, void *page,
         switch (attribute.type){
             case TypeInt:{
                 int data;
-                memcpy(&data, (char *)page+startOffset, sizeof(int));
+                denormalizeKey(attribute, (char *)page+startOffset, &data);
                 startOffset += (sizeof(int));
                 std::cout << data;
                 break;
             }
             case TypeReal:{
                 float data;
-                memcpy(&data, (char *)page+startOffset, sizeof(float));
+                denormalizeKey(attribute, (char *)page+startOffset, &data);
                 startOffset += (sizeof(float));
                 std::cout << data;
                 break;
@@ -1280,7 +3212,7 @@ RC IndexManager::printNode(IXFileHandle &ixFileHandle, int pageFlag, void *page,
                 memcpy(data, (char *)page+startOffset+ sizeof(int), length);
                 data[length] = '\0';
                 startOffset += (sizeof(int)+length);
-                std::cout << data;
+                std::cout << prefix << data;
                 free(data);
                 break;
             }
@@ -1288,11 +3220,19 @@ RC IndexManager::printNode(IXFileHandle &ixFileHandle, int pageFlag, void *page,
                 break;
         }
         if(pageFlag == LEAF_FLAG){
-            RID rid;
-            memcpy(&rid, (char *)page+startOffset, sizeOfData);
-            std::cout << ":[(" << rid.pageNum << ", " << rid.slotNum << ")]";
+            // all the RIDs of the key
+            std::vector<RID> rids;
+            readPostingList(ixFileHandle, (char *)page+startOffset, rids);
+            std::cout << ":[";
+            for(size_t i = 0; i < rids.size(); i++){
+                std::cout << (i == 0 ? "" : ",") << "(" << rids[i].pageNum << ", " << rids[i].slotNum << ")";
+            }
+            std::cout << "]";
+            startOffset += getPostingLength((char *)page+startOffset);
+        }
+        else{
+            startOffset += sizeOfData;
         }
-        startOffset += sizeOfData;
         if(index == numOfRecords-1){
             std::cout << "\"";
         }
@@ -1350,12 +3290,12 @@ RC IndexManager::printNormalBtree(IXFileHandle &ixFileHandle, int curNode, int l
         std::cout << indent << "{";
     }
 
-    printNode(ixFileHandle, pageFlag, page, numOfRecords, level, attribute);
+    printNode(ixFileHandle, pageFlag, page, numOfRecords, attribute);
 
     if(pageFlag == IM_FLAG || pageFlag == ROOT_FLAG){
         std::cout << "," << std::endl;
         std::cout << indent << "\"children\":[" << std::endl;
-        int index, nextNode;
+        int index, nextNode = -1;
         int offset = IM_DIR_SIZE;
 
         // index <= numRecords -> there are numOFRecords + 1 pointers inside the intermediate node
@@ -1417,7 +3357,9 @@ RC IX_ScanIterator::initializeScanIterator(IXFileHandle &ixFileHandle,
                                            bool highKeyInclusive,
                                            int curNode,
                                            int curOffset,
-                                           int curRecordId){
+                                           int curRecordId,
+                                           unsigned long long curVersion,
+                                           const void *curPage){
     this->ixFileHandlePtr = &ixFileHandle;
     this->attribute = attribute;
     this->lowKey = lowKey;
@@ -1429,229 +3371,171 @@ RC IX_ScanIterator::initializeScanIterator(IXFileHandle &ixFileHandle,
     this->curRecordId = curRecordId;
     
     this->curPage = (char *)malloc(PAGE_SIZE);
-    this->preOffset = curOffset;
+    this->batchEntries.clear();
+    this->batchRows.clear();
+    this->batchIndex = 0;
+    this->batched = false;
+    this->lastKey.clear();
+    this->curVersion = curVersion;
+    this->reverse = false;
+    this->hashScan = false;
     
-    ixFileHandlePtr->getFileHandle().readPage(curNode, curPage);
-    memcpy(&curLeafPageDir, curPage, LEAF_DIR_SIZE);
+    if(curNode != -1){
+        memcpy(this->curPage, curPage, PAGE_SIZE);
+        memcpy(&curLeafPageDir, curPage, LEAF_DIR_SIZE);
+    }
     
     return 0;
 }
 
-RC IX_ScanIterator::getNextEntry(RID &rid, void *key) {
-
-    if(curNode == -1){
-        // No Next Page.
-//        std::cout << "[Warning]: scan terminates." << std::endl;
-        return IX_EOF;
-    }
-    
-    // update curRecordId and curOffset
-    RC rc = checkDeleteToUpdateCurOffset(curPage);
-    if(rc != 0){
-        return -1;
+RC IX_ScanIterator::moveToNextLeaf(){
+    int link = reverse ? curLeafPageDir.prevNode : curLeafPageDir.nextNode;
+    if(link == -1){
+//        std::cout << "scan terminate." << std::endl;
+        curNode = -1;
+        return 0;
     }
-    
-    //
-    if(curRecordId >= curLeafPageDir.numOfRecords && curLeafPageDir.numOfRecords != 0 && curLeafPageDir.nextNode == -1){
-        // std::cout << "[warning] -> getNextEntry -> can't get an entry match the comparison." << std::endl;
-        return  IX_EOF;
-    } else{
-        // There may be some node without any records, then we check the next node.
-        while (curLeafPageDir.numOfRecords == 0) {
-            if (curLeafPageDir.nextNode != -1) {
-                curNode = curLeafPageDir.nextNode;
-                ixFileHandlePtr->getFileHandle().readPage(curNode, curPage);
-                memcpy(&curLeafPageDir, curPage, LEAF_DIR_SIZE);
-                curOffset = LEAF_DIR_SIZE;
-                preOffset = LEAF_DIR_SIZE;
-                curRecordId = 0;
-            }
-            if(curLeafPageDir.nextNode == IX_EOF) {
-//                std::cout << "scan terminate." << std::endl;
-                return IX_EOF;
-            }
+    FileHandle &fileHandle = ixFileHandlePtr->getFileHandle();
+    {
+        // the link of the copy is still the one of curNode if nobody latched curNode since it was read:
+        // a leaf split or merged next to it changes its links under its latch. The next leaf is latched first, so it
+        // can't change between the check and the read.
+        RWLatch &latch = fileHandle.getLatch(link);
+        SharedLatchGuard guard(latch);
+        if(fileHandle.getLatch(curNode).validate(curVersion)){
+            RC rc = fileHandle.readPage(link, curPage);
+            curVersion = latch.readVersion();
+            curNode = link;
+            memcpy(&curLeafPageDir, curPage, LEAF_DIR_SIZE);
+            curRecordId = reverse ? curLeafPageDir.numOfRecords - 1 : 0;
+            batched = false;
+            return rc;
         }
     }
-    
-//    std::cout << "curRecordId: " << curRecordId << " " << "; curLeafPageDir.numOfRecords: " << curLeafPageDir.numOfRecords << std::endl;
-    
-    if(rc != 0){
-        // std::cout << "[Error] -> getNextEntry -> checkDeleteToUpdateCurOffset" << std::endl;
-        return -1;
+    // curNode changed, it may even have been merged away: find the key after the last one of the batch again
+    return searchAgain();
+}
+
+RC IX_ScanIterator::searchAgain(){
+    IndexManager &indexManager = IndexManager::instance();
+    if(reverse){
+        // the key before the first one >= lastKey (past highKey if no key is returned yet), it may be in the leaf before.
+        const void *key = lastKey.empty() ? highKey : lastKey.data();
+        bool inclusive = lastKey.empty() ? !highKeyInclusive : true;
+        indexManager.searchEntry(*ixFileHandlePtr, curNode, curOffset, curRecordId, attribute, key, inclusive, curPage, true, &curVersion);
+        curRecordId--;
+    }
+    else{
+        const void *key = lastKey.empty() ? lowKey : lastKey.data();
+        bool inclusive = lastKey.empty() ? lowKeyInclusive : false;
+        // like in scan(...), the key may be past the last key of the leaf, the scan moves on to the next leaf then.
+        indexManager.searchEntry(*ixFileHandlePtr, curNode, curOffset, curRecordId, attribute, key, inclusive, curPage, false, &curVersion);
     }
+    memcpy(&curLeafPageDir, curPage, LEAF_DIR_SIZE);
+    batched = false;
+    return curLeafPageDir.flag == LEAF_FLAG ? 0 : -1;
+}
 
-    switch (attribute.type){
-        case TypeInt:{
-            int data, highData;
-            memcpy(&data, curPage+curOffset, sizeof(int));
-            if(highKey != NULL){
-                memcpy(&highData, highKey, sizeof(int));
-            }
-            if((highKey == NULL) || (highKeyInclusive && data <= highData) || (data < highData)){
-                memcpy(key, curPage+curOffset, sizeof(int));
-                memcpy(&rid, curPage + curOffset + sizeof(int), sizeof(RID));
-                curRecordId ++;
-                if(curRecordId == curLeafPageDir.numOfRecords){
-                    curNode = curLeafPageDir.nextNode;
-    
-                    ixFileHandlePtr->getFileHandle().readPage(curNode, curPage);
-                    memcpy(&curLeafPageDir, curPage, LEAF_DIR_SIZE);
-                    
-                    curOffset = LEAF_DIR_SIZE;
-                    preOffset = LEAF_DIR_SIZE;
-                    curRecordId = 0;
-//                    std::cout << "[Warning]: Last entry in this page." << std::endl;
-                } else{
-                    preOffset = curOffset;
-                    preRid = rid;
-                    curOffset += (sizeof(int) + sizeof(RID));
-//                    std::cout << "[Scan] get an entry. -> curNode: " << curNode << "; rid.pageNum: " << rid.pageNum << std::endl;
-                }
-                return 0;
-            } else{
-//                std::cout << "[Warning]: scan terminates." << std::endl;
-                return IX_EOF;
+RC IX_ScanIterator::readBatch(){
+    IndexManager &indexManager = IndexManager::instance();
+    batchEntries.clear();
+    batchRows.clear();
+    batchIndex = 0;
+    batched = true;
+    
+    // the keys of the copy of the leaf are read from it, an overflow posting list from its pages
+    std::vector<RID> rids;
+    std::string key(PAGE_SIZE, '\0');
+    for(int index = curRecordId; index >= 0 && index < curLeafPageDir.numOfRecords; index += reverse ? -1 : 1){
+        int offset = indexManager.getKeyOffset(curPage, index);
+        const void *bound = reverse ? lowKey : highKey;
+        bool boundInclusive = reverse ? lowKeyInclusive : highKeyInclusive;
+        if(bound != NULL){
+            int cmp = indexManager.compareLeafKey(curPage, offset, attribute, bound);
+            if(reverse ? cmp < 0 || (cmp == 0 && !boundInclusive) : cmp > 0 || (cmp == 0 && !boundInclusive)){
+                // the rest of the range is returned once this batch is
+                curNode = -1;
+                break;
             }
         }
-        case TypeReal:{
-            float data, highData;
-            memcpy(&data, curPage+curOffset, sizeof(float));
-            if(highKey != NULL){
-                memcpy(&highData, highKey, sizeof(float));
-            }
-            if((highKey == NULL) || (highKeyInclusive && data <= highData) || (data < highData)){
-                memcpy(key, curPage+curOffset, sizeof(float));
-                memcpy(&rid, curPage+curOffset+ sizeof(float), sizeof(RID));
-                
-                // if this record is the last entry inside this leaf page, update all the curInfo
-                curRecordId ++;
-                if(curRecordId == curLeafPageDir.numOfRecords){
-                    curNode = curLeafPageDir.nextNode;
-    
-                    ixFileHandlePtr->getFileHandle().readPage(curNode, curPage);
-                    memcpy(&curLeafPageDir, curPage, LEAF_DIR_SIZE);
-                    
-                    curOffset = LEAF_DIR_SIZE;
-                    preOffset = LEAF_DIR_SIZE;
-                    curRecordId = 0;
-//                    ixFileHandlePtr->getFileHandle().readPage(curNode, curPage);
-//                    memcpy(&curLeafPageDir, curPage, LEAF_DIR_SIZE);
-                } else{
-                    preOffset = curOffset;
-                    preRid = rid;
-                    curOffset += (sizeof(float) + sizeof(RID));
-                }
-                return 0;
-            } else{
-//                std::cout << "[Warning]: scan terminates." << std::endl;
-                return IX_EOF;
-            }
+        const char *posting = curPage + offset + indexManager.getKeyLength(attribute, curPage + offset);
+        if(ixFileHandlePtr->isClustered()){
+            // the row of a clustered tree instead of RIDs
+            indexManager.getLeafKey(curPage, offset, attribute, &key[0]);
+            lastKey.assign(key.data(), indexManager.getKeyLength(attribute, key.data()));
+            batchEntries.push_back({lastKey, {0, 0}});
+            batchRows.emplace_back(posting + POSTING_HEADER_SIZE, indexManager.getPostingLength(posting) - POSTING_HEADER_SIZE);
+            continue;
         }
-        case TypeVarChar:{
-            int length, highLength;
-            memcpy(&length, curPage+curOffset, sizeof(int));
-            auto *data = (char *)malloc(length+1);
-            memcpy(data, curPage+curOffset+ sizeof(int), length);
-            data[length] = '\0';
-        
-            
-            
-            char *highData;
-            if(highKey != NULL){
-                memcpy(&highLength, highKey, sizeof(int));
-                highData = (char *)malloc(highLength+1);
-                memcpy(highData, (char *)highKey+ sizeof(int), highLength);
-                highData[highLength] = '\0';
-            }
-    
-            
-            if((highKey == NULL) || (highKeyInclusive && strcmp(data, highData) <= 0) || (strcmp(data, highData) < 0)){
-                memcpy(key, curPage+curOffset, sizeof(int)+length);
-                memcpy(&rid, curPage+curOffset+ sizeof(int)+length, sizeof(RID));
-                curRecordId ++;
-                if(curRecordId == curLeafPageDir.numOfRecords){
-                    curNode = curLeafPageDir.nextNode;
-    
-                    ixFileHandlePtr->getFileHandle().readPage(curNode, curPage);
-                    memcpy(&curLeafPageDir, curPage, LEAF_DIR_SIZE);
-                    
-                    curOffset = LEAF_DIR_SIZE;
-                    preOffset = LEAF_DIR_SIZE;
-                    curRecordId = 0;
-//                    ixFileHandlePtr->getFileHandle().readPage(curNode, curPage);
-//                    memcpy(&curLeafPageDir, curPage, LEAF_DIR_SIZE);
-                } else{
-                    preOffset = curOffset;
-                    preRid = rid;
-                    curOffset += (sizeof(int) + length + sizeof(RID));
-                }
-                free(data);
-                if(highKey != NULL) {
-                    free(highData);
-                }
-                return 0;
-            } else{
-//                std::cout << "[Warning]: scan terminates." << std::endl;
-                free(data);
-                if(highKey != NULL) {
-                    free(highData);
-                }
-                return IX_EOF;
-            }
+        rids.clear();
+        if(indexManager.readPostingList(*ixFileHandlePtr, posting, rids) != 0){
+            // std::cout << "[Error] readBatch -> readPostingList" << std::endl;
+            return -1;
+        }
+        if(reverse){
+            std::reverse(rids.begin(), rids.end());
+        }
+        // an overflow list emptied meanwhile has no RIDs, the key still moves the scan on
+        indexManager.getLeafKey(curPage, offset, attribute, &key[0]);
+        lastKey.assign(key.data(), indexManager.getKeyLength(attribute, key.data()));
+        for(const RID &rid : rids){
+            batchEntries.push_back({lastKey, rid});
         }
-        default:
-            break;
     }
-    // std::cout << "[Error] getNextEntry" << std::endl;
-    return -1;
+    return 0;
 }
 
-RC IX_ScanIterator::checkDeleteToUpdateCurOffset(void *page){
-    if(preOffset == curOffset){
-        // initialized or start in a new page
-        // no check needed
-        return 0;
+RC IX_ScanIterator::getNextEntry(RID &rid, void *key) {
+
+    if(hashScan){
+        return HashIndexManager::instance().getNextEntry(*this, rid, key);
     }
-    if(preOffset < curOffset){
-        
-        RID tempRid;
-        switch (attribute.type){
-            case TypeInt:{
-                memcpy(&tempRid, (char *)page+preOffset+ sizeof(int), sizeof(RID));
-                break;
-            }
-            case TypeReal:{
-                memcpy(&tempRid, (char *)page+preOffset+ sizeof(float), sizeof(RID));
-                break;
-            }
     
-            case TypeVarChar:{
-                int length;
-                memcpy(&length, (char *)page+preOffset, sizeof(int));
-                memcpy(&tempRid, (char *)page+preOffset+ sizeof(int) + length, sizeof(RID));
-                break;
-            }
-            default:{
-                // std::cout << "[Error] -> checkDeleteToUpdateCurOffset -> attribute.type " << std::endl;
-                return -1;
-            }
-        }
-        if(tempRid.pageNum == preRid.pageNum && tempRid.slotNum == preRid.slotNum){
-            // no delete happen
-            return 0;
+    // the qualifying entries of the copy of a leaf are taken in one pass, then the scan moves on to the next leaf.
+    // The scan may start past the last entry of a leaf (the first key >= lowKey lives in the next leaf, the last key <= highKey
+    // of a reverse scan in the leaf before), and there may be some node without any records, so move on until there is an entry.
+    while(batchIndex >= batchEntries.size()){
+        if(curNode == -1){
+//            std::cout << "[Warning]: scan terminates." << std::endl;
+            return IX_EOF;
         }
-        else{
-            // std::cout << "checkDeleteToUpdateCurOffset -> delete happens." << std::endl;
-            curOffset = preOffset;
-            curRecordId -= 1;
-            return 0;
+        RC rc = batched ? moveToNextLeaf() : readBatch();
+        if(rc != 0){
+            // std::cout << "[Error] getNextEntry -> fail to read the next leaf." << std::endl;
+            curNode = -1;
+            return -1;
         }
-        //pass
-    } else{
-        // std::cout << "[Error] checkDeleteToUpdateCurOffset -> preOffset > curOffset" << std::endl;
-        return -1;
     }
     
+    const IndexEntry &entry = batchEntries[batchIndex];
+    IndexManager::instance().denormalizeKey(attribute, entry.key.data(), key);
+    rid = entry.rid;
+    batchIndex ++;
+    return 0;
+}
+
+RC IX_ScanIterator::getNextRow(void *key, void *row, unsigned &rowLength) {
+    if(hashScan || !ixFileHandlePtr->isClustered()){
+        // std::cout << "[Error] getNextRow -> not a scan of a clustered tree." << std::endl;
+        return -1;
+    }
+    RID rid;
+    RC rc = getNextEntry(rid, key);
+    if(rc != 0){
+        return rc;
+    }
+    const std::string &batchRow = batchRows[batchIndex - 1];
+    rowLength = batchRow.size();
+    memcpy(row, batchRow.data(), rowLength);
+    return 0;
+}
+
+RC IX_VectorEntryIterator::getNextEntry(IndexEntry &entry) {
+    if(nextEntry >= entries.size()){
+        return IX_EOF;
+    }
+    entry = entries[nextEntry++];
+    return 0;
 }
 
 RC IX_ScanIterator::close() {
@@ -1667,7 +3551,7 @@ RC IX_ScanIterator::close() {
 }
 
 IXFileHandle &IXFileHandle::instance() {
-    static IXFileHandle ixFileHandle = IXFileHandle();
+    static IXFileHandle ixFileHandle;
     return ixFileHandle;
 }
 
@@ -1695,3 +3579,52 @@ FileHandle& IXFileHandle::getFileHandle() {
     return fileHandle;
 }
 
+RC IXFileHandle::readCachedNode(PageNum pageNum, unsigned version, void *page) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if(version != cacheVersion){
+        cachedNodes.clear();
+        cacheVersion = version;
+        return -1;
+    }
+    auto it = cachedNodes.find(pageNum);
+    if(it == cachedNodes.end()){
+        return -1;
+    }
+    memcpy(page, it->second.data(), PAGE_SIZE);
+    return 0;
+}
+
+RC IXFileHandle::cacheNode(PageNum pageNum, unsigned version, const void *page) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if(version != cacheVersion){
+        cachedNodes.clear();
+        cacheVersion = version;
+    }
+    cachedNodes[pageNum].assign((const char *)page, PAGE_SIZE);
+    return 0;
+}
+
+RC IXFileHandle::clearCache() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cachedNodes.clear();
+    return 0;
+}
+
+RC IXFileHandle::setTreeVersion(std::atomic<unsigned> *treeVersion) {
+    this->treeVersion = treeVersion;
+    return 0;
+}
+
+std::atomic<unsigned> *IXFileHandle::getTreeVersion() {
+    return treeVersion;
+}
+
+RC IXFileHandle::setClustered(bool clustered) {
+    this->clustered = clustered;
+    return 0;
+}
+
+bool IXFileHandle::isClustered() const {
+    return clustered;
+}
+
@@ -3,14 +3,20 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <functional>
 
 #include "../rbf/rbfm.h"
+#include "../rbf/wal.h"
+#include "bloom.h"
 
 # define IX_EOF (-1)  // end of the index scan
 
 // avoid the issue of align
 # define IM_DIR_SIZE 12     // Root and im both use this
-# define LEAF_DIR_SIZE 16
+# define LEAF_DIR_SIZE 20
 /**
  * Flag:
     0: empty
@@ -22,14 +28,59 @@
 # define ROOT_FLAG 2        // root node
 # define IM_FLAG 3          //intermediate node
 # define LEAF_FLAG 4        // leaf node
+# define POSTING_FLAG 5     // overflow page of a posting list
+# define FREE_FLAG 6        // page on the free list, <FREE_FLAG, next free page>
 
 # define ROOT_PAGE 0
 
+// Once page 0 points to the root it is <ROOT_PTR_FLAG, root page, first free page>, 0 if the free list is empty.
+// Pages freed by merges and by posting lists are chained from there and reused by allocatePage(...).
+// The free list has a latch of its own, next to the ones of pfm.h which are not bound to a page. It is always the last latch taken.
+# define FREE_LIST_OFFSET 8
+# define FREE_LIST_LATCH (UINT_MAX - 2)
+
+# define IX_FILL_FACTOR 0.9     // default fraction of a node filled by bulkBuild
+# define IX_CACHED_LEVELS 2     // IXFileHandle keeps page 0 and the inner nodes of this many top levels, the root is level 1
+# define IX_MAX_HEIGHT 16       // most levels of a tree insertEntry can descend, the root is level 1
+# define IX_UNDERFLOW (PAGE_SIZE / 4)   // a node whose entries take fewer bytes is merged with a sibling or takes entries from it
+# define IX_PROBE_MAX_WALK 2     // leaves probeEntries walks along towards the next key before it searches from the root again
+# define IX_OPTIMISTIC_RETRIES 4 // optimistic descents a lookup or an insert starts again before it latches, see descendToLeaf(...)
+
+// Composite keys, see IndexManager::encodeCompositeKey(...)
+# define COMPOSITE_KEY_SEPARATOR ","    // joins the attribute names of a composite key
+# define COMPOSITE_NULL 0x00            // marker byte of a NULL attribute, NULLs come first
+# define COMPOSITE_NOT_NULL 0x01        // marker byte before the value of an attribute
+
 class IX_ScanIterator;
 
 class IXFileHandle;
 
 // we assume write Directory at the beginning of each page
+// Entries follow the directory in key order, packed from the front: leaf <key, rid> pairs, im P0 then <key, ptr> pairs.
+// The end of each node holds a slot array: slot i is the offset of the i'th key and lives at PAGE_SIZE - (i+1) * IX_SLOT_SIZE,
+// so keys of every type, VARCHAR included, are binary searched. freeSpace counts the bytes between the entries and the slots.
+# define IX_SLOT_SIZE 2
+
+// A VARCHAR leaf keeps the prefix shared by its keys right after the directory as <prefixLength:4, prefix>, then stores every
+// key without it: <length - prefixLength:4, rest of the key>. The prefix is the common prefix of the separators around the leaf
+// in its parent (its fence keys): every key the tree routes to the leaf lies between them, so it has the prefix as well.
+# define LEAF_PREFIX_SIZE 4
+
+// A leaf stores every key once, followed by the posting list of its RIDs sorted by <pageNum, slotNum>: <length:2, encoded RIDs>.
+// Each RID is encoded as two varints (7 bits per byte, the high bit tells another byte follows): the pageNum and the slotNum of the
+// first RID, then the difference of the pageNum to the previous RID and the slotNum, its difference as well if the pageNum is the same.
+// A list longer than POSTING_INLINE_MAX moves to a chain of overflow pages and the leaf keeps <POSTING_OVERFLOW:2, first page:4>.
+# define POSTING_HEADER_SIZE 2
+# define POSTING_OVERFLOW 0xFFFF
+# define POSTING_INLINE_MAX (PAGE_SIZE / 8)
+# define POSTING_MAX_RID_SIZE 10                                            // 5 bytes of pageNum, 5 bytes of slotNum
+# define POSTING_MAX_GROWTH (POSTING_HEADER_SIZE + 2 * POSTING_MAX_RID_SIZE)  // most bytes one more RID adds to an entry
+# define POSTING_DIR_SIZE 16
+
+// The leaves of a clustered tree (see IXFileHandle::setClustered(...)) store the row of every key instead of a posting list:
+// <key, length:2, row>, laid out like a key with an inline posting list, so splits, merges and scans handle both alike.
+// Keys are unique and a row is never longer than IX_MAX_ROW_SIZE.
+# define IX_MAX_ROW_SIZE POSTING_INLINE_MAX
 
 // Intermediate node PageDirectory
 typedef struct
@@ -46,8 +97,58 @@ typedef struct
     int freeSpace;
     int numOfRecords;
     int nextNode; // pageNum, Linklist
+    int prevNode; // pageNum of the leaf before, -1 for the first leaf
 } leafPageDirectory;
 
+// Overflow page of a posting list: the encoded RIDs follow the directory, the first one without a difference,
+// so every page decodes on its own. The RIDs of a page are larger than the ones of the pages before it.
+typedef struct
+{
+    int flag;
+    int length;         // bytes of encoded RIDs
+    int numOfRids;
+    int nextPage;       // -1 at the end of the chain
+} postingPageDirectory;
+
+// Root-to-leaf path of an insert (or of a delete which rebalances nodes), allocated once so the descent and the splits need no other buffer.
+// pages[i] is the copy of node pageNums[i], the root is pages[0]. A split pushes its key up in one of splitKeys,
+// the one the child level did not use, with the new page number in newPageNums.
+typedef struct
+{
+    int height;
+    unsigned pageNums[IX_MAX_HEIGHT];
+    char pages[IX_MAX_HEIGHT][PAGE_SIZE];
+    char splitKeys[2][PAGE_SIZE];
+    unsigned newPageNums[2];
+} IndexPath;
+
+// <key, rid> pair to bulk build a B+ tree, key follows the same format as in insertEntry()
+typedef struct
+{
+    std::string key;
+    RID rid;
+} IndexEntry;
+
+/*
+ * Source of the <key, rid> pairs of bulkLoad(...), sorted by key then by RID.
+ * getNextEntry(...) returns IX_EOF after the last pair.
+ */
+class IX_EntryIterator {
+public:
+    virtual ~IX_EntryIterator() = default;
+    virtual RC getNextEntry(IndexEntry &entry) = 0;
+};
+
+// IX_EntryIterator over a vector of entries which is already sorted, see IndexManager::sortEntries(...)
+class IX_VectorEntryIterator : public IX_EntryIterator {
+public:
+    explicit IX_VectorEntryIterator(std::vector<IndexEntry> &entries) : entries(entries), nextEntry(0) {}
+    RC getNextEntry(IndexEntry &entry) override;
+private:
+    std::vector<IndexEntry> &entries;
+    size_t nextEntry;
+};
+
 class IndexManager {
 
 public:
@@ -56,7 +157,7 @@ public:
     // Create an index file.
     RC createFile(const std::string &fileName);
 
-    // Delete an index file.
+    // Delete an index file, and its Bloom filter.
     RC destroyFile(const std::string &fileName);
 
     // Open an index and return an ixFileHandle.
@@ -69,22 +170,45 @@ public:
      * Insert an entry into the given index that is indicated by the given ixFileHandle.
      *
      * If the index file is empty, we need to append the root page and insert the <key, rid> pair into rootLeaf page(here the root page is actually a leaf page, page flag is LEAF_FLAG).
-     * If there is only one page, the page is rootLeaf page.
+     * If page 0 is a leaf, it is the rootLeaf page (the other pages are overflow pages of its posting lists).
      * If one page is not enough, page 0 stores the pointer which points to the real root page, file is in the tree format.
+     *
+     * An insert which fits into its leaf latches the leaf only, see insertIntoLeaf(...). The others use latch crabbing:
+     * page 0 and then the nodes on the path are latched in exclusive mode top-down, once a node has room for one more
+     * entry (it can't split) the latches of its ancestors are released.
+     * The key is added to the Bloom filter of the index, if it has one, before the entry goes in.
      */
     RC insertEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid);
 
     /*
      * Delete an entry from the given index that is indicated by the given ixFileHandle.
-     * Use searchEntry(...) to retrieve the desired <key, rid> pair.
-     * If key == key, rid == rid, then delete the entry.
+     * Use descendToLeaf(...) to retrieve the leaf of key (walk along the leaves if it was split meanwhile), then remove rid
+     * from the posting list of key, the entry goes once the list is empty.
+     * Only the leaf is latched in exclusive mode, when walking to the next leaf it is latched before this one is released.
+     * If the leaf was latched by a writer since it was read, it is read again, and searched again if the tree got a new
+     * version meanwhile, the page may have been merged away.
+     * A leaf which underflows afterwards is rebalanced by handleUnderflow(...).
     */
     RC deleteEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid);
 
+    /*
+     * Rows of a clustered tree, see IX_MAX_ROW_SIZE. They take the paths of insertEntry(...) and deleteEntry(...) with the row
+     * in place of the posting list: latching, splits, merges and the log are the same (OP_ROW_INSERT, OP_ROW_DELETE).
+     * insertRow(...) returns -1 if the key is in the tree already or the row is longer than IX_MAX_ROW_SIZE.
+     * readRow(...) copies the row of key into row, like a lookup of one key. A scan of the tree returns the rows in key order,
+     * see IX_ScanIterator::getNextRow(...). insertEntry(...) and deleteEntry(...) return -1 on a clustered tree.
+     */
+    RC insertRow(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const void *row, unsigned rowLength);
+    RC deleteRow(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key);
+    RC readRow(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, void *row, unsigned &rowLength);
+
     /*
      * Initialize and IX_ScanIterator to support a range search
      * Use searchEntry(...) to get where the scan should start
      * and then ix_ScanIterator.initializeScanIterator(...) to initialize the scan.
+     * A reverse scan returns the keys from highKey down to lowKey (the RIDs of a key backwards too): it starts at the last key
+     * of the range and walks the leaves along prevNode, so MAX or the last N keys read the rightmost leaves of the range only.
+     * A scan of one key the Bloom filter of the index rules out reads no page.
     */
     RC scan(IXFileHandle &ixFileHandle,
             const Attribute &attribute,
@@ -92,62 +216,343 @@ public:
             const void *highKey,
             bool lowKeyInclusive,
             bool highKeyInclusive,
-            IX_ScanIterator &ix_ScanIterator);
+            IX_ScanIterator &ix_ScanIterator,
+            bool reverse = false);
+
+    /*
+     * Look up many keys at once, keys are sorted (in the format of insertEntry) and rids[i] gets the RIDs of keys[i], none if it is absent.
+     * The tree is searched from the root for the first key, then the copy of its leaf is searched for the next keys, and the leaves
+     * after it are read while the tree keeps its version, up to IX_PROBE_MAX_WALK of them; a key further away is searched from the root.
+     * Keys the Bloom filter of the index rules out (see createBloomFilter(...)) are absent without a search.
+     * -1 if the keys are not sorted.
+     */
+    RC probeEntries(IXFileHandle &ixFileHandle, const Attribute &attribute, const std::vector<std::string> &keys,
+                    std::vector<std::vector<RID>> &rids);
+    
+    /*
+     * Build the B+ tree of an empty index file bottom-up from all of its <key, rid> pairs.
+     * entries are sorted by sortEntries(...) with numOfThreads threads, then passed to bulkLoad(...).
+     * The result has the same format as a tree built by insertEntry(...).
+     */
+    RC bulkBuild(IXFileHandle &ixFileHandle, const Attribute &attribute, std::vector<IndexEntry> &entries,
+                 float fillFactor = IX_FILL_FACTOR, unsigned numOfThreads = 1);
+    
+    /*
+     * Build the B+ tree of an empty index file bottom-up from sorted <key, rid> pairs, reading them once.
+     * The RIDs of a key form its posting list; a leaf is written once the first key of the next one is read,
+     * packed up to fillFactor of the page (a VARCHAR leaf with the prefix of its fences), so the leaves take contiguous pages
+     * left to right. Long posting lists are kept until the leaves are written and go to overflow pages after them.
+     * Then the intermediate levels are built on top of the leaves, and the Bloom filter of the file, if it has one, is built again
+     * for the keys. -1 if the pairs are not sorted.
+     */
+    RC bulkLoad(IXFileHandle &ixFileHandle, const Attribute &attribute, IX_EntryIterator &entries, float fillFactor = IX_FILL_FACTOR);
+
+    /*
+     * Shrink the index file online: the pages of the tree at the end of the file move into the free pages before them
+     * (the ones on the free list and any page no node points to), the pointers to them are changed and the file is truncated
+     * to the pages still used, the free list is empty afterwards.
+     * The whole tree is latched in exclusive mode top-down, concurrent operations wait until it is done. Not logged.
+     */
+    RC shrinkFile(IXFileHandle &ixFileHandle, const Attribute &attribute);
+
+    /*
+     * Build a Bloom filter of the keys of the index (see BloomFilter), sized for the keys it has (at least BLOOM_MIN_KEYS)
+     * at falsePositiveRate, into the file named after the index file with BLOOM_FILE_SUFFIX. From then on insertEntry(...)
+     * adds keys to it, bulkLoad(...) builds it again for its keys, and probeEntries(...) and scans of one key skip the keys
+     * it rules out without reading the tree. Building it again sizes it again and drops the bits of deleted keys.
+     * No entry may be inserted meanwhile. -1 for a hash index.
+     */
+    RC createBloomFilter(IXFileHandle &ixFileHandle, const Attribute &attribute, float falsePositiveRate = BLOOM_FALSE_POSITIVE_RATE);
+
+    // Delete the Bloom filter of the index file fileName, if it has one. destroyFile(...) deletes it too.
+    RC destroyBloomFilter(const std::string &fileName);
+
+    // Bloom filter of the index file fileName, NULL if it has none. It is read from its file on first use and stays in memory.
+    std::shared_ptr<BloomFilter> getBloomFilter(const std::string &fileName);
+
+    // The index file fileName was replaced by another one (see LogManager::replaceFiles(...)): the copies of the IXFileHandles
+    // on it become stale and its Bloom filter is read again on next use.
+    RC reloadFile(const std::string &fileName);
+
+    /*
+     * Composite keys over several attributes are VARCHAR keys whose bytes are in the order of the attributes under memcmp,
+     * so the tree compares them like any other VARCHAR key, with one memcmp per key and no switch on the types.
+     * Each attribute is a marker byte, COMPOSITE_NULL or COMPOSITE_NOT_NULL followed by its value: INT big-endian with
+     * the sign bit flipped, REAL big-endian with every bit flipped if negative and the sign bit flipped otherwise,
+     * VARCHAR with each 0 byte escaped as <0, 0xFF> and ended by <0, 0>, so no value is a prefix of another.
+     * getCompositeAttribute(...) gives the VARCHAR attribute of the index, named after the attributes joined by
+     * COMPOSITE_KEY_SEPARATOR and as long as the longest key. encodeCompositeKey(...) encodes data in the record format
+     * of attributes (null indicator, then the values) into key, decodeCompositeKey(...) turns key back into that format.
+     */
+    Attribute getCompositeAttribute(const std::vector<Attribute> &attributes) const;
+    RC encodeCompositeKey(const std::vector<Attribute> &attributes, const void *data, void *key) const;
+    RC decodeCompositeKey(const std::vector<Attribute> &attributes, const void *key, void *data) const;
+
+    /*
+     * Scan a composite index for the keys whose first numOfPrefixAttributes attributes equal prefix (in the record format
+     * of these attributes) and whose next attribute lies between lowKey and highKey (like scan(...), NULL is unbounded).
+     * The bounds are encoded into the iterator: the prefix, then the bound of the next attribute, followed by 0xFF
+     * when every key starting with it has to be below (or above) the bound.
+     */
+    RC prefixScan(IXFileHandle &ixFileHandle,
+                  const std::vector<Attribute> &attributes,
+                  const void *prefix,
+                  unsigned numOfPrefixAttributes,
+                  const void *lowKey,
+                  const void *highKey,
+                  bool lowKeyInclusive,
+                  bool highKeyInclusive,
+                  IX_ScanIterator &ix_ScanIterator);
 
     // Print the B+ tree in pre-order (in a JSON record format)
     void printBtree(IXFileHandle &ixFileHandle, const Attribute &attribute) const;
     
+    /*
+     * Keys of VARCHAR leaves are stored without the prefix of their leaf, use these to read the entry at offset of a node.
+     * getLeafKey(...) copies the whole key, compareLeafKey(...) compares it with key like compareNormalizedKey(...).
+     * For im nodes and INT / REAL leaves they read the key as it is stored.
+     */
+    RC getLeafKey(const void *page, int offset, const Attribute &attribute, void *key) const;
+    int compareLeafKey(const void *page, int offset, const Attribute &attribute, const void *key) const;
+    int getLeafPrefixLength(const void *page, const Attribute &attribute) const;     // 0 but for VARCHAR leaves
+    
+    /*
+     * Offset of the first entry of a node, after the directory, P0 of an im node and the prefix of a VARCHAR leaf.
+     */
+    int getNodeDataStart(const void *page, const Attribute &attribute) const;
+    
+    /*
+     * Compare two keys of this attribute, return < 0, 0 or > 0 like strcmp.
+     * VarChar keys are compared byte by byte then by length, which is the same order as strcmp on the strings.
+     * REAL keys are in the order of their normalized keys: -0.0 equals 0.0, every NaN is equal and above +infinity.
+     */
+    int compareKey(const Attribute &attribute, const void *key1, const void *key2) const;
+
+    /*
+     * Nodes keep INT and REAL keys normalized, so that two keys compare with one memcmp of 4 bytes: big-endian, INT with the
+     * sign bit flipped, REAL with every bit flipped if negative and the sign bit flipped otherwise, -0.0 as 0.0 and any NaN as
+     * the quiet NaN. VARCHAR keys are stored as they are, their bytes compare with memcmp then by length already.
+     * normalizeKey(...) writes the normalized INT / REAL key into normalized (4 bytes) and returns it, VARCHAR key itself.
+     * denormalizeKey(...) turns a key of a node back into the format of insertEntry(...).
+     * compareNormalizedKey(...) compares two keys of nodes like compareKey(...) compares the keys they come from.
+     */
+    const void *normalizeKey(const Attribute &attribute, const void *key, void *normalized) const;
+    RC denormalizeKey(const Attribute &attribute, const void *normalized, void *key) const;
+    int compareNormalizedKey(const Attribute &attribute, const void *key1, const void *key2) const;
+    
+    /*
+     * Length of a key stored in a node: 4 for INT and REAL, 4 + length for VARCHAR.
+     */
+    int getKeyLength(const Attribute &attribute, const void *key) const;
+    
+    /*
+     * Posting lists, see POSTING_HEADER_SIZE. posting points to the list right after the key of a leaf entry.
+     * getLeafEntryLength(...) is the length of the key and its list at offset of a leaf.
+     * readPostingList(...) decodes the list, reading its overflow pages under their shared latches.
+     */
+    int getPostingLength(const void *posting) const;
+    int getLeafEntryLength(const void *page, int offset, const Attribute &attribute) const;
+    RC readPostingList(IXFileHandle &ixFileHandle, const void *posting, std::vector<RID> &rids) const;
+    
+    /*
+     * Current version of the tree of the file, see newTreeVersion(...). A copy of a node read under its latch while the tree had
+     * this version may only be followed to another node (nextNode of a leaf) if the version is still the same.
+     */
+    unsigned getTreeVersion(IXFileHandle &ixFileHandle) const;
+    
 //    RC searchInside
 
 protected:
+    friend class IX_ScanIterator;                                               // searches the tree again, see getNextEntry(...)
+    
     IndexManager() = default;                                                   // Prevent construction
     ~IndexManager() = default;                                                  // Prevent unwanted destruction
     IndexManager(const IndexManager &) = default;                               // Prevent construction by copying
     IndexManager &operator=(const IndexManager &) = default;                    // Prevent assignment
     
     /*
-     * This method is the implementation of the pseduo-code in textbook. It is used to recursively.
+     * Append one attribute of a composite key to key, see encodeCompositeKey(...), value is NULL for a NULL attribute.
+     * Return the number of bytes appended.
+     */
+    int encodeCompositeValue(const Attribute &attribute, const void *value, char *key) const;
+
+    /*
+     * Create the Bloom filter of the index file fileName with the hashes of its keys (HashIndexManager::hashKey(...)),
+     * sized for them at falsePositiveRate, it replaces the filter the file had. Used by createBloomFilter(...) and bulkLoad(...).
+     */
+    RC buildBloomFilter(const std::string &fileName, const std::vector<unsigned> &hashes, float falsePositiveRate);
+
+    /*
+     * This method is the implementation of the pseduo-code in textbook, without recursion.
      * Check textbook "Database Management System" chapter 10.5: Insert
+     * It descends from rootPageNum to the leaf once, reading every node into path, then inserts into the leaf
+     * and walks path back up while the child split: the split key goes into the parent, which may split in turn.
+     * latchedNodes are the nodes latched in exclusive mode from top to bottom, the nodes of the path are latched and added to them.
+     */
+    RC insertion(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned rootPageNum, const void *key, const void *data,
+                 int sizeOfData, IndexPath &path, std::vector<unsigned> &latchedNodes);
+    
+    /*
+     * A node is safe if one more entry of the largest key fits in it, then inserting below it never splits it.
+     * leafGrowth is the most bytes the insert adds to a leaf next to the key, see getLeafGrowth(...).
+     */
+    bool isSafeNode(const Attribute &attribute, const void *page, int leafGrowth) const;
+    
+    /*
+     * Insert an entry into its leaf for insertEntry(...) and insertRow(...), data is the rid or the row (sizeOfData bytes).
+     * getLeafGrowth(...) is the most bytes it adds to a leaf next to the key: POSTING_MAX_GROWTH for a rid, the row with its
+     * length in a clustered tree. logLeafInsert(...) ends the insert in the log.
+     */
+    RC insertLeafEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const void *data, int sizeOfData);
+    int getLeafGrowth(IXFileHandle &ixFileHandle, int sizeOfData) const;
+    RC logLeafInsert(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const void *data, int sizeOfData);
+    
+    /*
+     * Remove rid from the posting list of key for deleteEntry(...), or the row of key for deleteRow(...) if rid is NULL.
+     */
+    RC removeLeafEntry(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID *rid);
+    
+    /*
+     * Called by deleteEntry after the leaf of key lost so many bytes that it underflows (see IX_UNDERFLOW).
+     * It descends from the root again with exclusive latch crabbing and walks the path back up: an underflowing node is merged
+     * with its right sibling (its left one if it is the last child) and their separator leaves the parent, which may underflow in turn.
+     * If they don't fit in one node their entries are split evenly instead and the separator is replaced.
+     * The root is never merged, when it is left with a single intermediate child it takes over the entries of the child.
+     */
+    RC handleUnderflow(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key);
+    
+    /*
+     * Merge rightPage into leftPage or redistribute their entries, both are children of parent and separated by its sepIndex'th key.
+     * lowFence and highFence are the fence keys around both of them, the prefix of a VARCHAR leaf comes from them.
+     * The nodes are written, a merged rightPage goes to the free list. Nothing changes if the new separator doesn't fit in parent.
+     */
+    RC rebalanceNodes(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned parentPageNum, void *parent, int sepIndex,
+                      unsigned leftPageNum, void *leftPage, unsigned rightPageNum, void *rightPage,
+                      const void *lowFence, const void *highFence, bool &merged);
+    
+    /*
+     * A node underflows if its entries take fewer than IX_UNDERFLOW bytes. A node is safe for a delete if it doesn't underflow
+     * after losing an entry of the largest key, and a separator of the largest key still fits in it: rebalancing below it never changes it
+     * beyond that. The root is safe with two keys.
+     */
+    bool isUnderflow(const void *page) const;
+    bool isSafeForDelete(const Attribute &attribute, const void *page, bool isRoot) const;
+    
+    /*
+     * Take the entries of a node out as whole keys and their data (posting list in a leaf, child pointer in an im node),
+     * link is nextNode of a leaf or P0 of an im node. writeNodeEntries(...) writes entries [begin, end) back into an empty node,
+     * a leaf stores its keys without the first prefixLength characters of prefix and gets prevLink as prevNode.
+     * It returns -1 if they don't fit, page is not changed then.
+     */
+    RC readNodeEntries(const void *page, const Attribute &attribute, std::vector<std::string> &keys, std::vector<std::string> &data,
+                       int &link) const;
+    RC writeNodeEntries(int pageFlag, void *page, const Attribute &attribute, const std::vector<std::string> &keys,
+                        const std::vector<std::string> &data, size_t begin, size_t end, int link, const char *prefix, int prefixLength,
+                        int prevLink = -1) const;
+    
+    /*
+     * Set prevNode of the leaf pageNum after the leaf before it was split or merged, under the exclusive latch of pageNum:
+     * the caller holds the latches of leaves left of it only, like deleteEntry(...) walking along the leaves.
+     */
+    RC setPrevNode(IXFileHandle &ixFileHandle, unsigned pageNum, int prevNode);
+    
+    /*
+     * Take a page of the free list for data, or append it if the list is empty (or page 0 is still the root-leaf page).
+     * freePage(...) puts a page no node points to any more on the free list, the caller holds its exclusive latch.
+     * Both start a new version of the tree when they change the free list: copies of a node may be of a page freed meanwhile.
+     */
+    RC allocatePage(IXFileHandle &ixFileHandle, const void *data, unsigned &pageNum);
+    RC freePage(IXFileHandle &ixFileHandle, unsigned pageNum);
+    
+    /*
+     * Call visit on every page number stored in page: the root in page 0, the children of an im node, nextNode, prevNode of a leaf and
+     * the first overflow page of its posting lists, the next page of an overflow page. owned is false for nextNode and prevNode,
+     * the other pages are only pointed to by this one. visit may change the page number in place.
+     */
+    RC forEachPagePointer(void *page, const Attribute &attribute, const std::function<void(unsigned &pageNum, bool owned)> &visit) const;
+    
+    /*
+     * Insert <key, rid> (<key, row> in a clustered tree) into its leaf if it fits there without a split: the leaf is found by
+     * descendToLeaf(...), then latched in exclusive mode only if nobody latched it since it was read (RWLatch::upgrade), so the copy
+     * is current. inserted is false if the leaf is full, or kept changing under IX_OPTIMISTIC_RETRIES descents, insertEntry latches
+     * the path then.
+     */
+    RC insertIntoLeaf(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const void *data, int sizeOfData,
+                      bool &inserted);
+    
+    /*
+     * Release the exclusive latches of the first numOfNodes nodes of latchedNodes and remove them.
      */
-    RC insertion(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned curNode, const void *key, const RID &rid, void *newChildKey, void *newChildData, bool &splitFlag);
+    RC unlatchNodes(IXFileHandle &ixFileHandle, std::vector<unsigned> &latchedNodes, size_t numOfNodes);
     
     /*
      * No matter in im node or leaf node, this function could be used to get the length for data pair by input parameter sizeOfData.
      * <key, ptr> in im node, input parameter sizeOfData is the length for ptr
-     * <key, rid> for lead node, input parameter sizeOfData is the length for rid
+     * <key, posting list> for leaf node, input parameter sizeOfData is POSTING_MAX_GROWTH
+     * The slot of the key is included.
      */
     RC getRequiredLength(const Attribute &attribute, const void *key, int sizeOfData);
     
     /*
      * Insert entry into a node page, this function is called after we get one available page which has enough space for insertion.
-     * data is ptr(pageNum) for im node and rid for lead node.
+     * data is ptr(pageNum) for im node and rid for lead node, the row in a leaf of a clustered tree.
      * This function also assure a order when insertion, that is key_n <= key_n+1
      * This function doesn't write back to disk, but update buffer page.
      *
     */
-    RC insertEntryToNode(int pageFlag, void *page, const Attribute &attribute, const void *key, const void *data, int sizeOfData);
+    RC insertEntryToNode(IXFileHandle &ixFileHandle, int pageFlag, void *page, const Attribute &attribute, const void *key, const void *data, int sizeOfData);
+    
+    /*
+     * Add rid to the posting list of the index'th entry of a leaf, the list moves to overflow pages when it gets too long.
+     * Remove rid from it, empty tells whether the list has no RID left, then the caller removes the entry.
+     */
+    RC insertIntoPostingList(IXFileHandle &ixFileHandle, void *page, int index, const Attribute &attribute, const RID &rid);
+    RC deleteFromPostingList(IXFileHandle &ixFileHandle, void *page, int index, const Attribute &attribute, const RID &rid, bool &empty);
+    
+    /*
+     * Overflow pages of a posting list. The caller holds the exclusive latch of the leaf which owns the list,
+     * the pages are written under their exclusive latches.
+     * appendPostingPages(...) writes rids into new pages filled up to fillFactor and returns the first one, the last one links to nextPage.
+     */
+    RC appendPostingPages(IXFileHandle &ixFileHandle, const RID *rids, size_t numOfRids, float fillFactor, unsigned &firstPageNum,
+                          int nextPage = -1);
+    RC insertIntoPostingPages(IXFileHandle &ixFileHandle, unsigned firstPageNum, const RID &rid);
+    RC deleteFromPostingPages(IXFileHandle &ixFileHandle, unsigned firstPageNum, const RID &rid, bool &empty);
+    
+    /*
+     * Encode sorted rids, return the length. Decode length bytes of encoded RIDs and append them to rids.
+     * encodeRid(...) encodes one RID after previous (NULL for the first RID of a list). data may be NULL to get the length only.
+     */
+    int encodeRids(const RID *rids, size_t numOfRids, char *data) const;
+    int encodeRid(const RID *previous, const RID &rid, char *data) const;
+    RC decodeRids(const char *data, int length, std::vector<RID> &rids) const;
+    
+    /*
+     * Change the length of the entry at offset of a leaf (its index'th one), the entries after it and their slots move.
+     */
+    RC resizeLeafEntry(void *page, int index, int offset, int oldLength, int newLength) const;
     
     /*
      * When we need to split a page in im node or leaf node, this function could get the split points including 3 values:
      * splitOffset: offset inside a node page where the split happens
      * splitNumOfRecords: numOfRecords ahead of the splitOffset
-     * splitKey: the first pair after the splitOffset
+     * splitKey: the first pair after the splitOffset, for a VARCHAR leaf its shortest prefix which still separates the two halves
      */
-    RC getSplitInNode(int pageFlag, void *page, const Attribute &attribute, int &splitOffset, int &splitNumOfRecords, void *splitKey, int sizeOfData);
+    RC getSplitInNode(int pageFlag, void *page, const Attribute &attribute, int &splitOffset, int &splitNumOfRecords, void *splitKey);
     
     /*
      * By comparing key and splitKey to determine which page the key should be allocated.
      * if key >= splitKey, go to the new page
      * else insert into the old page
      */
-    RC compareAndInsertToNode(int pageFlag, void *oldPage, void *newPage, const Attribute &attribute, const void *key, void *splitKey, const void *data, int sizeOfData);
+    RC compareAndInsertToNode(IXFileHandle &ixFileHandle, int pageFlag, void *oldPage, void *newPage, const Attribute &attribute, const void *key, void *splitKey, const void *data, int sizeOfData);
     
     /*
      * redistribute old page into oldPage and newPage for leaf node and im node.
      * im node: old page only contain the data ahead of splitOffset, new page contains the data after the splitOffset especially after the splitKey, new page doesn't contain the splitKey
      * leaf node: difference occurs in new page, new page for leaf node contains the splitKey
     */
-    RC redistributeNode(IXFileHandle &ixFileHandle, int pageFlag, void *oldPage, void *newPage, int splitOffset, int splitNumOfRecords, const Attribute &attribute);
+    RC redistributeNode(int pageFlag, void *oldPage, void *newPage, int splitOffset, int splitNumOfRecords, const Attribute &attribute);
     
     /*
      * Insert <key, data> to this node with splitting, return newPageNum and splitKey for upper level process.
@@ -157,8 +562,10 @@ protected:
      * 3. call compareAndInsertToNode(...) to insert the key into B+ node
      * 4. append the newPage into B+ tree.
      * 5. update nextNode attribute of old page to newPageNum
+     * lowKey and highKey are the fence keys of a VARCHAR leaf (NULL at the ends of the tree), both halves get the prefix of their fences.
     */
-    RC insertEntrytoNodeWithSplitting(IXFileHandle &ixFileHandle, int pageFlag, unsigned pageNum, unsigned &newPageNum, void *page, void *splitKey, const Attribute &attribute, const void *key, const void *data, int sizeOfData);
+    RC insertEntrytoNodeWithSplitting(IXFileHandle &ixFileHandle, int pageFlag, unsigned pageNum, unsigned &newPageNum, void *page, void *splitKey, const Attribute &attribute, const void *key, const void *data, int sizeOfData,
+                                      const void *lowKey = NULL, const void *highKey = NULL);
     
     /*
      * Insert <key, data> to this node without splitting and write back the page
@@ -169,7 +576,7 @@ protected:
      * First time insert a <key, data>.
      * initialize the root-leaf page and insert it. write back the root-leaf page.
     */
-    RC appendRootLeafPage(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid);
+    RC appendRootLeafPage(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const void *data, int sizeOfData);
     
     /*
      * If the root-leaf page is full, then we need to
@@ -177,14 +584,15 @@ protected:
             - create a root page
             - rewrite the page 0 as pointer to root page
     */
-    RC splitRootLeafPage(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const RID &rid);
+    RC splitRootLeafPage(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, const void *data, int sizeOfData);
     
     /*
      * If the root page is full, then we need to
      * 1. split the old root page and this old page and new page are now two im node
      * 2. create a new root page node storing this pageNum of old and new pages. Also rootPtr stores the new root page number.
+     * rootPage is the content of the root, it becomes the left im node.
     */
-    RC splitRootPage(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned rootPageNum, const void *key, const void *data);
+    RC splitRootPage(IXFileHandle &ixFileHandle, const Attribute &attribute, unsigned rootPageNum, void *rootPage, const void *key, const void *data);
     
     /*
      * Generate root page.
@@ -194,35 +602,128 @@ protected:
     
     /*
      * This function is used to search inside the B+tree to get an desired value whether the key is inclusive or not.
-     * This function is used in deleteEntry and scan.
+     * This function is used in deleteEntry, scan and IX_ScanIterator.
      * Loop call getNextNode to arrive get the pageNum of leafNode
      * then call searchInsideLeafNode to get the offset and recordId of this <key, rid> pair.
+     * The leaf is found by descendToLeaf(...), no latch is held when it returns.
+     * Every node on the path is read once, leafPage (if not NULL) gets the copy of the leaf the result belongs to.
+     * A NULL key leads to the first leaf, or to the end of the last leaf if lastLeaf is true (reverse scans start there).
+     * leafVersion (if not NULL) gets the version of the latch of the leaf the copy belongs to.
+     */
+    RC searchEntry(IXFileHandle &ixFileHandle, int &pageNum, int &offset, int &recordId, const Attribute &attribute, const void *key, bool inclusive,
+                   void *leafPage = NULL, bool lastLeaf = false, unsigned long long *leafVersion = NULL);
+    
+    /*
+     * Optimistic lock coupling from page 0 down to the leaf of key (see searchEntry(...) for a NULL key): no node is latched,
+     * each one is read between RWLatch::readVersion() and validate(), and the version of the child is taken before the
+     * parent is validated again, so the child was the right one when it was read. A writer changing a node on the way
+     * makes the descent start again; the last of IX_OPTIMISTIC_RETRIES + 1 descents latches the nodes in shared mode
+     * (crabbing), so readers are not starved by writers.
+     * page gets the copy of the leaf, latch and version are its latch and the version the copy belongs to.
+     */
+    RC descendToLeaf(IXFileHandle &ixFileHandle, const Attribute &attribute, const void *key, bool lastLeaf, unsigned &pageNum,
+                     void *page, RWLatch *&latch, unsigned long long &version);
+    
+    /*
+     * This function is used in insertion and searchEntry to choose the child of imPage, a node they have read.
+     * return a pageNum which is the node of next level to check in B+tree, 1 if imPage is a leaf.
+     * It is the left pointer of the first key > key: a key equal to a separator lives right of it, every key is in one leaf.
+     * keyIndex (if not NULL) gets the index of the key right of the chosen pointer.
+     */
+    RC getNextNode(const void *imPage, unsigned &nextNode, const Attribute &attribute, const void *key, int *keyIndex = NULL) const;
+    
+    /*
+     * Read a node of the tree, the caller holds its latch or validates its version afterwards. level is 0 for page 0 and 1 for the root.
+     * (an inner node read while a writer holds it may be kept torn, the writer starts a new version before it releases the latch)
+     * Page 0 and the inner nodes down to IX_CACHED_LEVELS are read from the copies kept by ixFileHandle while the tree keeps
+     * the version they are copied in. Leaves change without a new version, they are always read from the file.
      */
-    RC searchEntry(IXFileHandle &ixFileHandle, int &pageNum, int &offset, int &recordId, const Attribute &attribute, const void *key, bool inclusive);
+    RC readNode(IXFileHandle &ixFileHandle, unsigned pageNum, void *page, int level);
     
     /*
-     * This function is used in insertion to get the next node when inserting an entry (call insertion(...))
-     * return a pageNum which is the node of next level to check in B+tree.
+     * Start a new version of the tree after page 0 or inner nodes are changed, before the latches of the change are released.
+     * The copies of all the IXFileHandles on this file become stale.
      */
-    RC getNextNode(IXFileHandle &ixFileHandle, unsigned curNode, unsigned &nextNode, const Attribute &attribute, const void *key);
+    RC newTreeVersion(IXFileHandle &ixFileHandle);
+    RC newTreeVersion(const std::string &fileName);                            // the file is created or destroyed
     
     /*
-     * search inside the leaf node.
+     * search inside the leaf node with searchInsideNode(...).
      * If inclusive is true, then offset and recordId indicates the <newKey, rid> pair where key <= newKey
      * if inclusive is false, then key < newKey strictly.
      */
-    RC searchInsideLeafNode(IXFileHandle &ixFileHandle, unsigned curNode, int &offset, int &recordId, const Attribute &attribute, const void *key, bool inclusiveKey);
+    RC searchInsideLeafNode(const void *page, int &offset, int &recordId, const Attribute &attribute, const void *key, bool inclusiveKey) const;
+    
+    /*
+     * Binary search the slot array of a leaf or im node.
+     * Return the index of the first key with key <= nodeKey if inclusiveKey is true, key < nodeKey otherwise,
+     * numOfRecords if there is no such key.
+     */
+    int searchInsideNode(const void *page, const Attribute &attribute, const void *key, bool inclusiveKey) const;
+    
+    /*
+     * Read / write the slot of the index'th key of a node, which is the offset of the key inside the page.
+     */
+    int getKeyOffset(const void *page, int index) const;
+    void setKeyOffset(void *page, int index, int offset) const;
+    
+    /*
+     * Offset of the end of the entries of a node, where the next entry would be appended.
+     */
+    int getNodeDataEnd(const void *page) const;
+    
+    /*
+     * Write the slot array of a node from its entries, after they are moved in bulk (split, bulk build).
+     */
+    RC buildSlotArray(int pageFlag, void *page, const Attribute &attribute) const;
+    
+    /*
+     * Length of the common prefix of the characters of two VARCHAR keys, 0 if one of them is NULL.
+     */
+    int getCommonPrefixLength(const void *key1, const void *key2) const;
+    
+    /*
+     * Suffix truncation of the separator of two neighbouring leaves: the shortest prefix of rightKey which is >= leftKey,
+     * it still separates the leaves. separator may be rightKey itself.
+     */
+    RC getShortSeparator(const void *leftKey, const void *rightKey, void *separator) const;
+    
+    /*
+     * Store the keys of a VARCHAR leaf without the first prefixLength characters of prefix, which all of them share.
+     * The entries are rewritten, -1 if a key doesn't have the prefix or they don't fit.
+     */
+    RC setLeafPrefix(void *page, const Attribute &attribute, const char *prefix, int prefixLength) const;
+    
+    /*
+     * Sort entries by <key, rid>. Each thread sorts one chunk, then the sorted chunks are merged pairwise.
+     */
+    RC sortEntries(const Attribute &attribute, std::vector<IndexEntry> &entries, unsigned numOfThreads);
+    
+    /*
+     * Used by bulkLoad(...). level holds <first key, pageNum> of the nodes of one level from left to right,
+     * pack them into the nodes of the level above, append these nodes and replace level with them.
+     * The single node of the top level is the root.
+     */
+    RC buildUpperLevel(IXFileHandle &ixFileHandle, const Attribute &attribute, std::vector<std::pair<std::string, unsigned>> &level, float fillFactor);
     
     /*
      * print one single node.
      */
-    RC printNode(IXFileHandle &ixFileHandle, int pageFlag, void *page, int numOfRecords, int level, const Attribute &attribute) const;
+    RC printNode(IXFileHandle &ixFileHandle, int pageFlag, void *page, int numOfRecords, const Attribute &attribute) const;
     
     /*
      * Recursively call this function to print the B+tree.
     */
     RC printNormalBtree(IXFileHandle &ixFileHandle, int curNode, int level, const Attribute &attribute, bool isLastKey) const;
 
+private:
+    // version of the tree of every index file opened so far, shared by all the IXFileHandles on the file
+    std::mutex _treeVersionsMutex;
+    std::map<std::string, std::unique_ptr<std::atomic<unsigned>>> _treeVersions;
+
+    // Bloom filter of every index file looked up so far, NULL for the ones which have none
+    std::mutex _bloomFiltersMutex;
+    std::map<std::string, std::shared_ptr<BloomFilter>> _bloomFilters;
 };
 
 class IX_ScanIterator {
@@ -242,33 +743,53 @@ public:
                               bool highKeyInclusive,
                               int curNode,
                               int curOffset,
-                              int curRecordId);
+                              int curRecordId,
+                              unsigned long long curVersion,
+                              const void *curPage = NULL);        // copy of curNode (unless it is -1), curVersion the version of its latch
 
     /*
      * Get next matching entry
-     * There are two important attributes modified inside this function, curOffset and preOffset
-     * curOffset shows where the retrieve should happen
-     * preOffset shows the location of last retrieve.
-     * These two attributes are used in checkDeleteToUpdateCurOffset, if deletion happens, curOffset is reset to preOffset.
+     * The qualifying <key, rid> pairs of the copy of a leaf, from curRecordId on, are taken into batchEntries in one pass
+     * (readBatch), then returned one by one. The scan works on its copy, so entries deleted meanwhile (by the caller as well)
+     * don't move it.
+     * The next leaf is only taken from nextNode of the copy if nobody latched curNode since its copy was read (curVersion),
+     * otherwise the leaf may have been split or merged away and the scan searches the tree again for the first key after lastKey.
+     * A reverse scan moves the other way: from curRecordId down to the first key of the leaf, then along prevNode, and searches
+     * again for the last key before lastKey.
     */
     RC getNextEntry(RID &rid, void *key);
 
+    // Get the next key of a scan of a clustered tree with its row, see IndexManager::insertRow(...)
+    RC getNextRow(void *key, void *row, unsigned &rowLength);
+
     // Terminate index scan
     RC close();
+
+private:
+    /*
+     * Read the leaf after curNode (before it in a reverse scan) into curPage under its shared latch, and update curLeafPageDir.
+     * If curNode changed since its copy was read, searchAgain() instead. curNode is -1 after the last leaf.
+     */
+    RC moveToNextLeaf();
+    
+    /*
+     * Search the tree for the first key after lastKey (from lowKey if no key is returned yet), curNode is the leaf where it is.
+     */
+    RC searchAgain();
     
     /*
-     * check whether deletion happens during the scan.
-     * If deletion happens, change the curOffset to preOffset and decrement curRecordId, so that curOffset points to the next new pair and curRecordId show num of records that has been visited
+     * Take the entries of curPage from curRecordId to the end of the leaf (to its first key in a reverse scan) into batchEntries,
+     * with the RIDs of overflow posting lists (the rows of a clustered tree into batchRows). curNode becomes -1 when a key is past the range.
      */
-    RC checkDeleteToUpdateCurOffset(void *page);
+    RC readBatch();
 
-private:
     int curNode;
     int curOffset;
-    // previous offset inside each page
-    int preOffset;
-    RID preRid;
-    int curRecordId;
+    int curRecordId;                    // first entry of curPage to take into the batch
+    bool batched;                       // the entries of curPage are in batchEntries
+    std::string lastKey;                // last key taken into batchEntries, batchEntries keep normalized keys
+    unsigned long long curVersion;      // version of the latch of curNode when curPage was read, see RWLatch::readVersion()
+    bool reverse = false;               // from highKey down to lowKey, see IndexManager::scan(...)
     char *curPage;
     leafPageDirectory curLeafPageDir;
     IXFileHandle *ixFileHandlePtr;
@@ -277,6 +798,20 @@ private:
     const void *highKey;
     bool lowKeyInclusive;
     bool highKeyInclusive;
+    std::string lowBound;               // encoded bounds of IndexManager::prefixScan(...) or normalized INT / REAL bounds of
+    std::string highBound;              // IndexManager::scan(...), lowKey and highKey point to them
+    
+    // scan of a hash index, see HashIndexManager::scan(...). The positions are hashes with their bits reversed,
+    // the scan has read the buckets before hashCursor and stops at hashCursorEnd.
+    bool hashScan = false;
+    unsigned long long hashCursor;
+    unsigned long long hashCursorEnd;
+    std::vector<IndexEntry> batchEntries;   // entries of the last leaf or bucket read which lie between the keys
+    std::vector<std::string> batchRows;     // rows of batchEntries in a clustered tree
+    size_t batchIndex;
+
+    friend class IndexManager;
+    friend class HashIndexManager;
 
 };
 
@@ -299,9 +834,30 @@ public:
     RC collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount);
 
     FileHandle& getFileHandle();
+    
+    /*
+     * Copies of page 0 and the top inner nodes, see IndexManager::readNode(...). All of them belong to one version of the tree,
+     * a copy of another version is never returned, and the copies are dropped when the version changes.
+     */
+    RC readCachedNode(PageNum pageNum, unsigned version, void *page);
+    RC cacheNode(PageNum pageNum, unsigned version, const void *page);
+    RC clearCache();
+    
+    // version of the tree of the file, set by IndexManager::openFile(...). The copies are kept while the handle is opened on the same file.
+    RC setTreeVersion(std::atomic<unsigned> *treeVersion);
+    std::atomic<unsigned> *getTreeVersion();
+
+    // the leaves of the file hold rows, see IX_MAX_ROW_SIZE. IndexManager::openFile(...) clears it, the owner of the file sets it.
+    RC setClustered(bool clustered);
+    bool isClustered() const;
 
 private:
     FileHandle fileHandle;
+    std::atomic<unsigned> *treeVersion = nullptr;
+    std::mutex cacheMutex;
+    unsigned cacheVersion = 0;
+    std::map<PageNum, std::string> cachedNodes;
+    bool clustered = false;
 };
 
 #endif
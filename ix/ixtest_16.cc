@@ -0,0 +1,172 @@
+#include <thread>
+#include <atomic>
+#include "ix.h"
+#include "ix_test_util.h"
+
+int testCase_16(const std::string &indexFileName, const Attribute &attribute) {
+    // Checks whether concurrent inserts, deletes and scans keep the B+ tree consistent.
+    // Every thread opens its own IXFileHandle on the same index file.
+    // Functions tested
+    // 1. Create Index File
+    // 2. Insert entries from several threads **
+    // 3. Delete entries from several threads while others insert **
+    // 4. Scan entries while the tree is changed **
+    // 5. Scan all the entries left, in order
+    // 6. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 16 *****" << std::endl;
+
+    const int numOfThreads = 4;
+    const int numOfEntriesPerThread = 5000;
+
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+
+    std::atomic<bool> stop(false);
+    std::atomic<int> errors(0);
+
+    // thread t inserts keys k with k % numOfThreads == t, so the threads split the same leaves.
+    // Round 0 inserts [0, numOfThreads * N), round 1 inserts [numOfThreads * N, 2 * numOfThreads * N)
+    auto insertKeys = [&](int thread, int round) {
+        IXFileHandle ixFileHandle;
+        if (indexManager.openFile(indexFileName, ixFileHandle) != success) {
+            errors++;
+            return;
+        }
+        for (int i = 0; i < numOfEntriesPerThread; i++) {
+            int key = (round * numOfEntriesPerThread + i) * numOfThreads + thread;
+            RID rid;
+            rid.pageNum = key;
+            rid.slotNum = key % 100;
+            if (indexManager.insertEntry(ixFileHandle, attribute, &key, rid) != success) {
+                errors++;
+            }
+        }
+        indexManager.closeFile(ixFileHandle);
+    };
+
+    // thread t deletes its even keys of round 0
+    auto deleteKeys = [&](int thread) {
+        IXFileHandle ixFileHandle;
+        if (indexManager.openFile(indexFileName, ixFileHandle) != success) {
+            errors++;
+            return;
+        }
+        for (int i = 0; i < numOfEntriesPerThread; i += 2) {
+            int key = i * numOfThreads + thread;
+            RID rid;
+            rid.pageNum = key;
+            rid.slotNum = key % 100;
+            if (indexManager.deleteEntry(ixFileHandle, attribute, &key, rid) != success) {
+                errors++;
+            }
+        }
+        indexManager.closeFile(ixFileHandle);
+    };
+
+    auto scanLoop = [&]() {
+        while (!stop) {
+            IXFileHandle ixFileHandle;
+            IX_ScanIterator ix_ScanIterator;
+            if (indexManager.openFile(indexFileName, ixFileHandle) != success) {
+                errors++;
+                return;
+            }
+            if (indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator) != success) {
+                errors++;
+                indexManager.closeFile(ixFileHandle);
+                return;
+            }
+            // the scan is not isolated from the writers, only check every entry it returns is a complete one.
+            RID rid;
+            int key;
+            while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+                if ((int) rid.pageNum != key || (int) rid.slotNum != key % 100) {
+                    errors++;
+                }
+            }
+            // close() also closes the file
+            ix_ScanIterator.close();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    std::thread scanner1(scanLoop), scanner2(scanLoop);
+    for (int t = 0; t < numOfThreads; t++) {
+        threads.emplace_back(insertKeys, t, 0);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+
+    for (int t = 0; t < numOfThreads; t++) {
+        threads.emplace_back(deleteKeys, t);
+        threads.emplace_back(insertKeys, t, 1);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    stop = true;
+    scanner1.join();
+    scanner2.join();
+    assert(errors == 0 && "Concurrent operations should not fail.");
+
+    // scan all the entries left: keys of round 0 whose i is odd, and all the keys of round 1.
+    IXFileHandle ixFileHandle;
+    IX_ScanIterator ix_ScanIterator;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    rc = indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+
+    int expectedKey = 0;
+    int count = 0;
+    RID rid;
+    int key;
+    while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+        // skip the deleted keys
+        while (expectedKey < numOfThreads * numOfEntriesPerThread && (expectedKey / numOfThreads) % 2 == 0) {
+            expectedKey++;
+        }
+        if (key != expectedKey || (int) rid.pageNum != key) {
+            std::cerr << "Wrong entry: expected " << expectedKey << ", got " << key << std::endl;
+            errors++;
+            break;
+        }
+        expectedKey++;
+        count++;
+    }
+    ix_ScanIterator.close();
+
+    int expected = numOfThreads * numOfEntriesPerThread / 2 + numOfThreads * numOfEntriesPerThread;
+    std::cerr << "entries left: " << count << ", expected: " << expected << std::endl;
+
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (count != expected || errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "age_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    indexManager.destroyFile("age_idx");
+
+    if (testCase_16(indexFileName, attrAge) == success) {
+        std::cerr << "***** IX Test Case 16 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 16 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
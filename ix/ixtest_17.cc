@@ -0,0 +1,116 @@
+#include "ix.h"
+#include "ix_test_util.h"
+
+// look up one key, return the pages read by the scan
+int lookUp(const std::string &indexFileName, IXFileHandle &ixFileHandle, const Attribute &attribute, int key, int &errors) {
+    IX_ScanIterator ix_ScanIterator;
+    unsigned readPageCount, readPageCountAfter, writePageCount, appendPageCount;
+    RC rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    ixFileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+
+    rc = indexManager.scan(ixFileHandle, attribute, &key, &key, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    RID rid;
+    int returnedKey;
+    int count = 0;
+    while (ix_ScanIterator.getNextEntry(rid, &returnedKey) == success) {
+        if (returnedKey != key || (int) rid.pageNum != key) {
+            errors++;
+        }
+        count++;
+    }
+    if (count != 1) {
+        errors++;
+    }
+    ixFileHandle.collectCounterValues(readPageCountAfter, writePageCount, appendPageCount);
+    // close() also closes the file, the handle keeps its copies of the top of the tree.
+    ix_ScanIterator.close();
+    return readPageCountAfter - readPageCount;
+}
+
+int testCase_17(const std::string &indexFileName, const Attribute &attribute) {
+    // Checks whether point lookups read the top of the B+ tree from the copies kept by IXFileHandle,
+    // and whether the copies are dropped when another handle splits nodes.
+    // Functions tested
+    // 1. Create Index File
+    // 2. Insert entries, the tree gets three levels
+    // 3. Look up keys, only leaves are read once the top of the tree is kept **
+    // 4. Insert more entries with another handle, look up again **
+    // 5. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 17 *****" << std::endl;
+
+    const int numOfEntries = 200000;
+    const int numOfLookups = 1000;
+    int errors = 0;
+
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+
+    IXFileHandle writer;
+    rc = indexManager.openFile(indexFileName, writer);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    for (int key = 0; key < numOfEntries; key += 2) {
+        RID rid;
+        rid.pageNum = key;
+        rid.slotNum = key % 100;
+        rc = indexManager.insertEntry(writer, attribute, &key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+
+    // the first lookup reads page 0, the root, one intermediate node and the leaf, the others only the leaves.
+    IXFileHandle reader;
+    int firstReads = lookUp(indexFileName, reader, attribute, 0, errors);
+    int reads = 0;
+    for (int i = 1; i <= numOfLookups; i++) {
+        reads += lookUp(indexFileName, reader, attribute, (i * 97 % (numOfEntries / 2)) * 2, errors);
+    }
+    std::cerr << "pages read by the first lookup: " << firstReads << ", by " << numOfLookups << " more lookups: " << reads << std::endl;
+    // a lookup may also read the next leaf when its key is the last one of a leaf
+    if (firstReads < 4 || reads > numOfLookups + numOfLookups / 10) {
+        errors++;
+    }
+
+    // the splits of the writer make the copies of the reader stale
+    for (int key = 1; key < numOfEntries; key += 2) {
+        RID rid;
+        rid.pageNum = key;
+        rid.slotNum = key % 100;
+        rc = indexManager.insertEntry(writer, attribute, &key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+    rc = indexManager.closeFile(writer);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    for (int i = 1; i <= numOfLookups; i++) {
+        lookUp(indexFileName, reader, attribute, i * 97 % numOfEntries, errors);
+    }
+
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "age_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    indexManager.destroyFile("age_idx");
+
+    if (testCase_17(indexFileName, attrAge) == success) {
+        std::cerr << "***** IX Test Case 17 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 17 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <random>
+#include "ix.h"
+#include "ix_test_util.h"
+
+const std::string keyPrefix = "warehouse-north-east/region-0007/customer-account-";
+
+// <length, characters> of the i'th key, with or without the shared part
+void prepareKey(int i, bool withPrefix, void *key) {
+    char digits[16];
+    sprintf(digits, "%08d", i);
+    std::string value = (withPrefix ? keyPrefix : std::string()) + digits;
+    int length = value.size();
+    memcpy(key, &length, sizeof(int));
+    memcpy((char *) key + sizeof(int), value.data(), length);
+}
+
+// check the index holds the keys i with i % step == 0, in order, return the number of pages of the file
+int checkIndex(const std::string &indexFileName, const Attribute &attribute, int numOfEntries, int step, bool withPrefix,
+               int &errors) {
+    IXFileHandle ixFileHandle;
+    IX_ScanIterator ix_ScanIterator;
+    RC rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    int numOfPages = ixFileHandle.getFileHandle().getNumberOfPages();
+
+    char key[PAGE_SIZE], expectedKey[PAGE_SIZE];
+    RID rid;
+    rc = indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    int i = 0;
+    while (ix_ScanIterator.getNextEntry(rid, key) == success) {
+        prepareKey(i, withPrefix, expectedKey);
+        if (i >= numOfEntries || memcmp(key, expectedKey, sizeof(int) + *(int *) expectedKey) != 0 ||
+            (int) rid.pageNum != i) {
+            errors++;
+            break;
+        }
+        i += step;
+    }
+    if (i < numOfEntries) {
+        errors++;
+    }
+    ix_ScanIterator.close();
+
+    // point lookups, the deleted keys are not found
+    for (int j = 1; j < numOfEntries; j += 997) {
+        prepareKey(j, withPrefix, expectedKey);
+        rc = indexManager.openFile(indexFileName, ixFileHandle);
+        assert(rc == success && "indexManager::openFile() should not fail.");
+        rc = indexManager.scan(ixFileHandle, attribute, expectedKey, expectedKey, true, true, ix_ScanIterator);
+        assert(rc == success && "indexManager::scan() should not fail.");
+        int count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, key) == success) {
+            if ((int) rid.pageNum != j) {
+                errors++;
+            }
+            count++;
+        }
+        if (count != (j % step == 0 ? 1 : 0)) {
+            errors++;
+        }
+        ix_ScanIterator.close();
+    }
+    return numOfPages;
+}
+
+// insert the keys in a random order, return the number of pages
+int insertKeys(const std::string &indexFileName, const Attribute &attribute, int numOfEntries, bool withPrefix,
+               int &errors) {
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    std::vector<int> order(numOfEntries);
+    for (int i = 0; i < numOfEntries; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(18));
+    char key[PAGE_SIZE];
+    for (int i : order) {
+        prepareKey(i, withPrefix, key);
+        RID rid;
+        rid.pageNum = i;
+        rid.slotNum = i % 100;
+        rc = indexManager.insertEntry(ixFileHandle, attribute, key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    return checkIndex(indexFileName, attribute, numOfEntries, 1, withPrefix, errors);
+}
+
+int testCase_18(const std::string &indexFileName, const Attribute &attribute) {
+    // Checks whether VARCHAR keys with a long common part are stored once per leaf and the separators are shortened.
+    // Functions tested
+    // 1. Create Index File
+    // 2. Insert entries whose keys share a long prefix, in a random order **
+    // 3. Scan and look up the entries **
+    // 4. Delete every other entry, scan and look up again **
+    // 5. Bulk build the same entries **
+    // 6. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 18 *****" << std::endl;
+
+    const int numOfEntries = 50000;
+    int errors = 0;
+
+    // the same numbers without the common part, the pages the prefixed keys need should be close to these.
+    int shortKeyPages = insertKeys(indexFileName, attribute, numOfEntries, false, errors);
+    RC rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    int pages = insertKeys(indexFileName, attribute, numOfEntries, true, errors);
+    std::cerr << "pages of " << numOfEntries << " keys of " << keyPrefix.size() + 8 << " characters: " << pages
+              << ", of the same keys without the common " << keyPrefix.size() << " characters: " << shortKeyPages << std::endl;
+    if (pages > shortKeyPages + shortKeyPages / 4) {
+        errors++;
+    }
+
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    char key[PAGE_SIZE];
+    for (int i = 1; i < numOfEntries; i += 2) {
+        prepareKey(i, true, key);
+        RID rid;
+        rid.pageNum = i;
+        rid.slotNum = i % 100;
+        rc = indexManager.deleteEntry(ixFileHandle, attribute, key, rid);
+        assert(rc == success && "indexManager::deleteEntry() should not fail.");
+    }
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    checkIndex(indexFileName, attribute, numOfEntries, 2, true, errors);
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    // bulkBuild(...) writes the prefixes of the leaves itself
+    std::vector<IndexEntry> entries(numOfEntries);
+    for (int i = 0; i < numOfEntries; i++) {
+        prepareKey(i, true, key);
+        entries[i].key.assign(key, sizeof(int) + *(int *) key);
+        entries[i].rid.pageNum = i;
+        entries[i].rid.slotNum = i % 100;
+    }
+    rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    rc = indexManager.bulkBuild(ixFileHandle, attribute, entries);
+    assert(rc == success && "indexManager::bulkBuild() should not fail.");
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    int bulkPages = checkIndex(indexFileName, attribute, numOfEntries, 1, true, errors);
+    std::cerr << "pages after bulkBuild: " << bulkPages << std::endl;
+
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "account_idx";
+    Attribute attrAccount;
+    attrAccount.length = 100;
+    attrAccount.name = "account";
+    attrAccount.type = TypeVarChar;
+
+    indexManager.destroyFile("account_idx");
+
+    if (testCase_18(indexFileName, attrAccount) == success) {
+        std::cerr << "***** IX Test Case 18 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 18 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
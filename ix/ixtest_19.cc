@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <random>
+#include "ix.h"
+#include "ix_test_util.h"
+
+const int numOfEntries = 100000;
+// the first numOfHeavyKeys keys take every entry but one in ten, the other entries get keys of a few RIDs each
+const int numOfHeavyKeys = 20;
+
+int keyOf(int i) {
+    return i % 10 != 0 ? i % numOfHeavyKeys : numOfHeavyKeys + i / 30;
+}
+
+// check the RIDs of every key i with i % step == 0 are found, in the order of the keys, return the number of pages of the file
+int checkIndex(const std::string &indexFileName, const Attribute &attribute, int step, int &errors) {
+    IXFileHandle ixFileHandle;
+    IX_ScanIterator ix_ScanIterator;
+    RC rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    int numOfPages = ixFileHandle.getFileHandle().getNumberOfPages();
+
+    // a full scan returns the keys in order and every RID once
+    std::vector<bool> found(numOfEntries, false);
+    RID rid;
+    int key, previousKey = -1, count = 0;
+    rc = indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+        if (key < previousKey || (int) rid.pageNum >= numOfEntries || found[rid.pageNum] ||
+            keyOf(rid.pageNum) != key || (int) rid.slotNum != (int) rid.pageNum % 100) {
+            errors++;
+            break;
+        }
+        found[rid.pageNum] = true;
+        previousKey = key;
+        count++;
+    }
+    ix_ScanIterator.close();
+    for (int i = 0; i < numOfEntries; i++) {
+        if (found[i] != (i % step == 0)) {
+            errors++;
+            break;
+        }
+    }
+
+    // equality scans of a heavy key and of a light one
+    for (int lookUpKey : {7, 8, numOfHeavyKeys + 100}) {
+        rc = indexManager.openFile(indexFileName, ixFileHandle);
+        assert(rc == success && "indexManager::openFile() should not fail.");
+        rc = indexManager.scan(ixFileHandle, attribute, &lookUpKey, &lookUpKey, true, true, ix_ScanIterator);
+        assert(rc == success && "indexManager::scan() should not fail.");
+        int expected = 0;
+        for (int i = 0; i < numOfEntries; i += step) {
+            expected += keyOf(i) == lookUpKey ? 1 : 0;
+        }
+        count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+            if (key != lookUpKey || keyOf(rid.pageNum) != lookUpKey) {
+                errors++;
+            }
+            count++;
+        }
+        if (count != expected) {
+            errors++;
+        }
+        ix_ScanIterator.close();
+    }
+    return numOfPages;
+}
+
+int testCase_19(const std::string &indexFileName, const Attribute &attribute) {
+    // Checks whether the RIDs of a key are kept in one posting list, long lists in overflow pages.
+    // Functions tested
+    // 1. Create Index File
+    // 2. Insert entries of a few keys in a random order **
+    // 3. Scan all entries and look up keys **
+    // 4. Delete every other entry, all RIDs of some heavy keys, scan and look up again **
+    // 5. Bulk build the same entries **
+    // 6. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 19 *****" << std::endl;
+
+    int errors = 0;
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    std::vector<int> order(numOfEntries);
+    for (int i = 0; i < numOfEntries; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(19));
+    for (int i : order) {
+        int key = keyOf(i);
+        RID rid;
+        rid.pageNum = i;
+        rid.slotNum = i % 100;
+        rc = indexManager.insertEntry(ixFileHandle, attribute, &key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+
+    // a <key, rid> entry of its own takes 14 bytes, a RID in a posting list 2 or 3, the lists need less than a third of the pages.
+    int pages = checkIndex(indexFileName, attribute, 1, errors);
+    std::cerr << "pages of " << numOfEntries << " entries of " << numOfHeavyKeys + numOfEntries / 30 << " keys: " << pages << std::endl;
+    if (pages > numOfEntries * 14 / PAGE_SIZE / 3) {
+        errors++;
+    }
+
+    // every other entry, the heavy keys 1, 3, 5... lose all of their RIDs
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    for (int i : order) {
+        if (i % 2 == 0) {
+            continue;
+        }
+        int key = keyOf(i);
+        RID rid;
+        rid.pageNum = i;
+        rid.slotNum = i % 100;
+        rc = indexManager.deleteEntry(ixFileHandle, attribute, &key, rid);
+        assert(rc == success && "indexManager::deleteEntry() should not fail.");
+        // a second delete of the same entry fails
+        if (i % 1001 == 0 && indexManager.deleteEntry(ixFileHandle, attribute, &key, rid) == success) {
+            errors++;
+        }
+    }
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    checkIndex(indexFileName, attribute, 2, errors);
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    // bulkBuild(...) writes the posting lists itself
+    std::vector<IndexEntry> entries(numOfEntries);
+    for (int i = 0; i < numOfEntries; i++) {
+        int key = keyOf(order[i]);
+        entries[i].key.assign((char *) &key, sizeof(int));
+        entries[i].rid.pageNum = order[i];
+        entries[i].rid.slotNum = order[i] % 100;
+    }
+    rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    rc = indexManager.bulkBuild(ixFileHandle, attribute, entries);
+    assert(rc == success && "indexManager::bulkBuild() should not fail.");
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    int bulkPages = checkIndex(indexFileName, attribute, 1, errors);
+    std::cerr << "pages after bulkBuild: " << bulkPages << std::endl;
+    if (bulkPages > pages) {
+        errors++;
+    }
+
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "status_idx";
+    Attribute attrStatus;
+    attrStatus.length = 4;
+    attrStatus.name = "status";
+    attrStatus.type = TypeInt;
+
+    indexManager.destroyFile("status_idx");
+
+    if (testCase_19(indexFileName, attrStatus) == success) {
+        std::cerr << "***** IX Test Case 19 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 19 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
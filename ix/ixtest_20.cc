@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <random>
+#include "ix.h"
+#include "ix_test_util.h"
+
+const int numOfEntries = 100000;
+
+// check the index holds the keys i with present[i], in order, return the number of pages of the file
+int checkIndex(const std::string &indexFileName, const Attribute &attribute, const std::vector<bool> &present, int &errors) {
+    IXFileHandle ixFileHandle;
+    IX_ScanIterator ix_ScanIterator;
+    RC rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    int numOfPages = ixFileHandle.getFileHandle().getNumberOfPages();
+
+    RID rid;
+    int key, expected = 0;
+    rc = indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+        while (expected < numOfEntries && !present[expected]) {
+            expected++;
+        }
+        if (key != expected || (int) rid.pageNum != key) {
+            errors++;
+            break;
+        }
+        expected++;
+    }
+    while (expected < numOfEntries && !present[expected]) {
+        expected++;
+    }
+    if (expected != numOfEntries) {
+        errors++;
+    }
+    ix_ScanIterator.close();
+    return numOfPages;
+}
+
+RC updateEntries(IXFileHandle &ixFileHandle, const Attribute &attribute, const std::vector<int> &keys, bool insert) {
+    for (int key : keys) {
+        RID rid;
+        rid.pageNum = key;
+        rid.slotNum = key % 100;
+        RC rc = insert ? indexManager.insertEntry(ixFileHandle, attribute, &key, rid)
+                       : indexManager.deleteEntry(ixFileHandle, attribute, &key, rid);
+        if (rc != success) {
+            return rc;
+        }
+    }
+    return success;
+}
+
+int testCase_20(const std::string &indexFileName, const Attribute &attribute) {
+    // Checks whether deletes merge or rebalance the nodes which get less than a quarter full,
+    // and whether the pages they free are taken again by the splits.
+    // Functions tested
+    // 1. Create Index File
+    // 2. Insert entries in a random order
+    // 3. Delete nine entries in ten, scan **
+    // 4. Insert the deleted entries again, the file hardly grows **
+    // 5. Delete entries while scanning them **
+    // 6. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 20 *****" << std::endl;
+
+    int errors = 0;
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    std::vector<int> order(numOfEntries);
+    for (int i = 0; i < numOfEntries; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(20));
+    rc = updateEntries(ixFileHandle, attribute, order, true);
+    assert(rc == success && "indexManager::insertEntry() should not fail.");
+    std::vector<bool> present(numOfEntries, true);
+    int pages = checkIndex(indexFileName, attribute, present, errors);
+
+    // the leaves which get less than a quarter full are merged, the freed pages go to the free list
+    std::vector<int> deleted;
+    for (int key : order) {
+        if (key % 10 != 0) {
+            deleted.push_back(key);
+            present[key] = false;
+        }
+    }
+    rc = updateEntries(ixFileHandle, attribute, deleted, false);
+    assert(rc == success && "indexManager::deleteEntry() should not fail.");
+    checkIndex(indexFileName, attribute, present, errors);
+
+    // the splits take the free pages before they append new ones
+    rc = updateEntries(ixFileHandle, attribute, deleted, true);
+    assert(rc == success && "indexManager::insertEntry() should not fail.");
+    std::fill(present.begin(), present.end(), true);
+    int reinsertedPages = checkIndex(indexFileName, attribute, present, errors);
+    std::cerr << "pages of " << numOfEntries << " entries: " << pages << ", after deleting nine in ten and inserting them again: "
+              << reinsertedPages << std::endl;
+    if (reinsertedPages > pages + pages / 5) {
+        errors++;
+    }
+
+    // a scan goes on from its last key when the leaves it reaches were merged meanwhile
+    IX_ScanIterator ix_ScanIterator;
+    rc = indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    RID rid;
+    int key, expected = 0;
+    while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+        if (key != expected) {
+            errors++;
+            break;
+        }
+        if (key % 3 != 0) {
+            rc = indexManager.deleteEntry(ixFileHandle, attribute, &key, rid);
+            assert(rc == success && "indexManager::deleteEntry() should not fail.");
+            present[key] = false;
+        }
+        expected++;
+    }
+    ix_ScanIterator.close();
+    if (expected != numOfEntries) {
+        errors++;
+    }
+    checkIndex(indexFileName, attribute, present, errors);
+
+    // deleting the rest makes the tree lower again
+    std::vector<int> rest;
+    for (int i = 0; i < numOfEntries; i += 3) {
+        rest.push_back(i);
+        present[i] = false;
+    }
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    rc = updateEntries(ixFileHandle, attribute, rest, false);
+    assert(rc == success && "indexManager::deleteEntry() should not fail.");
+    checkIndex(indexFileName, attribute, present, errors);
+    indexManager.printBtree(ixFileHandle, attribute);
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "age_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    indexManager.destroyFile("age_idx");
+
+    if (testCase_20(indexFileName, attrAge) == success) {
+        std::cerr << "***** IX Test Case 20 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 20 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <random>
+#include "ix.h"
+#include "ix_test_util.h"
+
+const int numOfEntries = 100000;
+const int numOfConcurrentEntries = 20000;
+const int heavyKey = -1;
+
+// one entry in fifty goes to a key whose posting list takes overflow pages
+int keyOf(int i) {
+    return i % 50 == 0 ? heavyKey : i;
+}
+
+// check the index holds the entries i with present[i], return the number of pages of the file
+int checkIndex(const std::string &indexFileName, const Attribute &attribute, const std::vector<bool> &present, int &errors) {
+    IXFileHandle ixFileHandle;
+    IX_ScanIterator ix_ScanIterator;
+    RC rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    int numOfPages = ixFileHandle.getFileHandle().getNumberOfPages();
+
+    std::vector<bool> found(present.size(), false);
+    RID rid;
+    int key, previousKey = heavyKey;
+    rc = indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+        if (key < previousKey || rid.pageNum >= present.size() || keyOf(rid.pageNum) != key || found[rid.pageNum]) {
+            errors++;
+            break;
+        }
+        found[rid.pageNum] = true;
+        previousKey = key;
+    }
+    ix_ScanIterator.close();
+    if (found != present) {
+        errors++;
+    }
+    return numOfPages;
+}
+
+RC updateEntries(IXFileHandle &ixFileHandle, const Attribute &attribute, const std::vector<int> &entries, bool insert) {
+    for (int i : entries) {
+        int key = keyOf(i);
+        RID rid;
+        rid.pageNum = i;
+        rid.slotNum = i % 100;
+        RC rc = insert ? indexManager.insertEntry(ixFileHandle, attribute, &key, rid)
+                       : indexManager.deleteEntry(ixFileHandle, attribute, &key, rid);
+        if (rc != success) {
+            return rc;
+        }
+    }
+    return success;
+}
+
+int testCase_21(const std::string &indexFileName, const Attribute &attribute) {
+    // Checks whether shrinkFile moves the pages of the tree at the end of the file into the free pages and truncates it,
+    // while other threads insert entries.
+    // Functions tested
+    // 1. Create Index File
+    // 2. Insert entries in a random order, some of them of a key with overflow pages
+    // 3. Delete nine entries in ten
+    // 4. Shrink the file while another thread inserts entries **
+    // 5. Scan, shrink again **
+    // 6. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 21 *****" << std::endl;
+
+    int errors = 0;
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    std::vector<int> order(numOfEntries);
+    for (int i = 0; i < numOfEntries; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(21));
+    rc = updateEntries(ixFileHandle, attribute, order, true);
+    assert(rc == success && "indexManager::insertEntry() should not fail.");
+
+    std::vector<bool> present(numOfEntries + numOfConcurrentEntries, false);
+    std::vector<int> deleted;
+    for (int i : order) {
+        if (i % 10 != 0) {
+            deleted.push_back(i);
+        }
+        else {
+            present[i] = true;
+        }
+    }
+    rc = updateEntries(ixFileHandle, attribute, deleted, false);
+    assert(rc == success && "indexManager::deleteEntry() should not fail.");
+    int pages = ixFileHandle.getFileHandle().getNumberOfPages();
+
+    // the inserts of the other thread wait while the tree is latched, they may take free pages before
+    std::vector<int> concurrent;
+    for (int i = numOfEntries; i < numOfEntries + numOfConcurrentEntries; i++) {
+        concurrent.push_back(i);
+        present[i] = true;
+    }
+    std::thread inserter([&]() {
+        IXFileHandle inserterHandle;
+        if (indexManager.openFile(indexFileName, inserterHandle) != success ||
+            updateEntries(inserterHandle, attribute, concurrent, true) != success) {
+            errors++;
+        }
+        indexManager.closeFile(inserterHandle);
+    });
+    rc = indexManager.shrinkFile(ixFileHandle, attribute);
+    assert(rc == success && "indexManager::shrinkFile() should not fail.");
+    inserter.join();
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    checkIndex(indexFileName, attribute, present, errors);
+
+    // nothing is inserted now, the file keeps only the pages of the tree
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    rc = indexManager.shrinkFile(ixFileHandle, attribute);
+    assert(rc == success && "indexManager::shrinkFile() should not fail.");
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    int shrunkPages = checkIndex(indexFileName, attribute, present, errors);
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    rc = indexManager.shrinkFile(ixFileHandle, attribute);
+    assert(rc == success && "indexManager::shrinkFile() should not fail.");
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    int shrunkAgainPages = checkIndex(indexFileName, attribute, present, errors);
+    std::cerr << "pages after deleting nine entries in ten: " << pages << ", after inserting " << numOfConcurrentEntries
+              << " more and shrinking: " << shrunkPages << std::endl;
+    if (shrunkPages >= pages || shrunkAgainPages != shrunkPages) {
+        errors++;
+    }
+
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "age_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    indexManager.destroyFile("age_idx");
+
+    if (testCase_21(indexFileName, attrAge) == success) {
+        std::cerr << "***** IX Test Case 21 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 21 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
@@ -0,0 +1,191 @@
+#include "ix.h"
+#include "ix_test_util.h"
+
+const int numOfEntries = 100000;
+
+// one entry in five goes to a key whose posting list takes overflow pages
+int keyOf(int i) {
+    return i % 5 == 0 ? 1000 : i;
+}
+
+// produces the entries in key order without keeping them, entry i has key keyOf(i) and RID <i, i % 100>
+class GeneratedEntries : public IX_EntryIterator {
+public:
+    explicit GeneratedEntries(bool sorted) : sorted(sorted), next(0), heavyNext(0), heavyDone(false) {}
+
+    RC getNextEntry(IndexEntry &entry) override {
+        // the RIDs of the heavy key come when the keys reach it
+        int i;
+        if (!heavyDone && next >= 1000) {
+            i = heavyNext;
+            heavyNext += 5;
+            if (heavyNext >= numOfEntries) {
+                heavyDone = true;
+            }
+        } else {
+            while (next < numOfEntries && next % 5 == 0) {
+                next++;
+            }
+            if (next >= numOfEntries) {
+                return IX_EOF;
+            }
+            i = sorted ? next : numOfEntries - next;
+            next++;
+        }
+        int key = keyOf(i);
+        entry.key.assign((char *) &key, sizeof(int));
+        entry.rid.pageNum = i;
+        entry.rid.slotNum = i % 100;
+        return success;
+    }
+
+private:
+    bool sorted;
+    int next;
+    int heavyNext;
+    bool heavyDone;
+};
+
+int testCase_22(const std::string &indexFileName, const Attribute &attribute) {
+    // Checks whether bulkLoad builds the tree from a sorted stream of entries, with the leaves on contiguous pages.
+    // Functions tested
+    // 1. Create Index File
+    // 2. Bulk load unsorted entries, it fails **
+    // 3. Bulk load sorted entries **
+    // 4. Walk the leaves, scan and look up **
+    // 5. Insert and delete entries in the loaded tree
+    // 6. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 22 *****" << std::endl;
+
+    int errors = 0;
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    GeneratedEntries unsortedEntries(false);
+    if (indexManager.bulkLoad(ixFileHandle, attribute, unsortedEntries) == success) {
+        errors++;
+    }
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    GeneratedEntries entries(true);
+    rc = indexManager.bulkLoad(ixFileHandle, attribute, entries, 0.9);
+    assert(rc == success && "indexManager::bulkLoad() should not fail.");
+
+    // go down the first pointers to the first leaf, then along the leaves: every leaf links to the page after it
+    FileHandle &fileHandle = ixFileHandle.getFileHandle();
+    char page[PAGE_SIZE];
+    unsigned pageNum;
+    fileHandle.readPage(0, page);
+    memcpy(&pageNum, page + sizeof(int), sizeof(unsigned));
+    int pageFlag;
+    while (fileHandle.readPage(pageNum, page) == success && memcpy(&pageFlag, page, sizeof(int)) && pageFlag != LEAF_FLAG) {
+        memcpy(&pageNum, page + IM_DIR_SIZE, sizeof(unsigned));
+    }
+    int numOfLeaves = 1;
+    leafPageDirectory directory;
+    memcpy(&directory, page, LEAF_DIR_SIZE);
+    while (directory.nextNode != -1) {
+        if (directory.nextNode != (int) pageNum + 1) {
+            errors++;
+            break;
+        }
+        pageNum = directory.nextNode;
+        fileHandle.readPage(pageNum, page);
+        memcpy(&directory, page, LEAF_DIR_SIZE);
+        numOfLeaves++;
+    }
+    std::cerr << "pages of " << numOfEntries << " bulk loaded entries: " << fileHandle.getNumberOfPages() << ", leaves: "
+              << numOfLeaves << std::endl;
+
+    // a full scan, and the heavy key
+    IX_ScanIterator ix_ScanIterator;
+    std::vector<bool> found(numOfEntries, false);
+    RID rid;
+    int key, previousKey = -1, count = 0;
+    rc = indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+        if (key < previousKey || (int) rid.pageNum >= numOfEntries || keyOf(rid.pageNum) != key || found[rid.pageNum]) {
+            errors++;
+            break;
+        }
+        found[rid.pageNum] = true;
+        previousKey = key;
+        count++;
+    }
+    ix_ScanIterator.close();
+    if (count != numOfEntries) {
+        errors++;
+    }
+
+    // the loaded tree takes inserts and deletes like any other
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    for (int i = 1; i < numOfEntries; i += 7) {
+        key = keyOf(i);
+        rid.pageNum = i;
+        rid.slotNum = i % 100;
+        rc = indexManager.deleteEntry(ixFileHandle, attribute, &key, rid);
+        assert(rc == success && "indexManager::deleteEntry() should not fail.");
+        rid.pageNum = numOfEntries + i;
+        rc = indexManager.insertEntry(ixFileHandle, attribute, &key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+    for (int lookUpKey : {1000, 8, 16, numOfEntries - 1}) {
+        rc = indexManager.scan(ixFileHandle, attribute, &lookUpKey, &lookUpKey, true, true, ix_ScanIterator);
+        assert(rc == success && "indexManager::scan() should not fail.");
+        count = 0;
+        while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+            if (key != lookUpKey) {
+                errors++;
+            }
+            count++;
+        }
+        ix_ScanIterator.close();
+        if (count != (lookUpKey == 1000 ? numOfEntries / 5 : 1)) {
+            errors++;
+        }
+        rc = indexManager.openFile(indexFileName, ixFileHandle);
+        assert(rc == success && "indexManager::openFile() should not fail.");
+    }
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "age_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    indexManager.destroyFile("age_idx");
+
+    if (testCase_22(indexFileName, attrAge) == success) {
+        std::cerr << "***** IX Test Case 22 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 22 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
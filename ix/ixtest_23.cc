@@ -0,0 +1,129 @@
+#include "ix.h"
+#include "ix_test_util.h"
+
+const int numOfEntries = 50000;
+const int heavyKey = 3000;
+
+// the even keys are inserted, the odd ones are absent; one entry in ten goes to a key whose posting list takes overflow pages
+int keyOf(int i) {
+    return i % 10 == 0 ? heavyKey : 2 * i;
+}
+
+int testCase_23(const std::string &indexFileName, const Attribute &attribute) {
+    // Checks whether probeEntries looks up a sorted batch of keys, near and far apart, present and absent.
+    // Functions tested
+    // 1. Create Index File
+    // 2. Insert entries
+    // 3. Probe unsorted keys, it fails **
+    // 4. Probe sorted keys, compare with scans **
+    // 5. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 23 *****" << std::endl;
+
+    int errors = 0;
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    RID rid;
+    for (int i = 0; i < numOfEntries; i++) {
+        int key = keyOf(i);
+        rid.pageNum = i;
+        rid.slotNum = i % 100;
+        rc = indexManager.insertEntry(ixFileHandle, attribute, &key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+
+    std::vector<std::string> keys;
+    std::vector<std::vector<RID>> rids;
+    for (int key : {10, 4}) {
+        keys.emplace_back((char *) &key, sizeof(int));
+    }
+    if (indexManager.probeEntries(ixFileHandle, attribute, keys, rids) == success) {
+        errors++;
+    }
+
+    // runs of neighbouring keys, which share leaves, then jumps across the tree, and keys past both ends
+    keys.clear();
+    std::vector<int> probeKeys = {-5, 0};
+    for (int start : {2, 2990, 40000, 99900}) {
+        for (int key = start; key < start + 40; key++) {
+            probeKeys.push_back(key);
+        }
+    }
+    for (int key : {heavyKey, 120000, 250000}) {
+        probeKeys.push_back(key);
+    }
+    std::sort(probeKeys.begin(), probeKeys.end());
+    for (int key : probeKeys) {
+        keys.emplace_back((char *) &key, sizeof(int));
+    }
+    rc = indexManager.probeEntries(ixFileHandle, attribute, keys, rids);
+    assert(rc == success && "indexManager::probeEntries() should not fail.");
+    if (rids.size() != keys.size()) {
+        errors++;
+    }
+
+    int numOfFound = 0;
+    for (size_t i = 0; i < probeKeys.size() && errors == 0; i++) {
+        int key = probeKeys[i];
+        IX_ScanIterator ix_ScanIterator;
+        rc = indexManager.scan(ixFileHandle, attribute, &key, &key, true, true, ix_ScanIterator);
+        assert(rc == success && "indexManager::scan() should not fail.");
+        std::vector<RID> scanned;
+        int scannedKey;
+        while (ix_ScanIterator.getNextEntry(rid, &scannedKey) == success) {
+            scanned.push_back(rid);
+        }
+        ix_ScanIterator.close();
+        rc = indexManager.openFile(indexFileName, ixFileHandle);
+        assert(rc == success && "indexManager::openFile() should not fail.");
+
+        if (scanned.size() != rids[i].size()) {
+            errors++;
+            break;
+        }
+        for (size_t j = 0; j < scanned.size(); j++) {
+            if (scanned[j].pageNum != rids[i][j].pageNum || scanned[j].slotNum != rids[i][j].slotNum) {
+                errors++;
+                break;
+            }
+        }
+        numOfFound += !rids[i].empty();
+    }
+    std::cerr << "keys probed: " << keys.size() << ", found: " << numOfFound << ", RIDs of the heavy key: "
+              << (errors == 0 ? rids[std::lower_bound(probeKeys.begin(), probeKeys.end(), heavyKey) - probeKeys.begin()].size() : 0)
+              << std::endl;
+
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "age_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    indexManager.destroyFile("age_idx");
+
+    if (testCase_23(indexFileName, attrAge) == success) {
+        std::cerr << "***** IX Test Case 23 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 23 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
@@ -0,0 +1,251 @@
+#include "ix.h"
+#include "ix_test_util.h"
+
+const int numOfEntries = 20000;
+const int numOfDepts = 5;
+// "a\0b" sorts between "a" and "ab", the 0 byte is escaped in the key
+const std::string depts[numOfDepts] = {"", "a", std::string("a\0b", 3), "ab", "b"};
+
+struct Tuple {
+    std::string dept;
+    bool ageIsNull;
+    int age;
+    float score;
+};
+
+Tuple tupleOf(int i) {
+    Tuple tuple;
+    tuple.dept = depts[i % numOfDepts];
+    tuple.ageIsNull = i % 97 == 0;
+    tuple.age = (i * 37) % 200 - 100;
+    tuple.score = ((i * 13) % 101 - 50) * 0.5f;
+    return tuple;
+}
+
+// the order of the composite key: dept, then age with NULL first, then score
+bool lessThan(const Tuple &tuple1, const Tuple &tuple2) {
+    if (tuple1.dept != tuple2.dept) {
+        return tuple1.dept < tuple2.dept;
+    }
+    if (tuple1.ageIsNull != tuple2.ageIsNull) {
+        return tuple1.ageIsNull;
+    }
+    if (!tuple1.ageIsNull && tuple1.age != tuple2.age) {
+        return tuple1.age < tuple2.age;
+    }
+    return tuple1.score < tuple2.score;
+}
+
+// record format of <dept, age, score>
+void prepareTuple(const Tuple &tuple, void *data) {
+    char *buffer = (char *) data;
+    buffer[0] = tuple.ageIsNull ? (char) 0x40 : 0;
+    int offset = 1;
+    int length = tuple.dept.size();
+    memcpy(buffer + offset, &length, sizeof(int));
+    memcpy(buffer + offset + sizeof(int), tuple.dept.data(), length);
+    offset += sizeof(int) + length;
+    if (!tuple.ageIsNull) {
+        memcpy(buffer + offset, &tuple.age, sizeof(int));
+        offset += sizeof(int);
+    }
+    memcpy(buffer + offset, &tuple.score, sizeof(float));
+}
+
+void readTuple(const void *data, Tuple &tuple) {
+    const char *buffer = (const char *) data;
+    tuple.ageIsNull = buffer[0] & 0x40;
+    int offset = 1, length;
+    memcpy(&length, buffer + offset, sizeof(int));
+    tuple.dept.assign(buffer + offset + sizeof(int), length);
+    offset += sizeof(int) + length;
+    if (!tuple.ageIsNull) {
+        memcpy(&tuple.age, buffer + offset, sizeof(int));
+        offset += sizeof(int);
+    }
+    memcpy(&tuple.score, buffer + offset, sizeof(float));
+}
+
+// scan the index with prefixScan, check every entry with matches and return how many there are, -1 if the scan fails
+int countPrefixScan(const std::string &indexFileName, IXFileHandle &ixFileHandle, const std::vector<Attribute> &attributes, const void *prefix, unsigned numOfPrefixAttributes,
+                    const void *lowKey, const void *highKey, bool lowKeyInclusive, bool highKeyInclusive,
+                    const std::function<bool(const Tuple &)> &matches, int &errors) {
+    IX_ScanIterator ix_ScanIterator;
+    if (indexManager.prefixScan(ixFileHandle, attributes, prefix, numOfPrefixAttributes, lowKey, highKey, lowKeyInclusive,
+                                highKeyInclusive, ix_ScanIterator) != success) {
+        return -1;
+    }
+    RID rid;
+    char key[PAGE_SIZE], data[PAGE_SIZE];
+    Tuple tuple;
+    int count = 0;
+    while (ix_ScanIterator.getNextEntry(rid, key) == success) {
+        indexManager.decodeCompositeKey(attributes, key, data);
+        readTuple(data, tuple);
+        if (!matches(tuple)) {
+            errors++;
+        }
+        count++;
+    }
+    ix_ScanIterator.close();
+    indexManager.openFile(indexFileName, ixFileHandle);
+    return count;
+}
+
+int testCase_24(const std::string &indexFileName, const std::vector<Attribute> &attributes) {
+    // Checks whether a composite key of several attributes keeps the entries in the order of the attributes, NULLs first,
+    // and whether prefixScan finds the keys of a prefix, and a range of the attribute after it.
+    // Functions tested
+    // 1. Create Index File
+    // 2. Insert entries with encoded composite keys **
+    // 3. Scan all, decode the keys **
+    // 4. Scan prefixes and ranges after them **
+    // 5. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 24 *****" << std::endl;
+
+    int errors = 0;
+    Attribute attribute = indexManager.getCompositeAttribute(attributes);
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    RID rid;
+    char key[PAGE_SIZE], data[PAGE_SIZE];
+    for (int i = 0; i < numOfEntries; i++) {
+        prepareTuple(tupleOf(i), data);
+        rc = indexManager.encodeCompositeKey(attributes, data, key);
+        assert(rc == success && "indexManager::encodeCompositeKey() should not fail.");
+        rid.pageNum = i;
+        rid.slotNum = i % 100;
+        rc = indexManager.insertEntry(ixFileHandle, attribute, key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+
+    // the whole index is in the order of the tuples, and every key decodes to the tuple of its RID
+    IX_ScanIterator ix_ScanIterator;
+    rc = indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    Tuple tuple, previous = tupleOf(0);
+    int count = 0;
+    while (ix_ScanIterator.getNextEntry(rid, key) == success) {
+        indexManager.decodeCompositeKey(attributes, key, data);
+        readTuple(data, tuple);
+        Tuple expected = tupleOf(rid.pageNum);
+        if ((count > 0 && lessThan(tuple, previous)) || tuple.dept != expected.dept || tuple.ageIsNull != expected.ageIsNull ||
+            (!tuple.ageIsNull && tuple.age != expected.age) || tuple.score != expected.score) {
+            errors++;
+            break;
+        }
+        previous = tuple;
+        count++;
+    }
+    ix_ScanIterator.close();
+    if (count != numOfEntries) {
+        errors++;
+    }
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    // prefixes and ranges, the counts are checked against the entries
+    auto countOf = [](const std::function<bool(const Tuple &)> &matches) {
+        int count = 0;
+        for (int i = 0; i < numOfEntries; i++) {
+            count += matches(tupleOf(i));
+        }
+        return count;
+    };
+    std::vector<std::function<bool(const Tuple &)>> conditions;
+    std::vector<int> counts;
+    Tuple prefix;
+    prefix.ageIsNull = false;
+
+    // dept = "ab"
+    prefix.dept = "ab";
+    prepareTuple(prefix, data);
+    conditions.emplace_back([](const Tuple &t) { return t.dept == "ab"; });
+    counts.push_back(countPrefixScan(indexFileName, ixFileHandle, attributes, data, 1, NULL, NULL, true, true, conditions.back(), errors));
+
+    // dept = "a" and -10 <= age < 10, then -10 < age <= 10
+    prefix.dept = "a";
+    prepareTuple(prefix, data);
+    int low = -10, high = 10;
+    conditions.emplace_back([](const Tuple &t) { return t.dept == "a" && !t.ageIsNull && t.age >= -10 && t.age < 10; });
+    counts.push_back(countPrefixScan(indexFileName, ixFileHandle, attributes, data, 1, &low, &high, true, false, conditions.back(), errors));
+    conditions.emplace_back([](const Tuple &t) { return t.dept == "a" && !t.ageIsNull && t.age > -10 && t.age <= 10; });
+    counts.push_back(countPrefixScan(indexFileName, ixFileHandle, attributes, data, 1, &low, &high, false, true, conditions.back(), errors));
+
+    // dept = "a\0b" and age > 50
+    prefix.dept = depts[2];
+    prepareTuple(prefix, data);
+    int fifty = 50;
+    conditions.emplace_back([](const Tuple &t) { return t.dept == depts[2] && !t.ageIsNull && t.age > 50; });
+    counts.push_back(countPrefixScan(indexFileName, ixFileHandle, attributes, data, 1, &fifty, NULL, false, true, conditions.back(), errors));
+
+    // "a" <= dept <= "ab", no prefix
+    char lowDept[8], highDept[8];
+    int length = 1;
+    memcpy(lowDept, &length, sizeof(int));
+    memcpy(lowDept + sizeof(int), "a", 1);
+    length = 2;
+    memcpy(highDept, &length, sizeof(int));
+    memcpy(highDept + sizeof(int), "ab", 2);
+    conditions.emplace_back([](const Tuple &t) { return t.dept >= "a" && t.dept <= "ab"; });
+    counts.push_back(countPrefixScan(indexFileName, ixFileHandle, attributes, NULL, 0, lowDept, highDept, true, true, conditions.back(), errors));
+
+    // the whole key of one tuple
+    prefix = tupleOf(1234);
+    prepareTuple(prefix, data);
+    conditions.emplace_back([prefix](const Tuple &t) {
+        return t.dept == prefix.dept && t.ageIsNull == prefix.ageIsNull && t.age == prefix.age && t.score == prefix.score;
+    });
+    counts.push_back(countPrefixScan(indexFileName, ixFileHandle, attributes, data, 3, NULL, NULL, true, true, conditions.back(), errors));
+    if (countPrefixScan(indexFileName, ixFileHandle, attributes, data, 3, &low, NULL, true, true, conditions.back(), errors) != -1) {
+        errors++;
+    }
+
+    for (size_t i = 0; i < conditions.size(); i++) {
+        std::cerr << "prefix scan " << i << ": " << counts[i] << " entries" << std::endl;
+        if (counts[i] != countOf(conditions[i]) || counts[i] == 0) {
+            errors++;
+        }
+    }
+
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "composite_idx";
+    std::vector<Attribute> attributes(3);
+    attributes[0].name = "dept";
+    attributes[0].type = TypeVarChar;
+    attributes[0].length = 10;
+    attributes[1].name = "age";
+    attributes[1].type = TypeInt;
+    attributes[1].length = 4;
+    attributes[2].name = "score";
+    attributes[2].type = TypeReal;
+    attributes[2].length = 4;
+
+    indexManager.destroyFile(indexFileName);
+
+    if (testCase_24(indexFileName, attributes) == success) {
+        std::cerr << "***** IX Test Case 24 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 24 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
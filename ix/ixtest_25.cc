@@ -0,0 +1,223 @@
+#include "ix.h"
+#include "hash.h"
+#include "ix_test_util.h"
+
+HashIndexManager &hashIndexManager = HashIndexManager::instance();
+
+const int numOfEntries = 30000;
+const int heavyKey = 77777;
+
+// one entry in seven goes to a key whose bucket needs overflow pages
+int keyOf(int i) {
+    return i % 7 == 0 ? heavyKey : i % 10000;
+}
+
+// scan the index between the keys, check every entry against keyOf and the RIDs seen so far, return how many there are
+int countScan(const std::string &indexFileName, IXFileHandle &ixFileHandle, const Attribute &attribute, const int *lowKey,
+              const int *highKey, bool lowKeyInclusive, bool highKeyInclusive, int &errors) {
+    IX_ScanIterator ix_ScanIterator;
+    RC rc = hashIndexManager.scan(ixFileHandle, attribute, lowKey, highKey, lowKeyInclusive, highKeyInclusive, ix_ScanIterator);
+    assert(rc == success && "HashIndexManager::scan() should not fail.");
+    std::vector<bool> found(numOfEntries, false);
+    RID rid;
+    int key, count = 0;
+    while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+        if ((int) rid.pageNum >= numOfEntries || found[rid.pageNum] || keyOf(rid.pageNum) != key ||
+            (lowKey != NULL && (key < *lowKey || (key == *lowKey && !lowKeyInclusive))) ||
+            (highKey != NULL && (key > *highKey || (key == *highKey && !highKeyInclusive)))) {
+            errors++;
+            break;
+        }
+        found[rid.pageNum] = true;
+        count++;
+    }
+    ix_ScanIterator.close();
+    rc = hashIndexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "HashIndexManager::openFile() should not fail.");
+    return count;
+}
+
+int testCase_25(const std::string &indexFileName, const Attribute &attribute, const Attribute &attrHeight) {
+    // Checks whether the hash index finds the entries of a key reading one bucket page, with splits, directory doubling and
+    // overflow pages, and whether its scans return every entry once while the index grows.
+    // Functions tested
+    // 1. Create Hash Index File **
+    // 2. Insert entries, one key takes overflow pages **
+    // 3. Look up keys, count the page reads **
+    // 4. Scan all, scan a range, scan next to inserts **
+    // 5. Delete entries **
+    // 6. REAL keys -0.0 and 0.0 are equal **
+    // 7. Destroy Hash Index File **
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 25 *****" << std::endl;
+
+    int errors = 0;
+    RC rc = hashIndexManager.createFile(indexFileName);
+    assert(rc == success && "HashIndexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = hashIndexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "HashIndexManager::openFile() should not fail.");
+
+    RID rid;
+    int key;
+    for (int i = 0; i < numOfEntries; i++) {
+        key = keyOf(i);
+        rid.pageNum = i;
+        rid.slotNum = i % 100;
+        rc = hashIndexManager.insertEntry(ixFileHandle, attribute, &key, rid);
+        assert(rc == success && "HashIndexManager::insertEntry() should not fail.");
+    }
+    int globalDepth;
+    hashIndexManager.getGlobalDepth(ixFileHandle, globalDepth);
+    std::cerr << "pages of " << numOfEntries << " entries: " << ixFileHandle.getFileHandle().getNumberOfPages()
+              << ", global depth: " << globalDepth << std::endl;
+
+    // look up every key but the heavy one, the directory is read once, then each key reads its bucket
+    std::vector<std::string> keys;
+    std::vector<std::vector<RID>> rids;
+    for (key = 0; key < 10000; key++) {
+        keys.emplace_back((char *) &key, sizeof(int));
+    }
+    hashIndexManager.probeEntries(ixFileHandle, attribute, keys, rids);
+    unsigned readPageCount, writePageCount, appendPageCount, readPageCountBefore;
+    ixFileHandle.collectCounterValues(readPageCountBefore, writePageCount, appendPageCount);
+    rc = hashIndexManager.probeEntries(ixFileHandle, attribute, keys, rids);
+    assert(rc == success && "HashIndexManager::probeEntries() should not fail.");
+    ixFileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+    std::cerr << "page reads of " << keys.size() << " lookups: " << readPageCount - readPageCountBefore << std::endl;
+    for (key = 0; key < 10000; key++) {
+        size_t expected = 0;
+        for (int i = key; i < numOfEntries; i += 10000) {
+            expected += i % 7 != 0;
+        }
+        if (rids[key].size() != expected) {
+            errors++;
+        }
+    }
+    // only the keys in the bucket of the heavy key read its overflow pages
+    if (readPageCount - readPageCountBefore > keys.size() + 100) {
+        errors++;
+    }
+
+    // equality scans, the heavy key, a missing key, and a range
+    int missingKey = 12345, low = 100, high = 200;
+    int heavyCount = countScan(indexFileName, ixFileHandle, attribute, &heavyKey, &heavyKey, true, true, errors);
+    if (heavyCount != (numOfEntries + 6) / 7 || countScan(indexFileName, ixFileHandle, attribute, &missingKey, &missingKey, true, true, errors) != 0) {
+        errors++;
+    }
+    int rangeCount = countScan(indexFileName, ixFileHandle, attribute, &low, &high, false, true, errors), expectedRangeCount = 0;
+    for (int i = 0; i < numOfEntries; i++) {
+        expectedRangeCount += keyOf(i) > low && keyOf(i) <= high;
+    }
+    if (rangeCount != expectedRangeCount || countScan(indexFileName, ixFileHandle, attribute, NULL, NULL, true, true, errors) != numOfEntries) {
+        errors++;
+    }
+
+    // a full scan while the entries of other RIDs go in and split the buckets, it returns each old entry once
+    IX_ScanIterator ix_ScanIterator;
+    rc = hashIndexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "HashIndexManager::scan() should not fail.");
+    IXFileHandle insertHandle;
+    rc = hashIndexManager.openFile(indexFileName, insertHandle);
+    assert(rc == success && "HashIndexManager::openFile() should not fail.");
+    std::vector<bool> found(numOfEntries, false);
+    int count = 0;
+    while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+        if ((int) rid.pageNum < numOfEntries) {
+            if (found[rid.pageNum] || keyOf(rid.pageNum) != key) {
+                errors++;
+            }
+            found[rid.pageNum] = true;
+            count++;
+        }
+        if (count == numOfEntries / 2) {
+            for (int i = 0; i < numOfEntries; i++) {
+                int newKey = 20000 + i;
+                RID newRid = {(unsigned) (numOfEntries + i), 0};
+                hashIndexManager.insertEntry(insertHandle, attribute, &newKey, newRid);
+            }
+        }
+    }
+    ix_ScanIterator.close();
+    hashIndexManager.closeFile(insertHandle);
+    if (count != numOfEntries) {
+        errors++;
+    }
+    rc = hashIndexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "HashIndexManager::openFile() should not fail.");
+
+    // delete one entry in three, the heavy key loses its overflow pages one by one
+    for (int i = 0; i < numOfEntries; i += 3) {
+        key = keyOf(i);
+        rid.pageNum = i;
+        rid.slotNum = i % 100;
+        rc = hashIndexManager.deleteEntry(ixFileHandle, attribute, &key, rid);
+        assert(rc == success && "HashIndexManager::deleteEntry() should not fail.");
+    }
+    if (hashIndexManager.deleteEntry(ixFileHandle, attribute, &key, rid) == success) {
+        errors++;
+    }
+    int expectedHeavyCount = 0;
+    for (int i = 0; i < numOfEntries; i += 7) {
+        expectedHeavyCount += i % 3 != 0;
+    }
+    if (countScan(indexFileName, ixFileHandle, attribute, &heavyKey, &heavyKey, true, true, errors) != expectedHeavyCount) {
+        errors++;
+    }
+    rc = hashIndexManager.closeFile(ixFileHandle);
+    assert(rc == success && "HashIndexManager::closeFile() should not fail.");
+    rc = hashIndexManager.destroyFile(indexFileName);
+    assert(rc == success && "HashIndexManager::destroyFile() should not fail.");
+
+    // -0.0 is the same key as 0.0
+    rc = hashIndexManager.createFile(indexFileName);
+    assert(rc == success && "HashIndexManager::createFile() should not fail.");
+    rc = hashIndexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "HashIndexManager::openFile() should not fail.");
+    float zero = 0.0f, negativeZero = -0.0f, height;
+    rid.pageNum = 1;
+    hashIndexManager.insertEntry(ixFileHandle, attrHeight, &zero, rid);
+    rid.pageNum = 2;
+    hashIndexManager.insertEntry(ixFileHandle, attrHeight, &negativeZero, rid);
+    rc = hashIndexManager.scan(ixFileHandle, attrHeight, &negativeZero, &negativeZero, true, true, ix_ScanIterator);
+    assert(rc == success && "HashIndexManager::scan() should not fail.");
+    count = 0;
+    while (ix_ScanIterator.getNextEntry(rid, &height) == success) {
+        count++;
+    }
+    ix_ScanIterator.close();
+    if (count != 2) {
+        errors++;
+    }
+    rc = hashIndexManager.destroyFile(indexFileName);
+    assert(rc == success && "HashIndexManager::destroyFile() should not fail.");
+
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "age_hash_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+    Attribute attrHeight;
+    attrHeight.length = 4;
+    attrHeight.name = "height";
+    attrHeight.type = TypeReal;
+
+    hashIndexManager.destroyFile(indexFileName);
+
+    if (testCase_25(indexFileName, attrAge, attrHeight) == success) {
+        std::cerr << "***** IX Test Case 25 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 25 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
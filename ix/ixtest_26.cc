@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <random>
+#include "ix.h"
+#include "ix_test_util.h"
+
+const int numOfEntries = 50000;
+
+// every key but the ones of the tenth thousand has two RIDs, its pageNum is the key
+bool hasSecondRid(int key) {
+    return key / 1000 != 9;
+}
+
+// scan the keys i with present[i] between lowKey and highKey backwards, check the keys come down one by one with their RIDs,
+// return the number of entries
+int countReverseScan(const std::string &indexFileName, const Attribute &attribute, const std::vector<bool> &present,
+                     const int *lowKey, const int *highKey, bool lowKeyInclusive, bool highKeyInclusive, int &errors) {
+    IXFileHandle ixFileHandle;
+    IX_ScanIterator ix_ScanIterator;
+    RC rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    rc = indexManager.scan(ixFileHandle, attribute, lowKey, highKey, lowKeyInclusive, highKeyInclusive, ix_ScanIterator, true);
+    assert(rc == success && "indexManager::scan() should not fail.");
+
+    int low = lowKey == NULL ? 0 : *lowKey + (lowKeyInclusive ? 0 : 1);
+    int expected = highKey == NULL ? numOfEntries - 1 : *highKey - (highKeyInclusive ? 0 : 1);
+    int count = 0, ridsOfKey = 0;
+    RID rid;
+    int key;
+    while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+        if (ridsOfKey == 0) {
+            while (expected >= low && !present[expected]) {
+                expected--;
+            }
+            ridsOfKey = hasSecondRid(expected) ? 2 : 1;
+        }
+        // the RIDs of a key come backwards as well: slot 1 before slot 0
+        if (key != expected || (int) rid.pageNum != key || (int) rid.slotNum != ridsOfKey - 1) {
+            errors++;
+            break;
+        }
+        count++;
+        if (--ridsOfKey == 0) {
+            expected--;
+        }
+    }
+    while (expected >= low && !present[expected]) {
+        expected--;
+    }
+    if (expected >= low || ridsOfKey != 0) {
+        errors++;
+    }
+    ix_ScanIterator.close();
+    return count;
+}
+
+RC insertKey(IXFileHandle &ixFileHandle, const Attribute &attribute, int key, bool insert) {
+    for (unsigned slotNum = 0; slotNum < (hasSecondRid(key) ? 2u : 1u); slotNum++) {
+        RID rid = {(unsigned) key, slotNum};
+        RC rc = insert ? indexManager.insertEntry(ixFileHandle, attribute, &key, rid)
+                       : indexManager.deleteEntry(ixFileHandle, attribute, &key, rid);
+        if (rc != success) {
+            return rc;
+        }
+    }
+    return success;
+}
+
+int testCase_26(const std::string &indexFileName, const Attribute &attribute) {
+    // Checks whether reverse scans return the keys of a range from the last one down, walking the leaves along prevNode,
+    // after splits, after merges, on a bulk built tree and next to inserts, and whether MAX reads the rightmost leaf only.
+    // Functions tested
+    // 1. Create Index File
+    // 2. Insert entries in a random order, reverse scans **
+    // 3. Read the largest key, count the page reads **
+    // 4. Delete four keys in five, reverse scans **
+    // 5. Reverse scan while entries are inserted **
+    // 6. Bulk build, reverse scan **
+    // 7. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 26 *****" << std::endl;
+
+    int errors = 0;
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    std::vector<int> keys(numOfEntries);
+    for (int i = 0; i < numOfEntries; i++) {
+        keys[i] = i;
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(26));
+    for (int key : keys) {
+        rc = insertKey(ixFileHandle, attribute, key, true);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+    std::vector<bool> present(numOfEntries, true);
+    int numOfRids = 0;
+    for (int i = 0; i < numOfEntries; i++) {
+        numOfRids += hasSecondRid(i) ? 2 : 1;
+    }
+
+    // the whole index, then ranges with their bounds in or out
+    int low = 8500, high = 9500;
+    if (countReverseScan(indexFileName, attribute, present, NULL, NULL, true, true, errors) != numOfRids ||
+        countReverseScan(indexFileName, attribute, present, &low, &high, true, true, errors) != 1001 + 500 ||
+        countReverseScan(indexFileName, attribute, present, &low, &high, false, false, errors) != 999 + 499 ||
+        countReverseScan(indexFileName, attribute, present, NULL, &low, true, false, errors) != 2 * 8500 ||
+        countReverseScan(indexFileName, attribute, present, &high, NULL, true, true, errors) != 2 * (numOfEntries - high) - 500) {
+        errors++;
+    }
+
+    // the largest key is the first entry of a reverse scan, found by descending to the last leaf
+    IX_ScanIterator ix_ScanIterator;
+    unsigned readPageCount, writePageCount, appendPageCount, readPageCountBefore;
+    ixFileHandle.collectCounterValues(readPageCountBefore, writePageCount, appendPageCount);
+    rc = indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator, true);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    RID rid;
+    int key = -1;
+    rc = ix_ScanIterator.getNextEntry(rid, &key);
+    ixFileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+    std::cerr << "largest key: " << key << ", page reads: " << readPageCount - readPageCountBefore << std::endl;
+    if (rc != success || key != numOfEntries - 1 || readPageCount - readPageCountBefore > IX_CACHED_LEVELS + 2) {
+        errors++;
+    }
+    ix_ScanIterator.close();
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    // merges and redistributions relink the leaves
+    for (int key : keys) {
+        if (key % 5 != 0) {
+            rc = insertKey(ixFileHandle, attribute, key, false);
+            assert(rc == success && "indexManager::deleteEntry() should not fail.");
+            present[key] = false;
+        }
+    }
+    int expectedCount = 0;
+    for (int i = 0; i < numOfEntries; i += 5) {
+        expectedCount += hasSecondRid(i) ? 2 : 1;
+    }
+    if (countReverseScan(indexFileName, attribute, present, NULL, NULL, true, true, errors) != expectedCount ||
+        countReverseScan(indexFileName, attribute, present, &low, &high, true, true, errors) != 201 + 100) {
+        errors++;
+    }
+
+    // a reverse scan while the other keys go in again and split the leaves, it returns the old entries in order
+    rc = indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator, true);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    IXFileHandle insertHandle;
+    rc = indexManager.openFile(indexFileName, insertHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    int count = 0, lastKey = numOfEntries;
+    bool inserted = false;
+    while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+        if (key > lastKey || (int) rid.pageNum != key) {
+            errors++;
+        }
+        lastKey = key;
+        count += present[key];
+        if (!inserted && count == expectedCount / 2) {
+            for (int i = 0; i < numOfEntries; i++) {
+                if (!present[i]) {
+                    insertKey(insertHandle, attribute, i, true);
+                }
+            }
+            inserted = true;
+        }
+    }
+    ix_ScanIterator.close();
+    indexManager.closeFile(insertHandle);
+    if (count != expectedCount) {
+        errors++;
+    }
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    // the leaves of a bulk built tree are linked both ways too
+    rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    std::vector<IndexEntry> entries;
+    for (int i = 0; i < numOfEntries; i++) {
+        for (unsigned slotNum = 0; slotNum < (hasSecondRid(i) ? 2u : 1u); slotNum++) {
+            entries.push_back({std::string((char *) &i, sizeof(int)), {(unsigned) i, slotNum}});
+        }
+    }
+    rc = indexManager.bulkBuild(ixFileHandle, attribute, entries);
+    assert(rc == success && "indexManager::bulkBuild() should not fail.");
+    present.assign(numOfEntries, true);
+    if (countReverseScan(indexFileName, attribute, present, NULL, NULL, true, true, errors) != numOfRids) {
+        errors++;
+    }
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "age_reverse_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    indexManager.destroyFile(indexFileName);
+
+    if (testCase_26(indexFileName, attrAge) == success) {
+        std::cerr << "***** IX Test Case 26 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 26 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
@@ -0,0 +1,174 @@
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "ix.h"
+#include "ix_test_util.h"
+
+const int numOfKeys = 50000;            // the even keys 0, 2, ..., 2 * (numOfKeys - 1), their pageNum is the key
+const int numOfLookups = 40000;         // lookups of one round, split between its threads
+const int numOfInsertsPerThread = 10000;
+
+// look up the keys start, start + step, ... and check each one has its RID, return the number of lookups
+int lookupKeys(const std::string &indexFileName, const Attribute &attribute, int start, int step, int count,
+               const std::atomic<bool> *stop, std::atomic<int> &errors) {
+    IXFileHandle ixFileHandle;
+    if (indexManager.openFile(indexFileName, ixFileHandle) != success) {
+        errors++;
+        return 0;
+    }
+    std::vector<std::string> keys(1);
+    std::vector<std::vector<RID>> rids;
+    int lookups = 0;
+    for (int i = 0; (stop == NULL && i < count) || (stop != NULL && !*stop); i++) {
+        int key = 2 * ((start + (long long) i * step) % numOfKeys);
+        keys[0].assign((char *) &key, sizeof(int));
+        if (indexManager.probeEntries(ixFileHandle, attribute, keys, rids) != success || rids[0].size() != 1 ||
+            (int) rids[0][0].pageNum != key) {
+            errors++;
+        }
+        lookups++;
+    }
+    indexManager.closeFile(ixFileHandle);
+    return lookups;
+}
+
+// insert or delete the odd keys k with k / 2 % numOfThreads == thread, they go between the keys looked up
+void writeKeys(const std::string &indexFileName, const Attribute &attribute, int thread, int numOfThreads, bool insert,
+               std::atomic<int> &errors) {
+    IXFileHandle ixFileHandle;
+    if (indexManager.openFile(indexFileName, ixFileHandle) != success) {
+        errors++;
+        return;
+    }
+    for (int i = 0; i < numOfInsertsPerThread; i++) {
+        // spread over the whole tree, so the writers split and merge the leaves of the lookups
+        int key = 2 * ((i * 7919 % numOfInsertsPerThread) * numOfThreads + thread) + 1;
+        RID rid = {(unsigned) key, 1};
+        RC rc = insert ? indexManager.insertEntry(ixFileHandle, attribute, &key, rid)
+                       : indexManager.deleteEntry(ixFileHandle, attribute, &key, rid);
+        if (rc != success) {
+            errors++;
+        }
+    }
+    indexManager.closeFile(ixFileHandle);
+}
+
+int testCase_27(const std::string &indexFileName, const Attribute &attribute) {
+    // Checks whether lookups find their keys while other threads split and merge the leaves, and measures the lookup
+    // throughput with 1, 2, 4 and 8 threads: the nodes are read with optimistic lock coupling, readers latch nothing.
+    // Every thread opens its own IXFileHandle on the same index file.
+    // Functions tested
+    // 1. Create Index File, bulk build
+    // 2. Lookups from 1, 2, 4 and 8 threads **
+    // 3. Lookups while other threads insert entries **
+    // 4. Lookups while other threads delete entries **
+    // 5. Scan all the entries left, in order
+    // 6. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 27 *****" << std::endl;
+
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    std::vector<IndexEntry> entries;
+    for (int i = 0; i < numOfKeys; i++) {
+        int key = 2 * i;
+        entries.push_back({std::string((char *) &key, sizeof(int)), {(unsigned) key, 0}});
+    }
+    rc = indexManager.bulkBuild(ixFileHandle, attribute, entries);
+    assert(rc == success && "indexManager::bulkBuild() should not fail.");
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+
+    // the same lookups split between more and more threads, the hardware decides how far they scale
+    std::atomic<int> errors(0);
+    std::cerr << "hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+    for (int numOfThreads = 1; numOfThreads <= 8; numOfThreads *= 2) {
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < numOfThreads; t++) {
+            threads.emplace_back(lookupKeys, std::cref(indexFileName), std::cref(attribute), t * 7, 7919,
+                                 numOfLookups / numOfThreads, (const std::atomic<bool> *) NULL, std::ref(errors));
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cerr << numOfThreads << " thread(s): " << (long) (numOfLookups / seconds) << " lookups/s" << std::endl;
+    }
+
+    // two threads look up the even keys while four others insert the odd ones and then delete them again
+    const int numOfWriters = 4;
+    for (int round = 0; round < 2; round++) {
+        std::atomic<bool> stop(false);
+        std::atomic<int> lookups(0);
+        auto lookupLoop = [&](int start) {
+            lookups += lookupKeys(indexFileName, attribute, start, 7919, 0, &stop, errors);
+        };
+        auto begin = std::chrono::steady_clock::now();
+        std::thread reader1(lookupLoop, 0), reader2(lookupLoop, 3);
+        std::vector<std::thread> writers;
+        for (int t = 0; t < numOfWriters; t++) {
+            writers.emplace_back(writeKeys, std::cref(indexFileName), std::cref(attribute), t, numOfWriters, round == 0,
+                                 std::ref(errors));
+        }
+        for (auto &thread : writers) {
+            thread.join();
+        }
+        stop = true;
+        reader1.join();
+        reader2.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cerr << (round == 0 ? "inserts: " : "deletes: ") << (long) (numOfWriters * numOfInsertsPerThread / seconds)
+                  << " writes/s, " << (long) (lookups / seconds) << " lookups/s next to them" << std::endl;
+    }
+
+    // only the even keys are left
+    IX_ScanIterator ix_ScanIterator;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    rc = indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    RID rid;
+    int key, count = 0;
+    while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+        if (key != 2 * count || (int) rid.pageNum != key) {
+            std::cerr << "Wrong entry: expected " << 2 * count << ", got " << key << std::endl;
+            errors++;
+            break;
+        }
+        count++;
+    }
+    ix_ScanIterator.close();
+    std::cerr << "entries left: " << count << ", expected: " << numOfKeys << ", errors: " << errors << std::endl;
+
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (count != numOfKeys || errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "age_olc_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    indexManager.destroyFile(indexFileName);
+
+    if (testCase_27(indexFileName, attrAge) == success) {
+        std::cerr << "***** IX Test Case 27 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 27 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
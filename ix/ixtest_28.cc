@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <random>
+#include "ix.h"
+#include "ix_test_util.h"
+
+const int numOfEntries = 30000;
+
+// scan the whole index, deleting every entry it returns if remove is set: check the keys come in order, each once,
+// and count the pages read by getNextEntry only
+int scanAndDelete(const std::string &indexFileName, const Attribute &attribute, bool reverse, bool remove,
+                  unsigned &readPages, int &errors) {
+    IXFileHandle ixFileHandle;
+    IX_ScanIterator ix_ScanIterator;
+    RC rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    rc = indexManager.scan(ixFileHandle, attribute, NULL, NULL, true, true, ix_ScanIterator, reverse);
+    assert(rc == success && "indexManager::scan() should not fail.");
+
+    unsigned readPageCount, writePageCount, appendPageCount, readPageCountBefore;
+    readPages = 0;
+    int count = 0, key;
+    RID rid;
+    while (true) {
+        ixFileHandle.collectCounterValues(readPageCountBefore, writePageCount, appendPageCount);
+        rc = ix_ScanIterator.getNextEntry(rid, &key);
+        ixFileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+        readPages += readPageCount - readPageCountBefore;
+        if (rc != success) {
+            break;
+        }
+        int expected = reverse ? numOfEntries - 1 - count : count;
+        if (key != expected || (int) rid.pageNum != key) {
+            std::cerr << "Wrong entry: expected " << expected << ", got " << key << std::endl;
+            errors++;
+            break;
+        }
+        if (remove && indexManager.deleteEntry(ixFileHandle, attribute, &key, rid) != success) {
+            errors++;
+        }
+        count++;
+    }
+    ix_ScanIterator.close();
+    return count;
+}
+
+int testCase_28(const std::string &indexFileName, const Attribute &attribute) {
+    // Checks whether a scan takes the entries of a leaf in one pass and follows the leaf links while its leaf is unchanged,
+    // and searches the tree again only for the leaves changed under it: deleting every entry it returns stays cheap.
+    // Functions tested
+    // 1. Create Index File
+    // 2. Insert entries in a random order
+    // 3. Scan all, count the page reads **
+    // 4. Scan all and delete every entry returned, count the page reads **
+    // 5. The same backwards **
+    // 6. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 28 *****" << std::endl;
+
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+
+    std::vector<int> keys(numOfEntries);
+    for (int i = 0; i < numOfEntries; i++) {
+        keys[i] = i;
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(28));
+    int errors = 0;
+    for (int round = 0; round < 2; round++) {
+        bool reverse = round == 1;
+        for (int key : keys) {
+            RID rid = {(unsigned) key, 0};
+            rc = indexManager.insertEntry(ixFileHandle, attribute, &key, rid);
+            assert(rc == success && "indexManager::insertEntry() should not fail.");
+        }
+        unsigned numOfPages = ixFileHandle.getFileHandle().getNumberOfPages();
+
+        // every leaf is read once
+        unsigned readPages, deleteReadPages;
+        if (scanAndDelete(indexFileName, attribute, reverse, false, readPages, errors) != numOfEntries || readPages > numOfPages) {
+            errors++;
+        }
+        // every leaf changes under the scan, it is found again from the cached top of the tree
+        if (scanAndDelete(indexFileName, attribute, reverse, true, deleteReadPages, errors) != numOfEntries ||
+            deleteReadPages > 2 * numOfPages) {
+            errors++;
+        }
+        std::cerr << (reverse ? "reverse " : "") << "scan of " << numOfPages << " pages, page reads: " << readPages
+                  << ", deleting the entries: " << deleteReadPages << std::endl;
+        if (scanAndDelete(indexFileName, attribute, reverse, false, readPages, errors) != 0) {
+            errors++;
+        }
+    }
+
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "age_batch_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    indexManager.destroyFile(indexFileName);
+
+    if (testCase_28(indexFileName, attrAge) == success) {
+        std::cerr << "***** IX Test Case 28 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 28 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
@@ -0,0 +1,196 @@
+#include <fstream>
+#include "ix.h"
+#include "hash.h"
+#include "ix_test_util.h"
+
+const int numOfKeys = 20000;            // the even keys 0, 2, ..., 2 * (numOfKeys - 1), their pageNum is the key
+const float falsePositiveRate = 0.01;
+const int probeStep = 200;              // absent keys probed far apart, like the keys of a join which have no match
+
+// probe the keys start, start + step, ... at once, return the number of keys found and count the page reads
+int probeKeys(IXFileHandle &ixFileHandle, const Attribute &attribute, int start, int step, int count, unsigned &readPages,
+              int &errors) {
+    std::vector<std::string> keys;
+    for (int i = 0; i < count; i++) {
+        int key = start + step * i;
+        keys.emplace_back((char *) &key, sizeof(int));
+    }
+    std::vector<std::vector<RID>> rids;
+    unsigned readPageCount, writePageCount, appendPageCount, readPageCountBefore;
+    ixFileHandle.collectCounterValues(readPageCountBefore, writePageCount, appendPageCount);
+    RC rc = indexManager.probeEntries(ixFileHandle, attribute, keys, rids);
+    ixFileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+    readPages = readPageCount - readPageCountBefore;
+    assert(rc == success && "indexManager::probeEntries() should not fail.");
+    int found = 0;
+    for (int i = 0; i < count; i++) {
+        if (rids[i].empty()) {
+            continue;
+        }
+        if (rids[i].size() != 1 || (int) rids[i][0].pageNum != start + step * i) {
+            errors++;
+        }
+        found++;
+    }
+    return found;
+}
+
+// share of the odd keys the filter of the index lets through
+double falsePositives(const std::string &indexFileName, const Attribute &attribute, int count) {
+    std::shared_ptr<BloomFilter> filter = indexManager.getBloomFilter(indexFileName);
+    int passed = 0;
+    for (int i = 0; i < count; i++) {
+        int key = 2 * i + 1;
+        passed += filter->mayContain(HashIndexManager::instance().hashKey(attribute, &key));
+    }
+    return (double) passed / count;
+}
+
+bool fileExists(const std::string &fileName) {
+    std::ifstream f(fileName);
+    return f.good();
+}
+
+int testCase_29(const std::string &indexFileName, const Attribute &attribute) {
+    // Checks whether the Bloom filter of an index rules out most absent keys of a probe without reading the tree, never a key
+    // of the index, follows inserts and is built again by a bulk build.
+    // Functions tested
+    // 1. Create Index File, insert the even keys
+    // 2. Probe odd keys far apart, count the page reads
+    // 3. Create the Bloom filter **
+    // 4. Probe them again and the even keys, count the page reads, the rate of false positives **
+    // 5. Scans of one absent key **
+    // 6. Insert the odd keys, probe them **
+    // 7. Bulk build, the filter is built again **
+    // 8. Destroy Index File, its filter goes too **
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 29 *****" << std::endl;
+
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    for (int i = 0; i < numOfKeys; i++) {
+        int key = 2 * i;
+        RID rid = {(unsigned) key, 0};
+        rc = indexManager.insertEntry(ixFileHandle, attribute, &key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+
+    // without a filter the probes of absent keys far apart read a leaf each
+    int errors = 0;
+    unsigned readPages, filteredReadPages, presentReadPages;
+    if (indexManager.getBloomFilter(indexFileName) != nullptr ||
+        probeKeys(ixFileHandle, attribute, 1, probeStep, numOfKeys / probeStep, readPages, errors) != 0) {
+        errors++;
+    }
+
+    // with it they read next to nothing, the keys of the index are all found
+    rc = indexManager.createBloomFilter(ixFileHandle, attribute, falsePositiveRate);
+    assert(rc == success && "indexManager::createBloomFilter() should not fail.");
+    double rate = falsePositives(indexFileName, attribute, numOfKeys);
+    if (probeKeys(ixFileHandle, attribute, 1, probeStep, numOfKeys / probeStep, filteredReadPages, errors) != 0 ||
+        probeKeys(ixFileHandle, attribute, 0, 2, numOfKeys, presentReadPages, errors) != numOfKeys ||
+        filteredReadPages * 10 > readPages || rate > 3 * falsePositiveRate || !fileExists(indexFileName + BLOOM_FILE_SUFFIX)) {
+        errors++;
+    }
+    std::cerr << "probes of absent keys, page reads: " << readPages << ", with the filter: " << filteredReadPages
+              << ", false positives: " << rate << std::endl;
+
+    // an equality scan of a key the filter rules out reads no page
+    int readless = 0;
+    unsigned readPageCount, writePageCount, appendPageCount, readPageCountBefore;
+    for (int i = 0; i < 1000; i++) {
+        int key = 2 * i + 1;
+        IXFileHandle scanHandle;
+        IX_ScanIterator ix_ScanIterator;
+        rc = indexManager.openFile(indexFileName, scanHandle);
+        assert(rc == success && "indexManager::openFile() should not fail.");
+        scanHandle.collectCounterValues(readPageCountBefore, writePageCount, appendPageCount);
+        rc = indexManager.scan(scanHandle, attribute, &key, &key, true, true, ix_ScanIterator);
+        assert(rc == success && "indexManager::scan() should not fail.");
+        RID rid;
+        int found;
+        if (ix_ScanIterator.getNextEntry(rid, &found) != IX_EOF) {
+            errors++;
+        }
+        scanHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+        readless += readPageCount == readPageCountBefore;
+        ix_ScanIterator.close();
+    }
+    std::cerr << "scans of an absent key which read no page: " << readless << " of 1000" << std::endl;
+    if (readless < 950) {
+        errors++;
+    }
+
+    // inserted keys go into the filter
+    for (int i = 0; i < numOfKeys; i++) {
+        int key = 2 * i + 1;
+        RID rid = {(unsigned) key, 0};
+        rc = indexManager.insertEntry(ixFileHandle, attribute, &key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+    if (probeKeys(ixFileHandle, attribute, 1, 2, numOfKeys, readPages, errors) != numOfKeys) {
+        errors++;
+    }
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+    if (indexManager.getBloomFilter(indexFileName) != nullptr || fileExists(indexFileName + BLOOM_FILE_SUFFIX)) {
+        errors++;
+    }
+
+    // a filter created on the empty index is sized for the keys of the bulk build
+    rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    rc = indexManager.createBloomFilter(ixFileHandle, attribute, falsePositiveRate);
+    assert(rc == success && "indexManager::createBloomFilter() should not fail.");
+    std::vector<IndexEntry> entries;
+    for (int i = 0; i < 5 * numOfKeys; i++) {
+        int key = 2 * i;
+        entries.push_back({std::string((char *) &key, sizeof(int)), {(unsigned) key, 0}});
+    }
+    rc = indexManager.bulkBuild(ixFileHandle, attribute, entries);
+    assert(rc == success && "indexManager::bulkBuild() should not fail.");
+    rate = falsePositives(indexFileName, attribute, 5 * numOfKeys);
+    std::cerr << "bulk build of " << 5 * numOfKeys << " keys, filter capacity: "
+              << indexManager.getBloomFilter(indexFileName)->getCapacity() << ", false positives: " << rate << std::endl;
+    if (indexManager.getBloomFilter(indexFileName)->getCapacity() != 5 * numOfKeys || rate > 3 * falsePositiveRate ||
+        probeKeys(ixFileHandle, attribute, 0, 2, 5 * numOfKeys, presentReadPages, errors) != 5 * numOfKeys) {
+        errors++;
+    }
+
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "age_bloom_idx";
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    indexManager.destroyFile(indexFileName);
+
+    if (testCase_29(indexFileName, attrAge) == success) {
+        std::cerr << "***** IX Test Case 29 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 29 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
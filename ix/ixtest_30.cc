@@ -0,0 +1,264 @@
+#include <cmath>
+#include <random>
+#include <limits>
+#include "ix.h"
+#include "ix_test_util.h"
+
+const int numOfInts = 20000;            // the INT keys -numOfInts / 2, ..., numOfInts / 2 - 1, their pageNum is the key + numOfInts
+
+float floatOf(unsigned bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+// the keys of a scan of the index and their RIDs, in the order returned
+RC scanKeys(const std::string &indexFileName, const Attribute &attribute, const void *lowKey, const void *highKey,
+            bool reverse, std::vector<unsigned> &keys, std::vector<RID> &rids) {
+    IXFileHandle ixFileHandle;
+    IX_ScanIterator ix_ScanIterator;
+    RC rc = indexManager.openFile(indexFileName, ixFileHandle);
+    if (rc != success) {
+        return rc;
+    }
+    rc = indexManager.scan(ixFileHandle, attribute, lowKey, highKey, true, true, ix_ScanIterator, reverse);
+    if (rc != success) {
+        indexManager.closeFile(ixFileHandle);
+        return rc;
+    }
+    keys.clear();
+    rids.clear();
+    unsigned key;
+    RID rid;
+    while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+        keys.push_back(key);
+        rids.push_back(rid);
+    }
+    return ix_ScanIterator.close();
+}
+
+int testReals(const std::string &indexFileName, const Attribute &attribute) {
+    // the values in their order, pageNum of a RID is the rank of its value: -0.0 and 0.0 are equal, so are the NaNs
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<std::pair<float, unsigned>> values = {
+            {-inf, 0}, {-1e30f, 1}, {-2.5f, 2}, {-1.0f, 3}, {-1e-40f, 4}, {-0.0f, 5}, {0.0f, 5}, {1e-40f, 6}, {1.0f, 7},
+            {2.5f, 8}, {1e30f, 9}, {inf, 10}, {floatOf(0x7FC00000u), 11}, {floatOf(0xFFC00000u), 11}, {floatOf(0x7F800001u), 11}};
+    const unsigned numOfRanks = 12;
+
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    std::vector<size_t> order(values.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = (i * 7) % order.size();
+    }
+    for (size_t i : order) {
+        RID rid = {values[i].second, (unsigned) i};
+        rc = indexManager.insertEntry(ixFileHandle, attribute, &values[i].first, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+
+    // the whole index in the order of the ranks, the keys come back as they went in but -0.0 and the NaNs
+    int errors = 0;
+    std::vector<unsigned> keys;
+    std::vector<RID> rids;
+    rc = scanKeys(indexFileName, attribute, NULL, NULL, false, keys, rids);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    if (keys.size() != values.size()) {
+        errors++;
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+        float key = floatOf(keys[i]);
+        float value = values[rids[i].slotNum].first;
+        if ((i > 0 && rids[i].pageNum < rids[i - 1].pageNum) ||
+            (value == value ? key != value : key == key)) {
+            errors++;
+        }
+    }
+
+    // an equality scan of -0.0 finds 0.0, one of a NaN finds them all, a range takes the ranks between its bounds
+    float zero = -0.0f, nan = floatOf(0xFFC00001u), low = -1.0f, high = 1.0f;
+    rc = scanKeys(indexFileName, attribute, &zero, &zero, false, keys, rids);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    errors += keys.size() != 2;
+    rc = scanKeys(indexFileName, attribute, &nan, &nan, false, keys, rids);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    errors += keys.size() != 3;
+    rc = scanKeys(indexFileName, attribute, &low, &high, true, keys, rids);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    if (keys.size() != 6 || rids.front().pageNum != 7 || rids.back().pageNum != 3) {
+        errors++;
+    }
+    rc = scanKeys(indexFileName, attribute, &high, NULL, false, keys, rids);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    errors += keys.size() != 7;
+    std::cerr << "REAL keys in " << numOfRanks << " ranks, errors: " << errors << std::endl;
+
+    // compareKey(...) follows the order of the index
+    if (indexManager.compareKey(attribute, &zero, &values[6].first) != 0 ||
+        indexManager.compareKey(attribute, &nan, &values[12].first) != 0 ||
+        indexManager.compareKey(attribute, &values[11].first, &nan) >= 0 ||
+        indexManager.compareKey(attribute, &values[0].first, &values[1].first) >= 0) {
+        errors++;
+    }
+
+    // deleting -0.0 deletes the entry of 0.0, deleting a NaN the entry of another NaN
+    RID rid = {5, 6};
+    rc = indexManager.deleteEntry(ixFileHandle, attribute, &zero, rid);
+    errors += rc != success;
+    rid = {11, 14};
+    rc = indexManager.deleteEntry(ixFileHandle, attribute, &nan, rid);
+    errors += rc != success;
+    rc = scanKeys(indexFileName, attribute, NULL, NULL, false, keys, rids);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    errors += keys.size() != values.size() - 2;
+
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+    return errors;
+}
+
+int testInts(const std::string &indexFileName, const Attribute &attribute) {
+    RC rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    IXFileHandle ixFileHandle;
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    std::vector<int> ints;
+    for (int i = 0; i < numOfInts; i++) {
+        ints.push_back(i - numOfInts / 2);
+    }
+    std::shuffle(ints.begin(), ints.end(), std::mt19937(30));
+    for (int key : ints) {
+        RID rid = {(unsigned) (key + numOfInts), 0};
+        rc = indexManager.insertEntry(ixFileHandle, attribute, &key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+    int extremes[2] = {std::numeric_limits<int>::min(), std::numeric_limits<int>::max()};
+    for (int key : extremes) {
+        RID rid = {(unsigned) key, 1};
+        rc = indexManager.insertEntry(ixFileHandle, attribute, &key, rid);
+        assert(rc == success && "indexManager::insertEntry() should not fail.");
+    }
+
+    // the negative keys before the positive ones, forwards and backwards
+    int errors = 0;
+    std::vector<unsigned> keys;
+    std::vector<RID> rids;
+    for (int reverse = 0; reverse < 2; reverse++) {
+        rc = scanKeys(indexFileName, attribute, NULL, NULL, reverse, keys, rids);
+        assert(rc == success && "indexManager::scan() should not fail.");
+        if (keys.size() != numOfInts + 2) {
+            errors++;
+            continue;
+        }
+        for (size_t i = 0; i < keys.size(); i++) {
+            size_t rank = reverse ? keys.size() - 1 - i : i;
+            int expected = rank == 0 ? extremes[0] : rank == keys.size() - 1 ? extremes[1] : (int) rank - 1 - numOfInts / 2;
+            errors += (int) keys[i] != expected;
+        }
+    }
+
+    // a range around 0, a probe of keys on both sides of it
+    int low = -50, high = 50;
+    rc = scanKeys(indexFileName, attribute, &low, &high, false, keys, rids);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    if (keys.size() != 101 || (int) keys.front() != low || (int) keys.back() != high) {
+        errors++;
+    }
+    std::vector<std::string> probeKeys;
+    for (int key = -numOfInts; key < numOfInts; key += 97) {
+        probeKeys.emplace_back((char *) &key, sizeof(int));
+    }
+    std::vector<std::vector<RID>> probed;
+    rc = indexManager.probeEntries(ixFileHandle, attribute, probeKeys, probed);
+    assert(rc == success && "indexManager::probeEntries() should not fail.");
+    for (size_t i = 0; i < probeKeys.size(); i++) {
+        int key;
+        memcpy(&key, probeKeys[i].data(), sizeof(int));
+        bool present = key >= -numOfInts / 2 && key < numOfInts / 2;
+        if (probed[i].size() != (present ? 1u : 0u) || (present && (int) probed[i][0].pageNum != key + numOfInts)) {
+            errors++;
+        }
+    }
+    std::cerr << "INT keys inserted, errors: " << errors << std::endl;
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+
+    // a bulk build of the same keys gives the same scan
+    std::vector<unsigned> insertedKeys = keys;
+    rc = indexManager.createFile(indexFileName);
+    assert(rc == success && "indexManager::createFile() should not fail.");
+    rc = indexManager.openFile(indexFileName, ixFileHandle);
+    assert(rc == success && "indexManager::openFile() should not fail.");
+    std::vector<IndexEntry> entries;
+    for (int key : ints) {
+        entries.push_back({std::string((char *) &key, sizeof(int)), {(unsigned) (key + numOfInts), 0}});
+    }
+    rc = indexManager.bulkBuild(ixFileHandle, attribute, entries);
+    assert(rc == success && "indexManager::bulkBuild() should not fail.");
+    rc = scanKeys(indexFileName, attribute, &low, &high, false, keys, rids);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    errors += keys != insertedKeys;
+    rc = scanKeys(indexFileName, attribute, NULL, NULL, false, keys, rids);
+    assert(rc == success && "indexManager::scan() should not fail.");
+    errors += keys.size() != numOfInts || (int) keys.front() != -numOfInts / 2;
+    std::cerr << "INT keys bulk built, errors: " << errors << std::endl;
+
+    rc = indexManager.closeFile(ixFileHandle);
+    assert(rc == success && "indexManager::closeFile() should not fail.");
+    rc = indexManager.destroyFile(indexFileName);
+    assert(rc == success && "indexManager::destroyFile() should not fail.");
+    return errors;
+}
+
+int testCase_30(const std::string &indexFileName) {
+    // Checks whether INT and REAL keys are in order in the nodes, which keep them normalized: negative keys first,
+    // -0.0 equal to 0.0, every NaN equal and after +infinity, and whether keys come back from a scan as they went in.
+    // Functions tested
+    // 1. Create Index File, insert REAL keys of every kind **
+    // 2. Scans of the whole index, of -0.0, of a NaN and of a range backwards **
+    // 3. compareKey, deleteEntry of -0.0 and of a NaN **
+    // 4. Insert negative and positive INT keys, INT_MIN and INT_MAX, scan forwards and backwards **
+    // 5. Range scan, probe **
+    // 6. Bulk build of the INT keys **
+    // 7. Destroy Index File
+    // NOTE: "**" signifies the new functions being tested in this test case.
+    std::cerr << std::endl << "***** In IX Test Case 30 *****" << std::endl;
+
+    Attribute attrHeight;
+    attrHeight.length = 4;
+    attrHeight.name = "height";
+    attrHeight.type = TypeReal;
+    Attribute attrAge;
+    attrAge.length = 4;
+    attrAge.name = "age";
+    attrAge.type = TypeInt;
+
+    int errors = testReals(indexFileName, attrHeight) + testInts(indexFileName, attrAge);
+    if (errors != 0) {
+        return fail;
+    }
+    return success;
+}
+
+int main() {
+
+    const std::string indexFileName = "normalized_idx";
+    indexManager.destroyFile(indexFileName);
+
+    if (testCase_30(indexFileName) == success) {
+        std::cerr << "***** IX Test Case 30 finished. The result will be examined. *****" << std::endl;
+        return success;
+    } else {
+        std::cerr << "***** [FAIL] IX Test Case 30 failed. *****" << std::endl;
+        return fail;
+    }
+
+}
@@ -120,6 +120,8 @@ BNLJoin::BNLJoin(Iterator *leftIn, TableScan *rightIn, const Condition &conditio
     this->rightIn = rightIn;
     this->condition = condition;
     this->numPageinBlock = numPages;
+    // the join comes block by block in the order of rightIn, the order of leftIn is lost anyway
+    this->leftIn->setOrderNeeded(false);
     this->lhsTupleData = nullptr;
     this->rhsTupleData = nullptr;
     this->leftTableisOver = false;
@@ -509,6 +511,66 @@ bool BNLJoin::isBNLJoinSatisfied() {
     }
 }
 
+/*
+ *
+ * IndexScan
+ *
+ */
+
+RC IndexScan::fetchTuple(void *data) {
+    while (nextTuple >= tuples.size() || tuples[nextTuple].empty()) {
+        if (nextTuple < tuples.size()) {
+            // the tuple is deleted since its RID was read from the index
+            nextTuple++;
+            continue;
+        }
+        if (indexDone) {
+            return QE_EOF;
+        }
+        if (loadBatch() != 0) {
+            return -1;
+        }
+    }
+    rid = rids[nextTuple];
+    memcpy(data, tuples[nextTuple].data(), tuples[nextTuple].size());
+    nextTuple++;
+    return 0;
+}
+
+RC IndexScan::loadBatch() {
+    rids.clear();
+    tuples.clear();
+    nextTuple = 0;
+    
+    bool byPage = sortedFetch || (!orderNeeded && selectivity >= QE_SORTED_FETCH_SELECTIVITY);
+    size_t batchSize = byPage ? QE_SORTED_FETCH_BATCH : QE_FETCH_BATCH;
+    while (rids.size() < batchSize) {
+        if (iter->getNextEntry(rid, key) != 0) {
+            indexDone = true;
+            break;
+        }
+        rids.push_back(rid);
+    }
+    if (byPage) {
+        std::sort(rids.begin(), rids.end(), [](const RID &rid1, const RID &rid2) {
+            return rid1.pageNum < rid2.pageNum || (rid1.pageNum == rid2.pageNum && rid1.slotNum < rid2.slotNum);
+        });
+    }
+    return rm.readTuples(tableName, rids, tuples);
+}
+
+void IndexScan::estimateSelectivity(const void *lowKey, const void *highKey, bool lowKeyInclusive, bool highKeyInclusive) {
+    // share above lowKey plus share below highKey, minus the whole table they overlap on
+    double lowSelectivity = 1, highSelectivity = 1;
+    if (lowKey != NULL && rm.estimateSelectivity(tableName, attrName, lowKeyInclusive ? GE_OP : GT_OP, lowKey, lowSelectivity) != 0) {
+        lowSelectivity = 1;
+    }
+    if (highKey != NULL && rm.estimateSelectivity(tableName, attrName, highKeyInclusive ? LE_OP : LT_OP, highKey, highSelectivity) != 0) {
+        highSelectivity = 1;
+    }
+    selectivity = std::max(lowSelectivity + highSelectivity - 1, 0.0);
+}
+
 /*
  *
  * INLJoin
@@ -552,8 +614,15 @@ INLJoin::INLJoin(Iterator *leftIn, IndexScan *rightIn, const Condition &conditio
 //        std::cout << attr.name << std::endl;
     }
     
-    this->newLhsTuple = true;
-    this->newRhsScan = true;
+    // the keys of both sides have the type of the indexed attribute
+    for(Attribute & attr : this->rhsAttributes){
+        if(attr.name == this->condition.rhsAttr){
+            this->keyAttribute = attr;
+        }
+    }
+    
+    this->lhsIndex = 0;
+    this->ridIndex = 0;
 }
 
 void INLJoin::getAttributes(std::vector<Attribute> & attrs) const{
@@ -569,57 +638,92 @@ void INLJoin::getAttributes(std::vector<Attribute> & attrs) const{
 }
 
 RC INLJoin::getNextTuple(void* data) {
-    // we need to check Btree scan status and isFirstTime
     
     RC rc;
-
+    
     // Only consider join for one attributes and equi-join
     while(true){
-        if(this->newLhsTuple){
-            while(true){
-                rc = leftIn->getNextTuple(this->lhsTupleData);
-                if(rc == QE_EOF){
-//                    std::cout << "[Warning]: INLJoin::getNextTuple -> scan terminate" << std::endl;
-                    return QE_EOF;
-                }
-                else{
-//                    std::cout << "Get tuple from Left" << std::endl;
-//                    RelationManager::instance().printTuple(this->lhsAttributes, this->lhsTupleData);
-                }
-                extractFromReturnedData(this->lhsAttributes, this->lhsSelAttrNames, this->lhsTupleData, this->lhsSelData);
-                if (((char *) this->lhsSelData)[0] & (unsigned) 1 << (unsigned) 7){
-                    // std::cout << "Tuple from Left Hand is null" << std::endl;
-                    continue;
-                }
-                else{
-//                    std::cout << "Get tuple from Left" << std::endl;
-                    this->newLhsTuple = false;
-                    memmove(this->joinKey, (char *)this->lhsSelData + this->lhsNullSize, MAX_TUPLE_LEN-this->lhsNullSize);
-                    break;
-                }
+        if(this->lhsIndex >= this->lhsBlock.size()){
+            if(loadBlock() != 0){
+                // std::cout << "[Error]: INLJoin::getNextTuple -> loadBlock" << std::endl;
+                return -1;
+            }
+            if(this->lhsBlock.empty()){
+//                std::cout << "[Warning]: INLJoin::getNextTuple -> scan terminate" << std::endl;
+                return QE_EOF;
             }
         }
+        
+        int keyIndex = this->lhsKeyIndex[this->lhsIndex];
+        if(keyIndex == -1 || this->ridIndex >= this->rhsRids[keyIndex].size()){
+            // leftIn should get a new tuple
+            this->lhsIndex++;
+            this->ridIndex = 0;
+            continue;
+        }
+        rc = rightIn->readTuple(this->rhsRids[keyIndex][this->ridIndex], this->rhsTupleData);
+        this->ridIndex++;
+        if(rc != 0){
+            // the tuple is deleted since the index was probed
+            continue;
+        }
+//        RelationManager::instance().printTuple(this->rhsAttributes, this->rhsTupleData);
+        memcpy(this->lhsTupleData, this->lhsBlock[this->lhsIndex].data(), this->lhsBlock[this->lhsIndex].size());
+        concatenateData(this->allAttributes, this->lhsAttributes, this->rhsAttributes, this->lhsTupleData, this->rhsTupleData, data);
+        return 0;
+        // concatenate two schema
+    }
+}
+
+RC INLJoin::loadBlock() {
+    IndexManager &indexManager = IndexManager::instance();
+    this->lhsBlock.clear();
+    this->lhsKeyIndex.clear();
+    this->rhsRids.clear();
+    this->lhsIndex = 0;
+    this->ridIndex = 0;
+    
+    // the join key of each tuple, in the format of the index
+    std::vector<std::string> lhsKeys;
+    while(this->lhsBlock.size() < INL_JOIN_BLOCK_SIZE && leftIn->getNextTuple(this->lhsTupleData) != QE_EOF){
+//        RelationManager::instance().printTuple(this->lhsAttributes, this->lhsTupleData);
+        this->lhsBlock.emplace_back((char *)this->lhsTupleData, getLengthOfData(this->lhsAttributes, this->lhsTupleData));
+        extractFromReturnedData(this->lhsAttributes, this->lhsSelAttrNames, this->lhsTupleData, this->lhsSelData);
+        if (((char *) this->lhsSelData)[0] & (unsigned) 1 << (unsigned) 7){
+            // std::cout << "Tuple from Left Hand is null" << std::endl;
+            lhsKeys.emplace_back();
+            continue;
+        }
+        memmove(this->joinKey, (char *)this->lhsSelData + this->lhsNullSize, MAX_TUPLE_LEN-this->lhsNullSize);
+        lhsKeys.emplace_back((char *)this->joinKey, indexManager.getKeyLength(this->keyAttribute, this->joinKey));
+    }
     
-        if(this->newRhsScan){
-            rightIn->setIterator(joinKey, joinKey, true, true);
+    // probe every distinct key once, in key order
+    auto keyLess = [&](const std::string &key1, const std::string &key2){
+        return indexManager.compareKey(this->keyAttribute, key1.data(), key2.data()) < 0;
+    };
+    std::vector<std::string> probeKeys;
+    for(const std::string &key : lhsKeys){
+        if(!key.empty()){
+            probeKeys.push_back(key);
         }
-        while(true){
-            rc= rightIn->getNextTuple(this->rhsTupleData);
-            if(rc == IX_EOF){
-                this->newLhsTuple = true;
-                this->newRhsScan = true;
-                break;
-                // leftIn should get a new tuple
-            }
-            else{
-                this->newRhsScan = false;
-//                RelationManager::instance().printTuple(this->rhsAttributes, this->rhsTupleData);
-                concatenateData(this->allAttributes, this->lhsAttributes, this->rhsAttributes, this->lhsTupleData, this->rhsTupleData, data);
-                return 0;
-                // concatenate two schema
-            }
+    }
+    std::sort(probeKeys.begin(), probeKeys.end(), keyLess);
+    probeKeys.erase(std::unique(probeKeys.begin(), probeKeys.end(), [&](const std::string &key1, const std::string &key2){
+        return indexManager.compareKey(this->keyAttribute, key1.data(), key2.data()) == 0;
+    }), probeKeys.end());
+    if(!probeKeys.empty() && rightIn->probeKeys(probeKeys, this->rhsRids) != 0){
+        return -1;
+    }
+    
+    for(const std::string &key : lhsKeys){
+        if(key.empty()){
+            this->lhsKeyIndex.push_back(-1);
+            continue;
         }
+        this->lhsKeyIndex.push_back(std::lower_bound(probeKeys.begin(), probeKeys.end(), key, keyLess) - probeKeys.begin());
     }
+    return 0;
 }
 
 Aggregate::Aggregate(Iterator *input,          // Iterator of input R
@@ -630,6 +734,7 @@ Aggregate::Aggregate(Iterator *input,          // Iterator of input R
     this->aggAttr = aggAttr;
     this->op = op;
     this->input->getAttributes(this->allAttrs);
+    this->input->setOrderNeeded(false);
     this->opDone = false;
     
     if(aggAttr.type != TypeInt && aggAttr.type != TypeReal){
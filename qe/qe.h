@@ -9,6 +9,10 @@
 
 #define QE_EOF (-1)  // end of the index scan
 #define MAX_TUPLE_LEN 400
+#define INL_JOIN_BLOCK_SIZE 256  // left tuples INLJoin probes the index for at once
+#define QE_FETCH_BATCH 64               // RIDs an IndexScan in key order fetches at once
+#define QE_SORTED_FETCH_BATCH 4096      // RIDs an IndexScan with sortedFetch sorts and fetches at once
+#define QE_SORTED_FETCH_SELECTIVITY 0.05    // estimated share of the table from which an IndexScan whose order is not needed fetches by page
 
 typedef enum {
     MIN = 0, MAX, COUNT, SUM, AVG
@@ -65,6 +69,10 @@ public:
 
     virtual void getAttributes(std::vector<Attribute> &attrs) const = 0;
 
+    // Called by the consumer of the iterator when it does not need the order of the tuples, an IndexScan may then fetch
+    // them sorted by page. Operators whose output keeps the order of an input pass it on to that input.
+    virtual void setOrderNeeded(bool orderNeeded) {};
+
     virtual ~Iterator() = default;
 };
 
@@ -139,41 +147,107 @@ public:
     std::vector<Attribute> attrs;
     char key[PAGE_SIZE]{};
     RID rid{};
-
-    IndexScan(RelationManager &rm, const std::string &tableName, const std::string &attrName, const char *alias = NULL)
+    bool indexOnly;
+    bool reverse;                       // the keys come from the largest one down
+    bool sortedFetch;                   // the RIDs are always fetched sorted by page, the tuples don't come in key order, see loadBatch()
+    bool orderNeeded;                   // the consumer needs the key order, see setOrderNeeded(...)
+    double selectivity;                 // estimated share of the table in the range of the scan
+    bool indexDone;                     // the index scan has returned its last RID
+    std::vector<RID> rids;              // the RIDs of the batch
+    std::vector<std::string> tuples;    // their tuples, empty if deleted
+    size_t nextTuple;
+
+    // An index-only scan returns tuples of the indexed attribute alone, built from the keys of the index,
+    // and never reads the table: for queries which only need that attribute (MIN / MAX / COUNT of it, a projection onto it).
+    // A reverse scan returns the keys in descending order, so its first tuple has MAX of the attribute and the first N ones
+    // the N largest keys, reading the rightmost leaves of the index only (see IndexManager::scan(...)).
+    // Fetched sorted by page, QE_SORTED_FETCH_BATCH RIDs at a time sorted by RID, the pages of the table are read in order but
+    // the output order is NOT preserved, neither the key order nor the reverse one. A scan switches to it by itself when its
+    // consumer does not need the order (see setOrderNeeded(...)) and the estimated selectivity of its range is at least
+    // QE_SORTED_FETCH_SELECTIVITY, too large for the index to be selective. sortedFetch forces it whatever the estimate.
+    IndexScan(RelationManager &rm, const std::string &tableName, const std::string &attrName, const char *alias = NULL,
+              bool indexOnly = false, bool reverse = false, bool sortedFetch = false)
             : rm(rm) {
         // Set members
         this->tableName = tableName;
         this->attrName = attrName;
+        this->indexOnly = indexOnly;
+        this->reverse = reverse;
+        this->sortedFetch = sortedFetch;
+        this->orderNeeded = true;
+        this->indexDone = false;
+        this->nextTuple = 0;
 
 
         // Get Attributes from RM
         rm.getAttributes(tableName, attrs);
+        if (indexOnly) {
+            for (const Attribute &attribute : std::vector<Attribute>(attrs)) {
+                if (attribute.name == attrName) {
+                    attrs = {attribute};
+                }
+            }
+        }
 
         // Call rm indexScan to get iterator
         iter = new RM_IndexScanIterator();
-        rm.indexScan(tableName, attrName, NULL, NULL, true, true, *iter);
+        rm.indexScan(tableName, attrName, NULL, NULL, true, true, *iter, reverse);
+        estimateSelectivity(NULL, NULL, true, true);
 
         // Set alias
         if (alias) this->tableName = alias;
     };
 
-    // Start a new iterator given the new key range
+    // Start a new iterator given the new key range, in the direction of the scan
     void setIterator(void *lowKey, void *highKey, bool lowKeyInclusive, bool highKeyInclusive) {
         iter->close();
         delete iter;
         iter = new RM_IndexScanIterator();
-        rm.indexScan(tableName, attrName, lowKey, highKey, lowKeyInclusive, highKeyInclusive, *iter);
+        rm.indexScan(tableName, attrName, lowKey, highKey, lowKeyInclusive, highKeyInclusive, *iter, reverse);
+        estimateSelectivity(lowKey, highKey, lowKeyInclusive, highKeyInclusive);
+        indexDone = false;
+        rids.clear();
+        tuples.clear();
+        nextTuple = 0;
+    };
+
+    // Look up the sorted keys at once, rids[i] gets the RIDs of keys[i], see RelationManager::indexProbe(...)
+    RC probeKeys(const std::vector<std::string> &keys, std::vector<std::vector<RID>> &rids) {
+        return rm.indexProbe(tableName, attrName, keys, rids);
     };
 
+    // Read the tuple of a RID returned by probeKeys(...)
+    RC readTuple(const RID &rid, void *data) {
+        return rm.readTuple(tableName, rid, data);
+    };
+
+    // The tuples are fetched in batches, each page of the table is read once for a batch instead of once for every tuple on it.
+    // They come in key order unless they are fetched sorted by page.
     RC getNextTuple(void *data) override {
+        if (!indexOnly) {
+            return fetchTuple(data);
+        }
         int rc = iter->getNextEntry(rid, key);
         if (rc == 0) {
-            rc = rm.readTuple(tableName, rid, data);
+            // the null indicator, then the key, which has the format of the attribute
+            memset(data, 0, 1);
+            memcpy((char *) data + 1, key, IndexManager::instance().getKeyLength(attrs[0], key));
         }
         return rc;
     };
 
+    // Return the next tuple of the batch, load the next batch when it is done
+    RC fetchTuple(void *data);
+
+    // Read the next RIDs from the index and their tuples: QE_FETCH_BATCH of them, kept in key order,
+    // or QE_SORTED_FETCH_BATCH of them sorted by RID when they are fetched sorted by page.
+    RC loadBatch();
+
+    // Estimate selectivity for the range of the scan from the statistics of the attribute, 1 for a whole index
+    void estimateSelectivity(const void *lowKey, const void *highKey, bool lowKeyInclusive, bool highKeyInclusive);
+
+    void setOrderNeeded(bool orderNeeded) override { this->orderNeeded = orderNeeded; };
+
     void getAttributes(std::vector<Attribute> &attributes) const override {
         attributes.clear();
         attributes = this->attrs;
@@ -210,6 +284,8 @@ public:
     // To judge whether this tuple satisfies the condition.
     bool isSatisfied(void *data);
 
+    void setOrderNeeded(bool orderNeeded) override { input->setOrderNeeded(orderNeeded); };
+
 private:
     Iterator *input;
     Condition condition;
@@ -228,6 +304,8 @@ public:
     // For attribute in std::vector<Attribute>, name it as rel.attr
     void getAttributes(std::vector<Attribute> &attrs) const override;
 
+    void setOrderNeeded(bool orderNeeded) override { ite_input->setOrderNeeded(orderNeeded); };
+
 private:
     Iterator *ite_input;
     std::vector<Attribute> allAttrs;
@@ -300,13 +378,16 @@ public:
     }
 
     /*
-     * For each tuple from lhsTable, scan the entire lhsTable to check whether there is a join.
+     * Read a block of INL_JOIN_BLOCK_SIZE tuples from leftIn and probe the index once for their distinct join keys in order,
+     * see IndexScan::probeKeys(...). Then join every tuple of the block, in the order of leftIn, with the tuples of its RIDs.
      */
     RC getNextTuple(void *data) override;
 
     // For attribute in std::vector<Attribute>, name it as rel.attr
     void getAttributes(std::vector<Attribute> &attrs) const override;
 
+    void setOrderNeeded(bool orderNeeded) override { leftIn->setOrderNeeded(orderNeeded); };
+
 private:
     Iterator *leftIn;
     IndexScan *rightIn;
@@ -328,9 +409,18 @@ private:
     
     int lhsNullSize;
     int rhsNullSize;
-    bool newLhsTuple;
-    bool newRhsScan;
     
+    /*
+     * Read the next block of left tuples and probe their keys. The block is empty at the end of leftIn.
+     */
+    RC loadBlock();
+    
+    Attribute keyAttribute;                     // the attribute of the index
+    std::vector<std::string> lhsBlock;          // tuples of the block
+    std::vector<int> lhsKeyIndex;               // index of the key of each tuple in rhsRids, -1 if it is null
+    std::vector<std::vector<RID>> rhsRids;      // RIDs of the distinct keys of the block, sorted
+    size_t lhsIndex;                            // tuple of the block being joined
+    size_t ridIndex;                            // next RID of its key to join it with
 };
 
 // Optional for everyone. 10 extra-credit points
@@ -0,0 +1,93 @@
+#include "qe_test_util.h"
+
+RC testCase_17() {
+    // Optional for all
+    // 1. Index-only scan -- the tuples are built from the keys of the index, the table is not read
+    // SELECT max(left.B), count(left.B) from left, SELECT left.C from left WHERE left.C >= 100.0
+    std::cerr << "***** In QE Test Case 17 *****" << std::endl;
+
+    RC rc = success;
+
+    // The expected values come from the table
+    void *data = malloc(bufSize);
+    auto *tableScan = new TableScan(rm, "left");
+    float expectedMax = 0.0, expectedCount = 0.0;
+    int expectedResultCnt = 0;
+    while (tableScan->getNextTuple(data) != QE_EOF) {
+        expectedMax = std::max(expectedMax, (float) *(int *) ((char *) data + 1 + sizeof(int)));
+        expectedCount++;
+        expectedResultCnt += *(float *) ((char *) data + 1 + 2 * sizeof(int)) >= 100.0;
+    }
+    delete tableScan;
+
+    // Create an index-only IndexScan and an Aggregate on it
+    auto *input = new IndexScan(rm, "left", "B", NULL, true);
+    Attribute aggAttr;
+    aggAttr.name = "left.B";
+    aggAttr.type = TypeInt;
+    aggAttr.length = 4;
+    auto *agg = new Aggregate(input, aggAttr, MAX);
+
+    float maxVal = 0.0;
+    while (agg->getNextTuple(data) != QE_EOF) {
+        maxVal = *(float *) ((char *) data + 1);
+        std::cerr << "MAX(left.B) " << maxVal << std::endl;
+    }
+    if (maxVal != expectedMax) {
+        rc = fail;
+    }
+    delete agg;
+    delete input;
+
+    input = new IndexScan(rm, "left", "B", NULL, true);
+    agg = new Aggregate(input, aggAttr, COUNT);
+    float count = 0.0;
+    while (agg->getNextTuple(data) != QE_EOF) {
+        count = *(float *) ((char *) data + 1);
+        std::cerr << "COUNT(left.B) " << count << std::endl;
+    }
+    if (count != expectedCount) {
+        rc = fail;
+    }
+    delete agg;
+    delete input;
+
+    // The tuples have the indexed attribute alone, in key order
+    input = new IndexScan(rm, "left", "C", NULL, true);
+    std::vector<Attribute> attrs;
+    input->getAttributes(attrs);
+    if (attrs.size() != 1 || attrs[0].name != "left.C") {
+        rc = fail;
+    }
+    float compVal = 100.0;
+    input->setIterator(&compVal, NULL, true, true);
+    int actualResultCnt = 0;
+    float previous = compVal;
+    while (rc == success && input->getNextTuple(data) != QE_EOF) {
+        float valueC = *(float *) ((char *) data + 1);
+        if (*(unsigned char *) data != 0 || valueC < previous) {
+            std::cerr << "***** A returned value is not correct. *****" << std::endl;
+            rc = fail;
+        }
+        previous = valueC;
+        actualResultCnt++;
+    }
+    if (actualResultCnt != expectedResultCnt) {
+        std::cerr << "***** The number of returned tuple is not correct. *****" << std::endl;
+        rc = fail;
+    }
+    delete input;
+    free(data);
+    return rc;
+}
+
+int main() {
+
+    if (testCase_17() != success) {
+        std::cerr << "***** [FAIL] QE Test Case 17 failed. *****" << std::endl;
+        return fail;
+    } else {
+        std::cerr << "***** QE Test Case 17 finished. The result will be examined. *****" << std::endl;
+        return success;
+    }
+}
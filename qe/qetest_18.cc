@@ -0,0 +1,152 @@
+#include "qe_test_util.h"
+
+const int numOfTuples = 5000;
+
+// B is a permutation of A, so the key order of B is not the order the tuples are stored in
+int valueBOf(int a) {
+    return (a * 7919) % numOfTuples;
+}
+
+RC testCase_18() {
+    // Optional for all
+    // 1. IndexScan -- with sortedFetch the range is fetched in batches sorted by RID, without it in key order
+    // 2. IndexScan whose order is not needed -- the whole index is fetched by page, a narrow range keeps the key order
+    // SELECT * FROM leftsorted, SELECT * FROM leftsorted ORDER BY B, SELECT * FROM leftsorted WHERE B >= 100 AND B < 130
+    std::cerr << "***** In QE Test Case 18 *****" << std::endl;
+
+    RC rc = success;
+    auto *is = new IndexScan(rm, "leftsorted", "B", NULL, false, false, true);
+    void *data = malloc(bufSize);
+
+    // every tuple comes once, with its own values
+    std::vector<bool> found(numOfTuples, false);
+    int actualResultCnt = 0;
+    while (is->getNextTuple(data) != QE_EOF) {
+        int valueA = *(int *) ((char *) data + 1);
+        int valueB = *(int *) ((char *) data + 1 + sizeof(int));
+        if (valueA < 0 || valueA >= numOfTuples || found[valueA] || valueB != valueBOf(valueA)) {
+            std::cerr << "***** A returned value is not correct. *****" << std::endl;
+            rc = fail;
+            break;
+        }
+        found[valueA] = true;
+        actualResultCnt++;
+    }
+    if (actualResultCnt != numOfTuples) {
+        std::cerr << "***** The number of returned tuple is not correct. *****" << std::endl;
+        rc = fail;
+    }
+    delete is;
+
+    // a large range keeps the key order when sortedFetch is not asked for
+    is = new IndexScan(rm, "leftsorted", "B");
+    actualResultCnt = 0;
+    while (rc == success && is->getNextTuple(data) != QE_EOF) {
+        int valueB = *(int *) ((char *) data + 1 + sizeof(int));
+        if (valueB != actualResultCnt) {
+            std::cerr << "***** A returned value is not correct. *****" << std::endl;
+            rc = fail;
+        }
+        actualResultCnt++;
+    }
+    if (rc == success && actualResultCnt != numOfTuples) {
+        std::cerr << "***** The number of returned tuple is not correct. *****" << std::endl;
+        rc = fail;
+    }
+
+    // the consumer does not need the order and the whole table is in the range: the first batch comes in the order of A
+    is->setOrderNeeded(false);
+    is->setIterator(NULL, NULL, true, true);
+    int previousA = -1;
+    actualResultCnt = 0;
+    while (rc == success && is->getNextTuple(data) != QE_EOF) {
+        int valueA = *(int *) ((char *) data + 1);
+        if (actualResultCnt < QE_SORTED_FETCH_BATCH && valueA <= previousA) {
+            std::cerr << "***** The tuples are not fetched by page. *****" << std::endl;
+            rc = fail;
+        }
+        previousA = valueA;
+        actualResultCnt++;
+    }
+    if (rc == success && actualResultCnt != numOfTuples) {
+        std::cerr << "***** The number of returned tuple is not correct. *****" << std::endl;
+        rc = fail;
+    }
+
+    // the statistics createIndex collected make this range selective, it still comes in key order
+    int lowKey = 100, highKey = 130;
+    is->setIterator(&lowKey, &highKey, true, false);
+    int expected = lowKey;
+    while (rc == success && is->getNextTuple(data) != QE_EOF) {
+        int valueB = *(int *) ((char *) data + 1 + sizeof(int));
+        if (valueB != expected) {
+            std::cerr << "***** A returned value is not correct. *****" << std::endl;
+            rc = fail;
+        }
+        expected++;
+    }
+    if (expected != highKey) {
+        std::cerr << "***** The number of returned tuple is not correct. *****" << std::endl;
+        rc = fail;
+    }
+
+    delete is;
+    free(data);
+    return rc;
+}
+
+int createLeftSortedTable() {
+    vector<Attribute> attrs;
+    Attribute attr;
+    attr.name = "A";
+    attr.type = TypeInt;
+    attr.length = 4;
+    attrs.push_back(attr);
+
+    attr.name = "B";
+    attrs.push_back(attr);
+
+    attr.name = "C";
+    attr.type = TypeReal;
+    attrs.push_back(attr);
+
+    RC rc = rm.createTable("leftsorted", attrs);
+    if (rc != success) {
+        return rc;
+    }
+
+    void *buf = malloc(bufSize);
+    unsigned char nullsIndicator = 0;
+    RID rid;
+    for (int i = 0; i < numOfTuples && rc == success; i++) {
+        prepareLeftTuple(attrs.size(), &nullsIndicator, i, valueBOf(i), (float) i, buf);
+        rc = rm.insertTuple("leftsorted", buf, rid);
+    }
+    free(buf);
+    if (rc != success) {
+        return rc;
+    }
+    return rm.createIndex("leftsorted", "B");
+}
+
+int main() {
+    // Tables created: leftsorted
+    // Indexes created: leftsorted.B
+
+    rm.deleteTable("leftsorted");
+    if (createLeftSortedTable() != success) {
+        std::cerr << "***** createLeftSortedTable() failed." << std::endl;
+        std::cerr << "***** [FAIL] QE Test Case 18 failed. *****" << std::endl;
+        return fail;
+    }
+
+    RC rc = testCase_18();
+    rm.deleteTable("leftsorted");
+    if (rc != success) {
+        std::cerr << "***** [FAIL] QE Test Case 18 failed. *****" << std::endl;
+        return fail;
+    } else {
+        std::cerr << "***** QE Test Case 18 finished. The result will be examined. *****" << std::endl;
+        return success;
+    }
+}
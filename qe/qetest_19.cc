@@ -0,0 +1,127 @@
+#include "qe_test_util.h"
+
+const int numOfTuples = 5000;
+const int topN = 10;
+
+// B is a permutation of A, so the key order of B is not the order the tuples are stored in
+int valueBOf(int a) {
+    return (a * 7919) % numOfTuples;
+}
+
+RC testCase_19() {
+    // Optional for all
+    // 1. Reverse IndexScan -- the tuples come in descending order of the key, the first ones read the last leaves only
+    // SELECT * FROM leftdesc ORDER BY B DESC, SELECT max(B) FROM leftdesc, SELECT B FROM leftdesc ORDER BY B DESC LIMIT 10,
+    // SELECT * FROM leftdesc WHERE B >= 100 AND B < 130 ORDER BY B DESC
+    std::cerr << "***** In QE Test Case 19 *****" << std::endl;
+
+    RC rc = success;
+    auto *is = new IndexScan(rm, "leftdesc", "B", NULL, false, true);
+    void *data = malloc(bufSize);
+
+    // every tuple comes once, with its own values, B goes down
+    int expected = numOfTuples - 1;
+    while (rc == success && is->getNextTuple(data) != QE_EOF) {
+        int valueA = *(int *) ((char *) data + 1);
+        int valueB = *(int *) ((char *) data + 1 + sizeof(int));
+        if (valueB != expected || valueB != valueBOf(valueA)) {
+            std::cerr << "***** A returned value is not correct. *****" << std::endl;
+            rc = fail;
+        }
+        expected--;
+    }
+    if (expected != -1) {
+        std::cerr << "***** The number of returned tuple is not correct. *****" << std::endl;
+        rc = fail;
+    }
+
+    // a range, from its high end down
+    int lowKey = 100, highKey = 130;
+    is->setIterator(&lowKey, &highKey, true, false);
+    expected = highKey - 1;
+    while (rc == success && is->getNextTuple(data) != QE_EOF) {
+        int valueB = *(int *) ((char *) data + 1 + sizeof(int));
+        if (valueB != expected) {
+            std::cerr << "***** A returned value is not correct. *****" << std::endl;
+            rc = fail;
+        }
+        expected--;
+    }
+    if (expected != lowKey - 1) {
+        std::cerr << "***** The number of returned tuple is not correct. *****" << std::endl;
+        rc = fail;
+    }
+    delete is;
+
+    // MAX is the first tuple of an index-only reverse scan, the top N the first N tuples
+    auto *indexOnly = new IndexScan(rm, "leftdesc", "B", NULL, true, true);
+    for (int i = 0; rc == success && i < topN; i++) {
+        if (indexOnly->getNextTuple(data) != success || *(int *) ((char *) data + 1) != numOfTuples - 1 - i) {
+            std::cerr << "***** A returned value is not correct. *****" << std::endl;
+            rc = fail;
+        }
+        if (i == 0) {
+            std::cerr << "MAX(leftdesc.B) " << *(int *) ((char *) data + 1) << std::endl;
+        }
+    }
+    delete indexOnly;
+
+    free(data);
+    return rc;
+}
+
+int createLeftDescTable() {
+    vector<Attribute> attrs;
+    Attribute attr;
+    attr.name = "A";
+    attr.type = TypeInt;
+    attr.length = 4;
+    attrs.push_back(attr);
+
+    attr.name = "B";
+    attrs.push_back(attr);
+
+    attr.name = "C";
+    attr.type = TypeReal;
+    attrs.push_back(attr);
+
+    RC rc = rm.createTable("leftdesc", attrs);
+    if (rc != success) {
+        return rc;
+    }
+
+    void *buf = malloc(bufSize);
+    unsigned char nullsIndicator = 0;
+    RID rid;
+    for (int i = 0; i < numOfTuples && rc == success; i++) {
+        prepareLeftTuple(attrs.size(), &nullsIndicator, i, valueBOf(i), (float) i, buf);
+        rc = rm.insertTuple("leftdesc", buf, rid);
+    }
+    free(buf);
+    if (rc != success) {
+        return rc;
+    }
+    return rm.createIndex("leftdesc", "B");
+}
+
+int main() {
+    // Tables created: leftdesc
+    // Indexes created: leftdesc.B
+
+    rm.deleteTable("leftdesc");
+    if (createLeftDescTable() != success) {
+        std::cerr << "***** createLeftDescTable() failed." << std::endl;
+        std::cerr << "***** [FAIL] QE Test Case 19 failed. *****" << std::endl;
+        return fail;
+    }
+
+    RC rc = testCase_19();
+    rm.deleteTable("leftdesc");
+    if (rc != success) {
+        std::cerr << "***** [FAIL] QE Test Case 19 failed. *****" << std::endl;
+        return fail;
+    } else {
+        std::cerr << "***** QE Test Case 19 finished. The result will be examined. *****" << std::endl;
+        return success;
+    }
+}
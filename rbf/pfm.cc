@@ -1,9 +1,15 @@
+#include <unistd.h>
+#include <cstring>
 #include "pfm.h"
+#include "wal.h"
+
+static_assert(sizeof(LSN) == PAGE_LSN_SIZE, "the page header keeps one LSN");
 
 PagedFileManager *PagedFileManager::_pf_manager = nullptr;
 
+// function-local static, its initialization is thread-safe.
 PagedFileManager &PagedFileManager::instance() {
-    static PagedFileManager _pf_manager = PagedFileManager();
+    static PagedFileManager _pf_manager;
     return _pf_manager;
 }
 
@@ -11,9 +17,78 @@ PagedFileManager::PagedFileManager() = default;
 
 PagedFileManager::~PagedFileManager() { delete _pf_manager; }
 
-PagedFileManager::PagedFileManager(const PagedFileManager &) = default;
+void RWLatch::lockShared() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this](){ return !writer && numOfWaitingWriters == 0; });
+    numOfReaders++;
+}
+
+void RWLatch::unlockShared() {
+    std::lock_guard<std::mutex> lock(mutex);
+    numOfReaders--;
+    if(numOfReaders == 0){
+        cond.notify_all();
+    }
+}
+
+void RWLatch::lockExclusive() {
+    upgrade(0);
+}
+
+bool RWLatch::tryLockExclusive() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(writer || numOfReaders > 0 || numOfWaitingWriters > 0){
+        return false;
+    }
+    writer = true;
+    version.fetch_add(1);
+    return true;
+}
+
+void RWLatch::unlockExclusive() {
+    std::lock_guard<std::mutex> lock(mutex);
+    // the writer is done with the page, optimistic readers may read it again
+    version.fetch_add(1);
+    writer = false;
+    cond.notify_all();
+}
+
+unsigned long long RWLatch::readVersion() {
+    unsigned long long current = version.load();
+    while(current % 2 == 1){
+        // wait for the writer like a reader in shared mode
+        lockShared();
+        unlockShared();
+        current = version.load();
+    }
+    return current;
+}
 
-PagedFileManager &PagedFileManager::operator=(const PagedFileManager &) = default;
+bool RWLatch::validate(unsigned long long version) const {
+    // the reads before must not move after the version is read again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return this->version.load(std::memory_order_relaxed) == version;
+}
+
+bool RWLatch::upgrade(unsigned long long version) {
+    std::unique_lock<std::mutex> lock(mutex);
+    numOfWaitingWriters++;
+    cond.wait(lock, [this](){ return !writer && numOfReaders == 0; });
+    numOfWaitingWriters--;
+    writer = true;
+    // an odd version tells optimistic readers their copy may be torn
+    return this->version.fetch_add(1) == version;
+}
+
+RWLatch &PagedFileManager::getLatch(const std::string &fileName, PageNum pageNum) {
+    LatchTableShard &shard = _latchTable[pageNum % LATCH_TABLE_SHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::unique_ptr<RWLatch> &latch = shard.latches[std::make_pair(fileName, pageNum)];
+    if(!latch){
+        latch.reset(new RWLatch());
+    }
+    return *latch;
+}
 
 RC PagedFileManager::createFile(const std::string &fileName) {
     std::fstream f;
@@ -49,6 +124,19 @@ RC PagedFileManager::destroyFile(const std::string &fileName) {
     if(f){
         // if file exists, delete it.
         f.close();
+        // records of this file in the log must not be redone on a new file with the same name.
+        if(LogManager::instance().dropFile(fileName) != 0){
+            // std::cout << "[Error] Destroy a file failed to log it." << std::endl;
+            return -1;
+        }
+        {
+            // nobody uses the file any more, drop its latches.
+            for(LatchTableShard &shard : _latchTable){
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.latches.erase(shard.latches.lower_bound(std::make_pair(fileName, (PageNum)0)),
+                                    shard.latches.upper_bound(std::make_pair(fileName, (PageNum)UINT_MAX)));
+            }
+        }
         if(remove(fileName.c_str()) != 0 ){
             // std::cout << "[Error] Destroy a file failed. " << std::endl;
             return -1;
@@ -79,13 +167,14 @@ RC PagedFileManager::openFile(const std::string &fileName, FileHandle &fileHandl
     f.open(fileName, std::ios::in | std::ios::out | std::ios::binary);
     if(f.is_open())
     {
+        fileHandle.setFileName(fileName);
         f.seekg(0, std::ios::end);
         if(f.tellg() == 0){
 //            if the file is the first time to open, initialize the counter page.
             fileHandle.initializeCounterValues();
         }
 //        locate to the start of the page
-        f.seekg(PAGE_SIZE, std::ios::beg);
+        f.seekg(PAGE_FRAME_SIZE, std::ios::beg);
         fileHandle.loadCounterValues();
         // std::cout << "[Success] Open a file" << std::endl;
         return 0;
@@ -118,24 +207,32 @@ FileHandle::FileHandle() {
 FileHandle::~FileHandle()= default;
 
 RC FileHandle::appendPage(const void *data){
+    PageNum pageNum;
+    return appendPage(data, pageNum);
+}
+
+RC FileHandle::appendPage(const void *data, PageNum &pageNum){
+    std::lock_guard<std::recursive_mutex> lock(_fileMutex);
+    // other FileHandles on this file may append at the same time, only one of them gets the end of the file.
+    ExclusiveLatchGuard appendGuard(getLatch(APPEND_LATCH));
     unsigned int pageNumber = getNumberOfPages() + 1;
-    if(_file.seekp(pageNumber*PAGE_SIZE, std::ios::beg))
+    // the change is logged before the page reaches the file, a checkpoint waits until both are done.
+    SharedLatchGuard pageWriteGuard(LogManager::instance().getPageWriteLatch());
+    LSN pageLSN;
+    if(LogManager::instance().logPageWrite(*this, pageNumber - 1, data, true, pageLSN) != 0){
+        // std::cout << "[Error] appendPage() fail to log the new page." << std::endl;
+        return -1;
+    }
+    if(writeFrame(pageNumber - 1, data, pageLSN) == 0)
     {
-        // if tellg -> 4096, then write start from 4097.
-        _file.write(static_cast<const char *>(data), PAGE_SIZE);
-        if(_file.good()){
-            loadCounterValues();
-            appendPageCounter++;
-            saveCounterValues();
-            return 0;
-        }
-        else{
-            // std::cout << "[Error] appendPage() write a new page failed." << std::endl;
-            return -1;
-        }
+        pageNum = pageNumber - 1;
+        loadCounterValues();
+        appendPageCounter++;
+        saveCounterValues();
+        return 0;
     }
     else{
-        // std::cout << "[Error] appendPage() seek method failed." << std::endl;
+        // std::cout << "[Error] appendPage() write a new page failed." << std::endl;
         return -1;
     }
 
@@ -143,6 +240,7 @@ RC FileHandle::appendPage(const void *data){
 
 RC FileHandle::readPage(PageNum pageNum, void *data)
 {
+    std::lock_guard<std::recursive_mutex> lock(_fileMutex);
 //    getNUmberOfPages() already consider the hidden page (minus 1 to get the value), so we just pageNum+1 instead of +2
     if(pageNum+1 > getNumberOfPages())
     {
@@ -151,23 +249,15 @@ RC FileHandle::readPage(PageNum pageNum, void *data)
     }
     else
     {
-//        pageNum+1 -> the first page is the hidden page
-        if(_file.seekg((pageNum+1)*PAGE_SIZE, std::ios::beg))
-        {
-            _file.read(static_cast<char *>(data), PAGE_SIZE);
-            if(_file.good()){
-                loadCounterValues();
-                readPageCounter++;
-                saveCounterValues();
-                return 0;
-            }
-            else{
-                // std::cout << "[Error] readPage() read a new page failed." << std::endl;
-                return -1;
-            }
+        LSN pageLSN;
+        if(readFrame(pageNum, data, pageLSN) == 0){
+            loadCounterValues();
+            readPageCounter++;
+            saveCounterValues();
+            return 0;
         }
         else{
-            // std::cout << "[Error] readPage() seek method failed." << std::endl;
+            // std::cout << "[Error] readPage() read a new page failed." << std::endl;
             return -1;
         }
 
@@ -176,6 +266,7 @@ RC FileHandle::readPage(PageNum pageNum, void *data)
 
 RC FileHandle::writePage(PageNum pageNum, const void *data)
 {
+    std::lock_guard<std::recursive_mutex> lock(_fileMutex);
 //    getNUmberOfPages() already consider the hidden page (minus 1 to get the value), so we just pageNUm+1 instead of +2
     if(pageNum+1 > getNumberOfPages())
     {
@@ -184,23 +275,21 @@ RC FileHandle::writePage(PageNum pageNum, const void *data)
     }
     else
     {
-//        pageNum+1 -> the first page is the hidden page
-        if(_file.seekp((pageNum+1)*PAGE_SIZE, std::ios::beg))
-        {
-            _file.write((char*)(data), PAGE_SIZE);
-            if(_file.good()){
-                loadCounterValues();
-                writePageCounter++;
-                saveCounterValues();
-                return 0;
-            }
-            else{
-                 // std::cout << "[Error] writePage() write a new page failed." << std::endl;
-                return -1;
-            }
+        // the change is logged before the page reaches the file, a checkpoint waits until both are done.
+        SharedLatchGuard pageWriteGuard(LogManager::instance().getPageWriteLatch());
+        LSN pageLSN;
+        if(LogManager::instance().logPageWrite(*this, pageNum, data, false, pageLSN) != 0){
+            // std::cout << "[Error] writePage() fail to log the page." << std::endl;
+            return -1;
+        }
+        if(writeFrame(pageNum, data, pageLSN) == 0){
+            loadCounterValues();
+            writePageCounter++;
+            saveCounterValues();
+            return 0;
         }
         else{
-            // std::cout << "[Error] writePage() seek method failed." << std::endl;
+             // std::cout << "[Error] writePage() write a new page failed." << std::endl;
             return -1;
         }
     }
@@ -208,15 +297,35 @@ RC FileHandle::writePage(PageNum pageNum, const void *data)
 
 unsigned FileHandle::getNumberOfPages() {
     // This method returns the total number of pages currently in the file.
+    std::lock_guard<std::recursive_mutex> lock(_fileMutex);
 
     _file.seekg(0, std::ios::end);
 //    the first page is hidden page, so that -1
-    return unsigned(ceil(_file.tellg() / (double) PAGE_SIZE)-1);
+    return unsigned(ceil(_file.tellg() / (double) PAGE_FRAME_SIZE)-1);
 
 }
 
+RC FileHandle::truncateFile(unsigned numOfPages) {
+    std::lock_guard<std::recursive_mutex> lock(_fileMutex);
+    ExclusiveLatchGuard appendGuard(getLatch(APPEND_LATCH));
+    if(numOfPages > getNumberOfPages()){
+        // std::cout << "[Error] truncateFile() the file has fewer pages." << std::endl;
+        return -1;
+    }
+    // the hidden page stays.
+    if(truncate(_fileName.c_str(), (off_t)(numOfPages + 1) * PAGE_FRAME_SIZE) != 0){
+        // std::cout << "[Error] truncateFile() truncate failed." << std::endl;
+        return -1;
+    }
+    _file.clear();
+    _file.seekg(0, std::ios::beg);
+    _file.seekp(0, std::ios::beg);
+    return 0;
+}
+
 RC FileHandle::collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount) {
 //    load the counter from the file;
+    std::lock_guard<std::recursive_mutex> lock(_fileMutex);
     RC rc;
     rc = loadCounterValues();
     if(rc == 0){
@@ -284,4 +393,65 @@ RC FileHandle::initializeCounterValues()
 
 std::fstream& FileHandle::getFile() {
     return _file;
-}
\ No newline at end of file
+}
+
+RC FileHandle::setFileName(const std::string &fileName) {
+    _fileName = fileName;
+    return 0;
+}
+
+const std::string &FileHandle::getFileName() const {
+    return _fileName;
+}
+
+RWLatch &FileHandle::getLatch(PageNum pageNum) {
+    return PagedFileManager::instance().getLatch(_fileName, pageNum);
+}
+
+RC FileHandle::readPageWithLSN(PageNum pageNum, void *data, LSN &pageLSN) {
+    std::lock_guard<std::recursive_mutex> lock(_fileMutex);
+    if(pageNum+1 > getNumberOfPages()){
+        // std::cout << "[Error] pageNum exceed total number of pages on readPageWithLSN()" << std::endl;
+        return -1;
+    }
+    return readFrame(pageNum, data, pageLSN);
+}
+
+RC FileHandle::writePageWithLSN(PageNum pageNum, const void *data, LSN pageLSN) {
+    std::lock_guard<std::recursive_mutex> lock(_fileMutex);
+    return writeFrame(pageNum, data, pageLSN);
+}
+
+RC FileHandle::readFrame(PageNum pageNum, void *data, LSN &pageLSN) {
+    char frame[PAGE_FRAME_SIZE];
+//    pageNum+1 -> the first frame is the hidden page
+    if(!_file.seekg((pageNum+1)*PAGE_FRAME_SIZE, std::ios::beg)){
+        // std::cout << "[Error] readFrame() seek method failed." << std::endl;
+        return -1;
+    }
+    _file.read(frame, PAGE_FRAME_SIZE);
+    if(!_file.good()){
+        // std::cout << "[Error] readFrame() read a frame failed." << std::endl;
+        return -1;
+    }
+    memcpy(&pageLSN, frame, PAGE_LSN_SIZE);
+    memcpy(data, frame + PAGE_LSN_SIZE, PAGE_SIZE);
+    return 0;
+}
+
+RC FileHandle::writeFrame(PageNum pageNum, const void *data, LSN pageLSN) {
+    // the frame header keeps the page LSN, the page follows it.
+    char frame[PAGE_FRAME_SIZE];
+    memcpy(frame, &pageLSN, PAGE_LSN_SIZE);
+    memcpy(frame + PAGE_LSN_SIZE, data, PAGE_SIZE);
+    if(!_file.seekp((pageNum+1)*PAGE_FRAME_SIZE, std::ios::beg)){
+        // std::cout << "[Error] writeFrame() seek method failed." << std::endl;
+        return -1;
+    }
+    _file.write(frame, PAGE_FRAME_SIZE);
+    if(!_file.good()){
+        // std::cout << "[Error] writeFrame() write a frame failed." << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -4,8 +4,18 @@
 typedef unsigned PageNum;
 typedef int RC;
 typedef unsigned char byte;
+typedef unsigned long long LSN;         // log sequence number, see wal.h
 
-#define PAGE_SIZE 4096
+// On disk every page takes PAGE_FRAME_SIZE bytes, aligned on them: a header with the LSN of the last log record applied
+// to the page, then the PAGE_SIZE bytes the layouts of rbfm / ix use. The header is only seen by FileHandle and recovery,
+// readPage/writePage move PAGE_SIZE bytes.
+#define PAGE_FRAME_SIZE 4096
+#define PAGE_LSN_SIZE 8                                 // sizeof(LSN)
+#define PAGE_SIZE (PAGE_FRAME_SIZE - PAGE_LSN_SIZE)
+
+// latch which is not bound to one page, see PagedFileManager::getLatch(...)
+#define APPEND_LATCH (UINT_MAX - 1)     // serializes appendPage(...) of all the FileHandles on one file
+#define LATCH_TABLE_SHARDS 64
 
 #include <string>
 #include <climits>
@@ -13,9 +23,75 @@ typedef unsigned char byte;
 #include <fstream>
 #include <math.h>
 #include <string.h>
+#include <map>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 
 class FileHandle;
 
+/*
+ * Reader-writer latch: any number of readers in shared mode or one writer in exclusive mode.
+ * A waiting writer blocks new readers so writers are not starved. It is not re-entrant.
+ *
+ * It also has a version for optimistic readers, which don't latch at all: readVersion() waits until no writer holds
+ * the latch and returns the version, validate(version) tells whether no writer has latched it since, so what was read
+ * in between is consistent. upgrade(version) latches in exclusive mode and tells whether the latch is still at version.
+ */
+class RWLatch {
+public:
+    void lockShared();
+    void unlockShared();
+    void lockExclusive();
+    void unlockExclusive();
+    bool tryLockExclusive();                            // latch in exclusive mode only if nobody holds or waits for it
+
+    unsigned long long readVersion();
+    bool validate(unsigned long long version) const;
+    bool upgrade(unsigned long long version);
+
+private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    int numOfReaders = 0;
+    int numOfWaitingWriters = 0;
+    bool writer = false;
+    std::atomic<unsigned long long> version{0};         // odd while a writer holds the latch
+};
+
+// hold a latch in shared / exclusive mode until the end of the scope
+class SharedLatchGuard {
+public:
+    explicit SharedLatchGuard(RWLatch &latch) : latch(latch) { latch.lockShared(); }
+    ~SharedLatchGuard() { latch.unlockShared(); }
+private:
+    RWLatch &latch;
+};
+
+class ExclusiveLatchGuard {
+public:
+    explicit ExclusiveLatchGuard(RWLatch &latch) : latch(latch) { latch.lockExclusive(); }
+    ~ExclusiveLatchGuard() { latch.unlockExclusive(); }
+private:
+    RWLatch &latch;
+};
+
+// exclusive latches taken one after the other by one operation, all of them held until the end of the scope
+class ExclusiveLatchSet {
+public:
+    ExclusiveLatchSet() = default;
+    ~ExclusiveLatchSet() { for(RWLatch *latch : latches) latch->unlockExclusive(); }
+    void lock(RWLatch &latch) { latch.lockExclusive(); latches.push_back(&latch); }
+    bool tryLock(RWLatch &latch) { if(!latch.tryLockExclusive()) return false; latches.push_back(&latch); return true; }
+    void unlockLast() { latches.back()->unlockExclusive(); latches.pop_back(); }
+private:
+    ExclusiveLatchSet(const ExclusiveLatchSet &);
+    ExclusiveLatchSet &operator=(const ExclusiveLatchSet &);
+    std::vector<RWLatch *> latches;
+};
+
 class PagedFileManager {
 public:
     static PagedFileManager &instance();                                // Access to the _pf_manager instance
@@ -25,6 +101,14 @@ public:
     RC openFile(const std::string &fileName, FileHandle &fileHandle);   // Open a file
     RC closeFile(FileHandle &fileHandle);                               // Close a file
 
+    /*
+     * Latch of one page of a file, shared by all the FileHandles opened on this file, so it also works across threads
+     * which open their own FileHandle. pageNum is the page number used by FileHandle::readPage(...),
+     * APPEND_LATCH is a latch on the whole file.
+     * Latches are created on first use and dropped when the file is destroyed.
+     */
+    RWLatch &getLatch(const std::string &fileName, PageNum pageNum);
+
 protected:
     PagedFileManager();                                                 // Prevent construction
     ~PagedFileManager();                                                // Prevent unwanted destruction
@@ -33,6 +117,13 @@ protected:
 
 private:
     static PagedFileManager *_pf_manager;
+
+    // the latch table is split by page number so threads reading different pages don't wait for one mutex
+    struct LatchTableShard {
+        std::mutex mutex;
+        std::map<std::pair<std::string, PageNum>, std::unique_ptr<RWLatch>> latches;
+    };
+    LatchTableShard _latchTable[LATCH_TABLE_SHARDS];
 };
 
 class FileHandle {
@@ -46,20 +137,43 @@ public:
     FileHandle(const FileHandle &fileHandle);
     ~FileHandle();                                                      // Destructor
 
+    // A FileHandle can be shared by several threads, each call holds _fileMutex since they share one stream.
+    // A page is written to the file as a whole frame in one call, too big to stay in the stream buffer, so it reaches the file at once and
+    // FileHandles opened on the same file by other threads see it. Pages are not flushed one by one, the log makes them durable.
+    // When the calling thread runs a transaction, writePage/appendPage log the change before the page is written (see wal.h).
     RC readPage(PageNum pageNum, void *data);                           // Get a specific page
     RC writePage(PageNum pageNum, const void *data);                    // Write a specific page
     RC appendPage(const void *data);                                    // Append a specific page
+    RC appendPage(const void *data, PageNum &pageNum);                  // Append a specific page, pageNum gets its page number
     unsigned getNumberOfPages();                                        // Get the number of pages in the file
+    RC truncateFile(unsigned numOfPages);                               // Drop the pages from numOfPages on, not logged
     RC collectCounterValues(unsigned &readPageCount, unsigned &writePageCount,
                             unsigned &appendPageCount);                 // Put current counter values into variables
     RC saveCounterValues();
     RC loadCounterValues();
     RC initializeCounterValues();
     std::fstream& getFile();
+
+    RC setFileName(const std::string &fileName);
+    const std::string &getFileName() const;
+    RWLatch &getLatch(PageNum pageNum);                                 // PagedFileManager::getLatch(...) of this file
+
+    /*
+     * Read / write a page together with its page LSN, used by the log manager and recovery.
+     * Counters are not changed and nothing is logged. writePageWithLSN(...) may write past the end of the file,
+     * the pages in between are filled with zeros.
+     */
+    RC readPageWithLSN(PageNum pageNum, void *data, LSN &pageLSN);
+    RC writePageWithLSN(PageNum pageNum, const void *data, LSN pageLSN);
 private:
+    RC readFrame(PageNum pageNum, void *data, LSN &pageLSN);             // the header and the page, in one read of the frame
+    RC writeFrame(PageNum pageNum, const void *data, LSN pageLSN);      // the same in one write
+
     // can do both read&write manipulations.
     //std::unique_ptr<std::fstream> _file;
     std::fstream _file;
+    std::string _fileName;
+    std::recursive_mutex _fileMutex;
 };
 
 #endif
\ No newline at end of file
@@ -1,9 +1,11 @@
 #include "rbfm.h"
+#include "wal.h"
 
 RBFM_ScanIterator::RBFM_ScanIterator(){
     maxAttrLength = 0;
     maxRecordLength = 0;
     curNumOfSlotsInPage = 0;
+    curVersion = 0;
 }
 
 RC RBFM_ScanIterator::initiateRBFMScanIterator(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
@@ -16,6 +18,7 @@ RC RBFM_ScanIterator::initiateRBFMScanIterator(FileHandle &fileHandle, const std
     this->recordDescriptor = recordDescriptor;
     this->conditionAttribute = conditionAttribute;
     this->attributeNames = attributeNames;
+    this->versionDescriptors.clear();
     // clear the Attr vector
     this->attrVector.clear();
     std::vector<Attribute>().swap(this->attrVector);    // clear the memory
@@ -56,7 +59,10 @@ RC RBFM_ScanIterator::initiateRBFMScanIterator(FileHandle &fileHandle, const std
 
     // 5. initiate curNumOfSlotsInPage
     void *page = malloc(PAGE_SIZE);
-    fileHandlePtr->readPage(curRID.pageNum, page);
+    {
+        SharedLatchGuard guard(fileHandlePtr->getLatch(curRID.pageNum));
+        fileHandlePtr->readPage(curRID.pageNum, page);
+    }
     auto *pageDirPtr = (PageDirectory *)((char *)page + PAGE_SIZE - sizeof(PageDirectory));
     curNumOfSlotsInPage = pageDirPtr->numberofslot;
 
@@ -95,12 +101,41 @@ RC RBFM_ScanIterator::generateAttributesDescriptor(){
     return 0;
 }
 
+RC RBFM_ScanIterator::setVersionDescriptors(const std::vector<std::vector<Attribute>> &versionDescriptors){
+    this->versionDescriptors = versionDescriptors;
+    return 0;
+}
+
+RC RBFM_ScanIterator::setPageRange(unsigned startPage, unsigned endPage){
+    if(startPage > endPage){
+        // std::cout << "[Error]: setPageRange -> startPage is larger than endPage." << std::endl;
+        return -1;
+    }
+    numOfPages = std::min(numOfPages, endPage);
+    curRID.pageNum = startPage;
+    curRID.slotNum = -1;
+    if(startPage >= numOfPages){
+        // nothing to scan, the first getNextRID() meets the end of file.
+        curNumOfSlotsInPage = 0;
+        return 0;
+    }
+    return updateNumOfSlots();
+}
+
+const std::vector<Attribute> &RBFM_ScanIterator::getDescriptorForVersion(char16_t version){
+    // the schema never changed, all records use the current descriptor
+    if(versionDescriptors.size() <= 1 || version >= versionDescriptors.size()){
+        return recordDescriptor;
+    }
+    return versionDescriptors[version];
+}
+
 RC RBFM_ScanIterator::getNextRecord(RID &rid, void *data) {
 
     RC rc = getNextRID(rid);
     if(rc == 0){
         RecordBasedFileManager &rbfm = RecordBasedFileManager::instance();
-        rbfm.readAttributes(*fileHandlePtr, recordDescriptor, rid, attributeNames, data);
+        rbfm.readAttributes(*fileHandlePtr, getDescriptorForVersion(curVersion), rid, attributeNames, data);
 //        rbfm.printRecord(attrVector, data);
         return 0;
     }
@@ -120,7 +155,7 @@ RC RBFM_ScanIterator::getNextRecord(RID &rid, void *data) {
 RC RBFM_ScanIterator::getNextRID(RID &rid){
 
     RecordBasedFileManager &rbfm = RecordBasedFileManager::instance();
-    void *attribute = malloc(maxAttrLength);
+    void *attribute = malloc(PAGE_SIZE);
     RC rc;
     while(true) {
         // original curRID.slotNum = -1 -> first update
@@ -137,7 +172,8 @@ RC RBFM_ScanIterator::getNextRID(RID &rid){
         }
         else{
             // check whether the flag is record flag, in order to prevent redundant record print.
-            rc = rbfm.checkRecordFlag(*fileHandlePtr, curRID);
+            // the version stamp is taken from the page checkRecordFlag has already read.
+            rc = rbfm.checkRecordFlag(*fileHandlePtr, curRID, curVersion);
             if(rc != 0){
                 continue;
             }
@@ -150,7 +186,20 @@ RC RBFM_ScanIterator::getNextRID(RID &rid){
                     return 0;
                 }
 
-                rc = rbfm.readAttribute(*fileHandlePtr, recordDescriptor, curRID, conditionAttribute, attribute);
+                const std::vector<Attribute> &descriptor = getDescriptorForVersion(curVersion);
+                bool inDescriptor = false;
+                for(auto &attr : descriptor){
+                    if(attr.name == conditionAttribute){
+                        inDescriptor = true;
+                        break;
+                    }
+                }
+                if(!inDescriptor){
+                    // the condition attribute was added after this record was written, it's null and never qualifies.
+                    continue;
+                }
+
+                rc = rbfm.readAttribute(*fileHandlePtr, descriptor, curRID, conditionAttribute, attribute);
                 if(rc == -1){
                     free(attribute);
                     // std::cout << "[Error] : getNextRID -> readAttribute error." << std::endl;
@@ -162,7 +211,7 @@ RC RBFM_ScanIterator::getNextRID(RID &rid){
 //                std::cout << "[Warning] : getNextRID -> scan deleted record." << std::endl;
                 }
                 else if(rc == 0){
-                    int nullSize = ceil((double)recordDescriptor.size()/CHAR_BIT);
+                    int nullSize = ceil((double)descriptor.size()/CHAR_BIT);
                     if(doOp(nullSize, attribute)>0){
                         rid.pageNum = curRID.pageNum;
                         rid.slotNum = curRID.slotNum;
@@ -339,6 +388,7 @@ RC RBFM_ScanIterator::doOp(int nullSize, void *attribute){
 
 RC RBFM_ScanIterator::updateNumOfSlots(){
 
+    SharedLatchGuard guard(fileHandlePtr->getLatch(curRID.pageNum));
     void *page = malloc(PAGE_SIZE);
     if(fileHandlePtr->readPage(curRID.pageNum, page) == 0){
         auto *pageDirPtr = (PageDirectory *)((char *)page + PAGE_SIZE - sizeof(PageDirectory));
@@ -360,7 +410,7 @@ RC RBFM_ScanIterator::close() {
 RecordBasedFileManager *RecordBasedFileManager::_rbf_manager = nullptr;
 
 RecordBasedFileManager &RecordBasedFileManager::instance() {
-    static RecordBasedFileManager _rbf_manager = RecordBasedFileManager();
+    static RecordBasedFileManager _rbf_manager;
     return _rbf_manager;
 }
 
@@ -441,6 +491,10 @@ RC RecordBasedFileManager::getTotalLenAndLenAheadOfVariableField(const std::vect
     offset += flagLen;
     lengthBeforeVariableData += flagLen;
 
+    // +2 -> schema version of the record
+    offset += versionLen;
+    lengthBeforeVariableData += versionLen;
+
     memcpy((char *)info, &offset, 4);
     memcpy((char *)info+4, &lengthBeforeVariableData, 4);
     // recordLength = offset + 2 -> 2 (store number of fields)
@@ -448,7 +502,7 @@ RC RecordBasedFileManager::getTotalLenAndLenAheadOfVariableField(const std::vect
 }
 
 RC RecordBasedFileManager::formatRecord(const std::vector<Attribute> &recordDescriptor, const void *data, void *info, void *record,
-                                        char16_t fieldLength, int nullFieldsIndicatorActualSize, unsigned char *nullsIndicator){
+                                        char16_t fieldLength, int nullFieldsIndicatorActualSize, unsigned char *nullsIndicator, char16_t version){
 
     // char16_t recordLength = ((int *)info)[0];
     int offsetRecord = 0;
@@ -459,17 +513,21 @@ RC RecordBasedFileManager::formatRecord(const std::vector<Attribute> &recordDesc
     memset((char *)record, recordFlag, 1);
     offsetRecord += flagLen;
 
-    // 2. insert num of field
+    // 2. insert schema version
+    memcpy((char *)record+offsetRecord, &version, versionLen);
+    offsetRecord += versionLen;
+
+    // 3. insert num of field
     memcpy((char *)record+offsetRecord, &fieldLength, 2);
     offsetRecord += fieldSizeLen;      // First 2 byte to store the field number
 
 
-    // 3. insert nullIndicator
+    // 4. insert nullIndicator
     memcpy((char *) record+offsetRecord, (char *)data+offsetData, nullFieldsIndicatorActualSize);
     offsetData += nullFieldsIndicatorActualSize;
     offsetRecord += nullFieldsIndicatorActualSize;      // store nullIndicator
 
-    // 4. insert attributes
+    // 5. insert attributes
     int nullByteIndex, bitIndex, fieldIndex;
 
     int varCharLen;
@@ -519,13 +577,24 @@ RC RecordBasedFileManager::formatRecord(const std::vector<Attribute> &recordDesc
 }
 
 RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
-                                        const void *data, RID &rid) {
+                                        const void *data, RID &rid, char16_t version) {
+    ExclusiveLatchSet latches;
+    if(insertRecordWithoutLog(fileHandle, recordDescriptor, data, rid, version, latches) != 0){
+        return -1;
+    }
+    // logged while the page is still latched, undone by deleting the record.
+    return LogManager::instance().logRecordOperation(OP_RECORD_INSERT, fileHandle, rid);
+}
+
+RC RecordBasedFileManager::insertRecordWithoutLog(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
+                                                  const void *data, RID &rid, char16_t version, ExclusiveLatchSet &latches) {
 
     /*
       * Record format:
       * We follow the inline of fixed-size field displayed in the class.
       *
-      * 1. the first 2 byte is to store the number of field of record.
+      * 0. the first byte is the flag, the next 2 bytes store the schema version of the record.
+      * 1. the next 2 byte is to store the number of field of record.
       * 2. then according to the length of the record, we get the number of bytes to represent the null indicator.
       * 3. according to the type of the field, we store the data to record differently:
       *      1. for integer and float data type, we use 4 bytes and store in-line
@@ -558,11 +627,22 @@ RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const std::vecto
 //    std::cout << "insertRecord() " << "this record length is " << recordLength << std::endl;
 
     // 2. We format data to record format and insert it, and we need to make sure that the recordLength >= 9 bytes (pointer).
-    formatRecord(recordDescriptor, data, LenAndValidField, record, fieldLength, nullFieldsIndicatorActualSize, nullsIndicator);     // convert the data to record with the format stated above.
+    formatRecord(recordDescriptor, data, LenAndValidField, record, fieldLength, nullFieldsIndicatorActualSize, nullsIndicator, version);     // convert the data to record with the format stated above.
 
-    // 3. First, we find an available page to insert this record
+    // 3. insert the formatted record
+    RC rc = insertFormattedRecord(fileHandle, record, recordLength, rid, latches);
+    free(record);
+    free(LenAndValidField);
+    free(nullsIndicator);
+    return rc;
+
+}
+
+RC RecordBasedFileManager::insertFormattedRecord(FileHandle &fileHandle, const void *record, char16_t recordLength, RID &rid,
+                                                 ExclusiveLatchSet &latches) {
+    // First, we find an available page to insert this record, it is latched until the caller is done.
     void *page = malloc(PAGE_SIZE);
-    RC rc = findAvailablePage(fileHandle, recordLength, rid, page);
+    RC rc = findAvailablePage(fileHandle, recordLength, rid, page, latches);
 
     if(rc == 0){
         // update page information
@@ -587,16 +667,10 @@ RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const std::vecto
 
         if(fileHandle.writePage(rid.pageNum, page) == 0){
             // success
-            free(record);
-            free(LenAndValidField);
-            free(nullsIndicator);
             free(page);
         }
         else{
 //            std::cout << "[Error] Fail to write when inserting the record." << std::endl;
-            free(record);
-            free(LenAndValidField);
-            free(nullsIndicator);
             free(page);
             return -1;
         }
@@ -624,16 +698,10 @@ RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const std::vecto
 
         if(fileHandle.writePage(rid.pageNum, page) == 0){
             // success
-            free(record);
-            free(LenAndValidField);
-            free(nullsIndicator);
             free(page);
         }
         else{
 //            std::cout << "[Error] Fail to write when inserting the record." << std::endl;
-            free(record);
-            free(LenAndValidField);
-            free(nullsIndicator);
             free(page);
             return -1;
         }
@@ -641,9 +709,6 @@ RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const std::vecto
     }
     else{
         // std::cout << "[Error] There is no available page to insert the record." << std::endl;
-        free(record);
-        free(LenAndValidField);
-        free(nullsIndicator);
         free(page);
         return -1;
     }
@@ -663,6 +728,7 @@ RC RecordBasedFileManager::deFormatRecord(const std::vector<Attribute> &recordDe
     char flag;
     memcpy(&flag, (char *)record, 1);
     offsetRecord += flagLen;
+    offsetRecord += versionLen;
 
     // 2. get num of field
     char16_t fieldLength;
@@ -746,7 +812,7 @@ RC RecordBasedFileManager::readRecord(FileHandle &fileHandle, const std::vector<
  *          0 -> get the record
  */
 RC RecordBasedFileManager::getRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
-                                      const RID &rid, void *record) {
+                                      const RID &rid, void *record, char16_t *recordLength) {
 
     char *page = (char *)malloc(PAGE_SIZE);
     char* slot;
@@ -755,7 +821,13 @@ RC RecordBasedFileManager::getRecord(FileHandle &fileHandle, const std::vector<A
     RID tempRid = rid;
 
     while(flag == ptrFlag){
-        if(fileHandle.readPage(tempRid.pageNum, page) == 0){
+        RC rc;
+        {
+            // only the page being read is latched, a tombstone is followed after its page is released.
+            SharedLatchGuard guard(fileHandle.getLatch(tempRid.pageNum));
+            rc = fileHandle.readPage(tempRid.pageNum, page);
+        }
+        if(rc == 0){
             // success
             slot = page + PAGE_SIZE - sizeof(PageDirectory) - (tempRid.slotNum + 1) * sizeof(SlotDirectory);
             thisSlot = (SlotDirectory*)slot;
@@ -776,6 +848,9 @@ RC RecordBasedFileManager::getRecord(FileHandle &fileHandle, const std::vector<A
             if(flag == recordFlag){
 //                std::cout << "get record" << std::endl;
                 memcpy((char *)record, page + thisSlot->offset, thisSlot->length);
+                if(recordLength != nullptr){
+                    *recordLength = thisSlot->length;
+                }
                 free(page);
                 return 0;
             }
@@ -816,6 +891,8 @@ RC RecordBasedFileManager::getRecord(FileHandle &fileHandle, const std::vector<A
 RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
                                         const RID &rid) {
     // find record and set the recordLength to 0, and then shift all the remaining records forward to update freespace.
+    // Only one page is latched at a time, the page of the record itself stays latched until the delete is logged.
+    ExclusiveLatchSet latches;
 
     void* dpage = malloc(PAGE_SIZE);
 
@@ -825,6 +902,7 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const std::vecto
 
     // we first assign it to tombstone and check
     while(flag == ptrFlag){
+        latches.lock(fileHandle.getLatch(temp_rid.pageNum));
         if(fileHandle.readPage(temp_rid.pageNum, dpage) == 0){
 
             // std::cout << "Prepare to delete: " << temp_rid.pageNum << " , " << temp_rid.slotNum << std::endl;
@@ -924,6 +1002,8 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const std::vecto
                     free(dpage);
                     return -1;
                 }
+                // the tombstone is gone, release its page before latching the one the record moved to.
+                latches.unlockLast();
 
                 // so we continue to search and delete
                 // continue;
@@ -944,7 +1024,7 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const std::vecto
 
 //    std::cout<< "[Success] Delete Record completed." << std::endl;
     free(dpage);
-    return 0;
+    return LogManager::instance().logRecordOperation(OP_RECORD_DELETE, fileHandle, rid);
 
 }
 
@@ -1092,7 +1172,7 @@ RC RecordBasedFileManager::printRecord(const std::vector<Attribute> &recordDescr
 }
 
 RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
-                                        const void *data, const RID &rid) {
+                                        const void *data, const RID &rid, char16_t version) {
     // Given a record descriptor, update the record identified by the given rid with the passed data.
 
     char16_t fieldLength = recordDescriptor.size();
@@ -1117,9 +1197,35 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const std::vecto
     }
 
     // 2. We format data to record format and update it, and we need to make sure that the recordLength >= 9 bytes (pointer).
-    formatRecord(recordDescriptor, data, LenAndValidField, record, fieldLength, nullFieldsIndicatorActualSize, nullsIndicator);     // convert the data to record with the format stated above.
+    formatRecord(recordDescriptor, data, LenAndValidField, record, fieldLength, nullFieldsIndicatorActualSize, nullsIndicator, version);     // convert the data to record with the format stated above.
+
+    // 3. update with the formatted record
+    std::string oldRecord;
+    ExclusiveLatchSet latches;
+    RC rc = updateFormattedRecord(fileHandle, record, recordLength, rid, oldRecord, latches);
+    free(nullsIndicator);
+    free(LenAndValidField);
+    free(record);
+    if (rc != 0) {
+        return -1;
+    }
+    // logged while the pages are still latched, undone by writing the old record back.
+    return LogManager::instance().logRecordOperation(OP_RECORD_UPDATE, fileHandle, rid, oldRecord.c_str(), oldRecord.size());
 
-    // 4. we find this record and deal with it.
+}
+
+RC RecordBasedFileManager::restoreRecord(FileHandle &fileHandle, const RID &rid, const void *record, unsigned recordLength) {
+    std::string oldRecord;
+    ExclusiveLatchSet latches;
+    if (updateFormattedRecord(fileHandle, record, recordLength, rid, oldRecord, latches) != 0) {
+        return -1;
+    }
+    return LogManager::instance().logRecordOperation(OP_RECORD_UPDATE, fileHandle, rid, oldRecord.c_str(), oldRecord.size());
+}
+
+RC RecordBasedFileManager::updateFormattedRecord(FileHandle &fileHandle, const void *record, char16_t recordLength, const RID &rid,
+                                                 std::string &oldRecord, ExclusiveLatchSet &latches) {
+    // we find this record and deal with it.
     void *page = malloc(PAGE_SIZE);
 
     // we need to judge whether this record is a tombstone or not:
@@ -1128,6 +1234,7 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const std::vecto
 
     // we first assign it to ptrFlag and check
     while (flag == ptrFlag) {
+        latches.lock(fileHandle.getLatch(temp_rid.pageNum));
         if (fileHandle.readPage(temp_rid.pageNum, page) == 0) {
             // check whether this record is a tombstone
             char *_pSlot =
@@ -1140,9 +1247,6 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const std::vecto
                 // this record has been deleted.
                 // std::cout << "[Error] This record has already been deleted when we want to update a record." << std::endl;
 
-                free(nullsIndicator);
-                free(LenAndValidField);
-                free(record);
                 free(page);
 
                 return -1;
@@ -1161,22 +1265,16 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const std::vecto
                 temp_rid.pageNum = newRID->pageNum;
                 temp_rid.slotNum = newRID->slotNum;
 
-                // clear buffer
-                free(thisTombStone);
+                // clear buffer, the tombstone is left as it is so its page is released.
                 memset(page, 0, PAGE_SIZE);
+                latches.unlockLast();
             } else {
                 // std::cout << "[Error] updateRecord() wrong format record. No flag byte set. " << std::endl;
-                free(nullsIndicator);
-                free(LenAndValidField);
-                free(record);
                 free(page);
                 return -1;
             }
         } else {
             // std::cout << "[Error] Fail to update when reading the record." << std::endl;
-            free(nullsIndicator);
-            free(LenAndValidField);
-            free(record);
             free(page);
             return -1;
         }
@@ -1187,12 +1285,11 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const std::vecto
     auto *thisPage = (PageDirectory *) _pPage;
     auto *thisSlot = (SlotDirectory *) _pSlot;
     char16_t oldRecordLength = thisSlot->length;
+    // the old record is given back so the update can be undone
+    oldRecord.assign((char *) page + thisSlot->offset, oldRecordLength);
 
     if (temp_rid.slotNum + 1 > thisPage->numberofslot) {
         // std::cout << "[Error] Fail to update because the slotNum is out of limit." << std::endl;
-        free(nullsIndicator);
-        free(LenAndValidField);
-        free(record);
         free(page);
         return -1;
     }
@@ -1259,7 +1356,8 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const std::vecto
             thisSlot->offset = PAGE_SIZE - sizeof(PageDirectory) - (thisPage->numberofslot) * sizeof(SlotDirectory) -
                                thisPage->freespace;
 
-            if (insertRecord(fileHandle, recordDescriptor, data, newRid) == 0) {
+            // the page of the record stays latched, so findAvailablePage(...) skips it.
+            if (insertFormattedRecord(fileHandle, record, recordLength, newRid, latches) == 0) {
                 // put the newRID into this tombstone pointer.
                 memset((char *) page + thisSlot->offset, ptrFlag, 1);
 
@@ -1276,9 +1374,6 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const std::vecto
             }
             else {
                 // std::cout << "[Error] Fail to update when insert this record." << std::endl;
-                free(nullsIndicator);
-                free(LenAndValidField);
-                free(record);
                 free(page);
                 return -1;
             }
@@ -1291,22 +1386,101 @@ RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const std::vecto
 
     } else {
         // std::cout << "[Error] Fail to write when update the record." << std::endl;
-        free(nullsIndicator);
-        free(LenAndValidField);
-        free(record);
         free(page);
         return -1;
     }
 
-    free(nullsIndicator);
-    free(LenAndValidField);
+    free(page);
+    return 0;
+
+}
+
+RC RecordBasedFileManager::readRecordVersion(FileHandle &fileHandle, const RID &rid, char16_t &version){
+    void *record = malloc(PAGE_SIZE);
+    RC rc = getRecord(fileHandle, std::vector<Attribute>(), rid, record);
+    if(rc != 0){
+        // std::cout << "[Error]: readRecordVersion -> can't get the record." << std::endl;
+        free(record);
+        return rc;
+    }
+    memcpy(&version, (char *)record + flagLen, versionLen);
     free(record);
+    return 0;
+}
+
+RC RecordBasedFileManager::readFormattedRecords(FileHandle &fileHandle, PageNum pageNum, const std::vector<unsigned> &slotNums,
+                                                std::vector<std::string> &records){
+    records.assign(slotNums.size(), std::string());
+    char *page = (char *)malloc(PAGE_SIZE);
+    RC rc;
+    {
+        SharedLatchGuard guard(fileHandle.getLatch(pageNum));
+        rc = fileHandle.readPage(pageNum, page);
+    }
+    if(rc != 0){
+        // std::cout << "[Error]: readFormattedRecords -> fail to read the page." << std::endl;
+        free(page);
+        return -1;
+    }
+
+    auto *pageDir = (PageDirectory *)(page + PAGE_SIZE - sizeof(PageDirectory));
+    char *movedRecord = nullptr;
+    for(size_t i = 0; i < slotNums.size(); i++){
+        if(slotNums[i] >= pageDir->numberofslot){
+            continue;
+        }
+        auto *thisSlot = (SlotDirectory *)(page + PAGE_SIZE - sizeof(PageDirectory) - (slotNums[i] + 1) * sizeof(SlotDirectory));
+        if(thisSlot->length == 0){
+            // this record has been deleted.
+            continue;
+        }
+        char flag = page[thisSlot->offset];
+        if(flag == recordFlag){
+            records[i].assign(page + thisSlot->offset, thisSlot->length);
+        }
+        else if(flag == ptrFlag){
+            // moved to another page by an update, follow the tombstone for this record only.
+            RID movedRid;
+            memcpy(&movedRid, page + thisSlot->offset + flagLen, sizeof(RID));
+            if(movedRecord == nullptr){
+                movedRecord = (char *)malloc(PAGE_SIZE);
+            }
+            char16_t recordLength;
+            if(getRecord(fileHandle, std::vector<Attribute>(), movedRid, movedRecord, &recordLength) == 0){
+                records[i].assign(movedRecord, recordLength);
+            }
+        }
+    }
+    free(movedRecord);
     free(page);
     return 0;
+}
 
+RC RecordBasedFileManager::formatRecord(const std::vector<Attribute> &recordDescriptor, const void *data, char16_t version,
+                                        std::string &record){
+    char16_t fieldLength = recordDescriptor.size();
+    int nullFieldsIndicatorActualSize = ceil((double(fieldLength)/CHAR_BIT));
+    auto *nullsIndicator = (unsigned char *) malloc(nullFieldsIndicatorActualSize);
+    memcpy((char *) nullsIndicator, (char *)data, nullFieldsIndicatorActualSize);
+    
+    int LenAndValidField[2];
+    getTotalLenAndLenAheadOfVariableField(recordDescriptor, data, LenAndValidField, fieldLength, nullFieldsIndicatorActualSize, nullsIndicator);
+    record.assign(LenAndValidField[0], '\0');
+    RC rc = formatRecord(recordDescriptor, data, LenAndValidField, &record[0], fieldLength, nullFieldsIndicatorActualSize, nullsIndicator, version);
+    free(nullsIndicator);
+    return rc;
+}
+
+RC RecordBasedFileManager::deFormatRecord(const std::vector<Attribute> &recordDescriptor, const std::vector<std::string> &attributeNames,
+                                          const std::string &record, void *data){
+    if(attributeNames.empty()){
+        return deFormatRecord(recordDescriptor, data, (void *)record.data());
+    }
+    return readAttributesFromRecord(recordDescriptor, attributeNames, data, (void *)record.data());
 }
 
-RC RecordBasedFileManager::checkRecordFlag(FileHandle &fileHandle, const RID &rid){
+RC RecordBasedFileManager::checkRecordFlag(FileHandle &fileHandle, const RID &rid, char16_t &version){
+    SharedLatchGuard guard(fileHandle.getLatch(rid.pageNum));
     char *page = (char *)malloc(PAGE_SIZE);
     SlotDirectory* thisSlot;
     char flag;
@@ -1319,6 +1493,7 @@ RC RecordBasedFileManager::checkRecordFlag(FileHandle &fileHandle, const RID &ri
         else{
             memcpy(&flag, page+thisSlot->offset, 1);
             if(flag == recordFlag) {
+                memcpy(&version, page+thisSlot->offset+flagLen, versionLen);
                 free(page);
                 return 0;
             }
@@ -1336,8 +1511,8 @@ RC RecordBasedFileManager::checkRecordFlag(FileHandle &fileHandle, const RID &ri
 RC RecordBasedFileManager::readAttributeFromRecord(const std::vector<Attribute> &recordDescriptor, const std::string &attributeName, void *data, void *record){
 
     int fieldLength = recordDescriptor.size();
-    // 1. First byte is the flag
-    int offsetRecord = flagLen;
+    // 1. First byte is the flag, then the schema version
+    int offsetRecord = flagLen + versionLen;
     int offsetData = 0;
 
     //2. Next two bytes represents field length
@@ -1508,8 +1683,20 @@ RC RecordBasedFileManager::readAttributesFromRecord(const std::vector<Attribute>
     memset(nullIndicatorForAttributes, 0, nullFieldsIndicatorForAttributesSize);
     offsetData += nullFieldsIndicatorForAttributesSize;
 
-    // 1. First byte is the flag
+    // attributes which don't exist in this record (added by a later schema version) are read as null
+    std::vector<bool> inDescriptor(attributesLength, false);
+    for(int i = 0; i < attributesLength; i++){
+        for(auto &attr : recordDescriptor){
+            if(attr.name == attributeNames[i]){
+                inDescriptor[i] = true;
+                break;
+            }
+        }
+    }
+
+    // 1. First byte is the flag, then the schema version
     offsetRecord += flagLen;
+    offsetRecord += versionLen;
 
     //2. Next two bytes represents field length
     offsetRecord += fieldSizeLen;
@@ -1533,6 +1720,11 @@ RC RecordBasedFileManager::readAttributesFromRecord(const std::vector<Attribute>
         {
             fieldIndex = nullByteIndex*8 + bitIndex;
 
+            while(indexForAttributes < attributesLength && !inDescriptor[indexForAttributes]){
+                nullIndicatorForAttributes[indexForAttributes/CHAR_BIT] |= ((unsigned char) 1 << (unsigned) (7 - indexForAttributes%CHAR_BIT));
+                indexForAttributes++;
+            }
+
             if((fieldIndex == fieldLength) || (indexForAttributes == attributesLength))
                 break;
 
@@ -1592,6 +1784,11 @@ RC RecordBasedFileManager::readAttributesFromRecord(const std::vector<Attribute>
 
         }
     }
+    // the remaining attributes are not stored in this record
+    for(; indexForAttributes < attributesLength; indexForAttributes++){
+        nullIndicatorForAttributes[indexForAttributes/CHAR_BIT] |= ((unsigned char) 1 << (unsigned) (7 - indexForAttributes%CHAR_BIT));
+    }
+
     // write the nullsIndicatorForAttributes back to data
     memcpy(data, nullIndicatorForAttributes, nullFieldsIndicatorForAttributesSize);
     free(nullsIndicator);
@@ -1612,7 +1809,7 @@ RC RecordBasedFileManager::scan(FileHandle &fileHandle, const std::vector<Attrib
     return 0;
 }
 
-RC RecordBasedFileManager::findAvailablePage(FileHandle &fileHandle, char16_t recordLength, RID &rid, void* page){
+RC RecordBasedFileManager::findAvailablePage(FileHandle &fileHandle, char16_t recordLength, RID &rid, void* page, ExclusiveLatchSet &latches){
 
     if( recordLength > (PAGE_SIZE - sizeof(PageDirectory) - sizeof(SlotDirectory)) ){
          //std::cout << "[Error] The recordLength is too large to fit in a PAGE_SIZE." << std::endl;
@@ -1624,39 +1821,19 @@ RC RecordBasedFileManager::findAvailablePage(FileHandle &fileHandle, char16_t re
     if(fileHandle.getNumberOfPages() > 0){
         // search from the end of all pages, which is getNumberOfPages() - 1.
         for(int i=(int)(fileHandle.getNumberOfPages() - 1); i >= 0; i--){
-            // void *page = malloc(PAGE_SIZE);
-            // readPage: page num starts from 0;
+            // a page latched by another reader or writer is skipped instead of waited for.
+            if(!latches.tryLock(fileHandle.getLatch(i))){
+                continue;
+            }
 
+            // readPage: page num starts from 0;
             if(fileHandle.readPage(i, page) == 0){
-                // check freespace
-                char* _pPageDir = (char*) page + PAGE_SIZE - sizeof(PageDirectory);
-                auto* pageDir = (PageDirectory*) _pPageDir;
-
-                if( pageDir->freespace >= (recordLength + sizeof(SlotDirectory)) ){
-                    // this page is available
-                    // check all the slotDirectory to see if exists deleted records.
-
-                    for(unsigned int j = 0; j < pageDir->numberofslot; j++){
-                        char* _pSlot = _pPageDir - (j + 1) * sizeof(SlotDirectory);
-                        auto* thisSlot = (SlotDirectory*)_pSlot;
-                        if(thisSlot->length == 0){
-                            // this record has been deleted, we could reuse this slot.
-                            // std::cout << "[Notice] Find a deleted slot which could be reused." << std::endl;
-                            rid.slotNum = j;
-                            rid.pageNum = i;
-
-                            // return 1 means this slot existed and we just reuse it at this time.
-                            return 1;
-                        }
-                    }
-
-                    // no empty(deleted) slot. Just create a new slot.
-                    rid.slotNum = pageDir->numberofslot;
-                    rid.pageNum = i;
-
-                    // return 0 means it is a new slot which we need to create.
-                    return 0;
+                RC rc = findSlotInPage(page, i, recordLength, rid);
+                if(rc >= 0){
+                    // the page stays latched
+                    return rc;
                 }
+                latches.unlockLast();
             }
             else{
                 return -1;
@@ -1666,15 +1843,10 @@ RC RecordBasedFileManager::findAvailablePage(FileHandle &fileHandle, char16_t re
     }
 
 
-    // Otherwise, there is no pages in the file or no available pages. So we append new page and initialize it.
-    unsigned currentPageNum = fileHandle.getNumberOfPages();
-    // clear buffer
-    memset(page, 0, PAGE_SIZE);
-
-    // append a new page
-    if(fileHandle.appendPage(page) == 0){
-        rid.pageNum = currentPageNum;
-        rid.slotNum = 0;
+    // Otherwise, there is no pages in the file or no available pages. So we append new pages and initialize them.
+    while(true){
+        // clear buffer
+        memset(page, 0, PAGE_SIZE);
 
         // add PageDirectory when append a new page
         PageDirectory pageDirectory;
@@ -1684,13 +1856,58 @@ RC RecordBasedFileManager::findAvailablePage(FileHandle &fileHandle, char16_t re
         char16_t page_offset = PAGE_SIZE - sizeof(PageDirectory);
         memcpy((char*)page + page_offset, &pageDirectory, sizeof(PageDirectory));
 
-        return 0;
+        // appendPage(...) is the only place which takes the APPEND_LATCH.
+        PageNum pageNum;
+        if(fileHandle.appendPage(page, pageNum) != 0){
+            // std::cout << "[Error] appendPage() fail when findAvailablePage()" << std::endl;
+            return -1;
+        }
+
+        // other writers may have used the new page before it is latched here, read it again.
+        latches.lock(fileHandle.getLatch(pageNum));
+        if(fileHandle.readPage(pageNum, page) != 0){
+            return -1;
+        }
+        RC rc = findSlotInPage(page, pageNum, recordLength, rid);
+        if(rc >= 0){
+            return rc;
+        }
+        latches.unlockLast();
     }
-    else{
-        // std::cout << "[Error] appendPage() fail when findAvailablePage()" << std::endl;
+
+}
+
+RC RecordBasedFileManager::findSlotInPage(void *page, PageNum pageNum, char16_t recordLength, RID &rid){
+    // check freespace
+    char* _pPageDir = (char*) page + PAGE_SIZE - sizeof(PageDirectory);
+    auto* pageDir = (PageDirectory*) _pPageDir;
+
+    if( pageDir->freespace < (recordLength + sizeof(SlotDirectory)) ){
         return -1;
     }
 
+    // this page is available
+    // check all the slotDirectory to see if exists deleted records.
+    for(unsigned int j = 0; j < pageDir->numberofslot; j++){
+        char* _pSlot = _pPageDir - (j + 1) * sizeof(SlotDirectory);
+        auto* thisSlot = (SlotDirectory*)_pSlot;
+        if(thisSlot->length == 0){
+            // this record has been deleted, we could reuse this slot.
+            // std::cout << "[Notice] Find a deleted slot which could be reused." << std::endl;
+            rid.slotNum = j;
+            rid.pageNum = pageNum;
+
+            // return 1 means this slot existed and we just reuse it at this time.
+            return 1;
+        }
+    }
+
+    // no empty(deleted) slot. Just create a new slot.
+    rid.slotNum = pageDir->numberofslot;
+    rid.pageNum = pageNum;
+
+    // return 0 means it is a new slot which we need to create.
+    return 0;
 }
 
 RC RecordBasedFileManager::varCharFromDataToRecord(int &offsetRecord, int &offsetData, char16_t &varCharLen_16, int &varCharLen, char16_t &offsetVariableData, void *record, const void *data){
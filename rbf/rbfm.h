@@ -5,6 +5,7 @@
 #include <vector>
 #include <climits>
 #include <map>
+#include <algorithm>
 
 #include "pfm.h"
 
@@ -55,6 +56,7 @@ typedef enum {
 // Field Len of each part of the record
 #define fieldSizeLen 2
 #define flagLen 1
+#define versionLen 2        // schema version the record was written with
 #define varFieldLengthLen 2
 #define varFieldOffsetLen 2
 #define varFieldLen (varFieldLengthLen + varFieldOffsetLen)
@@ -107,7 +109,19 @@ public:
     
     RC close();
 
+    /*
+     * Record descriptors of every schema version of the file, versionDescriptors[v] is the one records stamped with version v were written with.
+     * A column which is not part of the current schema any more has an empty name in older descriptors, so it is skipped when projecting.
+     * Only needed when the schema has been changed, records stamped with an older version are then read through their own descriptor,
+     * attributes added after that version are returned as NULL.
+     */
+    RC setVersionDescriptors(const std::vector<std::vector<Attribute>> &versionDescriptors);
 
+    /*
+     * Restrict the scan to pages [startPage, endPage) of the file. Called after initiateRBFMScanIterator(...).
+     * Several iterators, each one with its own FileHandle, can then scan disjoint page ranges of one file in parallel.
+     */
+    RC setPageRange(unsigned startPage, unsigned endPage);
 
 private:
     FileHandle *fileHandlePtr;
@@ -118,10 +132,12 @@ private:
     std::string conditionAttribute;
     AttrType conditionAttributeType;
     std::vector<std::string> attributeNames;
+    std::vector<std::vector<Attribute>> versionDescriptors;
 
     unsigned numOfPages;
     char16_t curNumOfSlotsInPage;
     RID curRID;
+    char16_t curVersion;                                    // version stamp of the record at curRID
     unsigned maxAttrLength;
     unsigned maxRecordLength;
 
@@ -130,6 +146,7 @@ private:
     RC updateNumOfSlots();
     RC updateCurRIDAndCurNumOfSlotsInPage();
     RC doOp(int nullSize, void *attribute);
+    const std::vector<Attribute> &getDescriptorForVersion(char16_t version);  // descriptor of the version a record is stamped with
 
 };
 
@@ -160,10 +177,18 @@ public:
     //  !!! The same format is used for updateRecord(), the returned data of readRecord(), and readAttribute().
     // For example, refer to the Q8 of Project 1 wiki page.
 
+    // Record operations latch the pages they touch (see PagedFileManager::getLatch(...)): reads in shared mode, insert, update
+    // and delete in exclusive mode, so writers on different pages of one file run in parallel. A tombstone's page is released
+    // before the page the record moved to is latched. Looking for free space skips the pages other threads hold,
+    // the APPEND_LATCH is only taken when the file grows.
+    // Inside a transaction (see wal.h) insert, update and delete end by logging how they are undone, before the latches are released.
+
     /*
      * Insert a record into a file
+     * version: schema version stamped into the record header, records are always written with the descriptor of this version.
      */
-    RC insertRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const void *data, RID &rid);
+    RC insertRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const void *data, RID &rid,
+                    char16_t version = 0);
 
     /*
      * Read a record identified by the given rid, and change it back to the original format.
@@ -193,7 +218,12 @@ public:
      * Assume the RID does not change after an update
      */
     RC updateRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const void *data,
-                    const RID &rid);
+                    const RID &rid, char16_t version = 0);
+
+    /*
+     * Write a formatted record, as it is stored in the page, back to rid. Used to undo updateRecord(...).
+     */
+    RC restoreRecord(FileHandle &fileHandle, const RID &rid, const void *record, unsigned recordLength);
     
     /*
      * Read an attribute given its name and the rid.
@@ -223,8 +253,34 @@ public:
     
     /*
     * check the record corresponding to the rid whether is a tombstone
+    * if it isn't, version gets the schema version stamped in its header
     */
-    RC checkRecordFlag(FileHandle &fileHandle, const RID &rid);
+    RC checkRecordFlag(FileHandle &fileHandle, const RID &rid, char16_t &version);
+
+    /*
+     * get the schema version stamped in the record header, follow the tombstone if needed.
+     * return -2 if the record has been deleted.
+     */
+    RC readRecordVersion(FileHandle &fileHandle, const RID &rid, char16_t &version);
+
+    /*
+     * Read the records of several slots of one page with a single read of the page: records[i] gets the formatted record of
+     * slotNums[i], empty if it has been deleted. Only a record moved away by an update is read through its tombstone.
+     */
+    RC readFormattedRecords(FileHandle &fileHandle, PageNum pageNum, const std::vector<unsigned> &slotNums, std::vector<std::string> &records);
+
+    /*
+     * Change a formatted record of readFormattedRecords(...) back to the original format. recordDescriptor is the one of the version
+     * stamped in the record, attributeNames projects it like readAttributes(...), all of recordDescriptor when it is empty.
+     */
+    RC deFormatRecord(const std::vector<Attribute> &recordDescriptor, const std::vector<std::string> &attributeNames,
+                      const std::string &record, void *data);
+
+    /*
+     * Format data like insertRecord(...) does, stamped with version, without storing it anywhere.
+     * RelationManager keeps the rows of an index-organized table in this format.
+     */
+    RC formatRecord(const std::vector<Attribute> &recordDescriptor, const void *data, char16_t version, std::string &record);
 
 protected:
     RecordBasedFileManager();                                                   // Prevent construction
@@ -238,11 +294,26 @@ protected:
     RC getTotalLenAndLenAheadOfVariableField(const std::vector<Attribute> &recordDescriptor, const void *data, void *info,
                                              char16_t fieldLength, int nullsIndicatorLen, unsigned char *nullsIndicator);
     
+    /*
+     * insertRecord(...) without logging: format the record and insertFormattedRecord(...).
+     */
+    RC insertRecordWithoutLog(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor, const void *data, RID &rid,
+                              char16_t version, ExclusiveLatchSet &latches);
+    
+    /*
+     * Insert / update a record which is already formatted, the pages written are added to latches and stay latched until the caller is done.
+     * insertFormattedRecord(...) is also used by updateFormattedRecord(...) when the record is migrated.
+     * oldRecord gets the formatted record before the update.
+     */
+    RC insertFormattedRecord(FileHandle &fileHandle, const void *record, char16_t recordLength, RID &rid, ExclusiveLatchSet &latches);
+    RC updateFormattedRecord(FileHandle &fileHandle, const void *record, char16_t recordLength, const RID &rid, std::string &oldRecord,
+                             ExclusiveLatchSet &latches);
+    
     /*
      * change the original data into the format that could be stored in page
      */
     RC formatRecord(const std::vector<Attribute> &recordDescriptor, const void *data, void *info, void *record,
-                    char16_t fieldLength, int nullsIndicatorLen, unsigned char *nullsIndicator);
+                    char16_t fieldLength, int nullsIndicatorLen, unsigned char *nullsIndicator, char16_t version);
     
     /*
      * change the formatted record back into original format.
@@ -251,14 +322,21 @@ protected:
     
     /*
      * retrieve the record according to the rid, check the flag each time, if the flag is ptrFlag, loop until the flag is recordFlag.
+     * recordLength gets its length if it is given.
      */
     RC getRecord(FileHandle &fileHandle, const std::vector<Attribute> &recordDescriptor,
-                 const RID &rid, void *record);
+                 const RID &rid, void *record, char16_t *recordLength = nullptr);
     
     /*
      * Search all pages in the file to find rid and read the info to page buffer. Finding available page starts from the end of the file to the start.
+     * The page found is latched in exclusive mode and added to latches.
+     */
+     RC findAvailablePage(FileHandle &fileHandle, char16_t recordLength, RID &rid, void* page, ExclusiveLatchSet &latches);
+
+    /*
+     * Slot of page for a record of recordLength: 0 -> a new slot, 1 -> a deleted slot reused, -1 -> not enough freespace.
      */
-     RC findAvailablePage(FileHandle &fileHandle, char16_t recordLength, RID &rid, void* page);
+     RC findSlotInPage(void *page, PageNum pageNum, char16_t recordLength, RID &rid);
      
     /*
      * nullIndicator for the retrieved attribute has the same length as the entire record which is different from function readAttributes().
@@ -269,6 +347,7 @@ protected:
     /*
      * nullIndicator size is the same as the length of retrieved attributeNames. This is the main different from readAttribute.
      * data is in the original format.
+     * attribute names which are not in the recordDescriptor (added after this record was written) are returned as NULL.
      */
     RC readAttributesFromRecord(const std::vector<Attribute> &recordDescriptor, const std::vector<std::string> &attributeNames, void *data, void *record);
 
@@ -0,0 +1,898 @@
+#include "wal.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+thread_local std::unique_ptr<Transaction> LogManager::_transaction;
+
+LogManager &LogManager::instance() {
+    static LogManager _log_manager;
+    return _log_manager;
+}
+
+LogManager::LogManager() = default;
+
+LogManager::~LogManager() {
+    if(_fd >= 0){
+        close(_fd);
+    }
+}
+
+// payload helpers, strings are stored as length:2 and the characters
+static void appendBytes(std::string &payload, const void *data, unsigned length){
+    payload.append((const char *)data, length);
+}
+
+static void appendName(std::string &payload, const std::string &name){
+    unsigned short length = name.size();
+    appendBytes(payload, &length, sizeof(length));
+    payload.append(name);
+}
+
+// renames and new files are durable once their directory is
+static RC syncDirectory(){
+    int fd = open(".", O_RDONLY);
+    if(fd < 0){
+        return -1;
+    }
+    RC rc = fsync(fd);
+    close(fd);
+    return rc == 0 ? 0 : -1;
+}
+
+static void readBytes(const char *payload, unsigned &offset, void *data, unsigned length){
+    memcpy(data, payload + offset, length);
+    offset += length;
+}
+
+static std::string readName(const char *payload, unsigned &offset){
+    unsigned short length;
+    readBytes(payload, offset, &length, sizeof(length));
+    std::string name(payload + offset, length);
+    offset += length;
+    return name;
+}
+
+// ranges are <offset:2, length:2, before, after>, redo applies the after images and undo the before images
+static void applyRanges(const std::string &ranges, void *page, bool redo){
+    unsigned offset = 0;
+    while(offset < ranges.size()){
+        unsigned short rangeOffset, rangeLength;
+        readBytes(ranges.c_str(), offset, &rangeOffset, sizeof(rangeOffset));
+        readBytes(ranges.c_str(), offset, &rangeLength, sizeof(rangeLength));
+        const char *image = ranges.c_str() + offset + (redo ? rangeLength : 0);
+        memcpy((char *)page + rangeOffset, image, rangeLength);
+        offset += 2 * rangeLength;
+    }
+}
+
+RC LogManager::beginTransaction() {
+    if(_transaction){
+        // std::cout << "[Error] beginTransaction -> this thread already runs a transaction." << std::endl;
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(_transactionMutex);
+    _transaction.reset(new Transaction());
+    _transaction->txnId = _nextTxnId++;
+    return 0;
+}
+
+bool LogManager::inTransaction() const {
+    return _transaction != nullptr;
+}
+
+RC LogManager::commitWithNextOperation() {
+    if(!_transaction){
+        return -1;
+    }
+    _transaction->commitWithNextOperation = true;
+    return 0;
+}
+
+RC LogManager::commitTransaction() {
+    Transaction *transaction = _transaction.get();
+    if(transaction == nullptr){
+        // std::cout << "[Error] commitTransaction -> no transaction is running." << std::endl;
+        return -1;
+    }
+    RC rc = 0;
+    if(transaction->logged){
+        LSN lsn;
+        if(!transaction->committed){
+            rc = appendRecord(LOG_COMMIT, transaction, "", lsn);
+        }
+        if(rc == 0){
+            rc = flush(transaction->lastLSN);
+        }
+        std::lock_guard<std::mutex> lock(_flushMutex);
+        _commitCounter++;
+    }
+    endTransaction();
+    return rc;
+}
+
+RC LogManager::abortTransaction() {
+    Transaction *transaction = _transaction.get();
+    if(transaction == nullptr){
+        return -1;
+    }
+    RC rc = 0;
+    if(transaction->logged){
+        // the abort need not be durable: without it recovery finds every operation compensated already.
+        LSN lsn;
+        rc = appendRecord(LOG_ABORT, transaction, "", lsn);
+    }
+    endTransaction();
+    return rc;
+}
+
+RC LogManager::endTransaction() {
+    unsigned txnId = _transaction->txnId;
+    _transaction.reset();
+    LSN loggedSize;
+    {
+        std::lock_guard<std::mutex> lock(_logMutex);
+        // nothing will undo its records any more
+        _firstLSNs.erase(txnId);
+        loggedSize = _endLSN - _checkpointLSN;
+    }
+    if(loggedSize > LOG_CHECKPOINT_SIZE){
+        checkpoint();
+    }
+    return 0;
+}
+
+RC LogManager::openLog(bool create) {
+    if(_fd >= 0){
+        return 0;
+    }
+    if(!create && _logChecked){
+        return -1;
+    }
+    _logChecked = true;
+    _fd = open(LOG_FILE_NAME, O_RDWR | (create ? O_CREAT : 0), 0644);
+    if(_fd < 0){
+        return -1;
+    }
+    off_t size = lseek(_fd, 0, SEEK_END);
+    if(size < (off_t)LOG_HEADER_SIZE){
+        // a new log
+        _baseLSN = 1;
+        if(pwrite(_fd, &_baseLSN, LOG_HEADER_SIZE, 0) != (ssize_t)LOG_HEADER_SIZE){
+            // std::cout << "[Error] openLog -> fail to write the log header." << std::endl;
+            close(_fd);
+            _fd = -1;
+            return -1;
+        }
+        size = LOG_HEADER_SIZE;
+    }
+    else if(pread(_fd, &_baseLSN, LOG_HEADER_SIZE, 0) != (ssize_t)LOG_HEADER_SIZE){
+        close(_fd);
+        _fd = -1;
+        return -1;
+    }
+    _endLSN = _baseLSN + size - LOG_HEADER_SIZE;
+    _durableLSN = _endLSN;
+    _checkpointLSN = _baseLSN;
+    return 0;
+}
+
+RC LogManager::appendRecord(char type, Transaction *transaction, const std::string &payload, LSN &lsn) {
+    unsigned length = LOG_RECORD_HEADER_SIZE + payload.size() + sizeof(unsigned);
+    unsigned txnId = transaction == nullptr ? 0 : transaction->txnId;
+    std::string record;
+    record.reserve(length);
+    appendBytes(record, &length, sizeof(length));
+    appendBytes(record, &type, sizeof(type));
+    appendBytes(record, &txnId, sizeof(txnId));
+    record.append(payload);
+    // the length at the end tells whether the last record was written completely
+    appendBytes(record, &length, sizeof(length));
+
+    std::lock_guard<std::mutex> lock(_logMutex);
+    if(openLog(true) != 0){
+        // std::cout << "[Error] appendRecord -> fail to open the log." << std::endl;
+        return -1;
+    }
+    // written, not synced: the record reaches the OS before the page it describes
+    if(pwrite(_fd, record.c_str(), length, LOG_HEADER_SIZE + (_endLSN - _baseLSN)) != (ssize_t)length){
+        // std::cout << "[Error] appendRecord -> fail to write the log." << std::endl;
+        return -1;
+    }
+    lsn = _endLSN;
+    _endLSN += length;
+    if(transaction != nullptr){
+        if(!transaction->logged){
+            // a checkpoint keeps the log from here on until the transaction ends
+            _firstLSNs[txnId] = lsn;
+        }
+        transaction->logged = true;
+        transaction->lastLSN = _endLSN;
+    }
+    return 0;
+}
+
+RC LogManager::flush(LSN lsn) {
+    std::unique_lock<std::mutex> lock(_flushMutex);
+    while(_durableLSN < lsn){
+        if(_flushing){
+            // another commit is syncing, it may cover this one as well.
+            _flushCond.wait(lock);
+            continue;
+        }
+        _flushing = true;
+        lock.unlock();
+        LSN target;
+        int fd;
+        {
+            std::lock_guard<std::mutex> logLock(_logMutex);
+            target = _endLSN;
+            fd = _fd;
+        }
+        RC rc = fsync(fd);
+        lock.lock();
+        _flushing = false;
+        _flushCond.notify_all();
+        if(rc != 0){
+            // std::cout << "[Error] flush -> fail to sync the log." << std::endl;
+            return -1;
+        }
+        _syncCounter++;
+        if(target > _durableLSN){
+            _durableLSN = target;
+        }
+    }
+    return 0;
+}
+
+RC LogManager::logPageWrite(FileHandle &fileHandle, PageNum pageNum, const void *data, bool newPage, LSN &pageLSN) {
+    Transaction *transaction = _transaction.get();
+    if(transaction == nullptr){
+        // not logged, the page LSN still moves forward so no older record is redone on this page.
+        std::lock_guard<std::mutex> lock(_logMutex);
+        openLog(false);
+        pageLSN = _endLSN;
+        return 0;
+    }
+
+    // before image: the page in the file, a new page is compared with zeros
+    char *before = (char *)calloc(PAGE_SIZE, 1);
+    LSN oldLSN = 0;
+    if(!newPage && fileHandle.readPageWithLSN(pageNum, before, oldLSN) != 0){
+        free(before);
+        return -1;
+    }
+
+    std::string ranges;
+    const char *after = (const char *)data;
+    unsigned i = 0;
+    while(i < PAGE_SIZE){
+        if(before[i] == after[i]){
+            i++;
+            continue;
+        }
+        // a range ends when LOG_RANGE_GAP bytes in a row are the same
+        unsigned start = i, end = i + 1;
+        for(unsigned j = i + 1; j < PAGE_SIZE && j - end < LOG_RANGE_GAP; j++){
+            if(before[j] != after[j]){
+                end = j + 1;
+            }
+        }
+        unsigned short rangeOffset = start, rangeLength = end - start;
+        appendBytes(ranges, &rangeOffset, sizeof(rangeOffset));
+        appendBytes(ranges, &rangeLength, sizeof(rangeLength));
+        appendBytes(ranges, before + start, rangeLength);
+        appendBytes(ranges, after + start, rangeLength);
+        i = end;
+    }
+    free(before);
+
+    std::string payload;
+    appendName(payload, fileHandle.getFileName());
+    appendBytes(payload, &pageNum, sizeof(pageNum));
+    payload.append(ranges);
+
+    LSN lsn;
+    if(appendRecord(LOG_PAGE, transaction, payload, lsn) != 0){
+        return -1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_logMutex);
+        _loggedFiles.insert(fileHandle.getFileName());
+    }
+    LogPageChange change;
+    change.lsn = lsn;
+    change.fileName = fileHandle.getFileName();
+    change.pageNum = pageNum;
+    change.ranges = ranges;
+    transaction->pageChanges.push_back(change);
+    pageLSN = lsn;
+    // the page may reach the disk as soon as it is written, so its record has to be durable first.
+    // Writers running at the same time share the fsync like commits do.
+    return flush(lsn + 1);
+}
+
+RC LogManager::dropFile(const std::string &fileName) {
+    {
+        std::lock_guard<std::mutex> lock(_logMutex);
+        if(_loggedFiles.erase(fileName) == 0){
+            return 0;
+        }
+    }
+    std::string payload;
+    appendName(payload, fileName);
+    LSN lsn;
+    if(appendRecord(LOG_DROP_FILE, nullptr, payload, lsn) != 0){
+        return -1;
+    }
+    // the file is gone for good, so must be its drop
+    return flush(lsn + 1);
+}
+
+RC LogManager::replaceFiles(const std::vector<std::pair<std::string, std::string>> &files) {
+    // no checkpoint may cut the log between the record and the renames
+    std::lock_guard<std::mutex> checkpointLock(_checkpointMutex);
+    std::string payload;
+    unsigned numOfFiles = files.size();
+    appendBytes(payload, &numOfFiles, sizeof(numOfFiles));
+    for(auto &file : files){
+        // the new files are not logged, recovery needs them complete
+        if(access(file.first.c_str(), F_OK) != 0 || syncFile(file.first) != 0){
+            // std::cout << "[Error] replaceFiles -> fail to sync " << file.first << std::endl;
+            return -1;
+        }
+        appendName(payload, file.first);
+        appendName(payload, file.second);
+    }
+    {
+        std::lock_guard<std::mutex> lock(_logMutex);
+        for(auto &file : files){
+            _loggedFiles.erase(file.first);
+            _loggedFiles.erase(file.second);
+        }
+    }
+    LSN lsn;
+    if(appendRecord(LOG_REPLACE_FILES, nullptr, payload, lsn) != 0 || flush(lsn + 1) != 0){
+        return -1;
+    }
+
+    // from here on recovery finishes the renames, failing is no option any more
+    for(auto &file : files){
+        if(rename(file.first.c_str(), file.second.c_str()) != 0){
+            // std::cout << "[Error] replaceFiles -> fail to rename " << file.first << std::endl;
+            return -1;
+        }
+    }
+    // the renames must be durable before the end record, otherwise a later file of the same name would be renamed again
+    if(syncDirectory() != 0){
+        return -1;
+    }
+    payload.clear();
+    appendBytes(payload, &lsn, sizeof(lsn));
+    LSN endLSN;
+    if(appendRecord(LOG_REPLACE_END, nullptr, payload, endLSN) != 0){
+        return -1;
+    }
+    return flush(endLSN + 1);
+}
+
+RC LogManager::logRecordOperation(char operation, FileHandle &fileHandle, const RID &rid, const void *record, unsigned recordLength) {
+    if(!_transaction){
+        return 0;
+    }
+    LogOperation logOperation;
+    logOperation.operation = operation;
+    logOperation.fileName = fileHandle.getFileName();
+    logOperation.rid = rid;
+    logOperation.attribute.type = TypeInt;
+    logOperation.attribute.length = 0;
+    if(record != nullptr){
+        logOperation.data.assign((const char *)record, recordLength);
+    }
+    return endOperation(logOperation);
+}
+
+RC LogManager::logEntryOperation(char operation, FileHandle &fileHandle, const Attribute &attribute, const void *key, unsigned keyLength,
+                                 const RID &rid) {
+    if(!_transaction){
+        return 0;
+    }
+    LogOperation logOperation;
+    logOperation.operation = operation;
+    logOperation.fileName = fileHandle.getFileName();
+    logOperation.rid = rid;
+    logOperation.attribute = attribute;
+    logOperation.data.assign((const char *)key, keyLength);
+    return endOperation(logOperation);
+}
+
+RC LogManager::logRowOperation(char operation, FileHandle &fileHandle, const Attribute &attribute, const void *key, unsigned keyLength,
+                               const void *row, unsigned rowLength) {
+    if(!_transaction){
+        return 0;
+    }
+    LogOperation logOperation;
+    logOperation.operation = operation;
+    logOperation.fileName = fileHandle.getFileName();
+    logOperation.rid.pageNum = 0;
+    logOperation.rid.slotNum = 0;
+    logOperation.attribute = attribute;
+    logOperation.data.assign((const char *)key, keyLength);
+    if(row != nullptr){
+        logOperation.data.append((const char *)row, rowLength);
+    }
+    return endOperation(logOperation);
+}
+
+RC LogManager::endOperation(LogOperation &operation) {
+    Transaction *transaction = _transaction.get();
+    char flags = transaction->commitWithNextOperation ? OP_FLAG_COMMIT : 0;
+    LSN compensatedLSN = transaction->compensatedLSN;
+    if(compensatedLSN != 0){
+        // an undo step is never undone itself
+        operation.operation = OP_NONE;
+    }
+
+    // payload: flags:1, compensatedLSN:8, operation:1, fileName, rid:8, attribute type:4, attribute length:4, data length:4, data
+    std::string payload;
+    unsigned type = operation.attribute.type;
+    unsigned dataLength = operation.data.size();
+    appendBytes(payload, &flags, sizeof(flags));
+    appendBytes(payload, &compensatedLSN, sizeof(compensatedLSN));
+    appendBytes(payload, &operation.operation, sizeof(operation.operation));
+    appendName(payload, operation.fileName);
+    appendBytes(payload, &operation.rid, sizeof(RID));
+    appendBytes(payload, &type, sizeof(type));
+    appendBytes(payload, &operation.attribute.length, sizeof(AttrLength));
+    appendBytes(payload, &dataLength, sizeof(dataLength));
+    payload.append(operation.data);
+
+    if(appendRecord(LOG_OPERATION, transaction, payload, operation.lsn) != 0){
+        return -1;
+    }
+    transaction->pageChanges.clear();
+    transaction->compensatedLSN = 0;
+    if(flags & OP_FLAG_COMMIT){
+        transaction->committed = true;
+        transaction->commitWithNextOperation = false;
+    }
+    else if(operation.operation != OP_NONE && operation.operation != OP_RECORD_DELETE){
+        transaction->operations.push_back(operation);
+    }
+    return 0;
+}
+
+RC LogManager::undoPageChanges() {
+    Transaction *transaction = _transaction.get();
+    if(transaction == nullptr){
+        return -1;
+    }
+    // a rollback starts here, the transaction can't commit with its next operation any more.
+    transaction->commitWithNextOperation = false;
+    if(transaction->pageChanges.empty() && transaction->compensatedLSN == 0){
+        return 0;
+    }
+    // the before images are written back as new page changes of the transaction, newest first
+    std::vector<LogPageChange> changes;
+    changes.swap(transaction->pageChanges);
+    void *page = malloc(PAGE_SIZE);
+    RC rc = 0;
+    for(auto it = changes.rbegin(); it != changes.rend(); it++){
+        FileHandle fileHandle;
+        LSN pageLSN;
+        if(PagedFileManager::instance().openFile(it->fileName, fileHandle) != 0){
+            // the file is gone, so is the change
+            continue;
+        }
+        if(fileHandle.readPageWithLSN(it->pageNum, page, pageLSN) == 0){
+            applyRanges(it->ranges, page, false);
+            if(fileHandle.writePage(it->pageNum, page) != 0){
+                rc = -1;
+            }
+        }
+        PagedFileManager::instance().closeFile(fileHandle);
+    }
+    free(page);
+    if(rc != 0){
+        return -1;
+    }
+
+    // end the operation, it needs no undo any more
+    LogOperation operation;
+    operation.operation = OP_NONE;
+    operation.rid.pageNum = 0;
+    operation.rid.slotNum = 0;
+    operation.attribute.type = TypeInt;
+    operation.attribute.length = 0;
+    return endOperation(operation);
+}
+
+RC LogManager::getOperationsToUndo(std::vector<LogOperation> &operations) {
+    if(!_transaction){
+        return -1;
+    }
+    operations.clear();
+    operations.swap(_transaction->operations);
+    return 0;
+}
+
+RC LogManager::setCompensatedLSN(LSN lsn) {
+    if(!_transaction){
+        return -1;
+    }
+    _transaction->compensatedLSN = lsn;
+    return 0;
+}
+
+RC LogManager::redo(std::vector<unsigned> &losers) {
+    losers.clear();
+    std::string log;
+    {
+        std::lock_guard<std::mutex> lock(_logMutex);
+        if(openLog(false) != 0){
+            // no log, nothing to recover
+            return 0;
+        }
+        log.resize(_endLSN - _baseLSN);
+        if(!log.empty() && pread(_fd, &log[0], log.size(), LOG_HEADER_SIZE) != (ssize_t)log.size()){
+            // std::cout << "[Error] redo -> fail to read the log." << std::endl;
+            return -1;
+        }
+    }
+
+    // 1. records which were written completely, a torn one at the end is cut off.
+    struct LogRecord {
+        LSN lsn;
+        char type;
+        unsigned txnId;
+        unsigned offset;        // of the payload in log
+        unsigned length;        // of the payload
+    };
+    std::vector<LogRecord> records;
+    unsigned offset = 0;
+    while(offset + LOG_RECORD_HEADER_SIZE + sizeof(unsigned) <= log.size()){
+        unsigned length, trailer;
+        memcpy(&length, &log[offset], sizeof(unsigned));
+        if(length < LOG_RECORD_HEADER_SIZE + sizeof(unsigned) || offset + length > log.size()){
+            break;
+        }
+        memcpy(&trailer, &log[offset + length - sizeof(unsigned)], sizeof(unsigned));
+        if(trailer != length){
+            break;
+        }
+        LogRecord record;
+        record.lsn = _baseLSN + offset;
+        memcpy(&record.type, &log[offset + 4], 1);
+        memcpy(&record.txnId, &log[offset + 5], sizeof(unsigned));
+        record.offset = offset + LOG_RECORD_HEADER_SIZE;
+        record.length = length - LOG_RECORD_HEADER_SIZE - sizeof(unsigned);
+        records.push_back(record);
+        offset += length;
+    }
+    if(offset < log.size()){
+        std::lock_guard<std::mutex> lock(_logMutex);
+        if(ftruncate(_fd, LOG_HEADER_SIZE + offset) != 0){
+            return -1;
+        }
+        _endLSN = _baseLSN + offset;
+        _durableLSN = _endLSN;
+    }
+
+    // 2. analysis: where files were dropped, what every transaction did
+    std::map<std::string, LSN> dropLSNs;
+    std::map<LSN, std::vector<std::pair<std::string, std::string>>> replacedFiles;
+    std::set<unsigned> ended;
+    std::map<unsigned, std::set<LSN>> compensated;
+    std::map<unsigned, LSN> firstLSNs;
+    LSN redoLSN = 0;
+    unsigned maxTxnId = 0;
+    for(const LogRecord &record : records){
+        const char *payload = log.c_str() + record.offset;
+        unsigned payloadOffset = 0;
+        if(record.txnId > maxTxnId){
+            maxTxnId = record.txnId;
+        }
+        if(record.type == LOG_DROP_FILE){
+            dropLSNs[readName(payload, payloadOffset)] = record.lsn;
+            continue;
+        }
+        if(record.type == LOG_REPLACE_FILES){
+            unsigned numOfFiles;
+            readBytes(payload, payloadOffset, &numOfFiles, sizeof(numOfFiles));
+            std::vector<std::pair<std::string, std::string>> &files = replacedFiles[record.lsn];
+            for(unsigned i = 0; i < numOfFiles; i++){
+                std::string newName = readName(payload, payloadOffset);
+                std::string oldName = readName(payload, payloadOffset);
+                dropLSNs[newName] = record.lsn;
+                dropLSNs[oldName] = record.lsn;
+                files.push_back(std::make_pair(newName, oldName));
+            }
+            continue;
+        }
+        if(record.type == LOG_CHECKPOINT){
+            // the changes logged before its redo LSN are in the data files, the running transactions have their records
+            // after the keep LSN of the checkpoint so the analysis finds them anyway.
+            readBytes(payload, payloadOffset, &redoLSN, sizeof(redoLSN));
+            continue;
+        }
+        if(record.type == LOG_REPLACE_END){
+            LSN replaceLSN;
+            readBytes(payload, payloadOffset, &replaceLSN, sizeof(replaceLSN));
+            replacedFiles.erase(replaceLSN);
+            continue;
+        }
+        if(record.txnId == 0){
+            continue;
+        }
+        std::unique_ptr<Transaction> &transaction = _recoveredTransactions[record.txnId];
+        if(!transaction){
+            transaction.reset(new Transaction());
+            transaction->txnId = record.txnId;
+            transaction->logged = true;
+            firstLSNs[record.txnId] = record.lsn;
+        }
+        transaction->lastLSN = record.lsn + record.length + LOG_RECORD_HEADER_SIZE + sizeof(unsigned);
+        if(record.type == LOG_PAGE){
+            LogPageChange change;
+            change.lsn = record.lsn;
+            change.fileName = readName(payload, payloadOffset);
+            readBytes(payload, payloadOffset, &change.pageNum, sizeof(PageNum));
+            change.ranges.assign(payload + payloadOffset, record.length - payloadOffset);
+            transaction->pageChanges.push_back(change);
+        }
+        else if(record.type == LOG_OPERATION){
+            char flags;
+            LSN compensatedLSN;
+            unsigned type, dataLength;
+            LogOperation operation;
+            operation.lsn = record.lsn;
+            readBytes(payload, payloadOffset, &flags, sizeof(flags));
+            readBytes(payload, payloadOffset, &compensatedLSN, sizeof(compensatedLSN));
+            readBytes(payload, payloadOffset, &operation.operation, sizeof(operation.operation));
+            operation.fileName = readName(payload, payloadOffset);
+            readBytes(payload, payloadOffset, &operation.rid, sizeof(RID));
+            readBytes(payload, payloadOffset, &type, sizeof(type));
+            operation.attribute.type = (AttrType)type;
+            readBytes(payload, payloadOffset, &operation.attribute.length, sizeof(AttrLength));
+            readBytes(payload, payloadOffset, &dataLength, sizeof(dataLength));
+            operation.data.assign(payload + payloadOffset, dataLength);
+
+            transaction->pageChanges.clear();
+            if(compensatedLSN != 0){
+                compensated[record.txnId].insert(compensatedLSN);
+            }
+            if(flags & OP_FLAG_COMMIT){
+                transaction->committed = true;
+            }
+            else if(operation.operation != OP_NONE && operation.operation != OP_RECORD_DELETE){
+                transaction->operations.push_back(operation);
+            }
+        }
+        else if(record.type == LOG_COMMIT){
+            transaction->committed = true;
+        }
+        else if(record.type == LOG_ABORT){
+            ended.insert(record.txnId);
+        }
+    }
+
+    // the replacements which did not end: the new files which are still there are renamed, the others have been already
+    for(auto &replaced : replacedFiles){
+        for(auto &file : replaced.second){
+            if(access(file.first.c_str(), F_OK) == 0 && rename(file.first.c_str(), file.second.c_str()) != 0){
+                return -1;
+            }
+        }
+    }
+
+    // 3. redo: repeat the history of every page whose LSN is older than the record, from the redo LSN of the last checkpoint.
+    std::map<std::string, std::unique_ptr<FileHandle>> fileHandles;
+    void *page = malloc(PAGE_SIZE);
+    for(const LogRecord &record : records){
+        if(record.type != LOG_PAGE || record.lsn < redoLSN){
+            continue;
+        }
+        const char *payload = log.c_str() + record.offset;
+        unsigned payloadOffset = 0;
+        std::string fileName = readName(payload, payloadOffset);
+        PageNum pageNum;
+        readBytes(payload, payloadOffset, &pageNum, sizeof(PageNum));
+        auto drop = dropLSNs.find(fileName);
+        if(drop != dropLSNs.end() && drop->second > record.lsn){
+            continue;
+        }
+
+        std::unique_ptr<FileHandle> &fileHandle = fileHandles[fileName];
+        if(!fileHandle){
+            fileHandle.reset(new FileHandle());
+            if(PagedFileManager::instance().openFile(fileName, *fileHandle) != 0){
+                // the file is gone, nothing to redo on it
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(_logMutex);
+            _loggedFiles.insert(fileName);
+        }
+        if(!fileHandle->getFile().is_open()){
+            continue;
+        }
+
+        LSN pageLSN = 0;
+        if(pageNum < fileHandle->getNumberOfPages()){
+            if(fileHandle->readPageWithLSN(pageNum, page, pageLSN) != 0){
+                free(page);
+                return -1;
+            }
+        }
+        else{
+            // the page was appended but never reached the file
+            memset(page, 0, PAGE_SIZE);
+        }
+        if(pageLSN >= record.lsn){
+            continue;
+        }
+        applyRanges(std::string(payload + payloadOffset, record.length - payloadOffset), page, true);
+        if(fileHandle->writePageWithLSN(pageNum, page, record.lsn) != 0){
+            free(page);
+            return -1;
+        }
+    }
+    free(page);
+    for(auto &fileHandle : fileHandles){
+        PagedFileManager::instance().closeFile(*fileHandle.second);
+    }
+
+    // 4. losers: neither committed nor rolled back, minus the operations they have compensated already
+    for(auto it = _recoveredTransactions.begin(); it != _recoveredTransactions.end();){
+        Transaction &transaction = *it->second;
+        if(transaction.committed || ended.count(transaction.txnId) != 0){
+            it = _recoveredTransactions.erase(it);
+            continue;
+        }
+        std::set<LSN> &compensatedLSNs = compensated[transaction.txnId];
+        std::vector<LogOperation> operations;
+        for(LogOperation &operation : transaction.operations){
+            if(compensatedLSNs.count(operation.lsn) == 0){
+                operations.push_back(operation);
+            }
+        }
+        transaction.operations.swap(operations);
+        losers.push_back(transaction.txnId);
+        {
+            // a checkpoint keeps their records until they are rolled back
+            std::lock_guard<std::mutex> lock(_logMutex);
+            _firstLSNs[transaction.txnId] = firstLSNs[transaction.txnId];
+        }
+        it++;
+    }
+    std::lock_guard<std::mutex> lock(_transactionMutex);
+    if(maxTxnId >= _nextTxnId){
+        _nextTxnId = maxTxnId + 1;
+    }
+    return 0;
+}
+
+RC LogManager::resumeTransaction(unsigned txnId) {
+    if(_transaction){
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(_transactionMutex);
+    auto it = _recoveredTransactions.find(txnId);
+    if(it == _recoveredTransactions.end()){
+        return -1;
+    }
+    _transaction = std::move(it->second);
+    _recoveredTransactions.erase(it);
+    return 0;
+}
+
+RC LogManager::checkpoint() {
+    std::lock_guard<std::mutex> checkpointLock(_checkpointMutex);
+    LSN redoLSN, keepLSN;
+    std::set<std::string> files;
+    std::string payload;
+    {
+        // no page is between its record and the file meanwhile: every change logged before redoLSN is in its data file
+        ExclusiveLatchGuard pageWriteGuard(_pageWriteLatch);
+        std::lock_guard<std::mutex> lock(_logMutex);
+        if(_fd < 0){
+            return 0;
+        }
+        redoLSN = _endLSN;
+        keepLSN = redoLSN;
+        unsigned numOfTransactions = _firstLSNs.size();
+        appendBytes(payload, &redoLSN, sizeof(redoLSN));
+        appendBytes(payload, &numOfTransactions, sizeof(numOfTransactions));
+        for(auto &first : _firstLSNs){
+            appendBytes(payload, &first.first, sizeof(unsigned));
+            if(first.second < keepLSN){
+                keepLSN = first.second;
+            }
+        }
+        files = _loggedFiles;
+        if(keepLSN == redoLSN){
+            // no record of these files is kept, a later drop need not be logged
+            _loggedFiles.clear();
+        }
+        _checkpointLSN = redoLSN;
+    }
+
+    // the transactions go on writing, their changes are after redoLSN
+    for(const std::string &fileName : files){
+        if(syncFile(fileName) != 0){
+            // std::cout << "[Error] checkpoint -> fail to sync " << fileName << std::endl;
+            std::lock_guard<std::mutex> lock(_logMutex);
+            _loggedFiles.insert(files.begin(), files.end());
+            return -1;
+        }
+    }
+    LSN lsn;
+    if(appendRecord(LOG_CHECKPOINT, nullptr, payload, lsn) != 0){
+        return -1;
+    }
+    // the running transactions may still be rolled back, their records stay
+    return truncateLog(keepLSN);
+}
+
+RWLatch &LogManager::getPageWriteLatch() {
+    return _pageWriteLatch;
+}
+
+RC LogManager::syncFile(const std::string &fileName) {
+    int fd = open(fileName.c_str(), O_RDWR);
+    if(fd < 0){
+        // destroyed since it was logged
+        return 0;
+    }
+    RC rc = fsync(fd);
+    close(fd);
+    return rc == 0 ? 0 : -1;
+}
+
+RC LogManager::truncateLog(LSN lsn) {
+    // flush(...) syncs _fd without holding _logMutex, so the log is swapped while holding its turn to sync
+    {
+        std::unique_lock<std::mutex> lock(_flushMutex);
+        _flushCond.wait(lock, [this](){ return !_flushing; });
+        _flushing = true;
+    }
+    RC rc = -1;
+    LSN durableLSN = 0;
+    {
+        // the records from lsn on go to a new log which replaces the old one in one rename
+        std::lock_guard<std::mutex> lock(_logMutex);
+        std::string tail(_endLSN - lsn, '\0');
+        int fd = open(LOG_TEMP_FILE_NAME, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0
+           || (!tail.empty() && pread(_fd, &tail[0], tail.size(), LOG_HEADER_SIZE + (lsn - _baseLSN)) != (ssize_t)tail.size())
+           || pwrite(fd, &lsn, LOG_HEADER_SIZE, 0) != (ssize_t)LOG_HEADER_SIZE
+           || (!tail.empty() && pwrite(fd, tail.c_str(), tail.size(), LOG_HEADER_SIZE) != (ssize_t)tail.size())
+           || fsync(fd) != 0 || rename(LOG_TEMP_FILE_NAME, LOG_FILE_NAME) != 0){
+            // std::cout << "[Error] truncateLog -> fail to write the new log." << std::endl;
+            if(fd >= 0){
+                close(fd);
+            }
+        }
+        else{
+            // the old log is gone from the directory, appends go to the new one even if the rename is not durable yet
+            close(_fd);
+            _fd = fd;
+            _baseLSN = lsn;
+            durableLSN = _endLSN;
+            rc = syncDirectory();
+        }
+    }
+    std::lock_guard<std::mutex> lock(_flushMutex);
+    _flushing = false;
+    _flushCond.notify_all();
+    if(durableLSN > _durableLSN){
+        _durableLSN = durableLSN;
+    }
+    return rc;
+}
+
+RC LogManager::collectCounterValues(unsigned &commitCount, unsigned &syncCount) {
+    std::lock_guard<std::mutex> lock(_flushMutex);
+    commitCount = _commitCounter;
+    syncCount = _syncCounter;
+    return 0;
+}
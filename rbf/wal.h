@@ -0,0 +1,199 @@
+#ifndef _wal_h_
+#define _wal_h_
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#include "pfm.h"
+#include "rbfm.h"
+
+#define LOG_FILE_NAME "wal_log"
+#define LOG_TEMP_FILE_NAME "wal_log_tmp"            // a checkpoint writes the rest of the log here, then renames it over the log
+#define LOG_HEADER_SIZE sizeof(LSN)                 // the log file starts with the LSN of its first record
+#define LOG_RECORD_HEADER_SIZE 9                    // length:4, type:1, txnId:4, then the payload and the length again:4
+#define LOG_CHECKPOINT_SIZE (4 * 1024 * 1024)       // a transaction which ends runs a checkpoint once this much was logged since the last one
+#define LOG_RANGE_GAP 8                             // changed bytes of a page closer than this are logged as one range
+
+// log record types
+#define LOG_PAGE 1              // bytes of one page changed by an operation, before and after images of the changed ranges
+#define LOG_OPERATION 2         // end of one rbfm / ix operation, with what is needed to undo it
+#define LOG_COMMIT 3
+#define LOG_ABORT 4             // all the operations of the transaction have been undone
+#define LOG_DROP_FILE 5         // the file is destroyed, its earlier records are not redone
+#define LOG_REPLACE_FILES 6     // files written aside replace data files, recovery finishes the renames
+#define LOG_REPLACE_END 7       // the renames of the LOG_REPLACE_FILES record before it are done
+#define LOG_CHECKPOINT 8        // redo LSN:8, numOfTransactions:4, then the txnId:4 of every running transaction
+
+// operations ended by a LOG_OPERATION record, the comment tells how a finished one is undone
+#define OP_NONE 0               // nothing: an undo step (compensation) or the rest of an operation which never finished
+#define OP_RECORD_INSERT 1      // delete the record
+#define OP_RECORD_UPDATE 2      // write the old formatted record back
+#define OP_RECORD_DELETE 3      // never undone, RelationManager commits the transaction together with it
+#define OP_ENTRY_INSERT 4       // delete the entry
+#define OP_ENTRY_DELETE 5       // insert the entry again
+#define OP_ROW_INSERT 6         // delete the row from the tree of the index-organized table
+#define OP_ROW_DELETE 7         // insert the row again
+
+#define OP_FLAG_COMMIT 1        // the LOG_OPERATION record also commits the transaction
+
+// A finished operation of a transaction, what is needed to undo it.
+struct LogOperation {
+    LSN lsn;                    // LSN of its LOG_OPERATION record
+    char operation;
+    std::string fileName;
+    RID rid;
+    Attribute attribute;        // type and length of the key, entry and row operations only
+    std::string data;           // the key of an entry operation, the old formatted record of OP_RECORD_UPDATE,
+                                // the key and then the row of a row operation
+};
+
+// One LOG_PAGE record of the operation which is running.
+struct LogPageChange {
+    LSN lsn;
+    std::string fileName;
+    PageNum pageNum;
+    std::string ranges;         // <offset:2, length:2, before image, after image> of every changed range
+};
+
+struct Transaction {
+    unsigned txnId;
+    bool logged = false;                        // wrote a log record
+    bool committed = false;                     // its commit is in the log
+    bool commitWithNextOperation = false;
+    LSN lastLSN = 0;                            // end of its last record, made durable by the commit
+    LSN compensatedLSN = 0;                     // while rolling back, the operation the running undo step compensates
+    std::vector<LogOperation> operations;       // finished operations which are not undone
+    std::vector<LogPageChange> pageChanges;     // page changes of the operation which is running
+};
+
+/*
+ * Write-ahead log for the DML of RelationManager.
+ *
+ * A transaction belongs to one thread. While it runs, every page written by FileHandle is logged first as a LOG_PAGE record
+ * with the before and after images of the changed bytes, and the page keeps the LSN of the record in its page header.
+ * The page is only written once the log is durable up to its record, so a page on disk never holds a change the log has lost.
+ * An rbfm / ix operation ends with a LOG_OPERATION record written while its pages are still latched, so it tells
+ * how to undo the operation logically: other transactions may change the same pages as soon as the latches are released,
+ * so only the page changes of an operation which never ended are undone page by page.
+ *
+ * Commit waits until its record is durable. Commits of concurrent transactions share one fsync: the first one to wait
+ * syncs everything logged so far while the others wait for it (group commit).
+ *
+ * Recovery (redo(...) and RelationManager's rollback of the losers): every LOG_PAGE record newer than the page LSN is applied
+ * again, then the transactions without commit or abort are rolled back. Undo steps end with a LOG_OPERATION record which
+ * names the operation they compensate, so a crash during recovery never undoes an operation twice.
+ *
+ * A checkpoint runs next to the transactions (fuzzy checkpoint): it syncs the logged data files, so every change logged
+ * before its redo LSN is durable, and writes a LOG_CHECKPOINT record with the running transactions. The log is then cut
+ * before the oldest LSN still needed, the first record of the oldest running transaction or else the redo LSN.
+ * Pages written outside a transaction are not logged, they get the current end of the log as page LSN.
+ */
+class LogManager {
+public:
+    static LogManager &instance();
+
+    RC beginTransaction();                                              // start a transaction on this thread
+    bool inTransaction() const;
+    RC commitWithNextOperation();                                       // the next operation which ends also commits the transaction
+    RC commitTransaction();                                             // log the commit, wait until it is durable
+    RC abortTransaction();                                              // log the abort after the transaction is rolled back
+
+    /*
+     * FileHandle calls it before a page reaches the file. data is the new content of the page, newPage is true when it is appended.
+     * pageLSN gets the LSN to write in the page header. Inside a transaction it returns once the record is durable.
+     */
+    RC logPageWrite(FileHandle &fileHandle, PageNum pageNum, const void *data, bool newPage, LSN &pageLSN);
+
+    RC dropFile(const std::string &fileName);                           // log that the file is destroyed, if it has been logged
+
+    /*
+     * Rename every first file of files over the second one as one step: once the new files are durable a LOG_REPLACE_FILES
+     * record is, so after a crash either all the old files are still there or recovery finishes the renames.
+     * The earlier records of both names are not redone any more. No transaction may write the files meanwhile.
+     */
+    RC replaceFiles(const std::vector<std::pair<std::string, std::string>> &files);
+
+    /*
+     * rbfm / ix call them at the end of an operation, before releasing the latches. Nothing is done outside a transaction.
+     * record is the old formatted record of OP_RECORD_UPDATE, row the deleted row of OP_ROW_DELETE.
+     */
+    RC logRecordOperation(char operation, FileHandle &fileHandle, const RID &rid, const void *record = nullptr, unsigned recordLength = 0);
+    RC logEntryOperation(char operation, FileHandle &fileHandle, const Attribute &attribute, const void *key, unsigned keyLength, const RID &rid);
+    RC logRowOperation(char operation, FileHandle &fileHandle, const Attribute &attribute, const void *key, unsigned keyLength,
+                       const void *row = nullptr, unsigned rowLength = 0);
+
+    /*
+     * Rollback of the transaction of this thread, see RelationManager::rollbackTransaction().
+     * undoPageChanges() writes the before images of the operation which did not end back and ends it.
+     * getOperationsToUndo(...) hands over the finished operations, oldest first.
+     * setCompensatedLSN(...) is called before every undo step, its LOG_OPERATION record then names the operation it undoes.
+     */
+    RC undoPageChanges();
+    RC getOperationsToUndo(std::vector<LogOperation> &operations);
+    RC setCompensatedLSN(LSN lsn);
+
+    /*
+     * Recovery. redo(...) applies the log to the data files and returns the transactions to roll back,
+     * resumeTransaction(...) makes one of them the transaction of this thread.
+     */
+    RC redo(std::vector<unsigned> &losers);
+    RC resumeTransaction(unsigned txnId);
+
+    RC checkpoint();                                                    // sync the logged data files, drop the log nobody needs any more
+
+    /*
+     * FileHandle holds it shared from logging a page until the page is written. A checkpoint takes it exclusively
+     * to get its redo LSN, so no record older than that is waiting for its page then.
+     */
+    RWLatch &getPageWriteLatch();
+
+    RC collectCounterValues(unsigned &commitCount, unsigned &syncCount); // commits and fsyncs of the log so far
+
+protected:
+    LogManager();                                                       // Prevent construction
+    ~LogManager();                                                      // Prevent unwanted destruction
+    LogManager(const LogManager &);                                     // Prevent construction by copying
+    LogManager &operator=(const LogManager &);                          // Prevent assignment
+
+private:
+    static thread_local std::unique_ptr<Transaction> _transaction;
+
+    int _fd = -1;
+    bool _logChecked = false;                   // looked for the log file already
+    LSN _baseLSN = 1;                           // LSN of the first byte after the header, 0 is never used
+    LSN _endLSN = 1;
+    LSN _durableLSN = 1;
+    std::set<std::string> _loggedFiles;         // data files with records in the log
+    std::map<unsigned, LSN> _firstLSNs;         // first record of every logged transaction which has not ended
+    std::mutex _logMutex;
+
+    std::mutex _flushMutex;
+    std::condition_variable _flushCond;
+    bool _flushing = false;
+
+    std::mutex _checkpointMutex;                // one checkpoint at a time, none while replaceFiles(...) runs
+    RWLatch _pageWriteLatch;
+    LSN _checkpointLSN = 1;                     // redo LSN of the last checkpoint
+
+    std::mutex _transactionMutex;
+    unsigned _nextTxnId = 1;
+    std::map<unsigned, std::unique_ptr<Transaction>> _recoveredTransactions;
+
+    unsigned _commitCounter = 0;
+    unsigned _syncCounter = 0;
+
+    RC openLog(bool create);                                            // _logMutex is held
+    RC appendRecord(char type, Transaction *transaction, const std::string &payload, LSN &lsn);
+    RC flush(LSN lsn);                                                  // make the log durable up to lsn
+    RC endOperation(LogOperation &operation);
+    RC endTransaction();
+    RC syncFile(const std::string &fileName);
+    RC truncateLog(LSN lsn);                                            // drop the log before lsn
+};
+
+#endif
@@ -1,7 +1,12 @@
 #include "rm.h"
 
 RC RM_ScanIterator::getNextTuple(RID &rid, void *data) {
-    RC rc = _rbfmScanItearator.getNextRecord(rid, data);
+    if(_tableLatch == nullptr){
+        // std::cout << "[Error]: getNextTuple -> the scan is not initialized." << std::endl;
+        return RM_EOF;
+    }
+    SharedLatchGuard guard(*_tableLatch);
+    RC rc = _clustered ? getNextRow(rid, data) : _rbfmScanItearator.getNextRecord(rid, data);
     if(rc == IX_EOF){
 //        std::cout << "[Warning]: getNextEntry -> scan terminates" << std::endl;
         return RM_EOF;
@@ -9,12 +14,92 @@ RC RM_ScanIterator::getNextTuple(RID &rid, void *data) {
     return rc;
 };
 
+RC RM_ScanIterator::setClusteredScan(const ClusteredTree &tree, const std::vector<std::vector<Attribute>> &versionDescriptors,
+                                     const std::string &conditionAttribute, CompOp compOp, const void *value,
+                                     const std::vector<std::string> &attributeNames) {
+    _clustered = true;
+    _tree = tree;
+    _versionDescriptors = versionDescriptors;
+    _conditionAttribute.name.clear();
+    if(!conditionAttribute.empty()){
+        const std::vector<Attribute> &attrs = versionDescriptors.back();
+        auto attr = std::find_if(attrs.begin(), attrs.end(), [&](const Attribute &a){ return a.name == conditionAttribute; });
+        if(attr == attrs.end()){
+            // std::cout << "[Error]: setClusteredScan -> can't find the condition attribute." << std::endl;
+            return -1;
+        }
+        _conditionAttribute = *attr;
+    }
+    _compOp = compOp;
+    _value = value;
+    _attributeNames = attributeNames;
+    return 0;
+}
+
+RC RM_ScanIterator::getNextRow(RID &rid, void *data) {
+    RecordBasedFileManager &rbfm = RecordBasedFileManager::instance();
+    IndexManager &im = IndexManager::instance();
+    char *key = (char *)malloc(PAGE_SIZE);
+    char *row = (char *)malloc(PAGE_SIZE);
+    char *value = (char *)malloc(PAGE_SIZE);
+    unsigned rowLength;
+    RC rc;
+    while((rc = _ixScanItearator.getNextRow(key, row, rowLength)) == 0){
+        // the row is read with the descriptor of the version it is stamped with, like a record of the heap file
+        std::string record(row, rowLength);
+        char16_t version;
+        memcpy(&version, row + flagLen, versionLen);
+        const std::vector<Attribute> &descriptor = version + 1u < _versionDescriptors.size() ? _versionDescriptors[version]
+                                                                                             : _versionDescriptors.back();
+        if(!_conditionAttribute.name.empty() && _compOp != NO_OP){
+            // NULL satisfies no condition, nor does an attribute the row was written without
+            if(rbfm.deFormatRecord(descriptor, {_conditionAttribute.name}, record, value) != 0 || (value[0] & (unsigned) 1 << (unsigned) 7)){
+                continue;
+            }
+            int cmp = im.compareKey(_conditionAttribute, value + 1, _value);
+            bool satisfied;
+            switch(_compOp){
+                case EQ_OP: satisfied = cmp == 0; break;
+                case LT_OP: satisfied = cmp < 0; break;
+                case LE_OP: satisfied = cmp <= 0; break;
+                case GT_OP: satisfied = cmp > 0; break;
+                case GE_OP: satisfied = cmp >= 0; break;
+                case NE_OP: satisfied = cmp != 0; break;
+                default: satisfied = true; break;
+            }
+            if(!satisfied){
+                continue;
+            }
+        }
+        rc = rbfm.deFormatRecord(descriptor, _attributeNames, record, data);
+        if(rc == 0){
+            rc = RelationManager::instance().decodeRowKey(_tree, key, rid);
+        }
+        break;
+    }
+    free(key);
+    free(row);
+    free(value);
+    return rc;
+}
+
 RC RM_ScanIterator::close() {
+    if(_clustered){
+        // close() also closes the tree
+        _ixScanItearator.close();
+        _clustered = false;
+        return 0;
+    }
     _rbfmScanItearator.close();
     return 0;
 };
 
 RC RM_IndexScanIterator::getNextEntry(RID &rid, void *key) {
+    if(_tableLatch == nullptr){
+        // std::cout << "[Error]: getNextEntry -> the scan is not initialized." << std::endl;
+        return RM_EOF;
+    }
+    SharedLatchGuard guard(*_tableLatch);
     RC rc = _ixScanItearator.getNextEntry(rid, key);
     if(rc == IX_EOF){
 //        std::cout << "[Warning]: getNextEntry -> scan terminates" << std::endl;
@@ -30,38 +115,54 @@ RC RM_IndexScanIterator::close() {
 
 RelationManager *RelationManager::_relation_manager = nullptr;
 
+// function-local static, its initialization is thread-safe.
 RelationManager &RelationManager::instance() {
-    static RelationManager _relation_manager = RelationManager();
+    static RelationManager _relation_manager;
     return _relation_manager;
 }
 
 RelationManager::RelationManager(){
     this->_rbfm = &RecordBasedFileManager::instance();
     this->_im = &IndexManager::instance();
+    this->_hm = &HashIndexManager::instance();
     
     this->prepareTablesDescriptor();
     this->prepareColumnsDescriptor();
     this->prepareIndexesDescriptor();
+    this->prepareStatisticsDescriptor();
     
-    
-    
+    // bring the tables back to the state of the committed transactions before anyone uses them
+    this->recover();
 };
 
 RelationManager::~RelationManager() { delete _relation_manager; }
 
-RelationManager::RelationManager(const RelationManager &) = default;
-
-RelationManager &RelationManager::operator=(const RelationManager &) = default;
+RWLatch &RelationManager::getTableLatch(const std::string &tableName){
+    std::lock_guard<std::mutex> lock(_tableLatchesMutex);
+    std::unique_ptr<RWLatch> &latch = _tableLatches[tableName];
+    if(!latch){
+        latch.reset(new RWLatch());
+    }
+    return *latch;
+}
 
 RC RelationManager::createCatalog() {
     
+    std::lock_guard<std::mutex> ddlGuard(_ddlMutex);
     FileHandle fileHandle;
     RC rc;
     
-    if((_rbfm->createFile(TABLE_NAME) != 0) || _rbfm->createFile(COLUMN_NAME) != 0 || _rbfm->createFile(INDEX_NAME) != 0){
+    if((_rbfm->createFile(TABLE_NAME) != 0) || _rbfm->createFile(COLUMN_NAME) != 0 || _rbfm->createFile(INDEX_NAME) != 0 ||
+       _rbfm->createFile(STATISTICS_NAME) != 0){
         // std::cout << "[Error]: createCatalog() -> system Catalogs already exist." << std::endl;
         return -1;
     }
+    // catalog indexes have to exist before any catalog record is inserted
+    if(_im->createFile(TABLE_NAME_INDEX) != 0 || _im->createFile(COLUMN_TABLE_ID_INDEX) != 0 || _im->createFile(INDEX_TABLE_NAME_INDEX) != 0 ||
+       _im->createFile(STATISTICS_TABLE_ID_INDEX) != 0){
+        // std::cout << "[Error]: createCatalog() -> catalog indexes already exist." << std::endl;
+        return -1;
+    }
     
     _rbfm->openFile(TABLE_NAME, fileHandle);
     rc = insertRecordToTables(fileHandle, *_rbfm, 1, TABLE_NAME, TABLE_NAME);
@@ -71,19 +172,27 @@ RC RelationManager::createCatalog() {
     }
     rc = insertRecordToTables(fileHandle, *_rbfm, 2, COLUMN_NAME, COLUMN_NAME);
     insertRecordToTables(fileHandle, *_rbfm, 3, INDEX_NAME, INDEX_NAME);
+    insertRecordToTables(fileHandle, *_rbfm, 4, STATISTICS_NAME, STATISTICS_NAME);
     _rbfm->closeFile(fileHandle);
     
     _rbfm->openFile(COLUMN_NAME, fileHandle);
     insertDescriptorToColumns(fileHandle, *_rbfm, 1, _tablesDescriptor);
     insertDescriptorToColumns(fileHandle, *_rbfm, 2, _columnsDescriptor);
     insertDescriptorToColumns(fileHandle, *_rbfm, 3, _indexesDescriptor);
+    insertDescriptorToColumns(fileHandle, *_rbfm, 4, _statisticsDescriptor);
     _rbfm->closeFile(fileHandle);
     
+    _rbfm->openFile(INDEX_NAME, fileHandle);
+    insertRecordToIndexes(fileHandle, *_rbfm, TABLE_NAME, "table-name", TABLE_NAME_INDEX);
+    insertRecordToIndexes(fileHandle, *_rbfm, COLUMN_NAME, "table-id", COLUMN_TABLE_ID_INDEX);
+    insertRecordToIndexes(fileHandle, *_rbfm, INDEX_NAME, "table-name", INDEX_TABLE_NAME_INDEX);
+    insertRecordToIndexes(fileHandle, *_rbfm, STATISTICS_NAME, "table-id", STATISTICS_TABLE_ID_INDEX);
+    _rbfm->closeFile(fileHandle);
     
     _rbfm->openFile(TABLE_NAME, fileHandle);
     fileHandle.getFile().seekp(3* sizeof(unsigned), std::ios::beg);
     // set the num of table to 0;
-    int num = 3;
+    int num = 4;
     fileHandle.getFile().write((char *)&num, sizeof(int));
     _rbfm->closeFile(fileHandle);
     
@@ -91,26 +200,42 @@ RC RelationManager::createCatalog() {
 }
 
 RC RelationManager::deleteCatalog() {
+    std::lock_guard<std::mutex> ddlGuard(_ddlMutex);
     // destroy Tables Catalog
     _rbfm->destroyFile(TABLE_NAME);
     //delete Columns Catalog
     _rbfm->destroyFile(COLUMN_NAME);
     // delete Indexes Catalog
     _rbfm->destroyFile(INDEX_NAME);
+    // delete Statistics Catalog
+    _rbfm->destroyFile(STATISTICS_NAME);
+    // delete catalog indexes
+    _im->destroyFile(TABLE_NAME_INDEX);
+    _im->destroyFile(COLUMN_TABLE_ID_INDEX);
+    _im->destroyFile(INDEX_TABLE_NAME_INDEX);
+    _im->destroyFile(STATISTICS_TABLE_ID_INDEX);
     return 0;
 }
 
-RC RelationManager::createTable(const std::string &tableName, const std::vector<Attribute> &attrs) {
+RC RelationManager::createTable(const std::string &tableName, const std::vector<Attribute> &attrs, const std::string &clusterKey) {
+    std::lock_guard<std::mutex> ddlGuard(_ddlMutex);
+    ExclusiveLatchGuard tableGuard(getTableLatch(tableName));
     
     FileHandle fileHandle;
     int tableID;
     void *data = malloc(PAGE_SIZE);
     
     // 1. check table file name
-    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME){
+    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME || tableName == STATISTICS_NAME){
         // std::cout << "[Error]: createTable -> can't create a Catalog file." << std::endl;
         return -1;
     }
+    if(!clusterKey.empty() &&
+       std::none_of(attrs.begin(), attrs.end(), [&](const Attribute &attr){ return attr.name == clusterKey; })){
+        // std::cout << "[Error]: createTable -> can't find the cluster key." << std::endl;
+        free(data);
+        return -1;
+    }
     
     // 2. Table ID
     _rbfm->openFile(TABLE_NAME, fileHandle);
@@ -139,13 +264,24 @@ RC RelationManager::createTable(const std::string &tableName, const std::vector<
     insertDescriptorToColumns(fileHandle, *_rbfm, tableID, attrs);
     _rbfm->closeFile(fileHandle);
     
+    // 6. the tree of an index-organized table, recorded in Indexes on the cluster key
+    if(!clusterKey.empty()){
+        std::string treeFileName = tableName + CLUSTERED_TREE_SUFFIX;
+        _im->createFile(treeFileName);
+        _rbfm->openFile(INDEX_NAME, fileHandle);
+        insertRecordToIndexes(fileHandle, *_rbfm, tableName, clusterKey, treeFileName);
+        _rbfm->closeFile(fileHandle);
+    }
+    
     free(data);
     return 0;
     
 }
 
 RC RelationManager::deleteTable(const std::string &tableName) {
-    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME){
+    std::lock_guard<std::mutex> ddlGuard(_ddlMutex);
+    ExclusiveLatchGuard tableGuard(getTableLatch(tableName));
+    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME || tableName == STATISTICS_NAME){
         // std::cout << "[Error] deleteTable -> can't delete catalog file: Tables and Columns." << std::endl;
         return -1;
     }
@@ -173,8 +309,10 @@ RC RelationManager::deleteTable(const std::string &tableName) {
          // std::cout << "[Error] deleteTable -> fail to deleteTableInsideColumns" << std::endl;
         return -1;
     }
+    // 3. deletes its statistics, a catalog created before Statistics has none
+    deleteTableInsideStatistics(tableId);
     
-    // 3. delete table
+    // 4. delete table
     _rbfm->destroyFile(tableName);
     return 0;
 }
@@ -188,53 +326,88 @@ RC RelationManager::getAttributes(const std::string &tableName, std::vector<Attr
 }
 
 RC RelationManager::insertTuple(const std::string &tableName, const void *data, RID &rid) {
+    SharedLatchGuard tableGuard(getTableLatch(tableName));
+    LogManager &logManager = LogManager::instance();
+    if(logManager.beginTransaction() != 0){
+        return -1;
+    }
+    if(insertTupleInTransaction(tableName, data, rid) != 0){
+        rollbackTransaction();
+        return -1;
+    }
+    return logManager.commitTransaction();
+}
+
+RC RelationManager::insertTupleInTransaction(const std::string &tableName, const void *data, RID &rid) {
     FileHandle fileHandle;
-    std::vector<Attribute> attrs;
+    std::vector<std::vector<Attribute>> versionDescriptors;
     RC rc;
     
-    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME){
+    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME || tableName == STATISTICS_NAME){
 //        std::cout << "[Warning]: User can not change the Catalog files." << std::endl;
         return -1;
     }
     
-    rc = getAttributes(tableName, attrs);
+    rc = getVersionDescriptors(tableName, versionDescriptors);
     if(rc != 0){
 //        std::cout << "[Error] insertTuple -> can't get correct descriptor for tableName." << std::endl;
         return -1;
     }
+    const std::vector<Attribute> &attrs = versionDescriptors.back();
+    
+    std::map<std::pair<std::string, std::string>, RID> columnIndexMap;
+    rc = generateCoumnIndexMapGivenTable(tableName, columnIndexMap);
+    if(rc != 0){
+        // std::cout << "[Error]: insertTuple -> generateCoumnIndexMapGivenTable." << std::endl;
+        return -1;
+    }
+    ClusteredTree tree;
+    bool clustered = getClusteredTree(columnIndexMap, attrs, tree) == 0;
     
-    // 0. insert into heap file
+    // 0. insert into heap file, only the cluster key of an index-organized table
     rc = _rbfm->openFile(tableName, fileHandle);
     if(rc != 0){
         // std::cout << "[Error] insertTuple -> fail to open file." << std::endl;
         return -1;
     }
     
-    rc = _rbfm->insertRecord(fileHandle, attrs, data, rid);
+    char *value = nullptr;
+    if(clustered){
+        value = (char *)malloc(PAGE_SIZE);
+        value[0] = getIndexKey(attrs, data, {tree.keyAttrs[0]}, value + 1) ? 0 : (char) 0x80;
+        rc = _rbfm->insertRecord(fileHandle, tree.locatorDescriptor, value, rid, 0);
+    }
+    else{
+        rc = _rbfm->insertRecord(fileHandle, attrs, data, rid, versionDescriptors.size() - 1);
+    }
 //    void *temp = malloc(PAGE_SIZE);
 //    _rbfm->readRecord(fileHandle, attrs, rid, temp);
 //    _rbfm->printRecord(attrs, temp);
     if(rc != 0){
         rc = _rbfm->closeFile(fileHandle);
         // std::cout << "[Error] insertTuple -> fail to insert tuple." << std::endl;
+        free(value);
         return -1;
     }
     rc = _rbfm->closeFile(fileHandle);
     if(rc != 0){
         // std::cout << "[Error] insertTuple -> fail to close file." << std::endl;
+        free(value);
         return -1;
     }
     
-    // insert into index file
-    std::map<std::pair<std::string, std::string>, RID> columnIndexMap;
-    rc = generateCoumnIndexMapGivenTable(tableName, columnIndexMap);
-    if(rc != 0){
-        // std::cout << "[Error]: insertTuple -> generateCoumnIndexMapGivenTable." << std::endl;
-        return -1;
+    // 1. the row of an index-organized table goes into its tree
+    if(clustered){
+        rc = insertClusteredRow(tree, versionDescriptors, data, value, rid);
+        free(value);
+        if(rc != 0){
+            // std::cout << "[Error] insertTuple -> fail to insert the row into the tree." << std::endl;
+            return -1;
+        }
     }
     
-    // this rid is from _rbfm.insertRecord
-    rc = indexOperationWhenTupleChanged(tableName, rid, columnIndexMap, attrs, 1);
+    // insert into index file, this rid is from _rbfm.insertRecord
+    rc = indexOperationWhenTupleChanged(tableName, rid, columnIndexMap, versionDescriptors, 1);
     if(rc != 0){
         // std::cout << "[Error]: insertTuple -> indexOperationWhenTupleChanged" << std::endl;
         return  -1;
@@ -244,19 +417,33 @@ RC RelationManager::insertTuple(const std::string &tableName, const void *data,
 }
 
 RC RelationManager::deleteTuple(const std::string &tableName, const RID &rid) {
+    SharedLatchGuard tableGuard(getTableLatch(tableName));
+    LogManager &logManager = LogManager::instance();
+    if(logManager.beginTransaction() != 0){
+        return -1;
+    }
+    if(deleteTupleInTransaction(tableName, rid) != 0){
+        rollbackTransaction();
+        return -1;
+    }
+    return logManager.commitTransaction();
+}
+
+RC RelationManager::deleteTupleInTransaction(const std::string &tableName, const RID &rid) {
     FileHandle fileHandle;
-    std::vector<Attribute> attrs;
+    std::vector<std::vector<Attribute>> versionDescriptors;
     RC rc;
     
-    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME){
+    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME || tableName == STATISTICS_NAME){
 //        std::cout << "[Warning]: User can not change the Catalog files." << std::endl;
         return -1;
     }
-    rc = getAttributes(tableName, attrs);
+    rc = getVersionDescriptors(tableName, versionDescriptors);
     if(rc != 0){
         // std::cout << "[Error] deleteTuple -> can't get correct descriptor for tableName." << std::endl;
         return -1;
     }
+    const std::vector<Attribute> &attrs = versionDescriptors.back();
     // delete from index file
     std::map<std::pair<std::string, std::string>, RID> columnIndexMap;
     rc = generateCoumnIndexMapGivenTable(tableName, columnIndexMap);
@@ -265,12 +452,25 @@ RC RelationManager::deleteTuple(const std::string &tableName, const RID &rid) {
         return -1;
     }
     
-    rc = indexOperationWhenTupleChanged(tableName, rid, columnIndexMap, attrs, 2);
+    rc = indexOperationWhenTupleChanged(tableName, rid, columnIndexMap, versionDescriptors, 2);
     if(rc != 0){
         // std::cout << "[Error]: insertTuple -> indexOperationWhenTupleChanged" << std::endl;
         return  -1;
     }
     
+    // the row of an index-organized table leaves its tree, its record in the heap file only has the cluster key
+    ClusteredTree tree;
+    bool clustered = getClusteredTree(columnIndexMap, attrs, tree) == 0;
+    if(clustered){
+        void *value = malloc(PAGE_SIZE);
+        rc = deleteClusteredRow(tableName, tree, rid, value);
+        free(value);
+        if(rc != 0){
+            // std::cout << "[Error] deleteTuple -> fail to delete the row from the tree." << std::endl;
+            return -1;
+        }
+    }
+    
     // delete from heap file
     rc = _rbfm->openFile(tableName, fileHandle);
     if(rc != 0){
@@ -278,7 +478,9 @@ RC RelationManager::deleteTuple(const std::string &tableName, const RID &rid) {
         return -1;
     }
     
-    rc = _rbfm->deleteRecord(fileHandle, attrs, rid);
+    // the deleted record can't be restored, so the transaction commits together with the delete.
+    LogManager::instance().commitWithNextOperation();
+    rc = _rbfm->deleteRecord(fileHandle, clustered ? tree.locatorDescriptor : attrs, rid);
     if(rc != 0){
         rc = _rbfm->closeFile(fileHandle);
         if(rc != 0){
@@ -299,20 +501,34 @@ RC RelationManager::deleteTuple(const std::string &tableName, const RID &rid) {
 }
 
 RC RelationManager::updateTuple(const std::string &tableName, const void *data, const RID &rid) {
+    SharedLatchGuard tableGuard(getTableLatch(tableName));
+    LogManager &logManager = LogManager::instance();
+    if(logManager.beginTransaction() != 0){
+        return -1;
+    }
+    if(updateTupleInTransaction(tableName, data, rid) != 0){
+        rollbackTransaction();
+        return -1;
+    }
+    return logManager.commitTransaction();
+}
+
+RC RelationManager::updateTupleInTransaction(const std::string &tableName, const void *data, const RID &rid) {
     FileHandle fileHandle;
-    std::vector<Attribute> attrs;
+    std::vector<std::vector<Attribute>> versionDescriptors;
     RC rc;
     
-    if(tableName == TABLE_NAME || tableName == COLUMN_NAME){
+    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == STATISTICS_NAME){
 //        std::cout << "[Warning]: User can not change the Catalog files." << std::endl;
         return -1;
     }
     
-    rc = getAttributes(tableName, attrs);
+    rc = getVersionDescriptors(tableName, versionDescriptors);
     if(rc != 0){
         // std::cout << "[Error] updateTuple -> can't get correct descriptor for tableName." << std::endl;
         return -1;
     }
+    const std::vector<Attribute> &attrs = versionDescriptors.back();
     
     // delete from index file
     std::map<std::pair<std::string, std::string>, RID> columnIndexMap;
@@ -322,12 +538,41 @@ RC RelationManager::updateTuple(const std::string &tableName, const void *data,
         return -1;
     }
     
-    rc = indexOperationWhenTupleChanged(tableName, rid, columnIndexMap, attrs, 2);
+    rc = indexOperationWhenTupleChanged(tableName, rid, columnIndexMap, versionDescriptors, 2);
     if(rc != 0){
         // std::cout << "[Error]: insertTuple -> indexOperationWhenTupleChanged" << std::endl;
         return  -1;
     }
     
+    // the row of an index-organized table is deleted from its tree and inserted again under its new cluster key
+    ClusteredTree tree;
+    if(getClusteredTree(columnIndexMap, attrs, tree) == 0){
+        char *oldValue = (char *)malloc(PAGE_SIZE);
+        char *value = (char *)malloc(PAGE_SIZE);
+        rc = deleteClusteredRow(tableName, tree, rid, oldValue);
+        if(rc == 0){
+            value[0] = getIndexKey(attrs, data, {tree.keyAttrs[0]}, value + 1) ? 0 : (char) 0x80;
+            int length = getTupleLength(tree.locatorDescriptor, value);
+            if(length != getTupleLength(tree.locatorDescriptor, oldValue) || memcmp(value, oldValue, length) != 0){
+                rc = _rbfm->openFile(tableName, fileHandle);
+                if(rc == 0){
+                    rc = _rbfm->updateRecord(fileHandle, tree.locatorDescriptor, value, rid, 0);
+                    _rbfm->closeFile(fileHandle);
+                }
+            }
+        }
+        if(rc == 0){
+            rc = insertClusteredRow(tree, versionDescriptors, data, value, rid);
+        }
+        free(oldValue);
+        free(value);
+        if(rc != 0){
+            // std::cout << "[Error] updateTuple -> fail to update the row in the tree." << std::endl;
+            return -1;
+        }
+        return indexOperationWhenTupleChanged(tableName, rid, columnIndexMap, versionDescriptors, 1);
+    }
+    
     // update heap file
     rc = _rbfm->openFile(tableName, fileHandle);
     if(rc != 0){
@@ -335,7 +580,8 @@ RC RelationManager::updateTuple(const std::string &tableName, const void *data,
         return -1;
     }
     
-    rc = _rbfm->updateRecord(fileHandle, attrs, data, rid);
+    // the updated record is rewritten with the current schema version
+    rc = _rbfm->updateRecord(fileHandle, attrs, data, rid, versionDescriptors.size() - 1);
     if(rc != 0){
         rc = _rbfm->closeFile(fileHandle);
         if(rc != 0){
@@ -360,7 +606,7 @@ RC RelationManager::updateTuple(const std::string &tableName, const void *data,
     }
     
     // this rid is from _rbfm.insertRecord
-    rc = indexOperationWhenTupleChanged(tableName, rid, columnIndexMap, attrs, 1);
+    rc = indexOperationWhenTupleChanged(tableName, rid, columnIndexMap, versionDescriptors, 1);
     if(rc != 0){
         // std::cout << "[Error]: insertTuple -> indexOperationWhenTupleChanged" << std::endl;
         return  -1;
@@ -368,25 +614,140 @@ RC RelationManager::updateTuple(const std::string &tableName, const void *data,
     return 0;
 }
 
+RC RelationManager::rollbackTransaction() {
+    LogManager &logManager = LogManager::instance();
+    // the operation which failed halfway is undone page by page, the finished ones logically, newest first.
+    RC rc = logManager.undoPageChanges();
+    std::vector<LogOperation> operations;
+    logManager.getOperationsToUndo(operations);
+    for(auto it = operations.rbegin(); it != operations.rend(); it++){
+        logManager.setCompensatedLSN(it->lsn);
+        if(undoOperation(*it) != 0){
+            // std::cout << "[Error] rollbackTransaction -> fail to undo an operation." << std::endl;
+            logManager.undoPageChanges();
+            rc = -1;
+        }
+    }
+    if(logManager.abortTransaction() != 0){
+        return -1;
+    }
+    return rc;
+}
+
+RC RelationManager::undoOperation(const LogOperation &operation) {
+    RC rc;
+    if(operation.operation == OP_RECORD_INSERT || operation.operation == OP_RECORD_UPDATE){
+        FileHandle fileHandle;
+        rc = _rbfm->openFile(operation.fileName, fileHandle);
+        if(rc != 0){
+            return -1;
+        }
+        if(operation.operation == OP_RECORD_INSERT){
+            // deleteRecord(...) only needs the rid
+            std::vector<Attribute> recordDescriptor;
+            rc = _rbfm->deleteRecord(fileHandle, recordDescriptor, operation.rid);
+        }
+        else{
+            rc = _rbfm->restoreRecord(fileHandle, operation.rid, operation.data.c_str(), operation.data.size());
+        }
+        _rbfm->closeFile(fileHandle);
+        return rc;
+    }
+    if(operation.operation == OP_ENTRY_INSERT || operation.operation == OP_ENTRY_DELETE){
+        IXFileHandle ixFileHandle;
+        rc = _im->openFile(operation.fileName, ixFileHandle);
+        if(rc != 0){
+            return -1;
+        }
+        bool isHash = _hm->isHashIndex(operation.fileName);
+        if(operation.operation == OP_ENTRY_INSERT){
+            rc = isHash ? _hm->deleteEntry(ixFileHandle, operation.attribute, operation.data.c_str(), operation.rid)
+                        : _im->deleteEntry(ixFileHandle, operation.attribute, operation.data.c_str(), operation.rid);
+        }
+        else{
+            rc = isHash ? _hm->insertEntry(ixFileHandle, operation.attribute, operation.data.c_str(), operation.rid)
+                        : _im->insertEntry(ixFileHandle, operation.attribute, operation.data.c_str(), operation.rid);
+        }
+        _im->closeFile(ixFileHandle);
+        return rc;
+    }
+    if(operation.operation == OP_ROW_INSERT || operation.operation == OP_ROW_DELETE){
+        // the data is the key of the row in the tree of an index-organized table, then the row
+        IXFileHandle ixFileHandle;
+        rc = _im->openFile(operation.fileName, ixFileHandle);
+        if(rc != 0){
+            return -1;
+        }
+        ixFileHandle.setClustered(true);
+        const char *key = operation.data.c_str();
+        if(operation.operation == OP_ROW_INSERT){
+            rc = _im->deleteRow(ixFileHandle, operation.attribute, key);
+        }
+        else{
+            unsigned keyLength = _im->getKeyLength(operation.attribute, key);
+            rc = _im->insertRow(ixFileHandle, operation.attribute, key, key + keyLength, operation.data.size() - keyLength);
+        }
+        _im->closeFile(ixFileHandle);
+        return rc;
+    }
+    return 0;
+}
+
+RC RelationManager::recover() {
+    LogManager &logManager = LogManager::instance();
+    std::vector<unsigned> losers;
+    if(logManager.redo(losers) != 0){
+        // std::cout << "[Error] recover -> fail to redo the log." << std::endl;
+        return -1;
+    }
+    RC rc = 0;
+    for(unsigned txnId : losers){
+        if(logManager.resumeTransaction(txnId) != 0 || rollbackTransaction() != 0){
+            rc = -1;
+        }
+    }
+    if(rc != 0){
+        return -1;
+    }
+    return logManager.checkpoint();
+}
+
 RC RelationManager::readTuple(const std::string &tableName, const RID &rid, void *data) {
+    SharedLatchGuard tableGuard(getTableLatch(tableName));
     FileHandle fileHandle;
     RC rc;
-    std::vector<Attribute> attrs;
+    std::vector<std::vector<Attribute>> versionDescriptors;
     
     
-    rc = getAttributes(tableName, attrs);
+    rc = getVersionDescriptors(tableName, versionDescriptors);
     if(rc != 0){
 //        std::cout << "[Error] readTuple -> can't get correct descriptor for tableName." << std::endl;
         return -1;
     }
     
+    ClusteredTree tree;
+    IXFileHandle ixFileHandle;
+    bool clustered = getClusteredTree(tableName, versionDescriptors.back(), tree) == 0;
+    if(clustered && openClusteredTree(tree, ixFileHandle) != 0){
+        return -1;
+    }
+    
     rc = _rbfm->openFile(tableName, fileHandle);
     if(rc != 0){
         // std::cout << "[Error] readTuple -> fail to open file." << std::endl;
+        if(clustered){
+            _im->closeFile(ixFileHandle);
+        }
         return -1;
     }
     
-    rc = _rbfm->readRecord(fileHandle, attrs, rid, data);
+    if(clustered){
+        rc = readClusteredTuple(fileHandle, ixFileHandle, tree, versionDescriptors, rid, data);
+        _im->closeFile(ixFileHandle);
+    }
+    else{
+        rc = readVersionedRecord(fileHandle, versionDescriptors, rid, data);
+    }
     if(rc != 0){
         rc = _rbfm->closeFile(fileHandle);
         if(rc != 0){
@@ -405,18 +766,96 @@ RC RelationManager::readTuple(const std::string &tableName, const RID &rid, void
     return 0;
 }
 
+RC RelationManager::readTuples(const std::string &tableName, const std::vector<RID> &rids, std::vector<std::string> &tuples) {
+    SharedLatchGuard tableGuard(getTableLatch(tableName));
+    FileHandle fileHandle;
+    std::vector<std::vector<Attribute>> versionDescriptors;
+    
+    if(getVersionDescriptors(tableName, versionDescriptors) != 0){
+//        std::cout << "[Error] readTuples -> can't get correct descriptor for tableName." << std::endl;
+        return -1;
+    }
+    if(_rbfm->openFile(tableName, fileHandle) != 0){
+        // std::cout << "[Error] readTuples -> fail to open file." << std::endl;
+        return -1;
+    }
+    
+    ClusteredTree tree;
+    IXFileHandle ixFileHandle;
+    if(getClusteredTree(tableName, versionDescriptors.back(), tree) == 0){
+        // the rows of an index-organized table are looked up in its tree one by one
+        tuples.assign(rids.size(), std::string());
+        if(openClusteredTree(tree, ixFileHandle) == 0){
+            char *data = (char *)malloc(PAGE_SIZE);
+            for(size_t i = 0; i < rids.size(); i++){
+                if(readClusteredTuple(fileHandle, ixFileHandle, tree, versionDescriptors, rids[i], data) == 0){
+                    tuples[i].assign(data, getTupleLength(versionDescriptors.back(), data));
+                }
+            }
+            free(data);
+            _im->closeFile(ixFileHandle);
+        }
+    }
+    else{
+        readTuplesFromFile(fileHandle, versionDescriptors, rids, tuples);
+    }
+    
+    if(_rbfm->closeFile(fileHandle) != 0){
+        // std::cout << "[Error] readTuples -> fail to close file." << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+RC RelationManager::readTuplesFromFile(FileHandle &fileHandle, const std::vector<std::vector<Attribute>> &versionDescriptors,
+                                       const std::vector<RID> &rids, std::vector<std::string> &tuples) {
+    tuples.assign(rids.size(), std::string());
+    // the rids are taken page by page, the records of a page are decoded from one read of it.
+    std::vector<size_t> order(rids.size());
+    for(size_t i = 0; i < order.size(); i++){
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&rids](size_t i, size_t j){ return rids[i].pageNum < rids[j].pageNum; });
+    
+    char *data = (char *)malloc(PAGE_SIZE);
+    std::vector<unsigned> slotNums;
+    std::vector<std::string> records;
+    size_t begin = 0;
+    while(begin < order.size()){
+        PageNum pageNum = rids[order[begin]].pageNum;
+        size_t end = begin;
+        slotNums.clear();
+        while(end < order.size() && rids[order[end]].pageNum == pageNum){
+            slotNums.push_back(rids[order[end]].slotNum);
+            end++;
+        }
+        if(_rbfm->readFormattedRecords(fileHandle, pageNum, slotNums, records) == 0){
+            for(size_t i = begin; i < end; i++){
+                const std::string &record = records[i - begin];
+                if(!record.empty() && deFormatVersionedRecord(versionDescriptors, record, data) == 0){
+                    tuples[order[i]].assign(data, getTupleLength(versionDescriptors.back(), data));
+                }
+            }
+        }
+        begin = end;
+    }
+    free(data);
+    return 0;
+}
+
 RC RelationManager::printTuple(const std::vector<Attribute> &attrs, const void *data) {
     return _rbfm->printRecord(attrs, data);
 }
 
 RC RelationManager::readAttribute(const std::string &tableName, const RID &rid, const std::string &attributeName,
                                   void *data) {
+    SharedLatchGuard tableGuard(getTableLatch(tableName));
     FileHandle fileHandle;
     RC rc;
-    std::vector<Attribute> attrs;
+    std::vector<std::vector<Attribute>> versionDescriptors;
     
     
-    rc = getAttributes(tableName, attrs);
+    rc = getVersionDescriptors(tableName, versionDescriptors);
     if(rc != 0){
         // std::cout << "[Error] readAttribute -> can't get correct descriptor for tableName." << std::endl;
         return -1;
@@ -428,7 +867,31 @@ RC RelationManager::readAttribute(const std::string &tableName, const RID &rid,
         return -1;
     }
     
-    rc = _rbfm->readAttribute(fileHandle, attrs, rid, attributeName, data);
+    ClusteredTree tree;
+    IXFileHandle ixFileHandle;
+    const std::vector<Attribute> &attrs = versionDescriptors.back();
+    if(getClusteredTree(tableName, attrs, tree) == 0){
+        // the attribute is taken from the whole row, in the format of _rbfm->readAttribute()
+        auto attr = std::find_if(attrs.begin(), attrs.end(), [&](const Attribute &a){ return a.name == attributeName; });
+        void *tuple = malloc(PAGE_SIZE);
+        rc = attr == attrs.end() ? -1 : openClusteredTree(tree, ixFileHandle);
+        if(rc == 0){
+            rc = readClusteredTuple(fileHandle, ixFileHandle, tree, versionDescriptors, rid, tuple);
+            _im->closeFile(ixFileHandle);
+        }
+        if(rc == 0){
+            int attrIndex = attr - attrs.begin();
+            int nullIndicatorSize = ceil((double(attrs.size())/CHAR_BIT));
+            memset(data, -1, nullIndicatorSize);
+            if(getIndexKey(attrs, tuple, {*attr}, (char *)data + nullIndicatorSize)){
+                ((unsigned char *)data)[attrIndex/CHAR_BIT] &= ~((unsigned) 1 << (unsigned) (7 - attrIndex%CHAR_BIT));
+            }
+        }
+        free(tuple);
+    }
+    else{
+        rc = readVersionedAttribute(fileHandle, versionDescriptors, rid, attributeName, data);
+    }
     if(rc != 0){
         // std::cout << "[Error] readAttribute -> fail to read attribute." << std::endl;
         rc = _rbfm->closeFile(fileHandle);
@@ -453,168 +916,395 @@ RC RelationManager::scan(const std::string &tableName,
                          const void *value,
                          const std::vector<std::string> &attributeNames,
                          RM_ScanIterator &rm_ScanIterator) {
+    SharedLatchGuard tableGuard(getTableLatch(tableName));
     RC rc;
-    std::vector<Attribute> attrs;
-    rc = getAttributes(tableName, attrs);
+    std::vector<std::vector<Attribute>> versionDescriptors;
+    rc = getVersionDescriptors(tableName, versionDescriptors);
     if(rc != 0){
         // std::cout << "[Error]: RelationManager::scan -> getAttributes" << std::endl;
         return -1;
     }
+    rm_ScanIterator.setTableLatch(&getTableLatch(tableName));
+    
+    ClusteredTree tree;
+    if(getClusteredTree(tableName, versionDescriptors.back(), tree) == 0){
+        // the tree is scanned in key order, a condition on the cluster key bounds the scan to its range
+        const void *lowKey = NULL, *highKey = NULL;
+        bool lowKeyInclusive = true, highKeyInclusive = true;
+        if(conditionAttribute == tree.keyAttrs[0].name && value != NULL){
+            if(compOp == EQ_OP || compOp == GT_OP || compOp == GE_OP){
+                lowKey = value;
+                lowKeyInclusive = compOp != GT_OP;
+            }
+            if(compOp == EQ_OP || compOp == LT_OP || compOp == LE_OP){
+                highKey = value;
+                highKeyInclusive = compOp != LT_OP;
+            }
+        }
+        if(openClusteredTree(tree, rm_ScanIterator.getIXFileHandle()) != 0){
+            return -1;
+        }
+        rc = _im->prefixScan(rm_ScanIterator.getIXFileHandle(), tree.keyAttrs, NULL, 0, lowKey, highKey, lowKeyInclusive,
+                             highKeyInclusive, rm_ScanIterator.getIXScanIterator());
+        if(rc != 0){
+            // std::cout << "[Error]: RelationManager::scan -> _im->prefixScan" << std::endl;
+            _im->closeFile(rm_ScanIterator.getIXFileHandle());
+            return -1;
+        }
+        rc = rm_ScanIterator.setClusteredScan(tree, versionDescriptors, conditionAttribute, compOp, value, attributeNames);
+        if(rc != 0){
+            rm_ScanIterator.close();
+        }
+        return rc;
+    }
+    
     _rbfm->openFile(tableName, rm_ScanIterator.getFileHandle());
-    rc = _rbfm->scan(rm_ScanIterator.getFileHandle(), attrs, conditionAttribute, compOp, value, attributeNames, rm_ScanIterator.getRBFMScanIterator());
+    rc = _rbfm->scan(rm_ScanIterator.getFileHandle(), versionDescriptors.back(), conditionAttribute, compOp, value, attributeNames, rm_ScanIterator.getRBFMScanIterator());
     if(rc != 0){
         // std::cout << "[Error]: RelationManager::scan -> _rbfm->scan" << std::endl;
         return -1;
     }
+    rm_ScanIterator.getRBFMScanIterator().setVersionDescriptors(versionDescriptors);
     return 0;
 }
 
-RC RelationManager::createIndex(const std::string &tableName, const std::string &attributeName){
+RC RelationManager::createIndex(const std::string &tableName, const std::string &attributeName, float fillFactor){
+    return createIndex(tableName, attributeName, btreeIndex, fillFactor);
+}
+
+RC RelationManager::createIndex(const std::string &tableName, const std::string &attributeName, IndexType indexType, float fillFactor){
+    std::lock_guard<std::mutex> ddlGuard(_ddlMutex);
+    ExclusiveLatchGuard tableGuard(getTableLatch(tableName));
     FileHandle fileHandle;
-    IXFileHandle ixFileHandle;
-    RBFM_ScanIterator rbfmScanIterator;
     
-    std::string indexFileName = tableName + "_" + attributeName;
-    // 1. test the file existence.
-    if(_im->openFile(indexFileName, ixFileHandle) == 0){
+    std::string indexFileName = tableName + "_" + attributeName + (indexType == hashIndex ? HASH_INDEX_SUFFIX : "");
+    // 1. test the existence of an index of either type on the attribute, then create the file.
+    if(getIndexFileName(tableName, attributeName, indexFileName) == 0){
         // std::cout << "[Error]: createIndex -> Index file already exists." << std::endl;
         return -1;
     }
-    else if(_im->createFile(indexFileName) != 0){
+    else if((indexType == hashIndex ? _hm->createFile(indexFileName) : _im->createFile(indexFileName)) != 0){
         // std::cout << "[Error]: createIndex -> fail to create index file." << std::endl;
         return -1;
     }
     
-    RID rid;
     RC rc;
     
     // 2. insert record into Indexes Catalog
-    void *data = malloc(PAGE_SIZE);
     _rbfm->openFile(INDEX_NAME, fileHandle);
     rc = insertRecordToIndexes(fileHandle, *_rbfm, tableName, attributeName, indexFileName);
-    free(data);
     if(rc != 0){
         // std::cout << "[Error] createIndex -> fail to insertRecordToIndexes" << std::endl;
         return -1;
     }
     _rbfm->closeFile(fileHandle);
     
+    return buildIndex(tableName, tableName, attributeName, indexFileName, fillFactor);
+}
+
+RC RelationManager::createCompositeIndex(const std::string &tableName, const std::vector<std::string> &attributeNames, float fillFactor){
+    if(attributeNames.empty()){
+        // std::cout << "[Error]: createCompositeIndex -> no attribute to index." << std::endl;
+        return -1;
+    }
+    std::string columnName = attributeNames[0];
+    for(size_t i = 1; i < attributeNames.size(); i++){
+        columnName += COMPOSITE_KEY_SEPARATOR + attributeNames[i];
+    }
+    return createIndex(tableName, columnName, fillFactor);
+}
+
+RC RelationManager::buildIndex(const std::string &tableName, const std::string &tableFileName, const std::string &attributeName,
+                               const std::string &indexFileName, float fillFactor){
+    FileHandle fileHandle;
+    IXFileHandle ixFileHandle;
+    RC rc;
+    
     // Open for table file
-    rc = _rbfm->openFile(tableName, fileHandle);
+    rc = _rbfm->openFile(tableFileName, fileHandle);
     if(rc != 0){
         // std::cout << "[Error]: createIndex -> fail to open table file" << std::endl;
         return -1;
     }
-    if(fileHandle.getNumberOfPages() == 0){
-        _rbfm->closeFile(fileHandle);
+    unsigned numOfPages = fileHandle.getNumberOfPages();
+    _rbfm->closeFile(fileHandle);
+    if(numOfPages == 0){
 //        std::cout << "[Warning]: createIndex -> empty table." << std::endl;
         return 0;
     }
-    _rbfm->closeFile(fileHandle);
     
-    // 3. get attributes and attribute
-    std::vector<Attribute> attrs;
+    // 3. get attributes and the attributes of the key
+    std::vector<std::vector<Attribute>> versionDescriptors;
+    std::vector<Attribute> keyAttrs;
     Attribute attribute;
-    getAttributes(tableName, attrs);
-    for(Attribute &attr : attrs){
-        if(attributeName == attr.name){
-            attribute = attr;
-            break;
-        }
-    }
-    if(attribute.name != attributeName){
+    getVersionDescriptors(tableName, versionDescriptors);
+    if(getIndexAttributes(versionDescriptors.back(), attributeName, keyAttrs, attribute) != 0){
         // std::cout << "[Error]: createIndex -> can't find the index." << std::endl;
         return -1;
     }
     
-    // initialize scan
-    void *returnedData = malloc(PAGE_SIZE);
-    std::vector<std::string> attrNames;
-    attrNames.push_back(attributeName);
-    
-    
-    _rbfm->openFile(tableName, fileHandle);
-    _im->openFile(indexFileName, ixFileHandle);
-    rc = _rbfm->scan(fileHandle, attrs, "", NO_OP, NULL, attrNames, rbfmScanIterator);
-    if(rc != 0){
-        // std::cout << "[Error]: createIndex -> fail to initiate scan iterator" << std::endl;
-        free(returnedData);
-        return -1;
-    }
-
-    // do scan operation
-    int nullIndicatorSize = ceil((double)attrNames.size()/CHAR_BIT);
-    while (rbfmScanIterator.getNextRecord(rid, returnedData) != RM_EOF){
-        char* nullIndicator = (char *)malloc(nullIndicatorSize);
-        memcpy(nullIndicator, returnedData, nullIndicatorSize);
-        if(nullIndicator[0] & (unsigned) 1 << (unsigned)7){
-            // std::cout << "[Error]: createIndex -> index attribute is null" << std::endl;
-            free(nullIndicator);
-            return -1;
-        }
-        free(nullIndicator);
-        memmove((char *)returnedData, (char *)returnedData+nullIndicatorSize, PAGE_SIZE-nullIndicatorSize);
-        rc = _im->insertEntry(ixFileHandle, attribute, returnedData, rid);
-        if(rc != 0){
-            // std::cout << "[Error]: RelationManager::createIndex -> fail to insert into index file." << std::endl;
+    // 4. extract <key, rid> pairs, each thread scans its own range of pages with its own FileHandle.
+    unsigned numOfThreads = std::max(1u, std::thread::hardware_concurrency());
+    numOfThreads = std::min(numOfThreads, std::min(numOfPages, (unsigned)INDEX_BUILD_MAX_THREADS));
+    std::vector<IndexEntry> entries;
+    unsigned numOfTuples = 0;
+    ClusteredTree tree;
+    if(getClusteredTree(tableName, versionDescriptors.back(), tree) == 0){
+        // the rows of an index-organized table are in its tree, which is scanned once
+        char *key = (char *)malloc(PAGE_SIZE);
+        rc = forEachRow(tree, versionDescriptors, [&](const RID &rid, const void *tuple){
+            numOfTuples++;
+            if(getIndexKey(versionDescriptors.back(), tuple, keyAttrs, key)){
+                IndexEntry entry;
+                entry.key.assign(key, _im->getKeyLength(attribute, key));
+                entry.rid = rid;
+                entries.push_back(entry);
+            }
+        });
+        free(key);
+        if(rc != 0 || _im->openFile(tree.fileName, ixFileHandle) != 0){
+            // std::cout << "[Error]: createIndex -> fail to scan the tree." << std::endl;
             return -1;
         }
+        numOfPages = ixFileHandle.getFileHandle().getNumberOfPages();
+        _im->closeFile(ixFileHandle);
     }
+    else{
+        std::vector<std::vector<IndexEntry>> partitions(numOfThreads);
+        std::vector<RC> results(numOfThreads, 0);
+        std::vector<unsigned> numsOfTuples(numOfThreads, 0);
+        std::vector<std::thread> threads;
+        for(unsigned i = 0; i < numOfThreads; i++){
+            unsigned startPage = (unsigned)((unsigned long)numOfPages * i / numOfThreads);
+            unsigned endPage = (unsigned)((unsigned long)numOfPages * (i + 1) / numOfThreads);
+            threads.emplace_back([&, i, startPage, endPage](){
+                results[i] = scanIndexEntries(tableFileName, versionDescriptors, keyAttrs, startPage, endPage, partitions[i], numsOfTuples[i]);
+            });
+        }
+        for(auto &thread : threads){
+            thread.join();
+        }
     
-    free(returnedData);
-    rbfmScanIterator.close();
+        for(unsigned i = 0; i < numOfThreads; i++){
+            if(results[i] != 0){
+                // std::cout << "[Error]: createIndex -> fail to scan the table." << std::endl;
+                return -1;
+            }
+            entries.insert(entries.end(), partitions[i].begin(), partitions[i].end());
+            std::vector<IndexEntry>().swap(partitions[i]);
+            numOfTuples += numsOfTuples[i];
+        }
+    }
+    
+    // the keys are all here, the statistics of the column come for a few more comparisons.
+    // A catalog created before Statistics has none, the index is built all the same.
+    if(keyAttrs.size() == 1){
+        updateIndexStatistics(tableName, attribute, entries, numOfTuples, numOfPages);
+    }
+    
+    // 5. sort and build the B+ tree bottom-up, or fill the buckets of a hash index
+    _im->openFile(indexFileName, ixFileHandle);
+    if(_hm->isHashIndex(indexFileName)){
+        rc = _hm->bulkBuild(ixFileHandle, attribute, entries);
+    }
+    else{
+        rc = _im->bulkBuild(ixFileHandle, attribute, entries, fillFactor, numOfThreads);
+    }
 //    _im->printBtree(ixFileHandle, attribute);
-    // Open for table file and index file
-    rc = _im->closeFile(ixFileHandle);
+    _im->closeFile(ixFileHandle);
     if(rc != 0){
-        // std::cout << "[Error]: createIndex -> fail to close index file" << std::endl;
+        // std::cout << "[Error]: RelationManager::createIndex -> fail to build the index file." << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+RC RelationManager::updateIndexStatistics(const std::string &tableName, const Attribute &attribute, const std::vector<IndexEntry> &entries,
+                                          unsigned numOfTuples, unsigned numOfPages){
+    int tableId;
+    RID rid;
+    if(getTableIdForCustomTable(tableName, tableId, rid) != 0){
+        // std::cout << "[Error]: updateIndexStatistics -> can't find the table." << std::endl;
+        return -1;
+    }
+    
+    StatisticsCollector collector(attribute);
+    for(const IndexEntry &entry : entries){
+        collector.add(entry.key.data());
+    }
+    for(unsigned i = entries.size(); i < numOfTuples; i++){
+        collector.add(nullptr);
+    }
+    ColumnStatistics column;
+    collector.getStatistics(column);
+    TableStatistics table = {numOfTuples, numOfPages};
+    if(writeStatistics(tableId, "", table, nullptr) != 0 || writeStatistics(tableId, attribute.name, table, &column) != 0){
+        // std::cout << "[Error]: updateIndexStatistics -> fail to write Statistics." << std::endl;
         return -1;
     }
     return 0;
 }
 
 RC RelationManager::destroyIndex(const std::string &tableName, const std::string &attributeName){
-    FileHandle fileHandle;
-    IXFileHandle ixFileHandle;
-    RBFM_ScanIterator rbfmScanIterator;
+    std::lock_guard<std::mutex> ddlGuard(_ddlMutex);
+    ExclusiveLatchGuard tableGuard(getTableLatch(tableName));
+    return removeIndex(tableName, attributeName);
+}
+
+RC RelationManager::removeIndex(const std::string &tableName, const std::string &attributeName){
+    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME || tableName == STATISTICS_NAME){
+//        std::cout << "[Warning]: User can not destroy the indexes on Catalog files." << std::endl;
+        return -1;
+    }
     
+    FileHandle fileHandle;
     RC rc;
-    // destroy the file
-    std::string indexFileName = tableName + "_" + attributeName;
-    _rbfm->destroyFile(indexFileName);
     
-    // prepare the value
-    void *value = malloc(PAGE_SIZE);
-    int indexLen = strlen(indexFileName.c_str());
-    memcpy(value, &indexLen, 4);
-    memcpy((char *)value+4, indexFileName.c_str(), indexLen);
+    // find the record in Indexes, the index file is named after its type
+    std::map<std::pair<std::string, std::string>, RID> columnIndexMap;
+    rc = generateCoumnIndexMapGivenTable(tableName, columnIndexMap);
+    auto it = columnIndexMap.begin();
+    while(it != columnIndexMap.end() && (it->first.first != attributeName || isClusteredTree(it->first.second))){
+        it++;
+    }
+    if(rc != 0 || it == columnIndexMap.end()){
+        // std::cout << "[Error]: destroyIndex -> can't find the index." << std::endl;
+        return -1;
+    }
     
-    // prepare attrs vector
-    std::vector<std::string> attrNames;
-    attrNames.emplace_back("index-name");
+    // destroy the file
+    _im->destroyFile(it->first.second);
     
-    // initiate scan
+    // delete the record inside Indexes and its entry in the catalog index
     _rbfm->openFile(INDEX_NAME, fileHandle);
-    rc = _rbfm->scan(fileHandle, _indexesDescriptor, "index-name", EQ_OP, value, attrNames, rbfmScanIterator);
+    rc = _rbfm->deleteRecord(fileHandle, _indexesDescriptor, it->second);
+    _rbfm->closeFile(fileHandle);
     if(rc != 0){
-        // std::cout << "[Error]: destroyIndex -> fail to initialize the scan iterator" << std::endl;
+        // std::cout << "[Error]: destroyIndex -> fail to delete record in Indexes." << std::endl;
+        return -1;
+    }
+    
+    void *key = malloc(PAGE_SIZE);
+    int offset = 0;
+    int length = tableName.size();
+    std::string name = tableName;
+    prepareVarChar(length, name, key, offset);
+    rc = updateCatalogIndex(INDEX_TABLE_NAME_INDEX, _indexesDescriptor[0], key, it->second, 2);
+    free(key);
+    return rc;
+}
+
+RC RelationManager::clusterTable(const std::string &tableName, const std::string &attributeName){
+    std::lock_guard<std::mutex> ddlGuard(_ddlMutex);
+    ExclusiveLatchGuard tableGuard(getTableLatch(tableName));
+    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME || tableName == STATISTICS_NAME){
+//        std::cout << "[Warning]: User can not change the Catalog files." << std::endl;
+        return -1;
+    }
+    
+    // 1. the current descriptor and the attribute
+    std::vector<std::vector<Attribute>> versionDescriptors;
+    if(getVersionDescriptors(tableName, versionDescriptors) != 0){
+        // std::cout << "[Error]: clusterTable -> can't get correct descriptor for tableName." << std::endl;
+        return -1;
+    }
+    const std::vector<Attribute> &attrs = versionDescriptors.back();
+    std::vector<Attribute> keyAttrs;
+    Attribute attribute;
+    if(getIndexAttributes(attrs, attributeName, keyAttrs, attribute) != 0){
+        // std::cout << "[Error]: clusterTable -> can't find the attribute." << std::endl;
+        return -1;
+    }
+    ClusteredTree tree;
+    if(getClusteredTree(tableName, attrs, tree) == 0){
+        // std::cout << "[Error]: clusterTable -> an index-organized table is kept in the order of its cluster key." << std::endl;
         return -1;
     }
     
-    // do the scan
+    // 2. <key, rid> of every tuple in key order, NULL keys are empty and go last
+    FileHandle fileHandle;
+    if(_rbfm->openFile(tableName, fileHandle) != 0){
+        // std::cout << "[Error]: clusterTable -> fail to open table file" << std::endl;
+        return -1;
+    }
+    std::vector<IndexEntry> entries;
+    unsigned numOfTuples;
+    if(scanIndexEntries(tableName, versionDescriptors, keyAttrs, 0, fileHandle.getNumberOfPages(), entries, numOfTuples, true) != 0){
+        _rbfm->closeFile(fileHandle);
+        return -1;
+    }
+    std::stable_sort(entries.begin(), entries.end(), [&](const IndexEntry &entry1, const IndexEntry &entry2){
+        if(entry1.key.empty() || entry2.key.empty()){
+            return !entry1.key.empty() && entry2.key.empty();
+        }
+        return _im->compareKey(attribute, entry1.key.data(), entry2.key.data()) < 0;
+    });
+    
+    // 3. fetch the tuples in that order into the new table file, each batch reads a page once for all its rids
+    std::string clusteredFileName = CLUSTERED_FILE_PREFIX + tableName;
+    FileHandle clusteredFileHandle;
+    _rbfm->destroyFile(clusteredFileName);
+    RC rc = _rbfm->createFile(clusteredFileName);
+    if(rc == 0){
+        rc = _rbfm->openFile(clusteredFileName, clusteredFileHandle);
+    }
+    std::vector<RID> rids;
+    std::vector<std::string> tuples;
     RID rid;
-    void *data = malloc(PAGE_SIZE);
-    while(rbfmScanIterator.getNextRecord(rid, data) != RM_EOF){
-        deleteTuple(INDEX_NAME, rid);
+    for(size_t begin = 0; begin < entries.size() && rc == 0; begin += CLUSTER_FETCH_BATCH){
+        rids.clear();
+        for(size_t i = begin; i < std::min(entries.size(), begin + CLUSTER_FETCH_BATCH); i++){
+            rids.push_back(entries[i].rid);
+        }
+        rc = readTuplesFromFile(fileHandle, versionDescriptors, rids, tuples);
+        for(size_t i = 0; i < tuples.size() && rc == 0; i++){
+            // every tuple was scanned under the same latch, a missing one is an error
+            rc = tuples[i].empty() ? -1 : _rbfm->insertRecord(clusteredFileHandle, attrs, tuples[i].data(), rid, versionDescriptors.size() - 1);
+        }
     }
+    std::vector<IndexEntry>().swap(entries);
+    _rbfm->closeFile(clusteredFileHandle);
+    _rbfm->closeFile(fileHandle);
     
-    // close the scan
-    rbfmScanIterator.close();
+    // 4. the tuples have new RIDs, every index and its Bloom filter is built again aside, on the new file
+    std::vector<std::pair<std::string, std::string>> files;
+    files.push_back(std::make_pair(clusteredFileName, tableName));
+    std::map<std::pair<std::string, std::string>, RID> columnIndexMap;
+    if(rc == 0){
+        rc = generateCoumnIndexMapGivenTable(tableName, columnIndexMap);
+    }
+    for(auto index = columnIndexMap.begin(); index != columnIndexMap.end() && rc == 0; index++){
+        const std::string &indexFileName = index->first.second;
+        std::string clusteredIndexFileName = CLUSTERED_FILE_PREFIX + indexFileName;
+        std::shared_ptr<BloomFilter> filter = _im->getBloomFilter(indexFileName);
+        _im->destroyFile(clusteredIndexFileName);
+        files.push_back(std::make_pair(clusteredIndexFileName, indexFileName));
+        rc = _hm->isHashIndex(clusteredIndexFileName) ? _hm->createFile(clusteredIndexFileName) : _im->createFile(clusteredIndexFileName);
+        if(rc == 0){
+            rc = buildIndex(tableName, clusteredFileName, index->first.first, clusteredIndexFileName, IX_FILL_FACTOR);
+        }
+        if(rc == 0 && filter){
+            // the new one gets the rate of the old one
+            rc = buildBloomFilter(tableName, index->first.first, clusteredIndexFileName, filter->getFalsePositiveRate());
+            files.push_back(std::make_pair(clusteredIndexFileName + BLOOM_FILE_SUFFIX, indexFileName + BLOOM_FILE_SUFFIX));
+        }
+        // the filter is read again under the name it gets
+        _im->reloadFile(clusteredIndexFileName);
+    }
+    if(rc != 0){
+        // std::cout << "[Error]: clusterTable -> fail to write the clustered files" << std::endl;
+        for(const auto &file : files){
+            PagedFileManager::instance().destroyFile(file.first);
+        }
+        return -1;
+    }
     
-    // free the memory
-    free(data);
-    free(value);
-    return 0;
+    // 5. swap them all in at once, the records of the old files in the log are not redone on the new ones
+    rc = LogManager::instance().replaceFiles(files);
+    for(const auto &index : columnIndexMap){
+        _im->reloadFile(index.first.second);
+    }
+    return rc;
 }
 
 // indexScan returns an iterator to allow the caller to go through qualified entries in index
@@ -624,32 +1314,36 @@ RC RelationManager::indexScan(const std::string &tableName,
              const void *highKey,
              bool lowKeyInclusive,
              bool highKeyInclusive,
-             RM_IndexScanIterator &rm_IndexScanIterator){
-    std::vector<Attribute> attrs;
+             RM_IndexScanIterator &rm_IndexScanIterator,
+             bool reverse){
+    SharedLatchGuard tableGuard(getTableLatch(tableName));
+    std::vector<Attribute> attrs, keyAttrs;
     Attribute attribute;
     RC rc;
     
-    // get attribute
+    // get attribute, the one of the encoded keys for a composite index
     rc = getAttributes(tableName, attrs);
-    for(Attribute attr: attrs){
-        if(attr.name == attributeName){
-            attribute = attr;
-//            std::cout << "Attribute name: " << attribute.name << std::endl;
-        }
-    }
-    if(rc != 0 || attribute.name != attributeName){
+    if(rc != 0 || getIndexAttributes(attrs, attributeName, keyAttrs, attribute) != 0){
         // std::cout << "[Error] indexScan -> getAttributes" << std::endl;
         return -1;
     }
     
     // initialize scan
-    std::string indexFileName = tableName+"_"+attributeName;
-    rc = _im->openFile(indexFileName, rm_IndexScanIterator.getIXFileHandle());
-    if(rc != 0){
-        // std::cout << "[Error]: indexScan -> fail to open index file" << std::endl;
+    std::string indexFileName;
+    if(getIndexFileName(tableName, attributeName, indexFileName) != 0 || (reverse && _hm->isHashIndex(indexFileName)) ||
+       _im->openFile(indexFileName, rm_IndexScanIterator.getIXFileHandle()) != 0){
+        // std::cout << "[Error]: indexScan -> fail to open index file, or a reverse scan of a hash index" << std::endl;
         return -1;
     }
-    rc = _im->scan(rm_IndexScanIterator.getIXFileHandle(), attribute, lowKey, highKey, lowKeyInclusive, highKeyInclusive, rm_IndexScanIterator.getIXScanIterator());
+    rm_IndexScanIterator.setTableLatch(&getTableLatch(tableName));
+    if(_hm->isHashIndex(indexFileName)){
+        rc = _hm->scan(rm_IndexScanIterator.getIXFileHandle(), attribute, lowKey, highKey, lowKeyInclusive, highKeyInclusive,
+                       rm_IndexScanIterator.getIXScanIterator());
+    }
+    else{
+        rc = _im->scan(rm_IndexScanIterator.getIXFileHandle(), attribute, lowKey, highKey, lowKeyInclusive, highKeyInclusive,
+                       rm_IndexScanIterator.getIXScanIterator(), reverse);
+    }
     if(rc != 0){
         // std::cout << "[Error]: indexScan -> fail to create IX_ScanItarator" << std::endl;
         return -1;
@@ -657,14 +1351,346 @@ RC RelationManager::indexScan(const std::string &tableName,
     return 0;
 }
 
+RC RelationManager::indexPrefixScan(const std::string &tableName,
+                                    const std::vector<std::string> &attributeNames,
+                                    const void *prefix,
+                                    unsigned numOfPrefixAttributes,
+                                    const void *lowKey,
+                                    const void *highKey,
+                                    bool lowKeyInclusive,
+                                    bool highKeyInclusive,
+                                    RM_IndexScanIterator &rm_IndexScanIterator){
+    SharedLatchGuard tableGuard(getTableLatch(tableName));
+    std::vector<Attribute> attrs, keyAttrs;
+    Attribute attribute;
+    if(attributeNames.empty()){
+        return -1;
+    }
+    std::string columnName = attributeNames[0];
+    for(size_t i = 1; i < attributeNames.size(); i++){
+        columnName += COMPOSITE_KEY_SEPARATOR + attributeNames[i];
+    }
+    if(getAttributes(tableName, attrs) != 0 || getIndexAttributes(attrs, columnName, keyAttrs, attribute) != 0){
+        // std::cout << "[Error] indexPrefixScan -> getAttributes" << std::endl;
+        return -1;
+    }
+    
+    if(_im->openFile(tableName + "_" + columnName, rm_IndexScanIterator.getIXFileHandle()) != 0){
+        // std::cout << "[Error]: indexPrefixScan -> fail to open index file" << std::endl;
+        return -1;
+    }
+    rm_IndexScanIterator.setTableLatch(&getTableLatch(tableName));
+    if(_im->prefixScan(rm_IndexScanIterator.getIXFileHandle(), keyAttrs, prefix, numOfPrefixAttributes, lowKey, highKey,
+                       lowKeyInclusive, highKeyInclusive, rm_IndexScanIterator.getIXScanIterator()) != 0){
+        // std::cout << "[Error]: indexPrefixScan -> fail to create IX_ScanItarator" << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+RC RelationManager::indexProbe(const std::string &tableName,
+              const std::string &attributeName,
+              const std::vector<std::string> &keys,
+              std::vector<std::vector<RID>> &rids){
+    SharedLatchGuard tableGuard(getTableLatch(tableName));
+    std::vector<Attribute> attrs, keyAttrs;
+    Attribute attribute;
+    RC rc = getAttributes(tableName, attrs);
+    if(rc != 0 || getIndexAttributes(attrs, attributeName, keyAttrs, attribute) != 0){
+        // std::cout << "[Error] indexProbe -> getAttributes" << std::endl;
+        return -1;
+    }
+    
+    IXFileHandle ixFileHandle;
+    std::string indexFileName;
+    if(getIndexFileName(tableName, attributeName, indexFileName) != 0 || _im->openFile(indexFileName, ixFileHandle) != 0){
+        // std::cout << "[Error]: indexProbe -> fail to open index file" << std::endl;
+        return -1;
+    }
+    rc = _hm->isHashIndex(indexFileName) ? _hm->probeEntries(ixFileHandle, attribute, keys, rids)
+                                         : _im->probeEntries(ixFileHandle, attribute, keys, rids);
+    _im->closeFile(ixFileHandle);
+    return rc;
+}
+
+RC RelationManager::createBloomFilter(const std::string &tableName, const std::string &attributeName, float falsePositiveRate){
+    std::lock_guard<std::mutex> ddlGuard(_ddlMutex);
+    ExclusiveLatchGuard tableGuard(getTableLatch(tableName));
+    std::string indexFileName;
+    if(getIndexFileName(tableName, attributeName, indexFileName) != 0 || _hm->isHashIndex(indexFileName)){
+        // std::cout << "[Error]: createBloomFilter -> no B+ tree index on the attribute." << std::endl;
+        return -1;
+    }
+    return buildBloomFilter(tableName, attributeName, indexFileName, falsePositiveRate);
+}
+
+RC RelationManager::buildBloomFilter(const std::string &tableName, const std::string &attributeName, const std::string &indexFileName,
+                                     float falsePositiveRate){
+    std::vector<std::vector<Attribute>> versionDescriptors;
+    std::vector<Attribute> keyAttrs;
+    Attribute attribute;
+    getVersionDescriptors(tableName, versionDescriptors);
+    if(versionDescriptors.empty() || getIndexAttributes(versionDescriptors.back(), attributeName, keyAttrs, attribute) != 0){
+        // std::cout << "[Error]: buildBloomFilter -> can't find the index." << std::endl;
+        return -1;
+    }
+    IXFileHandle ixFileHandle;
+    if(_im->openFile(indexFileName, ixFileHandle) != 0){
+        // std::cout << "[Error]: buildBloomFilter -> fail to open index file" << std::endl;
+        return -1;
+    }
+    RC rc = _im->createBloomFilter(ixFileHandle, attribute, falsePositiveRate);
+    _im->closeFile(ixFileHandle);
+    return rc;
+}
+
 // Extra credit work
+RC RelationManager::analyze(const std::string &tableName){
+    std::lock_guard<std::mutex> ddlGuard(_ddlMutex);
+    SharedLatchGuard tableGuard(getTableLatch(tableName));
+    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME || tableName == STATISTICS_NAME){
+//        std::cout << "[Warning]: analyze -> the Catalog files have no statistics." << std::endl;
+        return -1;
+    }
+    
+    int tableId;
+    RID rid;
+    std::vector<std::vector<Attribute>> versionDescriptors;
+    if(getTableIdForCustomTable(tableName, tableId, rid) != 0 || getVersionDescriptors(tableName, versionDescriptors) != 0){
+        // std::cout << "[Error]: analyze -> can't find the table." << std::endl;
+        return -1;
+    }
+    const std::vector<Attribute> &attrs = versionDescriptors.back();
+    
+    // 1. one scan of the table, each column gives its values to its collector
+    FileHandle fileHandle;
+    RBFM_ScanIterator rbfmScanIterator;
+    std::vector<std::string> attrNames;
+    std::vector<StatisticsCollector> collectors;
+    for(const Attribute &attr : attrs){
+        attrNames.push_back(attr.name);
+        collectors.emplace_back(attr);
+    }
+    TableStatistics table = {0, 0};
+    int nullIndicatorSize = ceil((double) attrs.size() / CHAR_BIT);
+    auto collect = [&](const char *tuple){
+        table.numOfTuples++;
+        int offset = nullIndicatorSize;
+        for(size_t i = 0; i < attrs.size(); i++){
+            if(((const unsigned char *)tuple)[i / CHAR_BIT] & (unsigned) 1 << (unsigned) (7 - i % CHAR_BIT)){
+                collectors[i].add(nullptr);
+                continue;
+            }
+            collectors[i].add(tuple + offset);
+            offset += _im->getKeyLength(attrs[i], tuple + offset);
+        }
+    };
+    
+    ClusteredTree tree;
+    if(getClusteredTree(tableName, attrs, tree) == 0){
+        // the rows of an index-organized table are in the pages of its tree
+        IXFileHandle ixFileHandle;
+        if(_im->openFile(tree.fileName, ixFileHandle) != 0){
+            // std::cout << "[Error]: analyze -> fail to open the tree" << std::endl;
+            return -1;
+        }
+        table.numOfPages = ixFileHandle.getFileHandle().getNumberOfPages();
+        _im->closeFile(ixFileHandle);
+        if(forEachRow(tree, versionDescriptors, [&](const RID &, const void *tuple){ collect((const char *)tuple); }) != 0){
+            // std::cout << "[Error]: analyze -> fail to scan the tree" << std::endl;
+            return -1;
+        }
+    }
+    else{
+        if(_rbfm->openFile(tableName, fileHandle) != 0){
+            // std::cout << "[Error]: analyze -> fail to open table file" << std::endl;
+            return -1;
+        }
+        table.numOfPages = fileHandle.getNumberOfPages();
+        if(_rbfm->scan(fileHandle, attrs, "", NO_OP, NULL, attrNames, rbfmScanIterator) != 0){
+            // std::cout << "[Error]: analyze -> fail to initiate scan iterator" << std::endl;
+            _rbfm->closeFile(fileHandle);
+            return -1;
+        }
+        rbfmScanIterator.setVersionDescriptors(versionDescriptors);
+        
+        char *returnedData = (char *)malloc(PAGE_SIZE);
+        while(rbfmScanIterator.getNextRecord(rid, returnedData) != RM_EOF){
+            collect(returnedData);
+        }
+        free(returnedData);
+        rbfmScanIterator.close();
+    }
+    
+    // 2. replace the rows of the table and of its columns in Statistics
+    if(writeStatistics(tableId, "", table, nullptr) != 0){
+        // std::cout << "[Error]: analyze -> fail to write Statistics." << std::endl;
+        return -1;
+    }
+    for(const StatisticsCollector &collector : collectors){
+        ColumnStatistics column;
+        collector.getStatistics(column);
+        if(writeStatistics(tableId, column.attribute.name, table, &column) != 0){
+            // std::cout << "[Error]: analyze -> fail to write Statistics." << std::endl;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+RC RelationManager::getTableStatistics(const std::string &tableName, TableStatistics &statistics){
+    int tableId;
+    RID rid;
+    if(getTableIdForCustomTable(tableName, tableId, rid) != 0){
+        // std::cout << "[Error]: getTableStatistics -> can't find the table." << std::endl;
+        return -1;
+    }
+    return readStatistics(tableId, "", rid, statistics, nullptr);
+}
+
+RC RelationManager::getColumnStatistics(const std::string &tableName, const std::string &attributeName, ColumnStatistics &statistics){
+    int tableId;
+    RID rid;
+    std::vector<Attribute> attrs;
+    if(getTableIdForCustomTable(tableName, tableId, rid) != 0 || getAttributesGivenTableId(tableId, attrs) != 0){
+        // std::cout << "[Error]: getColumnStatistics -> can't find the table." << std::endl;
+        return -1;
+    }
+    auto attr = std::find_if(attrs.begin(), attrs.end(), [&](const Attribute &a){ return a.name == attributeName; });
+    if(attr == attrs.end()){
+        // std::cout << "[Error]: getColumnStatistics -> can't find the attribute." << std::endl;
+        return -1;
+    }
+    TableStatistics table;
+    statistics.attribute = *attr;
+    return readStatistics(tableId, attributeName, rid, table, &statistics);
+}
+
+RC RelationManager::estimateSelectivity(const std::string &tableName, const std::string &attributeName, CompOp compOp, const void *value,
+                                        double &selectivity){
+    ColumnStatistics statistics;
+    if(getColumnStatistics(tableName, attributeName, statistics) == 0){
+        selectivity = statistics.selectivity(compOp, value);
+        return 0;
+    }
+    int tableId;
+    RID rid;
+    if(getTableIdForCustomTable(tableName, tableId, rid) != 0){
+        // std::cout << "[Error]: estimateSelectivity -> can't find the table." << std::endl;
+        return -1;
+    }
+    switch(compOp){
+        case NO_OP: selectivity = 1; break;
+        case EQ_OP: selectivity = STATS_DEFAULT_EQ_SELECTIVITY; break;
+        case NE_OP: selectivity = 1 - STATS_DEFAULT_EQ_SELECTIVITY; break;
+        default: selectivity = STATS_DEFAULT_RANGE_SELECTIVITY; break;
+    }
+    return 0;
+}
+
 RC RelationManager::dropAttribute(const std::string &tableName, const std::string &attributeName) {
-    return -1;
+    std::lock_guard<std::mutex> ddlGuard(_ddlMutex);
+    ExclusiveLatchGuard tableGuard(getTableLatch(tableName));
+    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME || tableName == STATISTICS_NAME){
+//        std::cout << "[Warning]: User can not change the Catalog files." << std::endl;
+        return -1;
+    }
+    
+    int tableId;
+    RID rid;
+    std::vector<ColumnRecord> columns;
+    if(getTableIdForCustomTable(tableName, tableId, rid) != 0 || getColumnsGivenTableId(tableId, columns) != 0){
+        // std::cout << "[Error]: dropAttribute -> can't find the table." << std::endl;
+        return -1;
+    }
+    
+    // 1. the next schema version, and the column to drop
+    int newVersion = 0;
+    ColumnRecord *target = nullptr;
+    for(auto &column : columns){
+        newVersion = std::max(newVersion, std::max(column.version, column.dropVersion));
+        if(column.dropVersion == 0 && column.attr.name == attributeName){
+            target = &column;
+        }
+    }
+    newVersion++;
+    if(target == nullptr){
+        // std::cout << "[Error]: dropAttribute -> can't find the attribute." << std::endl;
+        return -1;
+    }
+    
+    // 2. an index on a dropped attribute is useless, composite ones included
+    std::map<std::pair<std::string, std::string>, RID> columnIndexMap;
+    std::vector<Attribute> attrs, keyAttrs;
+    Attribute attribute;
+    generateCoumnIndexMapGivenTable(tableName, columnIndexMap);
+    getAttributesGivenTableId(tableId, attrs);
+    ClusteredTree tree;
+    if(getClusteredTree(columnIndexMap, attrs, tree) == 0 && tree.keyAttrs[0].name == attributeName){
+        // std::cout << "[Error]: dropAttribute -> can't drop the cluster key of an index-organized table." << std::endl;
+        return -1;
+    }
+    for(auto &it : columnIndexMap){
+        if(getIndexAttributes(attrs, it.first.first, keyAttrs, attribute) == 0 &&
+           std::any_of(keyAttrs.begin(), keyAttrs.end(), [&](const Attribute &attr){ return attr.name == attributeName; })){
+            removeIndex(tableName, it.first.first);
+        }
+    }
+    
+    // 3. mark the column as dropped in Columns, records in heap file are left untouched.
+    FileHandle fileHandle;
+    void *data = malloc(PAGE_SIZE);
+    prepareColumnsRecord(tableId, target->attr.name, target->attr.type, target->attr.length, target->position, target->version, newVersion, data);
+    _rbfm->openFile(COLUMN_NAME, fileHandle);
+    RC rc = _rbfm->updateRecord(fileHandle, _columnsDescriptor, data, target->rid);
+    _rbfm->closeFile(fileHandle);
+    free(data);
+    if(rc != 0){
+        // std::cout << "[Error]: dropAttribute -> fail to update Columns." << std::endl;
+        return -1;
+    }
+    
+    // 4. and its statistics
+    deleteTableInsideStatistics(tableId, &attributeName);
+    return 0;
 }
 
 // Extra credit work
 RC RelationManager::addAttribute(const std::string &tableName, const Attribute &attr) {
-    return -1;
+    std::lock_guard<std::mutex> ddlGuard(_ddlMutex);
+    ExclusiveLatchGuard tableGuard(getTableLatch(tableName));
+    if(tableName == TABLE_NAME || tableName == COLUMN_NAME || tableName == INDEX_NAME || tableName == STATISTICS_NAME){
+//        std::cout << "[Warning]: User can not change the Catalog files." << std::endl;
+        return -1;
+    }
+    
+    int tableId;
+    RID rid;
+    std::vector<ColumnRecord> columns;
+    if(getTableIdForCustomTable(tableName, tableId, rid) != 0 || getColumnsGivenTableId(tableId, columns) != 0){
+        // std::cout << "[Error]: addAttribute -> can't find the table." << std::endl;
+        return -1;
+    }
+    
+    // the new column goes to the next schema version and the last position
+    int newVersion = 0;
+    int newPosition = 0;
+    for(auto &column : columns){
+        if(column.dropVersion == 0 && column.attr.name == attr.name){
+            // std::cout << "[Error]: addAttribute -> attribute already exists." << std::endl;
+            return -1;
+        }
+        newVersion = std::max(newVersion, std::max(column.version, column.dropVersion));
+        newPosition = std::max(newPosition, column.position);
+    }
+    newVersion++;
+    newPosition++;
+    
+    FileHandle fileHandle;
+    _rbfm->openFile(COLUMN_NAME, fileHandle);
+    RC rc = insertRecordToColumns(fileHandle, *_rbfm, tableId, attr.name, attr.type, attr.length, newPosition, newVersion);
+    _rbfm->closeFile(fileHandle);
+    return rc;
 }
 
 // ========================================= //
@@ -693,6 +1719,10 @@ RC RelationManager::prepareColumnsDescriptor(){
     _columnsDescriptor.push_back(attr4);
     Attribute attr5 = {"column-position", TypeInt, (AttrLength) TypeIntLen};
     _columnsDescriptor.push_back(attr5);
+    Attribute attr6 = {"column-version", TypeInt, (AttrLength) TypeIntLen};
+    _columnsDescriptor.push_back(attr6);
+    Attribute attr7 = {"drop-version", TypeInt, (AttrLength) TypeIntLen};
+    _columnsDescriptor.push_back(attr7);
     
     return 0;
 }
@@ -709,6 +1739,29 @@ RC RelationManager::prepareIndexesDescriptor(){
     return 0;
 }
 
+RC RelationManager::prepareStatisticsDescriptor(){
+    
+    Attribute attr1 = {"table-id", TypeInt, (AttrLength) TypeIntLen};
+    _statisticsDescriptor.push_back(attr1);
+    Attribute attr2 = {"column-name", TypeVarChar, (AttrLength) TypeVarCharLen};
+    _statisticsDescriptor.push_back(attr2);
+    Attribute attr3 = {"row-count", TypeInt, (AttrLength) TypeIntLen};
+    _statisticsDescriptor.push_back(attr3);
+    Attribute attr4 = {"page-count", TypeInt, (AttrLength) TypeIntLen};
+    _statisticsDescriptor.push_back(attr4);
+    Attribute attr5 = {"null-count", TypeInt, (AttrLength) TypeIntLen};
+    _statisticsDescriptor.push_back(attr5);
+    Attribute attr6 = {"distinct-count", TypeInt, (AttrLength) TypeIntLen};
+    _statisticsDescriptor.push_back(attr6);
+    // the bounds of the histogram, each as long as a clipped VARCHAR key at most
+    Attribute attr7 = {"histogram", TypeVarChar, (AttrLength) ((STATS_HISTOGRAM_BUCKETS + 1) * (sizeof(int) + STATS_MAX_VARCHAR_LENGTH))};
+    _statisticsDescriptor.push_back(attr7);
+    Attribute attr8 = {"sketch", TypeVarChar, (AttrLength) HLL_REGISTERS};
+    _statisticsDescriptor.push_back(attr8);
+    
+    return 0;
+}
+
 RC RelationManager::insertRecordToTables(FileHandle &fileHandle, RecordBasedFileManager &rbfm, int tableId, std::string tableName, std::string fileName){
     void *data = malloc(PAGE_SIZE);
     RID rid;
@@ -716,8 +1769,14 @@ RC RelationManager::insertRecordToTables(FileHandle &fileHandle, RecordBasedFile
     rbfm.insertRecord(fileHandle, _tablesDescriptor, data, rid);
 //    rbfm.readRecord(fileHandle, _tablesDescriptor, rid, data);
 //    rbfm.printRecord(_tablesDescriptor, data);
+    
+    // reuse data as the key of the index on table-name
+    int offset = 0;
+    int length = tableName.size();
+    prepareVarChar(length, tableName, data, offset);
+    RC rc = updateCatalogIndex(TABLE_NAME_INDEX, _tablesDescriptor[1], data, rid, 1);
     free(data);
-    return 0;
+    return rc;
 }
 
 RC RelationManager::insertDescriptorToColumns(FileHandle &fileHandle, RecordBasedFileManager &rbfm, int tableId, const std::vector<Attribute> targetDescriptor){
@@ -732,26 +1791,32 @@ RC RelationManager::insertDescriptorToColumns(FileHandle &fileHandle, RecordBase
     return 0;
 }
 
-RC RelationManager::insertRecordToColumns(FileHandle &fileHandle, RecordBasedFileManager &rbfm, int tableId, std::string columnName, int columnType, int columnLength, int columnPosition){
+RC RelationManager::insertRecordToColumns(FileHandle &fileHandle, RecordBasedFileManager &rbfm, int tableId, std::string columnName, int columnType, int columnLength, int columnPosition, int columnVersion){
     void *data = malloc(PAGE_SIZE);
     RID rid;
-    prepareColumnsRecord(tableId, std::move(columnName), columnType, columnLength, columnPosition, data);
+    prepareColumnsRecord(tableId, std::move(columnName), columnType, columnLength, columnPosition, columnVersion, 0, data);
     rbfm.insertRecord(fileHandle, _columnsDescriptor, data, rid);
     // rbfm.readRecord(fileHandle, _columnsDescriptor, rid, data);
     // rbfm.printRecord(_columnsDescriptor, data);
     free(data);
-    return 0;
+    return updateCatalogIndex(COLUMN_TABLE_ID_INDEX, _columnsDescriptor[0], &tableId, rid, 1);
 }
 
 RC RelationManager::insertRecordToIndexes(FileHandle &fileHandle, RecordBasedFileManager &rbfm, std::string tableName, std::string columnName, std::string indexName){
     void *data = malloc(PAGE_SIZE);
     RID rid;
-    prepareIndexesRecord(std::move(tableName), std::move(columnName), std::move(indexName), data);
+    prepareIndexesRecord(tableName, std::move(columnName), std::move(indexName), data);
     rbfm.insertRecord(fileHandle, _indexesDescriptor, data, rid);
     // rbfm.readRecord(fileHandle, _indexesDescriptor, rid, data);
     // rbfm.printRecord(_indexesDescriptor, data);
+    
+    // reuse data as the key of the index on table-name
+    int offset = 0;
+    int length = tableName.size();
+    prepareVarChar(length, tableName, data, offset);
+    RC rc = updateCatalogIndex(INDEX_TABLE_NAME_INDEX, _indexesDescriptor[0], data, rid, 1);
     free(data);
-    return 0;
+    return rc;
 }
 
 RC RelationManager::prepareTablesRecord(int tableId, std::string tableName, std::string fileName, void *data){
@@ -795,7 +1860,7 @@ RC RelationManager::prepareTablesRecord(int tableId, std::string tableName, std:
 }
 
 // prepare the attribute as record in Columns as data format
-RC RelationManager::prepareColumnsRecord(int tableId, std::string columnName, int columnType, int columnLength, int columnPosition, void *data){
+RC RelationManager::prepareColumnsRecord(int tableId, std::string columnName, int columnType, int columnLength, int columnPosition, int columnVersion, int dropVersion, void *data){
     
     bool nullBit;
     int nullFieldsIndicatorActualSize = ceil((double)_columnsDescriptor.size()/CHAR_BIT);
@@ -839,6 +1904,18 @@ RC RelationManager::prepareColumnsRecord(int tableId, std::string columnName, in
         prepareInt(columnPosition, data, offset);
     }
     
+    // column-version
+    nullBit = nullsIndicator[0] & (unsigned) 1 << (unsigned) 2;
+    if(!nullBit){
+        prepareInt(columnVersion, data, offset);
+    }
+    
+    // drop-version
+    nullBit = nullsIndicator[0] & (unsigned) 1 << (unsigned) 1;
+    if(!nullBit){
+        prepareInt(dropVersion, data, offset);
+    }
+    
     free(nullsIndicator);
     nullsIndicator = nullptr;
     return 0;
@@ -882,6 +1959,43 @@ RC RelationManager::prepareIndexesRecord(std::string tableName, std::string colu
     return 0;
 }
 
+RC RelationManager::prepareStatisticsRecord(int tableId, const std::string &columnName, const TableStatistics &table, const ColumnStatistics *column,
+                                            void *data){
+    int nullFieldsIndicatorActualSize = ceil((double)_statisticsDescriptor.size()/CHAR_BIT);
+    memset(data, 0, nullFieldsIndicatorActualSize);
+    int offset = nullFieldsIndicatorActualSize;
+    
+    int value = tableId;
+    prepareInt(value, data, offset);
+    std::string name = columnName;
+    int length = name.size();
+    prepareVarChar(length, name, data, offset);
+    value = table.numOfTuples;
+    prepareInt(value, data, offset);
+    value = table.numOfPages;
+    prepareInt(value, data, offset);
+    value = column == nullptr ? 0 : column->nullCount;
+    prepareInt(value, data, offset);
+    value = column == nullptr ? 0 : column->distinctCount;
+    prepareInt(value, data, offset);
+    
+    // histogram and sketch
+    if(column == nullptr){
+        ((unsigned char *)data)[0] |= (unsigned) 1 << (unsigned) 1 | (unsigned) 1;
+        return 0;
+    }
+    std::string histogram;
+    for(const std::string &bound : column->histogram){
+        histogram += bound;
+    }
+    length = histogram.size();
+    prepareVarChar(length, histogram, data, offset);
+    std::string sketch = column->sketch.getRegisters();
+    length = sketch.size();
+    prepareVarChar(length, sketch, data, offset);
+    return 0;
+}
+
 RC RelationManager::prepareInt(int &value, void *data, int &offset){
     memcpy((char *)data + offset, &value, sizeof(int));
     offset += sizeof(int);
@@ -904,114 +2018,140 @@ RC RelationManager::prepareVarChar(int &length, std::string &varChar, void *data
 
 RC RelationManager::getTableIdForCustomTable(const std::string &tableName, int &tableId, RID &rid){
     
-    RBFM_ScanIterator rbfmScanIterator;
     FileHandle fileHandle;
+    std::vector<RID> rids;
     
     RC rc;
     void *data = malloc(PAGE_SIZE);
     
-    _rbfm->openFile(TABLE_NAME, fileHandle);
-    
     // 1.1 prepare the value for table-name
-    int length = strlen(tableName.c_str());
-    void *table_name_value = malloc(length+4);
-    memcpy(table_name_value, &length, 4);
-    memcpy((char *)table_name_value+4, tableName.c_str(), length);
+    int offset = 0;
+    int length = tableName.size();
+    std::string name = tableName;
+    prepareVarChar(length, name, data, offset);
+    
+    // 1.2 probe the index on table-name, since there is no duplicate table names, so that the first rid is the final result.
+    rc = lookupCatalogIndex(TABLE_NAME_INDEX, _tablesDescriptor[1], data, rids);
+    if(rc != 0 || rids.empty()){
+        // std::cout << "[Error] getTableIdForCustomTable -> can't find the table in Tables" << std::endl;
+        free(data);
+        return -1;
+    }
+    rid = rids[0];
     
     // Only need to retrieve the tableId attribute.
     std::vector<std::string> attrNames;
     attrNames.emplace_back("table-id");
     
-    // 1.3 initialize rbfmScanIterator
-    rc = _rbfm->scan(fileHandle, _tablesDescriptor, "table-name", EQ_OP, table_name_value, attrNames, rbfmScanIterator);
-    if(rc != 0){
-        // std::cout << "[Error] getTableIdForCustomTable -> initiateRBFMScanIterator for Tabels" << std::endl;
-        _rbfm->closeFile(fileHandle);
-        free(table_name_value);
-        free(data);
-        return -1;
-    }
-    
-    //1.4 get the record whose table-name is tableName, since there is no duplicate table names, so that the first result of getNextRecord is the final result.
-    rc = rbfmScanIterator.getNextRecord(rid, data);
+    // 1.3 read table-id of this row
+    _rbfm->openFile(TABLE_NAME, fileHandle);
+    rc = _rbfm->readAttributes(fileHandle, _tablesDescriptor, rid, attrNames, data);
+    _rbfm->closeFile(fileHandle);
     if(rc != 0){
-        // std::cout << "[Error] getTableIdForCustomTable -> getNextRecord for Tabels" << std::endl;
-        _rbfm->closeFile(fileHandle);
+        // std::cout << "[Error] getTableIdForCustomTable -> readAttributes for Tabels" << std::endl;
         free(data);
-        free(table_name_value);
         return -1;
     }
-    rbfmScanIterator.close();
     
-    // 1.5 retrieved data is in the original format, the first part is nullIndicator, then use memcpy to get tableId.
+    // 1.4 retrieved data is in the original format, the first part is nullIndicator, then use memcpy to get tableId.
     int nullIndicatorSize = ceil(double(attrNames.size())/CHAR_BIT);
     memcpy(&tableId, (char *)data+nullIndicatorSize, 4);       // +1 -> 1 byte nullindicator
     
     free(data);
-    free(table_name_value);
     return 0;
 }
 
 RC RelationManager::getAttributesGivenTableId(int tableId, std::vector<Attribute> &attrs) {
     
-    RBFM_ScanIterator rbfmScanIterator;
+    std::vector<ColumnRecord> columns;
+    
+    // 2.2 clear the customDescriptor
+    attrs.clear();
+    std::vector<Attribute>().swap(attrs);
+    
+    if(getColumnsGivenTableId(tableId, columns) != 0){
+        // std::cout << "[Error] getDescriptorForCustomTable -> getColumnsGivenTableId" << std::endl;
+        return -1;
+    }
+    
+    // only the alive columns belong to current descriptor
+    for(auto &column : columns){
+        if(column.dropVersion == 0){
+            attrs.push_back(column.attr);
+        }
+    }
+    return 0;
+}
+
+RC RelationManager::getColumnsGivenTableId(int tableId, std::vector<ColumnRecord> &columns) {
+    
     FileHandle fileHandle;
+    std::vector<RID> rids;
     
     RC rc;
-    RID rid;
     void *data = malloc(PAGE_SIZE);
     
+    columns.clear();
+    
+    // 2.1 probe the index on table-id
+    rc = lookupCatalogIndex(COLUMN_TABLE_ID_INDEX, _columnsDescriptor[0], &tableId, rids);
+    if(rc != 0){
+        // std::cout << "[Error] getColumnsGivenTableId -> lookupCatalogIndex for Columns" << std::endl;
+        free(data);
+        return -1;
+    }
+    
     rc = _rbfm->openFile(COLUMN_NAME, fileHandle);
     if(rc != 0){
-        // std::cout << "[Error] getDescriptorForCustomTable -> openFile for Columns" << std::endl;
+        // std::cout << "[Error] getColumnsGivenTableId -> openFile for Columns" << std::endl;
         free(data);
         return -1;
     }
     
-    // 2.1 prepare attribute vector -> use the columndescriptor
-    // hard-code attribute -> push and only push 3 attributes!!!!!
+    // 2.2 prepare attribute vector -> use the columndescriptor
     std::vector<std::string> attrNames;
     attrNames.emplace_back("column-name");
     attrNames.emplace_back("column-type");
     attrNames.emplace_back("column-length");
+    attrNames.emplace_back("column-position");
+    attrNames.emplace_back("column-version");
+    attrNames.emplace_back("drop-version");
     
-    
-    // 2.2 clear the customDescriptor
-    attrs.clear();
-    std::vector<Attribute>().swap(attrs);
-    
-    // 2.3 initialize rbfmScanIterator
-    rc = _rbfm->scan(fileHandle, _columnsDescriptor, "table-id", EQ_OP, &tableId, attrNames, rbfmScanIterator);
-    if(rc != 0){
-        // std::cout << "[Error] getDescriptorForCustomTable -> initiateRBFMScanIterator for Columns" << std::endl;
-        free(data);
-        return -1;
-    }
-    
-    while(true){
-        rc = rbfmScanIterator.getNextRecord(rid, data);
-        if(rc == 0){
-            attrs.push_back(getAttributeFromData(attrNames, data));
-        }
-        else{
-            break;
+    // 2.3 read each row of this table
+    for(const RID &rid : rids){
+        rc = _rbfm->readAttributes(fileHandle, _columnsDescriptor, rid, attrNames, data);
+        if(rc != 0){
+            // std::cout << "[Error] getColumnsGivenTableId -> readAttributes for Columns" << std::endl;
+            _rbfm->closeFile(fileHandle);
+            free(data);
+            return -1;
         }
+        ColumnRecord column = getColumnRecordFromData(attrNames, data);
+        column.rid = rid;
+        columns.push_back(column);
     }
     
-    rc = rbfmScanIterator.close();
+    rc = _rbfm->closeFile(fileHandle);
     if(rc != 0){
-        // std::cout << "[Error] getDescriptorForCustomTable -> closeFile for Columns" << std::endl;
+        // std::cout << "[Error] getColumnsGivenTableId -> closeFile for Columns" << std::endl;
         free(data);
         return -1;
     }
     free(data);
+    
+    // index entries with the same key are not in position order, so sort them.
+    std::stable_sort(columns.begin(), columns.end(), [](const ColumnRecord &a, const ColumnRecord &b){
+        return a.position < b.position;
+    });
     return 0;
 }
 
-Attribute RelationManager::getAttributeFromData(std::vector<std::string> attrNames, void *data){
-    // 1. clear the precious customDescriptor
-    Attribute attr;
-    // 2. Attribute struct has 3 attributes, name, type, length
+ColumnRecord RelationManager::getColumnRecordFromData(std::vector<std::string> attrNames, void *data){
+    ColumnRecord column;
+    column.position = 0;
+    column.version = 0;
+    column.dropVersion = 0;
+    Attribute &attr = column.attr;
     
     int fieldLength = attrNames.size();
 //    get the nullIndicator size
@@ -1053,29 +2193,173 @@ Attribute RelationManager::getAttributeFromData(std::vector<std::string> attrNam
                 ((char*)varChar)[varCharLen] = '\0';        // last byte should be '\0' for string
                 offset += varCharLen;
                 attr.name = (char *)varChar;
-//                std::cout << attributes[fieldIndex] << '\t' << (char*)varChar << '\t';
                 free(varChar);
                 varChar = nullptr;
+                continue;
             }
-            else if(attrNames[fieldIndex] == "column-type"){
-                memcpy(&intData, (char *)data+offset, sizeof(intData));
+            
+            // the other columns are all int
+            memcpy(&intData, (char *)data+offset, sizeof(intData));
+            offset += sizeof(intData);
+            if(attrNames[fieldIndex] == "column-type"){
                 attr.type = (AttrType)intData;
-                offset += sizeof(intData);
-//                std::cout << attributes[fieldIndex] << '\t' << intData << '\t';
             }
             else if(attrNames[fieldIndex] == "column-length"){
-                memcpy(&intData, (char *)data+offset, sizeof(intData));
                 attr.length = intData;
-                offset += sizeof(intData);
-//                std::cout << attributes[fieldIndex] << '\t' << intData << '\t';
             }
-            
+            else if(attrNames[fieldIndex] == "column-position"){
+                column.position = intData;
+            }
+            else if(attrNames[fieldIndex] == "column-version"){
+                column.version = intData;
+            }
+            else if(attrNames[fieldIndex] == "drop-version"){
+                column.dropVersion = intData;
+            }
         }
     }
 
-//    std::cout << std::endl;
     free(nullsIndicator);
-    return attr;
+    return column;
+}
+
+RC RelationManager::getVersionDescriptors(const std::string &tableName, std::vector<std::vector<Attribute>> &versionDescriptors){
+    int tableId;
+    RID rid;
+    std::vector<ColumnRecord> columns;
+    
+    versionDescriptors.clear();
+    if(getTableIdForCustomTable(tableName, tableId, rid) != 0 || getColumnsGivenTableId(tableId, columns) != 0){
+        // std::cout << "[Error] getVersionDescriptors -> can't get columns for tableName." << std::endl;
+        return -1;
+    }
+    
+    int currentVersion = 0;
+    for(auto &column : columns){
+        currentVersion = std::max(currentVersion, std::max(column.version, column.dropVersion));
+    }
+    
+    // columns are sorted by position, which is also the order inside the records of every version.
+    versionDescriptors.resize(currentVersion + 1);
+    for(int version = 0; version <= currentVersion; version++){
+        for(auto &column : columns){
+            if(column.version > version || (column.dropVersion != 0 && column.dropVersion <= version)){
+                continue;
+            }
+            Attribute attr = column.attr;
+            if(column.dropVersion != 0){
+                // dropped afterwards, keep it only to walk through old records.
+                attr.name = "";
+            }
+            versionDescriptors[version].push_back(attr);
+        }
+    }
+    return 0;
+}
+
+RC RelationManager::readVersionedRecord(FileHandle &fileHandle, const std::vector<std::vector<Attribute>> &versionDescriptors, const RID &rid, void *data){
+    const std::vector<Attribute> &attrs = versionDescriptors.back();
+    char16_t version;
+    
+    if(versionDescriptors.size() > 1){
+        RC rc = _rbfm->readRecordVersion(fileHandle, rid, version);
+        if(rc != 0){
+            return rc;
+        }
+        if(version + 1u < versionDescriptors.size()){
+            // project the old record to the current descriptor
+            std::vector<std::string> attrNames;
+            for(auto &attr : attrs){
+                attrNames.push_back(attr.name);
+            }
+            return _rbfm->readAttributes(fileHandle, versionDescriptors[version], rid, attrNames, data);
+        }
+    }
+    return _rbfm->readRecord(fileHandle, attrs, rid, data);
+}
+
+RC RelationManager::deFormatVersionedRecord(const std::vector<std::vector<Attribute>> &versionDescriptors, const std::string &record, void *data){
+    const std::vector<Attribute> &attrs = versionDescriptors.back();
+    std::vector<std::string> attrNames;
+    char16_t version;
+    
+    memcpy(&version, record.data() + flagLen, versionLen);
+    if(versionDescriptors.size() > 1 && version + 1u < versionDescriptors.size()){
+        // project the old record to the current descriptor
+        for(auto &attr : attrs){
+            attrNames.push_back(attr.name);
+        }
+        return _rbfm->deFormatRecord(versionDescriptors[version], attrNames, record, data);
+    }
+    return _rbfm->deFormatRecord(attrs, attrNames, record, data);
+}
+
+int RelationManager::getTupleLength(const std::vector<Attribute> &attrs, const void *data) const{
+    int nullIndicatorSize = ceil((double) attrs.size() / CHAR_BIT);
+    int offset = nullIndicatorSize;
+    for(size_t i = 0; i < attrs.size(); i++){
+        if(((const unsigned char *)data)[i / CHAR_BIT] & (unsigned) 1 << (unsigned) (7 - i % CHAR_BIT)){
+            continue;
+        }
+        if(attrs[i].type == TypeVarChar){
+            int length;
+            memcpy(&length, (const char *)data + offset, sizeof(int));
+            offset += length;
+        }
+        offset += sizeof(int);
+    }
+    return offset;
+}
+
+RC RelationManager::readVersionedAttribute(FileHandle &fileHandle, const std::vector<std::vector<Attribute>> &versionDescriptors, const RID &rid,
+                                           const std::string &attributeName, void *data){
+    const std::vector<Attribute> &attrs = versionDescriptors.back();
+    char16_t version;
+    
+    if(versionDescriptors.size() > 1){
+        RC rc = _rbfm->readRecordVersion(fileHandle, rid, version);
+        if(rc != 0){
+            return rc;
+        }
+        if(version + 1u < versionDescriptors.size()){
+            int attrIndex = -1;
+            for(unsigned i = 0; i < attrs.size(); i++){
+                if(attrs[i].name == attributeName){
+                    attrIndex = i;
+                    break;
+                }
+            }
+            if(attrIndex == -1){
+                // std::cout << "[Error]: readVersionedAttribute -> can't get this attribute." << std::endl;
+                return -1;
+            }
+            
+            void *attribute = malloc(PAGE_SIZE);
+            std::vector<std::string> attrNames;
+            attrNames.push_back(attributeName);
+            rc = _rbfm->readAttributes(fileHandle, versionDescriptors[version], rid, attrNames, attribute);
+            if(rc != 0){
+                free(attribute);
+                return rc;
+            }
+            
+            // same format as _rbfm->readAttribute(), nullIndicator has the length of the entire current descriptor.
+            int nullIndicatorSize = ceil((double(attrs.size())/CHAR_BIT));
+            memset(data, -1, nullIndicatorSize);
+            if(!(((unsigned char *)attribute)[0] & (unsigned) 1 << (unsigned) 7)){
+                ((unsigned char *)data)[attrIndex/CHAR_BIT] &= ~((unsigned) 1 << (unsigned) (7 - attrIndex%CHAR_BIT));
+                int attrLen = 4;
+                if(attrs[attrIndex].type == TypeVarChar){
+                    memcpy(&attrLen, (char *)attribute+1, 4);
+                    attrLen += 4;
+                }
+                memcpy((char *)data+nullIndicatorSize, (char *)attribute+1, attrLen);
+            }
+            free(attribute);
+            return 0;
+        }
+    }
+    return _rbfm->readAttribute(fileHandle, attrs, rid, attributeName, data);
 }
 
 RC RelationManager::deleteTableInsideTables(const std::string tableName, int &tableId){
@@ -1099,50 +2383,41 @@ RC RelationManager::deleteTableInsideTables(const std::string tableName, int &ta
         return -1;
     }
     
-    return 0;
+    void *key = malloc(PAGE_SIZE);
+    int offset = 0;
+    int length = tableName.size();
+    std::string name = tableName;
+    prepareVarChar(length, name, key, offset);
+    rc = updateCatalogIndex(TABLE_NAME_INDEX, _tablesDescriptor[1], key, rid, 2);
+    free(key);
+    return rc;
 }
 
 RC RelationManager::deleteTableInsideColumns(int &tableId){
-    RBFM_ScanIterator rbfmScanIterator;
     FileHandle fileHandle;
-    
+    std::vector<RID> rids;
     RC rc;
-    RID rid;
-    void *data = malloc(PAGE_SIZE);
     
-    rc = _rbfm->openFile(COLUMN_NAME, fileHandle);
+    rc = lookupCatalogIndex(COLUMN_TABLE_ID_INDEX, _columnsDescriptor[0], &tableId, rids);
     if(rc != 0){
-         std::cout << "[Error] initiateRMScanIterator -> openFile for Columns" << std::endl;
-        free(data);
+        // std::cout << "[Error] deleteTableInsideColumns -> lookupCatalogIndex for Columns" << std::endl;
         return -1;
     }
     
-    // 2.1 prepare attribute vector
-    std::vector<std::string> attrNames;
-    attrNames.emplace_back("table-id");
-    
-    // 2.3 initialize rbfmScanIterator
-    rc = _rbfm->scan(fileHandle, _columnsDescriptor, "table-id", EQ_OP, &tableId, attrNames, rbfmScanIterator);
+    rc = _rbfm->openFile(COLUMN_NAME, fileHandle);
     if(rc != 0){
-         // std::cout << "[Error] initiateRMScanIterator -> initiateRBFMScanIterator for Columns" << std::endl;
-        free(data);
+         std::cout << "[Error] initiateRMScanIterator -> openFile for Columns" << std::endl;
         return -1;
     }
     
-    while(true){
-        rc = rbfmScanIterator.getNextRecord(rid, data);
-        if(rc == 0){
-            _rbfm->deleteRecord(fileHandle, _columnsDescriptor, rid);
-        }
-        else{
-            break;
-        }
+    for(const RID &rid : rids){
+        _rbfm->deleteRecord(fileHandle, _columnsDescriptor, rid);
+        updateCatalogIndex(COLUMN_TABLE_ID_INDEX, _columnsDescriptor[0], &tableId, rid, 2);
     }
     
-    rc = rbfmScanIterator.close();
+    rc = _rbfm->closeFile(fileHandle);
     if(rc != 0){
-         // std::cout << "[Error] initiateRMScanIterator -> closeFile for Columns" << std::endl;
-        free(data);
+         // std::cout << "[Error] deleteTableInsideColumns -> closeFile for Columns" << std::endl;
         return -1;
     }
     return 0;
@@ -1164,45 +2439,177 @@ RC RelationManager::deleteTableInsideIndexes(const std::string tableName){
         _rbfm->destroyFile(it.first.second);
     }
     
-    // delete the tuple inside the Indexes
+    // delete the tuple inside the Indexes and its entry in the catalog index
+    void *key = malloc(PAGE_SIZE);
+    int offset = 0;
+    int length = tableName.size();
+    std::string name = tableName;
+    prepareVarChar(length, name, key, offset);
+    
     _rbfm->openFile(INDEX_NAME, fileHandle);
     for(auto &it : columnIndexMap){
         _rbfm->deleteRecord(fileHandle, _indexesDescriptor, it.second);
+        updateCatalogIndex(INDEX_TABLE_NAME_INDEX, _indexesDescriptor[0], key, it.second, 2);
     }
     _rbfm->closeFile(fileHandle);
     
+    free(key);
     return 0;
 }
 
-RC RelationManager::generateCoumnIndexMapGivenTable(const std::string &tableName, std::map<std::pair<std::string, std::string>, RID> &columnIndexMap) {
-    RBFM_ScanIterator rbfmScanIterator;
+RC RelationManager::deleteTableInsideStatistics(int tableId, const std::string *columnName){
     FileHandle fileHandle;
-    RC rc;
+    std::vector<RID> rids;
     
-    _rbfm->openFile(INDEX_NAME, fileHandle);
+    if(columnName != nullptr){
+        RID rid;
+        TableStatistics table;
+        if(readStatistics(tableId, *columnName, rid, table, nullptr) == 0){
+            rids.push_back(rid);
+        }
+    }
+    else if(lookupCatalogIndex(STATISTICS_TABLE_ID_INDEX, _statisticsDescriptor[0], &tableId, rids) != 0){
+        // std::cout << "[Error] deleteTableInsideStatistics -> lookupCatalogIndex for Statistics" << std::endl;
+        return -1;
+    }
+    if(rids.empty()){
+        return 0;
+    }
     
-    void *value = malloc(PAGE_SIZE);
-    int indexLen = strlen(tableName.c_str());
-    memcpy(value, &indexLen, 4);
-    memcpy((char *) value + 4, tableName.c_str(), indexLen);
+    if(_rbfm->openFile(STATISTICS_NAME, fileHandle) != 0){
+        // std::cout << "[Error] deleteTableInsideStatistics -> openFile for Statistics" << std::endl;
+        return -1;
+    }
+    for(const RID &rid : rids){
+        _rbfm->deleteRecord(fileHandle, _statisticsDescriptor, rid);
+        updateCatalogIndex(STATISTICS_TABLE_ID_INDEX, _statisticsDescriptor[0], &tableId, rid, 2);
+    }
+    _rbfm->closeFile(fileHandle);
+    return 0;
+}
+
+RC RelationManager::readStatistics(int tableId, const std::string &columnName, RID &rid, TableStatistics &table, ColumnStatistics *column){
+    FileHandle fileHandle;
+    std::vector<RID> rids;
     
-    std::vector<std::string> indexAttrNames;
-    indexAttrNames.emplace_back("column-name");
-    indexAttrNames.emplace_back("index-name");
+    if(lookupCatalogIndex(STATISTICS_TABLE_ID_INDEX, _statisticsDescriptor[0], &tableId, rids) != 0 || rids.empty()){
+        return -1;
+    }
+    if(_rbfm->openFile(STATISTICS_NAME, fileHandle) != 0){
+        // std::cout << "[Error] readStatistics -> openFile for Statistics" << std::endl;
+        return -1;
+    }
+    
+    // the rows of the table, the one of columnName follows table-id with its column-name
+    RC rc = -1;
+    char *data = (char *)malloc(PAGE_SIZE);
+    int nullIndicatorSize = ceil((double)_statisticsDescriptor.size()/CHAR_BIT);
+    for(const RID &statisticsRid : rids){
+        if(_rbfm->readRecord(fileHandle, _statisticsDescriptor, statisticsRid, data) != 0){
+            continue;
+        }
+        int offset = nullIndicatorSize + sizeof(int);
+        int length;
+        memcpy(&length, data + offset, sizeof(int));
+        offset += sizeof(int);
+        if(std::string(data + offset, length) != columnName){
+            continue;
+        }
+        offset += length;
+        rid = statisticsRid;
+        memcpy(&table.numOfTuples, data + offset, sizeof(int));
+        offset += sizeof(int);
+        memcpy(&table.numOfPages, data + offset, sizeof(int));
+        offset += sizeof(int);
+        rc = 0;
+        if(column == nullptr){
+            break;
+        }
+        
+        column->numOfTuples = table.numOfTuples;
+        memcpy(&column->nullCount, data + offset, sizeof(int));
+        offset += sizeof(int);
+        memcpy(&column->distinctCount, data + offset, sizeof(int));
+        offset += sizeof(int);
+        column->histogram.clear();
+        if(!(data[0] & (unsigned) 1 << (unsigned) 1)){
+            memcpy(&length, data + offset, sizeof(int));
+            offset += sizeof(int);
+            for(int end = offset + length; offset < end; ){
+                int keyLength = _im->getKeyLength(column->attribute, data + offset);
+                column->histogram.emplace_back(data + offset, keyLength);
+                offset += keyLength;
+            }
+        }
+        if(!(data[0] & (unsigned) 1)){
+            memcpy(&length, data + offset, sizeof(int));
+            offset += sizeof(int);
+            column->sketch.setRegisters(std::string(data + offset, length));
+        }
+        break;
+    }
+    free(data);
+    _rbfm->closeFile(fileHandle);
+    return rc;
+}
+
+RC RelationManager::writeStatistics(int tableId, const std::string &columnName, const TableStatistics &table, const ColumnStatistics *column){
+    FileHandle fileHandle;
+    RID rid;
+    TableStatistics oldTable;
     
+    bool exists = readStatistics(tableId, columnName, rid, oldTable, nullptr) == 0;
+    if(_rbfm->openFile(STATISTICS_NAME, fileHandle) != 0){
+        // std::cout << "[Error] writeStatistics -> openFile for Statistics" << std::endl;
+        return -1;
+    }
+    void *data = malloc(PAGE_SIZE);
+    prepareStatisticsRecord(tableId, columnName, table, column, data);
+    RC rc;
+    if(exists){
+        rc = _rbfm->updateRecord(fileHandle, _statisticsDescriptor, data, rid);
+    }
+    else{
+        rc = _rbfm->insertRecord(fileHandle, _statisticsDescriptor, data, rid);
+        if(rc == 0){
+            rc = updateCatalogIndex(STATISTICS_TABLE_ID_INDEX, _statisticsDescriptor[0], &tableId, rid, 1);
+        }
+    }
+    _rbfm->closeFile(fileHandle);
+    free(data);
+    return rc;
+}
+
+RC RelationManager::generateCoumnIndexMapGivenTable(const std::string &tableName, std::map<std::pair<std::string, std::string>, RID> &columnIndexMap) {
+    FileHandle fileHandle;
+    std::vector<RID> rids;
+    RC rc;
     
-    rc = _rbfm->scan(fileHandle, _indexesDescriptor, "table-name", EQ_OP, value, indexAttrNames, rbfmScanIterator);
+    void *value = malloc(PAGE_SIZE);
+    int offset = 0;
+    int indexLen = tableName.size();
+    std::string name = tableName;
+    prepareVarChar(indexLen, name, value, offset);
     
+    rc = lookupCatalogIndex(INDEX_TABLE_NAME_INDEX, _indexesDescriptor[0], value, rids);
     if (rc != 0) {
-        // std::cout << "[Error]: generateCoumnIndexMapGivenTable -> fail to initialize scan iterator." << std::endl;
+        // std::cout << "[Error]: generateCoumnIndexMapGivenTable -> fail to probe the index on Indexes." << std::endl;
         free(value);
         return -1;
     }
     
-    RID indexRid;
+    std::vector<std::string> indexAttrNames;
+    indexAttrNames.emplace_back("column-name");
+    indexAttrNames.emplace_back("index-name");
+    
+    _rbfm->openFile(INDEX_NAME, fileHandle);
+    
     void *indexData = malloc(PAGE_SIZE);
     int nullIndicatorSize = ceil((double)indexAttrNames.size()/CHAR_BIT);
-    while (rbfmScanIterator.getNextRecord(indexRid, indexData) != RM_EOF) {
+    for (const RID &indexRid : rids) {
+        if (_rbfm->readAttributes(fileHandle, _indexesDescriptor, indexRid, indexAttrNames, indexData) != 0) {
+            continue;
+        }
         int columnLen;
         memcpy(&columnLen, (char *) indexData + nullIndicatorSize, 4);
         char *columnData = (char *) malloc(columnLen + 1);
@@ -1220,49 +2627,429 @@ RC RelationManager::generateCoumnIndexMapGivenTable(const std::string &tableName
         free(indexNameData);
     }
     
-    rbfmScanIterator.close();
+    _rbfm->closeFile(fileHandle);
     free(indexData);
     free(value);
     return 0;
 }
 
-RC RelationManager::indexOperationWhenTupleChanged(const std::string &tableName, const RID rid, const std::map<std::pair<std::string, std::string>, RID> columnIndexMap, const std::vector<Attribute> attrs, int operationFlag){
+RC RelationManager::getIndexFileName(const std::string &tableName, const std::string &attributeName, std::string &indexFileName){
+    std::map<std::pair<std::string, std::string>, RID> columnIndexMap;
+    if(generateCoumnIndexMapGivenTable(tableName, columnIndexMap) != 0){
+        return -1;
+    }
+    for(const auto &index : columnIndexMap){
+        if(index.first.first == attributeName && !isClusteredTree(index.first.second)){
+            indexFileName = index.first.second;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+bool RelationManager::isClusteredTree(const std::string &indexFileName) const{
+    size_t suffixLength = strlen(CLUSTERED_TREE_SUFFIX);
+    return indexFileName.size() > suffixLength &&
+           indexFileName.compare(indexFileName.size() - suffixLength, suffixLength, CLUSTERED_TREE_SUFFIX) == 0;
+}
+
+RC RelationManager::getClusteredTree(const std::string &tableName, const std::vector<Attribute> &attrs, ClusteredTree &tree){
+    std::map<std::pair<std::string, std::string>, RID> columnIndexMap;
+    if(generateCoumnIndexMapGivenTable(tableName, columnIndexMap) != 0){
+        return -1;
+    }
+    return getClusteredTree(columnIndexMap, attrs, tree);
+}
+
+RC RelationManager::getClusteredTree(const std::map<std::pair<std::string, std::string>, RID> &columnIndexMap, const std::vector<Attribute> &attrs,
+                                     ClusteredTree &tree){
+    for(const auto &index : columnIndexMap){
+        if(!isClusteredTree(index.first.second)){
+            continue;
+        }
+        auto attr = std::find_if(attrs.begin(), attrs.end(), [&](const Attribute &a){ return a.name == index.first.first; });
+        if(attr == attrs.end()){
+            // std::cout << "[Error]: getClusteredTree -> can't find the cluster key." << std::endl;
+            return -1;
+        }
+        tree.fileName = index.first.second;
+        tree.keyAttrs = {*attr, {"rid-page", TypeInt, 4}, {"rid-slot", TypeInt, 4}};
+        tree.attribute = _im->getCompositeAttribute(tree.keyAttrs);
+        tree.locatorDescriptor = {*attr};
+        return 0;
+    }
+    return -1;
+}
+
+RC RelationManager::openClusteredTree(const ClusteredTree &tree, IXFileHandle &ixFileHandle){
+    if(_im->openFile(tree.fileName, ixFileHandle) != 0){
+        // std::cout << "[Error]: openClusteredTree -> fail to open the tree." << std::endl;
+        return -1;
+    }
+    return ixFileHandle.setClustered(true);
+}
+
+RC RelationManager::encodeRowKey(const ClusteredTree &tree, const void *value, const RID &rid, void *key) const{
+    // <cluster key, pageNum, slotNum> in the record format of keyAttrs, the null bit of the cluster key comes from value
+    char *data = (char *)malloc(PAGE_SIZE);
+    int offset = 1;
+    data[0] = (char) (((const unsigned char *)value)[0] & (unsigned) 1 << (unsigned) 7);
+    if(!data[0]){
+        int length = _im->getKeyLength(tree.keyAttrs[0], (const char *)value + 1);
+        memcpy(data + offset, (const char *)value + 1, length);
+        offset += length;
+    }
+    int pageNum = rid.pageNum, slotNum = rid.slotNum;
+    memcpy(data + offset, &pageNum, sizeof(int));
+    memcpy(data + offset + sizeof(int), &slotNum, sizeof(int));
+    RC rc = _im->encodeCompositeKey(tree.keyAttrs, data, key);
+    free(data);
+    return rc;
+}
+
+RC RelationManager::decodeRowKey(const ClusteredTree &tree, const void *key, RID &rid) const{
+    char *data = (char *)malloc(PAGE_SIZE);
+    RC rc = _im->decodeCompositeKey(tree.keyAttrs, key, data);
+    if(rc == 0){
+        int offset = 1;
+        if(!(data[0] & (unsigned) 1 << (unsigned) 7)){
+            offset += _im->getKeyLength(tree.keyAttrs[0], data + 1);
+        }
+        int pageNum, slotNum;
+        memcpy(&pageNum, data + offset, sizeof(int));
+        memcpy(&slotNum, data + offset + sizeof(int), sizeof(int));
+        rid.pageNum = pageNum;
+        rid.slotNum = slotNum;
+    }
+    free(data);
+    return rc;
+}
+
+RC RelationManager::insertClusteredRow(const ClusteredTree &tree, const std::vector<std::vector<Attribute>> &versionDescriptors, const void *tuple,
+                                       const void *value, const RID &rid){
+    IXFileHandle ixFileHandle;
+    std::string row;
+    if(_rbfm->formatRecord(versionDescriptors.back(), tuple, versionDescriptors.size() - 1, row) != 0 ||
+       openClusteredTree(tree, ixFileHandle) != 0){
+        // std::cout << "[Error]: insertClusteredRow -> fail to format the row." << std::endl;
+        return -1;
+    }
+    char *key = (char *)malloc(PAGE_SIZE);
+    encodeRowKey(tree, value, rid, key);
+    RC rc = _im->insertRow(ixFileHandle, tree.attribute, key, row.data(), row.size());
+    _im->closeFile(ixFileHandle);
+    free(key);
+    return rc;
+}
+
+RC RelationManager::deleteClusteredRow(const std::string &tableName, const ClusteredTree &tree, const RID &rid, void *value){
     FileHandle fileHandle;
     IXFileHandle ixFileHandle;
+    if(_rbfm->openFile(tableName, fileHandle) != 0){
+        // std::cout << "[Error]: deleteClusteredRow -> fail to open table file." << std::endl;
+        return -1;
+    }
+    RC rc = _rbfm->readRecord(fileHandle, tree.locatorDescriptor, rid, value);
+    _rbfm->closeFile(fileHandle);
+    if(rc != 0 || openClusteredTree(tree, ixFileHandle) != 0){
+        // std::cout << "[Error]: deleteClusteredRow -> can't find the row." << std::endl;
+        return -1;
+    }
+    char *key = (char *)malloc(PAGE_SIZE);
+    encodeRowKey(tree, value, rid, key);
+    rc = _im->deleteRow(ixFileHandle, tree.attribute, key);
+    _im->closeFile(ixFileHandle);
+    free(key);
+    return rc;
+}
+
+RC RelationManager::readClusteredTuple(FileHandle &fileHandle, IXFileHandle &ixFileHandle, const ClusteredTree &tree,
+                                       const std::vector<std::vector<Attribute>> &versionDescriptors, const RID &rid, void *tuple){
+    // the heap file gives the cluster key of rid, the tree the row
+    char *value = (char *)malloc(PAGE_SIZE);
+    char *key = (char *)malloc(PAGE_SIZE);
+    char *row = (char *)malloc(PAGE_SIZE);
+    unsigned rowLength;
+    RC rc = _rbfm->readRecord(fileHandle, tree.locatorDescriptor, rid, value);
+    if(rc == 0){
+        encodeRowKey(tree, value, rid, key);
+        rc = _im->readRow(ixFileHandle, tree.attribute, key, row, rowLength);
+    }
+    if(rc == 0){
+        rc = deFormatVersionedRecord(versionDescriptors, std::string(row, rowLength), tuple);
+    }
+    free(value);
+    free(key);
+    free(row);
+    return rc;
+}
+
+RC RelationManager::forEachRow(const ClusteredTree &tree, const std::vector<std::vector<Attribute>> &versionDescriptors,
+                               const std::function<void(const RID &rid, const void *tuple)> &visit){
+    IXFileHandle ixFileHandle;
+    IX_ScanIterator ixScanIterator;
+    if(openClusteredTree(tree, ixFileHandle) != 0){
+        return -1;
+    }
+    if(_im->prefixScan(ixFileHandle, tree.keyAttrs, NULL, 0, NULL, NULL, true, true, ixScanIterator) != 0){
+        // std::cout << "[Error]: forEachRow -> fail to initialize the scan." << std::endl;
+        _im->closeFile(ixFileHandle);
+        return -1;
+    }
     
+    char *key = (char *)malloc(PAGE_SIZE);
+    char *row = (char *)malloc(PAGE_SIZE);
+    char *tuple = (char *)malloc(PAGE_SIZE);
+    unsigned rowLength;
+    RID rid;
     RC rc;
+    while((rc = ixScanIterator.getNextRow(key, row, rowLength)) == 0){
+        rc = decodeRowKey(tree, key, rid);
+        if(rc == 0){
+            rc = deFormatVersionedRecord(versionDescriptors, std::string(row, rowLength), tuple);
+        }
+        if(rc != 0){
+            break;
+        }
+        visit(rid, tuple);
+    }
+    
+    // close() also closes the tree
+    ixScanIterator.close();
+    free(key);
+    free(row);
+    free(tuple);
+    return rc == IX_EOF ? 0 : rc;
+}
+
+RC RelationManager::scanIndexEntries(const std::string &fileName, const std::vector<std::vector<Attribute>> &versionDescriptors,
+                                     const std::vector<Attribute> &keyAttrs, unsigned startPage, unsigned endPage, std::vector<IndexEntry> &entries,
+                                     unsigned &numOfTuples, bool withNulls){
+    FileHandle fileHandle;
+    RBFM_ScanIterator rbfmScanIterator;
+    
+    std::vector<std::string> attrNames;
+    for(const Attribute &attr : keyAttrs){
+        attrNames.push_back(attr.name);
+    }
+    
+    if(_rbfm->openFile(fileName, fileHandle) != 0){
+        // std::cout << "[Error]: scanIndexEntries -> fail to open table file" << std::endl;
+        return -1;
+    }
+    if(_rbfm->scan(fileHandle, versionDescriptors.back(), "", NO_OP, NULL, attrNames, rbfmScanIterator) != 0){
+        // std::cout << "[Error]: scanIndexEntries -> fail to initiate scan iterator" << std::endl;
+        _rbfm->closeFile(fileHandle);
+        return -1;
+    }
+    rbfmScanIterator.setVersionDescriptors(versionDescriptors);
+    rbfmScanIterator.setPageRange(startPage, endPage);
+    
+    RID rid;
+    void *returnedData = malloc(PAGE_SIZE);
+    char *key = (char *)malloc(PAGE_SIZE);
+    Attribute attribute = keyAttrs.size() == 1 ? keyAttrs[0] : _im->getCompositeAttribute(keyAttrs);
+    numOfTuples = 0;
+    while(rbfmScanIterator.getNextRecord(rid, returnedData) != RM_EOF){
+        numOfTuples++;
+        IndexEntry entry;
+        if(getIndexKey(keyAttrs, returnedData, keyAttrs, key)){
+            entry.key.assign(key, _im->getKeyLength(attribute, key));
+        }
+        else if(!withNulls){
+            // null is not indexed, e.g. records written before this attribute was added.
+            continue;
+        }
+        entry.rid = rid;
+        entries.push_back(entry);
+    }
+    
+    free(key);
+    free(returnedData);
+    rbfmScanIterator.close();
+    return 0;
+}
+
+RC RelationManager::getIndexAttributes(const std::vector<Attribute> &attrs, const std::string &columnName, std::vector<Attribute> &keyAttrs,
+                                       Attribute &attribute){
+    keyAttrs.clear();
+    size_t start = 0;
+    while(start <= columnName.size()){
+        size_t end = columnName.find(COMPOSITE_KEY_SEPARATOR, start);
+        if(end == std::string::npos){
+            end = columnName.size();
+        }
+        std::string name = columnName.substr(start, end - start);
+        auto attr = std::find_if(attrs.begin(), attrs.end(), [&](const Attribute &a){ return a.name == name; });
+        if(attr == attrs.end()){
+            // std::cout << "[Error]: getIndexAttributes -> can't find the attribute." << std::endl;
+            return -1;
+        }
+        keyAttrs.push_back(*attr);
+        start = end + 1;
+    }
+    attribute = keyAttrs.size() == 1 ? keyAttrs[0] : _im->getCompositeAttribute(keyAttrs);
+    return 0;
+}
+
+bool RelationManager::getIndexKey(const std::vector<Attribute> &attrs, const void *tuple, const std::vector<Attribute> &keyAttrs, void *key){
+    // offsets of the values in tuple, -1 for NULL
+    int nullIndicatorSize = ceil((double) attrs.size() / CHAR_BIT);
+    std::vector<int> offsets(attrs.size(), -1);
+    int offset = nullIndicatorSize;
+    for(size_t i = 0; i < attrs.size(); i++){
+        if(((const unsigned char *)tuple)[i / CHAR_BIT] & (unsigned) 1 << (unsigned) (7 - i % CHAR_BIT)){
+            continue;
+        }
+        offsets[i] = offset;
+        offset += _im->getKeyLength(attrs[i], (const char *)tuple + offset);
+    }
+    
+    // the values of keyAttrs in the record format, a single one is the key as it is
+    char *data = (char *)malloc(PAGE_SIZE);
+    int keyNullIndicatorSize = ceil((double) keyAttrs.size() / CHAR_BIT);
+    memset(data, 0, keyNullIndicatorSize);
+    offset = keyNullIndicatorSize;
+    for(size_t i = 0; i < keyAttrs.size(); i++){
+        size_t j = 0;
+        while(j < attrs.size() && attrs[j].name != keyAttrs[i].name){
+            j++;
+        }
+        if(j == attrs.size() || offsets[j] == -1){
+            data[i / CHAR_BIT] |= (unsigned) 1 << (unsigned) (7 - i % CHAR_BIT);
+            continue;
+        }
+        int length = _im->getKeyLength(attrs[j], (const char *)tuple + offsets[j]);
+        memcpy(data + offset, (const char *)tuple + offsets[j], length);
+        offset += length;
+    }
+    bool hasKey = true;
+    if(keyAttrs.size() == 1){
+        hasKey = !(data[0] & (unsigned) 1 << (unsigned) 7);
+        memcpy(key, data + keyNullIndicatorSize, offset - keyNullIndicatorSize);
+    }
+    else{
+        _im->encodeCompositeKey(keyAttrs, data, key);
+    }
+    free(data);
+    return hasKey;
+}
+
+RC RelationManager::lookupCatalogIndex(const std::string &indexFileName, const Attribute &attribute, const void *key, std::vector<RID> &rids){
+    IXFileHandle ixFileHandle;
+    IX_ScanIterator ixScanIterator;
+    
+    rids.clear();
+    if(_im->openFile(indexFileName, ixFileHandle) != 0){
+        // std::cout << "[Error]: lookupCatalogIndex -> fail to open catalog index." << std::endl;
+        return -1;
+    }
+    if(_im->scan(ixFileHandle, attribute, key, key, true, true, ixScanIterator) != 0){
+        // std::cout << "[Error]: lookupCatalogIndex -> fail to initialize the scan." << std::endl;
+        _im->closeFile(ixFileHandle);
+        return -1;
+    }
+    
+    RID rid;
     void *returnedKey = malloc(PAGE_SIZE);
+    while(ixScanIterator.getNextEntry(rid, returnedKey) != IX_EOF){
+        rids.push_back(rid);
+    }
+    
+    // close() also closes the index file
+    ixScanIterator.close();
+    free(returnedKey);
+    return 0;
+}
+
+RC RelationManager::updateCatalogIndex(const std::string &indexFileName, const Attribute &attribute, const void *key, const RID &rid, int operationFlag){
+    IXFileHandle ixFileHandle;
+    RC rc = -1;
+    
+    if(_im->openFile(indexFileName, ixFileHandle) != 0){
+        // std::cout << "[Error]: updateCatalogIndex -> fail to open catalog index." << std::endl;
+        return -1;
+    }
+    if(operationFlag == 1){
+        rc = _im->insertEntry(ixFileHandle, attribute, key, rid);
+    }
+    else if(operationFlag == 2){
+        rc = _im->deleteEntry(ixFileHandle, attribute, key, rid);
+    }
+    _im->closeFile(ixFileHandle);
+    
+    if(rc != 0){
+        // std::cout << "[Error]: updateCatalogIndex -> fail to update catalog index." << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+RC RelationManager::indexOperationWhenTupleChanged(const std::string &tableName, const RID rid, const std::map<std::pair<std::string, std::string>, RID> columnIndexMap, const std::vector<std::vector<Attribute>> &versionDescriptors, int operationFlag){
+    FileHandle fileHandle;
+    IXFileHandle ixFileHandle;
+    const std::vector<Attribute> &attrs = versionDescriptors.back();
+    ClusteredTree tree;
+    bool clustered = getClusteredTree(columnIndexMap, attrs, tree) == 0;
+    if(columnIndexMap.size() == (clustered ? 1u : 0u)){
+        return 0;
+    }
+    
+    // the tuple is read once for all of the indexes, from the tree of an index-organized table
+    RC rc = 0;
+    void *tuple = malloc(PAGE_SIZE);
+    void *key = malloc(PAGE_SIZE);
     _rbfm->openFile(tableName, fileHandle);
+    if(clustered){
+        rc = openClusteredTree(tree, ixFileHandle);
+        if(rc == 0){
+            rc = readClusteredTuple(fileHandle, ixFileHandle, tree, versionDescriptors, rid, tuple);
+            _im->closeFile(ixFileHandle);
+        }
+    }
+    else{
+        rc = readVersionedRecord(fileHandle, versionDescriptors, rid, tuple);
+    }
+    _rbfm->closeFile(fileHandle);
+    if(rc != 0){
+        // std::cout << "[Error]: indexOperationWhenTupleChanged -> fail to read the tuple" << std::endl;
+        free(tuple);
+        free(key);
+        return -1;
+    }
     
     for(auto it = columnIndexMap.begin(); it != columnIndexMap.end(); it++){
-        _rbfm->readAttribute(fileHandle, attrs, rid, it->first.first, returnedKey);
-        char nullIndicator;
-        memcpy(&nullIndicator, returnedKey, sizeof(char));
-        int nullIndicatorSize = ceil((double(attrs.size())/CHAR_BIT));
-        memmove(returnedKey, (char *)returnedKey+nullIndicatorSize, PAGE_SIZE-nullIndicatorSize);
+        std::vector<Attribute> keyAttrs;
+        Attribute attribute;
+        if(isClusteredTree(it->first.second)){
+            continue;
+        }
+        if(getIndexAttributes(attrs, it->first.first, keyAttrs, attribute) != 0 || !getIndexKey(attrs, tuple, keyAttrs, key)){
+            // null is not indexed
+            continue;
+        }
         _im->openFile(it->first.second, ixFileHandle);
-        for(auto &attribute : attrs){
-            if(attribute.name == it->first.first){
-                if(operationFlag == 1){
-                    rc = _im->insertEntry(ixFileHandle, attribute, returnedKey, rid);
-                    if(rc != 0){
-                        // std::cout << "[Error]: RelationManager::indexOperationWhenTupleChanged -> fail to _im->insertEntry" << std::endl;
-                    }
-                }
-                else if(operationFlag == 2){
-                    rc = _im->deleteEntry(ixFileHandle, attribute, returnedKey, rid);
-                }
-                
-                if(rc != 0){
-                    // std::cout << "[Error]: insertTuple -> insertEntry into index file" << std::endl;
-                    return -1;
-                }
-//                _im->printBtree(ixFileHandle, attribute);
+        bool isHash = _hm->isHashIndex(it->first.second);
+        if(operationFlag == 1){
+            rc = isHash ? _hm->insertEntry(ixFileHandle, attribute, key, rid) : _im->insertEntry(ixFileHandle, attribute, key, rid);
+            if(rc != 0){
+                // std::cout << "[Error]: RelationManager::indexOperationWhenTupleChanged -> fail to _im->insertEntry" << std::endl;
             }
         }
+        else if(operationFlag == 2){
+            rc = isHash ? _hm->deleteEntry(ixFileHandle, attribute, key, rid) : _im->deleteEntry(ixFileHandle, attribute, key, rid);
+        }
         _im->closeFile(ixFileHandle);
+        
+        if(rc != 0){
+            // std::cout << "[Error]: insertTuple -> insertEntry into index file" << std::endl;
+            free(tuple);
+            free(key);
+            return -1;
+        }
+//        _im->printBtree(ixFileHandle, attribute);
     }
-    _rbfm->closeFile(fileHandle);
-    free(returnedKey);
+    free(tuple);
+    free(key);
     return 0;
-}
\ No newline at end of file
+}
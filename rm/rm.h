@@ -3,24 +3,65 @@
 
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #include "../rbf/rbfm.h"
 #include "../ix/ix.h"
+#include "../ix/hash.h"
+#include "stats.h"
 
 # define TABLE_NAME "Tables"
 # define COLUMN_NAME "Columns"
 # define INDEX_NAME "Indexes"
+# define STATISTICS_NAME "Statistics"
+
+// B+ tree indexes on the catalogs, named as tableName_attributeName like other index files
+# define TABLE_NAME_INDEX "Tables_table-name"
+# define COLUMN_TABLE_ID_INDEX "Columns_table-id"
+# define INDEX_TABLE_NAME_INDEX "Indexes_table-name"
+# define STATISTICS_TABLE_ID_INDEX "Statistics_table-id"
 
 # define RM_EOF (-1)  // end of a scan operator
 # define TypeVarCharLen 50
 # define TypeIntLen 4
 # define TypeRealLen 4
 
+# define INDEX_BUILD_MAX_THREADS 8    // max number of threads createIndex scans the table with
+# define CLUSTERED_FILE_PREFIX ".clustered_"    // clusterTable writes the new table and index files under these names first
+# define CLUSTER_FETCH_BATCH 1024    // tuples clusterTable reads at once, page by page
+# define CLUSTERED_TREE_SUFFIX ".tree"     // B+ tree holding the rows of an index-organized table, see ClusteredTree
+
 typedef enum {
     systemFlag = 0,
     customFlag
 } Flag;
 
+// Access method of an index, see RelationManager::createIndex(...)
+typedef enum {
+    btreeIndex = 0,
+    hashIndex
+} IndexType;
+
+// One row of Columns catalog.
+typedef struct {
+    Attribute attr;
+    int position;
+    int version;        // schema version which adds this column
+    int dropVersion;    // schema version which drops this column, 0 if the column is still alive
+    RID rid;            // rid of this row inside Columns
+} ColumnRecord;
+
+// The B+ tree of an index-organized table, recorded in Indexes like an index on the cluster key (see createTable(...)).
+// Its leaves hold the rows (IndexManager::insertRow(...)) in the format of rbfm records, under the composite key
+// <cluster key, rid>. The heap file of the table keeps one record per row with the cluster key only, which gives the row
+// its rid and maps the rid back to the key of the row, so rids stay stable while the tree splits and merges.
+typedef struct {
+    std::string fileName;
+    std::vector<Attribute> keyAttrs;            // the cluster key, then the pageNum and the slotNum of the rid
+    Attribute attribute;                        // the composite attribute of the keys
+    std::vector<Attribute> locatorDescriptor;   // the cluster key, descriptor of the records of the heap file
+} ClusteredTree;
+
 // RM_ScanIterator is an iterator to go through tuples
 class RM_ScanIterator {
 public:
@@ -40,9 +81,44 @@ public:
     RBFM_ScanIterator &getRBFMScanIterator(){
         return _rbfmScanItearator;
     };
+    
+    IXFileHandle &getIXFileHandle(){
+        return _ixFileHandle;
+    }
+    
+    IX_ScanIterator &getIXScanIterator(){
+        return _ixScanItearator;
+    };
+    
+    // each getNextTuple(...) holds the table latch in shared mode, so DDL on the table waits for it.
+    RC setTableLatch(RWLatch *tableLatch){
+        _tableLatch = tableLatch;
+        return 0;
+    }
+    
+    /*
+     * Scan of an index-organized table, the scan of its tree is already initialized: the rows come in key order, each one is
+     * checked against the condition and projected to attributeNames here, like RBFM_ScanIterator does with records.
+     */
+    RC setClusteredScan(const ClusteredTree &tree, const std::vector<std::vector<Attribute>> &versionDescriptors,
+                        const std::string &conditionAttribute, CompOp compOp, const void *value,
+                        const std::vector<std::string> &attributeNames);
 private:
+    RC getNextRow(RID &rid, void *data);        // getNextTuple(...) of the scan of a tree
+    
     RBFM_ScanIterator _rbfmScanItearator;
     FileHandle _fileHandle;
+    RWLatch *_tableLatch = nullptr;
+    
+    bool _clustered = false;
+    IX_ScanIterator _ixScanItearator;
+    IXFileHandle _ixFileHandle;
+    ClusteredTree _tree;
+    std::vector<std::vector<Attribute>> _versionDescriptors;
+    Attribute _conditionAttribute;              // its name is empty without a condition
+    CompOp _compOp = NO_OP;
+    const void *_value = nullptr;
+    std::vector<std::string> _attributeNames;
 };
 
 // RM_IndexScanIterator is an iterator to go through index entries
@@ -62,12 +138,25 @@ public:
     IX_ScanIterator &getIXScanIterator(){
         return _ixScanItearator;
     };
+    
+    // each getNextEntry(...) holds the table latch in shared mode, so DDL on the table waits for it.
+    RC setTableLatch(RWLatch *tableLatch){
+        _tableLatch = tableLatch;
+        return 0;
+    }
 private:
     IX_ScanIterator _ixScanItearator;
     IXFileHandle _ixFileHandle;
+    RWLatch *_tableLatch = nullptr;
 };
 
 // Relation Manager
+// RelationManager can be used by several threads at the same time. Each table has a reader-writer latch:
+// DML (insert/delete/update/read/scan) holds it in shared mode, DDL (create/delete table, create/destroy index,
+// add/drop attribute) holds it in exclusive mode. DDL is also serialized by a mutex since it changes the catalogs in several steps.
+// Concurrent DML on one table is made safe by the latches of rbfm and the B+ tree.
+// Every insertTuple/deleteTuple/updateTuple is a transaction of the write-ahead log (see wal.h): it changes the heap file and
+// all the indexes or none of them, and it is durable once it returns. Recovery runs when RelationManager is constructed.
 class RelationManager {
 public:
     static RelationManager &instance();
@@ -75,16 +164,25 @@ public:
     /*
      * system catalog:
      * Tables (table-id:int, table-name:varchar(50), file-name:varchar(50))
-     * Columns(table-id:int, column-name:varchar(50), column-type:int, column-length:int, column-position:int)
+     * Columns(table-id:int, column-name:varchar(50), column-type:int, column-length:int, column-position:int, column-version:int, drop-version:int)
      * Indexes(table-name:varchar(50), column-name:varchar(50), index-name:varchar(50))
+     * Statistics(table-id:int, column-name:varchar(50), row-count:int, page-count:int, null-count:int, distinct-count:int,
+     *            histogram:varchar, sketch:varchar)
+     *
+     * column-version and drop-version record the schema version which adds and drops the column. The current schema version of a table
+     * is the largest of them, every record is stamped with the schema version it is written with.
+     *
+     * Statistics has a row for each table analyzed, with an empty column-name, and one for each of its columns, see analyze(...).
      *
-     * Insert three record into Tables, each one is corresponding to a catalog table.
-     * Insert three descriptor into Columns.
+     * Insert four record into Tables, each one is corresponding to a catalog table.
+     * Insert four descriptor into Columns.
+     * Create B+ tree indexes on Tables(table-name), Columns(table-id), Indexes(table-name) and Statistics(table-id) and record
+     * them in Indexes, catalog lookups use these indexes instead of scanning the catalog files.
      */
     RC createCatalog();
     
     /*
-     * destroy three catalog files.
+     * destroy four catalog files and their indexes.
      */
     RC deleteCatalog();
     
@@ -92,8 +190,12 @@ public:
      * get tableId. tableId is stored in hidden page after three pageCounter: readPageCounter, writePageCounter and appendPageCounter.
      * Increase the tableId as table id for new table.
      * Then insert into Tables and Columns.
+     * With a clusterKey the table is index-organized: its rows live in the leaves of a B+ tree ordered by that attribute
+     * (see ClusteredTree), inserts, reads and scans go through the tree and a scan returns the tuples in key order,
+     * a condition on the key only reads its range. It stays so for the life of the table, the key can't be dropped.
+     * A row may take IX_MAX_ROW_SIZE bytes at most in the record format.
      */
-    RC createTable(const std::string &tableName, const std::vector<Attribute> &attrs);
+    RC createTable(const std::string &tableName, const std::vector<Attribute> &attrs, const std::string &clusterKey = "");
     
     /*
      * Key: when delete a table, need to delete record in three catalog files and also associated index file.
@@ -133,6 +235,12 @@ public:
      */
     RC readTuple(const std::string &tableName, const RID &rid, void *data);
     
+    /*
+     * Read the tuples of many rids with one latch of the table and one open file, tuples[i] gets the tuple of rids[i]
+     * (empty if it is deleted). Each page of the heap file is read once for all the rids on it, in the order of pageNum.
+     */
+    RC readTuples(const std::string &tableName, const std::vector<RID> &rids, std::vector<std::string> &tuples);
+    
     /*
      * Print a tuple that is passed to this utility method.
      * The format is the same as printRecord().
@@ -148,7 +256,7 @@ public:
     /*
      * Scan returns an iterator to allow the caller to go through the results one by one.
      * Do not store entire results in the scan iterator.
-     * Using RM_ScanIterator is essentially using RBFM_ScanIterator
+     * Using RM_ScanIterator is essentially using RBFM_ScanIterator, or the scan of the tree of an index-organized table.
     */
     RC scan(const std::string &tableName,
             const std::string &conditionAttribute,
@@ -161,19 +269,48 @@ public:
      * This method creates an index on a given attribute of a given table. (It should also reflect its existence in the catalogs.)
      * This function could and only could be called once for this tableName and attributeName combination.
      * First, insert record into Indexes catalog file.
-     * Then scan all the record inside heap file, build a index file on this attributeName.
+     * Then scan the heap file in parallel with scanIndexEntries(...), each thread takes a range of pages, to collect all the <key, rid> pairs.
+     * Finally _im->bulkBuild(...) sorts them and builds the index bottom-up, leaves and intermediate nodes are filled up to fillFactor.
+     */
+    RC createIndex(const std::string &tableName, const std::string &attributeName, float fillFactor = IX_FILL_FACTOR);
+    
+    /*
+     * Create an index of the given type. A btreeIndex is the B+ tree above. A hashIndex is an extendible hashing index
+     * (see HashIndexManager) whose file, recorded in Indexes, is named with HASH_INDEX_SUFFIX: an equality indexScan(...) or
+     * indexProbe(...) reads one bucket page, other scans read every bucket and return the entries in no order.
+     * An attribute has one index of either type.
+     */
+    RC createIndex(const std::string &tableName, const std::string &attributeName, IndexType indexType, float fillFactor = IX_FILL_FACTOR);
+    
+    /*
+     * An index on several attributes, its keys are compared in the order of attributeNames (see
+     * IndexManager::encodeCompositeKey(...)). It is named after the attributes joined by COMPOSITE_KEY_SEPARATOR,
+     * e.g. "dept,age", in Indexes and for destroyIndex(...), indexScan(...) and clusterTable(...). NULLs are indexed too.
      */
-    RC createIndex(const std::string &tableName, const std::string &attributeName);
+    RC createCompositeIndex(const std::string &tableName, const std::vector<std::string> &attributeNames, float fillFactor = IX_FILL_FACTOR);
     
     /*
      * This method destroys an index on a given attribute of a given table. (It should also reflect its non-existence in the catalogs.)
-     * delete the index file and use RBFMScanIterator to delete the record inside Indexes catalog file.
+     * find the record inside Indexes catalog file with generateCoumnIndexMapGivenTable(...), delete it and the index file.
+     * The indexes on the catalogs can't be destroyed.
      */
     RC destroyIndex(const std::string &tableName, const std::string &attributeName);
     
+    /*
+     * Rewrite the heap file in the order of attributeName, like CLUSTER of PostgreSQL: a range scan of the index on attributeName
+     * then reads the heap file mostly sequentially. It is a one-time reorganization, not an index-organized table: tuples inserted
+     * later are appended as usual, clusterTable(...) can be called again to put them in order. -1 for an index-organized table.
+     * The <key, rid> pairs of the table are sorted (NULLs last) and the tuples fetched in that order, CLUSTER_FETCH_BATCH at a time,
+     * into a new file named with CLUSTERED_FILE_PREFIX. They get new RIDs, so every index and Bloom filter of the table is built
+     * again aside as well. Only then they all replace the old files in one logged step, see LogManager::replaceFiles(...):
+     * on failure the table is left as it was, after a crash recovery either keeps the old files or finishes the swap.
+     */
+    RC clusterTable(const std::string &tableName, const std::string &attributeName);
+    
     /*
      * indexScan returns an iterator to allow the caller to go through qualified entries in index
      * Using RM_IndexScanIterator is essentially using IX_ScanIterator.
+     * A reverse scan returns the entries from highKey down to lowKey, see IndexManager::scan(...). A hash index has no order, it fails.
     */
     RC indexScan(const std::string &tableName,
                  const std::string &attributeName,
@@ -181,9 +318,71 @@ public:
                  const void *highKey,
                  bool lowKeyInclusive,
                  bool highKeyInclusive,
-                 RM_IndexScanIterator &rm_IndexScanIterator);
+                 RM_IndexScanIterator &rm_IndexScanIterator,
+                 bool reverse = false);
+    
+    /*
+     * Scan the composite index on attributeNames for the keys whose first numOfPrefixAttributes attributes equal prefix
+     * (in the record format of these attributes) and whose next one lies between lowKey and highKey,
+     * see IndexManager::prefixScan(...). The keys returned are encoded, IndexManager::decodeCompositeKey(...) reads them.
+     */
+    RC indexPrefixScan(const std::string &tableName,
+                       const std::vector<std::string> &attributeNames,
+                       const void *prefix,
+                       unsigned numOfPrefixAttributes,
+                       const void *lowKey,
+                       const void *highKey,
+                       bool lowKeyInclusive,
+                       bool highKeyInclusive,
+                       RM_IndexScanIterator &rm_IndexScanIterator);
+    
+    /*
+     * Look up the sorted keys (in the format of insertEntry) of an index at once, rids[i] gets the RIDs of keys[i].
+     * The index file is opened once for all of them, see IndexManager::probeEntries(...).
+     */
+    RC indexProbe(const std::string &tableName,
+                  const std::string &attributeName,
+                  const std::vector<std::string> &keys,
+                  std::vector<std::vector<RID>> &rids);
+    
+    /*
+     * Build a Bloom filter of the keys of the B+ tree index on attributeName, see IndexManager::createBloomFilter(...):
+     * indexProbe(...) and indexScan(...) of one key skip the keys it rules out without reading the index, like the keys
+     * of an INLJoin which have no match. Inserts add their keys to it, clusterTable(...) builds it again.
+     * Building it again sizes it for the keys the index has then. -1 for a hash index.
+     */
+    RC createBloomFilter(const std::string &tableName, const std::string &attributeName,
+                         float falsePositiveRate = BLOOM_FALSE_POSITIVE_RATE);
+
+    /*
+     * Collect the statistics of a table in one scan and store them in Statistics, replacing the ones it had:
+     * its tuples and pages, and for each column its NULLs, its distinct values (HyperLogLog sketch) and an equi-depth
+     * histogram (see ColumnStatistics) whose first and last bounds are its min and max.
+     * createIndex(...) and clusterTable(...) refresh the table and the columns of single attribute indexes from the
+     * keys they build the indexes with. Other changes of the table leave the statistics as they are until the next analyze(...).
+     */
+    RC analyze(const std::string &tableName);
+    
+    /*
+     * The statistics of a table and of one of its columns in Statistics, -1 if it has none (never analyzed).
+     */
+    RC getTableStatistics(const std::string &tableName, TableStatistics &statistics);
+    RC getColumnStatistics(const std::string &tableName, const std::string &attributeName, ColumnStatistics &statistics);
+    
+    /*
+     * Estimate the share of the tuples of a table satisfying "attributeName compOp value", for the cost of a plan,
+     * see ColumnStatistics::selectivity(...). A column without statistics gets STATS_DEFAULT_EQ_SELECTIVITY for
+     * equality and STATS_DEFAULT_RANGE_SELECTIVITY for a range.
+     */
+    RC estimateSelectivity(const std::string &tableName, const std::string &attributeName, CompOp compOp, const void *value,
+                           double &selectivity);
 
 // Extra credit work (10 points)
+    /*
+     * Schema change only touches Columns, the heap file is never rewritten.
+     * addAttribute inserts a Columns row for the next schema version with the next column-position. Old records read the new attribute as NULL.
+     * dropAttribute sets drop-version of the column's row (and destroys its index). Old records skip the dropped attribute.
+     */
     RC addAttribute(const std::string &tableName, const Attribute &attr);
     
     RC dropAttribute(const std::string &tableName, const std::string &attributeName);
@@ -195,19 +394,23 @@ protected:
     RelationManager &operator=(const RelationManager &);                // Prevent assignment
     
     /*
-     * hard code the attributes of three catalog table descriptors.
+     * hard code the attributes of four catalog table descriptors.
      * Tables (table-id:int, table-name:varchar(50), file-name:varchar(50))
-     * Columns(table-id:int, column-name:varchar(50), column-type:int, column-length:int, column-position:int)
+     * Columns(table-id:int, column-name:varchar(50), column-type:int, column-length:int, column-position:int, column-version:int, drop-version:int)
      * Indexes(table-name:varchar(50), column-name:varchar(50), index-name:varchar(50))
+     * Statistics(table-id:int, column-name:varchar(50), row-count:int, page-count:int, null-count:int, distinct-count:int, histogram:varchar, sketch:varchar)
      */
     RC prepareTablesDescriptor();
     RC prepareColumnsDescriptor();
     RC prepareIndexesDescriptor();
+    RC prepareStatisticsDescriptor();
+    
+    friend class RM_ScanIterator;                                       // decodeRowKey(...)
     
     /*
      * insert record into Tables
      * fileHandle already opens table Tables, call prepareTablesRecord(...) to prepare the record given tableId, tableName and fileName.
-     * Then call rbfm.insertRecord(...) to insert the record into Tables.
+     * Then call rbfm.insertRecord(...) to insert the record into Tables, and insert <tableName, rid> into the index on table-name.
      */
     RC insertRecordToTables(FileHandle &fileHandle, RecordBasedFileManager &rbfm, int tableId, std::string tableName, std::string fileName);
     
@@ -219,28 +422,35 @@ protected:
     
     /*
      * Same as insertRecordToTables(...), but prepare Columns record and insert the record into Columns catalog file.
-     * fileHandle already opens table Columns, call prepareColumnsRecord(...) to prepare the record given tableId, columnName, columnType, columnLength and columnPosition.
-     * Then call rbfm.insertRecord(...) to insert the record into Columns.
+     * fileHandle already opens table Columns, call prepareColumnsRecord(...) to prepare the record given tableId, columnName, columnType, columnLength, columnPosition and columnVersion.
+     * Then call rbfm.insertRecord(...) to insert the record into Columns, and insert <tableId, rid> into the index on table-id.
     */
-    RC insertRecordToColumns(FileHandle &fileHandle, RecordBasedFileManager &rbfm, int tableId, std::string columnName, int columnType, int columnLength, int columnPosition);
+    RC insertRecordToColumns(FileHandle &fileHandle, RecordBasedFileManager &rbfm, int tableId, std::string columnName, int columnType, int columnLength, int columnPosition, int columnVersion = 0);
     
     /*
      * Same as insertRecordToTables(...), but prepare Indexes record and insert the record into Indexes catalog file.
      * fileHandle already opens table INdexes, call prepareIndexesRecord(...) to prepare the record given tableName, columnName and indexName.
-     * Then call rbfm.insertRecord(...) to insert the record into Indexes.
+     * Then call rbfm.insertRecord(...) to insert the record into Indexes, and insert <tableName, rid> into the index on table-name.
     */
     RC insertRecordToIndexes(FileHandle &fileHandle, RecordBasedFileManager &rbfm, std::string tableName, std::string columnName, std::string indexName);
     
     /*
      * The following three function are used to format the data into target format, as the original input data format in rbfm.cc. That is nullIndicator followed by attributes. And for varChar, varCharLen is followed by the actual varChar data.
      * Tables (table-id:int, table-name:varchar(50), file-name:varchar(50))
-     * Columns(table-id:int, column-name:varchar(50), column-type:int, column-length:int, column-position:int)
+     * Columns(table-id:int, column-name:varchar(50), column-type:int, column-length:int, column-position:int, column-version:int, drop-version:int)
      * Indexes(table-name:varchar(50), column-name:varchar(50), index-name:varchar(50))
      */
     RC prepareTablesRecord(int tableId, std::string tableName, std::string fileName, void *data);
-    RC prepareColumnsRecord(int tableId, std::string columnName, int columnType, int columnLength, int columnPosition, void *data);
+    RC prepareColumnsRecord(int tableId, std::string columnName, int columnType, int columnLength, int columnPosition, int columnVersion, int dropVersion, void *data);
     RC prepareIndexesRecord(std::string tableName, std::string columnName, std::string indexName, void *data);
     
+    /*
+     * A row of Statistics, the one of the table if column is nullptr: its null-count and distinct-count are 0,
+     * its histogram and sketch NULL. The bounds of the histogram are stored one after the other in the format of insertEntry.
+     */
+    RC prepareStatisticsRecord(int tableId, const std::string &columnName, const TableStatistics &table, const ColumnStatistics *column,
+                               void *data);
+    
     /*
      * The following three functions are used in the upper functions to format the data into target format.
      */
@@ -249,24 +459,87 @@ protected:
     RC prepareFloat(float &value, void *data, int &offset);
     
     /*
-     * Use RBFM_ScanIterator to scan the catalog file - Tables to get the tableId for this table.
+     * Used by createIndex(...) and clusterTable(...), collect <key, rid> pairs of keyAttrs from pages [startPage, endPage) of the
+     * heap file fileName, see getIndexKey(...). It opens its own FileHandle, so several ranges can be scanned by different threads
+     * at the same time. numOfTuples gets the tuples of the range, the ones without a key too, withNulls keeps them with an empty key.
+     */
+    RC scanIndexEntries(const std::string &fileName, const std::vector<std::vector<Attribute>> &versionDescriptors,
+                        const std::vector<Attribute> &keyAttrs, unsigned startPage, unsigned endPage, std::vector<IndexEntry> &entries,
+                        unsigned &numOfTuples, bool withNulls = false);
+    
+    /*
+     * The index on columnName (one attribute, or the attributes of a composite key joined by COMPOSITE_KEY_SEPARATOR):
+     * keyAttrs gets its attributes in attrs and attribute the one of its keys. -1 if an attribute is not in attrs.
+     */
+    RC getIndexAttributes(const std::vector<Attribute> &attrs, const std::string &columnName, std::vector<Attribute> &keyAttrs,
+                          Attribute &attribute);
+    
+    /*
+     * Write the key of the index on keyAttrs of tuple (in the format of attrs) into key, in the format of insertEntry.
+     * False if the tuple has no key: NULL is not indexed by a single attribute, a composite key encodes it.
+     */
+    bool getIndexKey(const std::vector<Attribute> &attrs, const void *tuple, const std::vector<Attribute> &keyAttrs, void *key);
+    
+    /*
+     * Probe a catalog index with an equality scan, rids gets all the rids whose key == key.
+     */
+    RC lookupCatalogIndex(const std::string &indexFileName, const Attribute &attribute, const void *key, std::vector<RID> &rids);
+    
+    /*
+     * Keep a catalog index up to date when its catalog file changes.
+     * if operationFlag == 1: insertion.
+     * if operationFlag == 2: deletion.
+     */
+    RC updateCatalogIndex(const std::string &indexFileName, const Attribute &attribute, const void *key, const RID &rid, int operationFlag);
+    
+    /*
+     * Use lookupCatalogIndex(...) on Tables(table-name) to get the rid of this table, then read the tableId from Tables.
      * This function also return a rid which maybe used in other function like, deleteTableInsideTables(...)
      */
     RC getTableIdForCustomTable(const std::string &tableName, int &tableId, RID &rid);
     
     /*
      * Since we already get tableId by last function, then we can use this function to get a customDescriptor which is attrs.
-     * Similarly, we use RBFM_ScanIterator to get the target result, there are multiple output corresponding to different attributes of this table.
-     * For each output, call getAttributeFromData to generate an Attribute, added into customDescriptor which is attrs
+     * Only the columns alive in the current schema version are returned, ordered by column-position.
      */
     RC getAttributesGivenTableId(int tableId, std::vector<Attribute> &attrs);
     
     /*
-     * Use attrNames and data to generate an Attribute.
-     * Attribute struct has three variables: name, type and length.
-     * data also contains three value from RBFM_ScanIterator: column-name, column-type and column-length.
+     * Similarly, we use lookupCatalogIndex(...) on Columns(table-id) to get the rids, there are multiple output corresponding to different columns of this table, including dropped ones.
+     * For each output, call getColumnRecordFromData to generate a ColumnRecord, sorted by column-position.
+     */
+    RC getColumnsGivenTableId(int tableId, std::vector<ColumnRecord> &columns);
+    
+    /*
+     * Use attrNames and data to generate a ColumnRecord.
+     * data contains the value from _rbfm->readAttributes(...): column-name, column-type, column-length, column-position, column-version and drop-version.
+     */
+    ColumnRecord getColumnRecordFromData(std::vector<std::string> attrNames, void *data);
+    
+    /*
+     * versionDescriptors[v] is the record descriptor of schema version v, the last one is the current descriptor (same as getAttributes).
+     * In an old descriptor, a column which has been dropped since then keeps its type and length but has an empty name.
+     */
+    RC getVersionDescriptors(const std::string &tableName, std::vector<std::vector<Attribute>> &versionDescriptors);
+    
+    /*
+     * Version-aware reads of the heap file. Records stamped with an old version are read through their own descriptor
+     * and projected to the current one: missing attributes are NULL, dropped attributes are skipped.
+     * data has the same format as _rbfm->readRecord(...) and _rbfm->readAttribute(...) with the current descriptor.
+     */
+    RC readVersionedRecord(FileHandle &fileHandle, const std::vector<std::vector<Attribute>> &versionDescriptors, const RID &rid, void *data);
+
+    /*
+     * readVersionedRecord(...) of a formatted record already read with _rbfm->readFormattedRecords(...).
+     */
+    RC deFormatVersionedRecord(const std::vector<std::vector<Attribute>> &versionDescriptors, const std::string &record, void *data);
+    
+    /*
+     * Length of a tuple in the format of readTuple(...): the null indicator and the values which are not NULL.
      */
-    Attribute getAttributeFromData(std::vector<std::string> attrNames, void *data);
+    int getTupleLength(const std::vector<Attribute> &attrs, const void *data) const;
+    RC readVersionedAttribute(FileHandle &fileHandle, const std::vector<std::vector<Attribute>> &versionDescriptors, const RID &rid,
+                              const std::string &attributeName, void *data);
     
     /*
      * seach tableID inside Tables with tableName, and delete this row.
@@ -275,7 +548,7 @@ protected:
     RC deleteTableInsideTables(const std::string tableName, int &tableId);
     
     /*
-     * Given tableId, use RBFM_ScanIterator to get rid where the retrieved tableId == tableId, then delete this row with rid.
+     * Given tableId, use lookupCatalogIndex(...) to get rid where the retrieved tableId == tableId, then delete this row with rid.
      */
     RC deleteTableInsideColumns(int &tableId);
     
@@ -286,28 +559,144 @@ protected:
     RC deleteTableInsideIndexes(const std::string tableName);
     
     /*
-     * This function generate a map which is <<columnName, IndexName>, rid>
+     * Delete the rows of tableId in Statistics, or the row of one column if columnName is given.
+     */
+    RC deleteTableInsideStatistics(int tableId, const std::string *columnName = nullptr);
+    
+    /*
+     * The row of columnName (empty for the table) of tableId in Statistics: its rid, the statistics of the table and, if column
+     * is not nullptr, those of the column, whose attribute has to be set. -1 if there is no such row.
+     */
+    RC readStatistics(int tableId, const std::string &columnName, RID &rid, TableStatistics &table, ColumnStatistics *column);
+    
+    /*
+     * Replace the row of columnName (empty for the table) of tableId in Statistics, see prepareStatisticsRecord(...).
+     */
+    RC writeStatistics(int tableId, const std::string &columnName, const TableStatistics &table, const ColumnStatistics *column);
+    
+    /*
+     * This function generate a map which is <<columnName, IndexName>, rid>, rids come from lookupCatalogIndex(...) on Indexes(table-name).
      * <columnsName, IndexName> could be used in indexOperationWhenTupleChanged(...)
      */
     RC generateCoumnIndexMapGivenTable(const std::string &tableName, std::map<std::pair<std::string, std::string>, RID> &columnIndexMap);
     
+    /*
+     * The file of the index on attributeName recorded in Indexes, its name tells a hash index from a B+ tree. -1 if there is none.
+     */
+    RC getIndexFileName(const std::string &tableName, const std::string &attributeName, std::string &indexFileName);
+    
+    /*
+     * The tree of an index-organized table from its indexes in Indexes (the file named with CLUSTERED_TREE_SUFFIX),
+     * attrs is the current descriptor of the table. -1 for a heap table.
+     * The tree is not an index of the table for getIndexFileName(...), destroyIndex(...) or indexOperationWhenTupleChanged(...).
+     */
+    bool isClusteredTree(const std::string &indexFileName) const;
+    RC getClusteredTree(const std::string &tableName, const std::vector<Attribute> &attrs, ClusteredTree &tree);
+    RC getClusteredTree(const std::map<std::pair<std::string, std::string>, RID> &columnIndexMap, const std::vector<Attribute> &attrs,
+                        ClusteredTree &tree);
+    RC openClusteredTree(const ClusteredTree &tree, IXFileHandle &ixFileHandle);
+    
+    /*
+     * Key of the row of rid in the tree, value is the cluster key of the row in the format of a locator record
+     * (its null indicator, then the value). decodeRowKey(...) gives the rid of a key back.
+     */
+    RC encodeRowKey(const ClusteredTree &tree, const void *value, const RID &rid, void *key) const;
+    RC decodeRowKey(const ClusteredTree &tree, const void *key, RID &rid) const;
+    
+    /*
+     * Rows of an index-organized table. insertClusteredRow(...) formats tuple with the current version into the tree under
+     * value and rid. deleteClusteredRow(...) deletes the row of rid, value gets its cluster key from the heap file.
+     * readClusteredTuple(...) reads the tuple of rid like readVersionedRecord(...), from the open heap file and tree.
+     * forEachRow(...) visits every tuple in key order.
+     */
+    RC insertClusteredRow(const ClusteredTree &tree, const std::vector<std::vector<Attribute>> &versionDescriptors, const void *tuple,
+                          const void *value, const RID &rid);
+    RC deleteClusteredRow(const std::string &tableName, const ClusteredTree &tree, const RID &rid, void *value);
+    RC readClusteredTuple(FileHandle &fileHandle, IXFileHandle &ixFileHandle, const ClusteredTree &tree,
+                          const std::vector<std::vector<Attribute>> &versionDescriptors, const RID &rid, void *tuple);
+    RC forEachRow(const ClusteredTree &tree, const std::vector<std::vector<Attribute>> &versionDescriptors,
+                  const std::function<void(const RID &rid, const void *tuple)> &visit);
+    
     /*
      * This function is used for Indexes catalog file operation.
-     * call _rbfm->readAttribute(...) to get the target attribute value given columnName from map.
+     * call readVersionedAttribute(...) to get the target attribute value given columnName from map. NULL values are not indexed.
      * Change all the index files associate to this table.
      * if operationFlag == 0: insertion.
      * if operationFlag == 1: deletion.
      */
-    RC indexOperationWhenTupleChanged(const std::string &tableName, const RID rid, const std::map<std::pair<std::string, std::string>, RID> columnIndexMap, const std::vector<Attribute> attrs, int operationFlag);
+    RC indexOperationWhenTupleChanged(const std::string &tableName, const RID rid, const std::map<std::pair<std::string, std::string>, RID> columnIndexMap, const std::vector<std::vector<Attribute>> &versionDescriptors, int operationFlag);
+    
+    /*
+     * Bodies of insertTuple(...), deleteTuple(...) and updateTuple(...), they run inside the transaction the public functions begin.
+     */
+    RC insertTupleInTransaction(const std::string &tableName, const void *data, RID &rid);
+    RC deleteTupleInTransaction(const std::string &tableName, const RID &rid);
+    RC updateTupleInTransaction(const std::string &tableName, const void *data, const RID &rid);
+    
+    /*
+     * Roll back the transaction of this thread: undo the page changes of the operation which did not finish,
+     * then undoOperation(...) every finished operation, newest first, and log the abort.
+     */
+    RC rollbackTransaction();
+    RC undoOperation(const LogOperation &operation);
+    
+    /*
+     * Redo the log, roll back the transactions which neither committed nor aborted, then checkpoint.
+     */
+    RC recover();
+    
+    /*
+     * destroyIndex(...) without taking the DDL mutex and the table latch, used by DDL which already holds them.
+     */
+    RC removeIndex(const std::string &tableName, const std::string &attributeName);
+    
+    /*
+     * Fill the empty index file of attributeName: collect the <key, rid> pairs of the heap file tableFileName with scanIndexEntries(...)
+     * and _im->bulkBuild(...) them, or _hm->bulkBuild(...) for a hash index. Used by createIndex(...) on the table file and by
+     * clusterTable(...) on the file which replaces it.
+     */
+    RC buildIndex(const std::string &tableName, const std::string &tableFileName, const std::string &attributeName,
+                  const std::string &indexFileName, float fillFactor);
+    
+    /*
+     * Refresh the statistics of the table and of the column of a single attribute index from the entries buildIndex(...)
+     * collected, the tuples without a key are its NULLs.
+     */
+    RC updateIndexStatistics(const std::string &tableName, const Attribute &attribute, const std::vector<IndexEntry> &entries,
+                             unsigned numOfTuples, unsigned numOfPages);
+    
+    /*
+     * Build the Bloom filter of the index file of attributeName with _im->createBloomFilter(...).
+     * Used by createBloomFilter(...) and clusterTable(...).
+     */
+    RC buildBloomFilter(const std::string &tableName, const std::string &attributeName, const std::string &indexFileName,
+                        float falsePositiveRate);
+    
+    /*
+     * readTuples(...) on the open table file, the caller holds the latch of the table. Also used by clusterTable(...).
+     */
+    RC readTuplesFromFile(FileHandle &fileHandle, const std::vector<std::vector<Attribute>> &versionDescriptors,
+                          const std::vector<RID> &rids, std::vector<std::string> &tuples);
+    
+    /*
+     * The reader-writer latch of this table, created on first use.
+     */
+    RWLatch &getTableLatch(const std::string &tableName);
     
 private:
     static RelationManager *_relation_manager;
     RecordBasedFileManager *_rbfm;
     IndexManager *_im;
+    HashIndexManager *_hm;
     
     std::vector<Attribute> _tablesDescriptor;
     std::vector<Attribute> _columnsDescriptor;
     std::vector<Attribute> _indexesDescriptor;
+    std::vector<Attribute> _statisticsDescriptor;
+    
+    std::mutex _ddlMutex;
+    std::mutex _tableLatchesMutex;
+    std::map<std::string, std::unique_ptr<RWLatch>> _tableLatches;
 };
 
 #endif
\ No newline at end of file
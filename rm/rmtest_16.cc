@@ -0,0 +1,166 @@
+#include <thread>
+#include <atomic>
+#include "rm_test_util.h"
+
+RC TEST_RM_16(const std::string &tableName) {
+    // Functions Tested
+    // 1. Concurrent insertTuple ** from several threads
+    // 2. Concurrent deleteTuple ** while other threads keep inserting
+    // 3. Concurrent scan and indexScan ** while the table is changed
+    std::cout << std::endl << "***** In RM Test Case 16 *****" << std::endl;
+
+    const int numOfThreads = 4;
+    const int numOfTuplesPerThread = 500;
+
+    rm.deleteTable(tableName);
+    RC rc = createTable(tableName);
+    assert(rc == success && "Creating a table should not fail.");
+    rc = rm.createIndex(tableName, "Age");
+    assert(rc == success && "RelationManager::createIndex() should not fail.");
+
+    std::vector<Attribute> attrs;
+    rc = rm.getAttributes(tableName, attrs);
+    assert(rc == success && "RelationManager::getAttributes() should not fail.");
+
+    // 1. every thread inserts its own range of ages, two scanners go through the table at the same time.
+    // Round 0 inserts [t * N, (t + 1) * N), round 1 inserts the same range shifted by numOfThreads * N.
+    std::vector<std::vector<RID>> rids(numOfThreads);
+    std::atomic<bool> stop(false);
+    std::atomic<int> errors(0);
+
+    auto insertRange = [&](int thread, int round) {
+        void *tuple = malloc(200);
+        unsigned tupleSize = 0;
+        unsigned char nullsIndicator[1] = {0};
+        for (int i = 0; i < numOfTuplesPerThread; i++) {
+            int age = (round * numOfThreads + thread) * numOfTuplesPerThread + i;
+            prepareTuple(attrs.size(), nullsIndicator, 6, "Worker", age, 170.1, age, tuple, &tupleSize);
+            RID rid;
+            if (rm.insertTuple(tableName, tuple, rid) != success) {
+                errors++;
+            }
+            if (round == 0) {
+                rids[thread].push_back(rid);
+            }
+        }
+        free(tuple);
+    };
+
+    auto scanLoop = [&]() {
+        void *returnedData = malloc(200);
+        std::vector<std::string> projected{"Age"};
+        while (!stop) {
+            RM_ScanIterator rmsi;
+            RID rid;
+            if (rm.scan(tableName, "", NO_OP, NULL, projected, rmsi) != success) {
+                errors++;
+                break;
+            }
+            // the scans are not isolated from the writers, only check every tuple they return is a complete one.
+            while (rmsi.getNextTuple(rid, returnedData) != RM_EOF) {
+                int age;
+                memcpy(&age, (char *) returnedData + 1, sizeof(int));
+                if (age < 0 || age >= 2 * numOfThreads * numOfTuplesPerThread) {
+                    errors++;
+                }
+            }
+            rmsi.close();
+
+            RM_IndexScanIterator rmisi;
+            if (rm.indexScan(tableName, "Age", NULL, NULL, true, true, rmisi) != success) {
+                errors++;
+                break;
+            }
+            int key;
+            while (rmisi.getNextEntry(rid, &key) != RM_EOF) {
+                if (key < 0 || key >= 2 * numOfThreads * numOfTuplesPerThread) {
+                    errors++;
+                }
+            }
+            rmisi.close();
+        }
+        free(returnedData);
+    };
+
+    std::vector<std::thread> threads;
+    std::thread scanner1(scanLoop), scanner2(scanLoop);
+    for (int t = 0; t < numOfThreads; t++) {
+        threads.emplace_back(insertRange, t, 0);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+
+    // 2. half of the threads delete the tuples inserted in round 0 with an even age, the others insert round 1.
+    for (int t = 0; t < numOfThreads; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < numOfTuplesPerThread; i += 2) {
+                if (rm.deleteTuple(tableName, rids[t][i]) != success) {
+                    errors++;
+                }
+            }
+        });
+        threads.emplace_back(insertRange, t, 1);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    stop = true;
+    scanner1.join();
+    scanner2.join();
+    assert(errors == 0 && "Concurrent operations should not fail.");
+
+    // 3. check the result: odd ages of round 0 and all the ages of round 1 are left, in the heap file and in the index.
+    int expected = numOfThreads * numOfTuplesPerThread / 2 + numOfThreads * numOfTuplesPerThread;
+    std::set<int> ages;
+    void *returnedData = malloc(200);
+    RM_ScanIterator rmsi;
+    RID rid;
+    std::vector<std::string> projected{"Age"};
+    rc = rm.scan(tableName, "", NO_OP, NULL, projected, rmsi);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+    while (rmsi.getNextTuple(rid, returnedData) != RM_EOF) {
+        int age;
+        memcpy(&age, (char *) returnedData + 1, sizeof(int));
+        ages.insert(age);
+    }
+    rmsi.close();
+
+    int indexCount = 0;
+    RM_IndexScanIterator rmisi;
+    rc = rm.indexScan(tableName, "Age", NULL, NULL, true, true, rmisi);
+    assert(rc == success && "RelationManager::indexScan() should not fail.");
+    int key;
+    while (rmisi.getNextEntry(rid, &key) != RM_EOF) {
+        if (ages.count(key) == 0) {
+            errors++;
+        }
+        indexCount++;
+    }
+    rmisi.close();
+    free(returnedData);
+
+    std::cout << "tuples left: " << ages.size() << ", index entries left: " << indexCount << ", expected: " << expected << std::endl;
+    bool even = false;
+    for (int age : ages) {
+        if (age < numOfThreads * numOfTuplesPerThread && age % 2 == 0) {
+            even = true;
+        }
+    }
+
+    rc = rm.deleteTable(tableName);
+    assert(rc == success && "RelationManager::deleteTable() should not fail.");
+
+    if ((int) ages.size() != expected || indexCount != expected || even || errors != 0) {
+        std::cout << "***** [FAIL] Test Case 16 Failed *****" << std::endl;
+        return -1;
+    }
+    std::cout << "***** Test Case 16 Finished. The result will be examined. *****" << std::endl;
+    return success;
+}
+
+int main() {
+    // Concurrent clients on one table
+    return TEST_RM_16("tbl_concurrent");
+}
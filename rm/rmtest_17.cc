@@ -0,0 +1,177 @@
+#include <thread>
+#include <atomic>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "rm_test_util.h"
+
+const int numOfThreads = 4;
+const int numOfTuplesPerThread = 100;
+const int partialAge = 9999;
+
+// the files as they are before any transaction
+std::string readWholeFile(const std::string &fileName) {
+    std::ifstream file(fileName, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+void writeWholeFile(const std::string &fileName, const std::string &content) {
+    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+    file.write(content.c_str(), content.size());
+}
+
+// Runs in a child process which is killed in the middle of a transaction.
+void runTransactions(const std::string &tableName) {
+    std::vector<Attribute> attrs;
+    rm.getAttributes(tableName, attrs);
+    void *tuple = malloc(200);
+    unsigned tupleSize = 0;
+    unsigned char nullsIndicator[1] = {0};
+
+    // committed: inserts from several threads (they share fsyncs), then deletes and updates
+    std::vector<RID> rids(numOfThreads * numOfTuplesPerThread);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numOfThreads; t++) {
+        threads.emplace_back([&, t]() {
+            void *threadTuple = malloc(200);
+            unsigned threadTupleSize = 0;
+            for (int i = 0; i < numOfTuplesPerThread; i++) {
+                int age = t * numOfTuplesPerThread + i;
+                prepareTuple(attrs.size(), nullsIndicator, 6, "Worker", age, 170.1, age, threadTuple, &threadTupleSize);
+                if (rm.insertTuple(tableName, threadTuple, rids[age]) != success) {
+                    _exit(1);
+                }
+            }
+            free(threadTuple);
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (int age = 0; age < 50; age++) {
+        if (rm.deleteTuple(tableName, rids[age]) != success) {
+            _exit(1);
+        }
+    }
+    for (int age = 50; age < 60; age++) {
+        prepareTuple(attrs.size(), nullsIndicator, 6, "Worker", age + 1000, 170.1, age, tuple, &tupleSize);
+        if (rm.updateTuple(tableName, tuple, rids[age]) != success) {
+            _exit(1);
+        }
+    }
+    unsigned commitCount, syncCount;
+    LogManager::instance().collectCounterValues(commitCount, syncCount);
+    std::cout << "commits: " << commitCount << ", log fsyncs: " << syncCount << std::endl;
+
+    // not committed: a heap record and its index entry, then the process dies
+    FileHandle fileHandle;
+    IXFileHandle ixFileHandle;
+    RID rid;
+    int key = partialAge;
+    prepareTuple(attrs.size(), nullsIndicator, 6, "Worker", partialAge, 170.1, partialAge, tuple, &tupleSize);
+    LogManager::instance().beginTransaction();
+    RecordBasedFileManager::instance().openFile(tableName, fileHandle);
+    RecordBasedFileManager::instance().insertRecord(fileHandle, attrs, tuple, rid);
+    IndexManager::instance().openFile(tableName + "_Age", ixFileHandle);
+    IndexManager::instance().insertEntry(ixFileHandle, attrs[1], &key, rid);
+    free(tuple);
+    // an insert or a delete forces the log before each of its two pages and at its commit, an update once more:
+    // without sharing there would be at least 3 fsyncs per commit.
+    _exit(commitCount == numOfThreads * numOfTuplesPerThread + 60 && syncCount < 3 * commitCount ? 0 : 1);
+}
+
+RC TEST_RM_17_CRASH(const std::string &tableName, const char *program) {
+    // Functions Tested
+    // 1. insertTuple, deleteTuple and updateTuple commit through the write-ahead log **
+    // 2. a crash in the middle of a transaction
+    std::cout << std::endl << "***** In RM Test Case 17 *****" << std::endl;
+
+    rm.deleteTable(tableName);
+    RC rc = createTable(tableName);
+    assert(rc == success && "Creating a table should not fail.");
+    rc = rm.createIndex(tableName, "Age");
+    assert(rc == success && "RelationManager::createIndex() should not fail.");
+
+    // the data files lose every change made by the transactions, only the log keeps them.
+    std::string tableFile = readWholeFile(tableName);
+    std::string indexFile = readWholeFile(tableName + "_Age");
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        runTransactions(tableName);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0 && "The transactions should not fail.");
+
+    writeWholeFile(tableName, tableFile);
+    writeWholeFile(tableName + "_Age", indexFile);
+
+    // a new process recovers when it constructs RelationManager
+    execl(program, program, "recover", (char *) NULL);
+    std::cout << "***** [FAIL] Test Case 17 Failed *****" << std::endl;
+    return -1;
+}
+
+RC TEST_RM_17_RECOVER(const std::string &tableName) {
+    // 3. recovery redoes the committed transactions and rolls back the one which did not commit **
+    std::cout << "***** Recovered, in RM Test Case 17 *****" << std::endl;
+
+    std::set<int> expected;
+    for (int age = 60; age < numOfThreads * numOfTuplesPerThread; age++) {
+        expected.insert(age);
+    }
+    for (int age = 50; age < 60; age++) {
+        expected.insert(age + 1000);
+    }
+
+    std::set<int> ages;
+    void *returnedData = malloc(200);
+    RM_ScanIterator rmsi;
+    RID rid;
+    std::vector<std::string> projected{"Age"};
+    RC rc = rm.scan(tableName, "", NO_OP, NULL, projected, rmsi);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+    int count = 0;
+    while (rmsi.getNextTuple(rid, returnedData) != RM_EOF) {
+        int age;
+        memcpy(&age, (char *) returnedData + 1, sizeof(int));
+        ages.insert(age);
+        count++;
+    }
+    rmsi.close();
+    free(returnedData);
+
+    std::set<int> keys;
+    int indexCount = 0;
+    RM_IndexScanIterator rmisi;
+    rc = rm.indexScan(tableName, "Age", NULL, NULL, true, true, rmisi);
+    assert(rc == success && "RelationManager::indexScan() should not fail.");
+    int key;
+    while (rmisi.getNextEntry(rid, &key) != RM_EOF) {
+        keys.insert(key);
+        indexCount++;
+    }
+    rmisi.close();
+
+    std::cout << "tuples: " << count << ", index entries: " << indexCount << ", expected: " << expected.size() << std::endl;
+
+    rc = rm.deleteTable(tableName);
+    assert(rc == success && "RelationManager::deleteTable() should not fail.");
+
+    if (ages != expected || keys != expected || count != (int) expected.size() || indexCount != (int) expected.size()) {
+        std::cout << "***** [FAIL] Test Case 17 Failed *****" << std::endl;
+        return -1;
+    }
+    std::cout << "***** Test Case 17 Finished. The result will be examined. *****" << std::endl;
+    return success;
+}
+
+int main(int argc, char *argv[]) {
+    // Crash and recovery of the write-ahead log
+    if (argc > 1 && std::string(argv[1]) == "recover") {
+        return TEST_RM_17_RECOVER("tbl_wal");
+    }
+    return TEST_RM_17_CRASH("tbl_wal", "/proc/self/exe");
+}
@@ -0,0 +1,115 @@
+#include "rm_test_util.h"
+
+const int numOfTuples = 2000;
+
+// Age is a permutation of the insert order, one tuple in a hundred has no Age
+int ageOf(int i) {
+    return (i * 7919) % numOfTuples;
+}
+
+RC TEST_RM_18(const std::string &tableName) {
+    // Functions Tested
+    // 1. Insert tuples in random order of Age, create indexes
+    // 2. clusterTable ** on Age
+    // 3. Scan: the tuples come in Age order, NULLs last
+    // 4. indexScan on Age reads the RIDs in order, the index on Salary is built again
+    std::cout << std::endl << "***** In RM Test Case 18 *****" << std::endl;
+
+    rm.deleteTable(tableName);
+    RC rc = createTable(tableName);
+    assert(rc == success && "Creating a table should not fail.");
+
+    std::vector<Attribute> attrs;
+    rc = rm.getAttributes(tableName, attrs);
+    assert(rc == success && "RelationManager::getAttributes() should not fail.");
+    void *tuple = malloc(200);
+    unsigned tupleSize = 0;
+    RID rid;
+    for (int i = 0; i < numOfTuples; i++) {
+        unsigned char nullsIndicator[1] = {(unsigned char) (i % 100 == 99 ? 1 << 6 : 0)};
+        prepareTuple(attrs.size(), nullsIndicator, 6, "Worker", ageOf(i), 170.1, i, tuple, &tupleSize);
+        rc = rm.insertTuple(tableName, tuple, rid);
+        assert(rc == success && "RelationManager::insertTuple() should not fail.");
+    }
+    rc = rm.createIndex(tableName, "Age");
+    assert(rc == success && "RelationManager::createIndex() should not fail.");
+    rc = rm.createIndex(tableName, "Salary");
+    assert(rc == success && "RelationManager::createIndex() should not fail.");
+
+    rc = rm.clusterTable(tableName, "Age");
+    assert(rc == success && "RelationManager::clusterTable() should not fail.");
+
+    // the tuples are stored in Age order, NULLs last
+    int errors = 0;
+    std::vector<std::string> attrNames = {"Age", "Salary"};
+    RM_ScanIterator rmsi;
+    rc = rm.scan(tableName, "", NO_OP, NULL, attrNames, rmsi);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+    int count = 0, previousAge = -1;
+    bool nullSeen = false;
+    while (rmsi.getNextTuple(rid, tuple) != RM_EOF) {
+        bool ageIsNull = *(unsigned char *) tuple & (unsigned) 1 << (unsigned) 7;
+        int age = *(int *) ((char *) tuple + 1);
+        int salary = *(int *) ((char *) tuple + 1 + (ageIsNull ? 0 : sizeof(int)));
+        if ((ageIsNull && salary % 100 != 99) || (!ageIsNull && (nullSeen || age < previousAge || age != ageOf(salary)))) {
+            errors++;
+        }
+        nullSeen = nullSeen || ageIsNull;
+        previousAge = ageIsNull ? previousAge : age;
+        count++;
+    }
+    rmsi.close();
+    if (count != numOfTuples) {
+        errors++;
+    }
+
+    // a range of Age reads the table in the order of its pages
+    RM_IndexScanIterator rmisi;
+    rc = rm.indexScan(tableName, "Age", NULL, NULL, true, true, rmisi);
+    assert(rc == success && "RelationManager::indexScan() should not fail.");
+    RID previousRid = {0, 0};
+    int key;
+    count = 0;
+    while (rmisi.getNextEntry(rid, &key) == success) {
+        if (rid.pageNum < previousRid.pageNum || (rid.pageNum == previousRid.pageNum && rid.slotNum < previousRid.slotNum)) {
+            errors++;
+        }
+        previousRid = rid;
+        count++;
+    }
+    rmisi.close();
+    if (count != numOfTuples - numOfTuples / 100) {
+        errors++;
+    }
+
+    // the index on Salary has the new RIDs
+    int salary = 1234;
+    rc = rm.indexScan(tableName, "Salary", &salary, &salary, true, true, rmisi);
+    assert(rc == success && "RelationManager::indexScan() should not fail.");
+    count = 0;
+    while (rmisi.getNextEntry(rid, &key) == success) {
+        rc = rm.readAttribute(tableName, rid, "Salary", tuple);
+        if (rc != success || *(int *) ((char *) tuple + 1) != salary) {
+            errors++;
+        }
+        count++;
+    }
+    rmisi.close();
+    if (count != 1) {
+        errors++;
+    }
+
+    free(tuple);
+    rm.deleteTable(tableName);
+    if (errors != 0) {
+        std::cout << "***** [FAIL] Test Case 18 Failed *****" << std::endl << std::endl;
+        return -1;
+    }
+    std::cout << "***** Test Case 18 Finished. The result will be examined. *****" << std::endl << std::endl;
+    return success;
+}
+
+int main() {
+    // Clustered table
+    return TEST_RM_18("tbl_clustered");
+}
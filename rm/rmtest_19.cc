@@ -0,0 +1,142 @@
+#include "rm_test_util.h"
+
+const int numOfTuples = 4000;
+const int numOfDepts = 4;
+
+struct Expected {
+    bool present;
+    bool ageIsNull;
+    int age;
+};
+
+// EmpName is one of numOfDepts names, one tuple in fifty has no Age
+std::string nameOf(int i) {
+    return "Dept" + std::to_string(i % numOfDepts);
+}
+
+RC writeTuple(const std::string &tableName, const std::vector<Attribute> &attrs, int i, const Expected &expected, RID &rid, bool update) {
+    void *tuple = malloc(200);
+    unsigned tupleSize = 0;
+    unsigned char nullsIndicator[1] = {(unsigned char) (expected.ageIsNull ? 1 << 6 : 0)};
+    std::string name = nameOf(i);
+    prepareTuple(attrs.size(), nullsIndicator, name.size(), name, expected.age, 170.1, i, tuple, &tupleSize);
+    RC rc = update ? rm.updateTuple(tableName, tuple, rid) : rm.insertTuple(tableName, tuple, rid);
+    free(tuple);
+    return rc;
+}
+
+// scan the prefix name and the range [low, high) of Age, check every entry and return how many there are
+int countPrefixScan(const std::string &tableName, const std::vector<Attribute> &keyAttrs, const std::string &name, const int *low,
+                    const int *high, const std::vector<Expected> &expected, int &errors) {
+    char prefix[PAGE_SIZE], key[PAGE_SIZE], data[PAGE_SIZE];
+    prefix[0] = 0;
+    int length = name.size();
+    memcpy(prefix + 1, &length, sizeof(int));
+    memcpy(prefix + 1 + sizeof(int), name.data(), length);
+
+    RM_IndexScanIterator rmisi;
+    RC rc = rm.indexPrefixScan(tableName, {"EmpName", "Age"}, prefix, 1, low, high, true, false, rmisi);
+    assert(rc == success && "RelationManager::indexPrefixScan() should not fail.");
+    RID rid;
+    int count = 0;
+    while (rmisi.getNextEntry(rid, key) == success) {
+        // the key decodes to <EmpName, Age>, the tuple behind the RID has them
+        IndexManager::instance().decodeCompositeKey(keyAttrs, key, data);
+        bool ageIsNull = data[0] & (unsigned) 1 << (unsigned) 6;
+        int age = *(int *) (data + 1 + sizeof(int) + length);
+        // Salary is the last field of the tuple
+        rc = rm.readTuple(tableName, rid, key);
+        int i = *(int *) (key + 1 + sizeof(int) + length + (ageIsNull ? 0 : sizeof(int)) + sizeof(float));
+        if (rc != success || std::string(data + 1 + sizeof(int), length) != name || i < 0 || i >= numOfTuples || nameOf(i) != name ||
+            !expected[i].present || ageIsNull != expected[i].ageIsNull || (!ageIsNull && age != expected[i].age)) {
+            errors++;
+        }
+        count++;
+    }
+    rmisi.close();
+    return count;
+}
+
+RC TEST_RM_19(const std::string &tableName) {
+    // Functions Tested
+    // 1. Insert tuples, create a composite index ** on <EmpName, Age>
+    // 2. Insert, delete and update tuples, the index follows them
+    // 3. indexPrefixScan ** on EmpName, and on EmpName and a range of Age
+    // 4. destroyIndex ** by the joined name, dropAttribute drops the composite index
+    std::cout << std::endl << "***** In RM Test Case 19 *****" << std::endl;
+
+    rm.deleteTable(tableName);
+    RC rc = createTable(tableName);
+    assert(rc == success && "Creating a table should not fail.");
+
+    std::vector<Attribute> attrs;
+    rc = rm.getAttributes(tableName, attrs);
+    assert(rc == success && "RelationManager::getAttributes() should not fail.");
+    std::vector<Attribute> keyAttrs = {attrs[0], attrs[1]};
+    std::vector<Expected> expected(numOfTuples);
+    std::vector<RID> rids(numOfTuples);
+    for (int i = 0; i < numOfTuples; i++) {
+        if (i == numOfTuples / 2) {
+            rc = rm.createCompositeIndex(tableName, {"EmpName", "Age"});
+            assert(rc == success && "RelationManager::createCompositeIndex() should not fail.");
+        }
+        expected[i] = {true, i % 50 == 49, (i * 37) % 100};
+        rc = writeTuple(tableName, attrs, i, expected[i], rids[i], false);
+        assert(rc == success && "RelationManager::insertTuple() should not fail.");
+    }
+    for (int i = 0; i < numOfTuples; i++) {
+        if (i % 10 == 3) {
+            rc = rm.deleteTuple(tableName, rids[i]);
+            assert(rc == success && "RelationManager::deleteTuple() should not fail.");
+            expected[i].present = false;
+        }
+        else if (i % 10 == 7) {
+            expected[i].age = (expected[i].age + 1) % 100;
+            expected[i].ageIsNull = !expected[i].ageIsNull && i % 20 == 7;
+            rc = writeTuple(tableName, attrs, i, expected[i], rids[i], true);
+            assert(rc == success && "RelationManager::updateTuple() should not fail.");
+        }
+    }
+
+    // a whole department, NULL Ages first, then Dept2 with 20 <= Age < 40
+    int errors = 0;
+    int low = 20, high = 40;
+    int count = countPrefixScan(tableName, keyAttrs, "Dept1", NULL, NULL, expected, errors);
+    int rangeCount = countPrefixScan(tableName, keyAttrs, "Dept2", &low, &high, expected, errors);
+    int expectedCount = 0, expectedRangeCount = 0;
+    for (int i = 0; i < numOfTuples; i++) {
+        expectedCount += expected[i].present && nameOf(i) == "Dept1";
+        expectedRangeCount += expected[i].present && nameOf(i) == "Dept2" && !expected[i].ageIsNull && expected[i].age >= low &&
+                              expected[i].age < high;
+    }
+    std::cout << "Dept1: " << count << " tuples, Dept2 with 20 <= Age < 40: " << rangeCount << " tuples" << std::endl;
+    if (count != expectedCount || rangeCount != expectedRangeCount) {
+        errors++;
+    }
+
+    // the index is named after both attributes, dropping one of them drops it
+    rc = rm.destroyIndex(tableName, "EmpName" COMPOSITE_KEY_SEPARATOR "Age");
+    assert(rc == success && "RelationManager::destroyIndex() should not fail.");
+    rc = rm.createCompositeIndex(tableName, {"EmpName", "Age"});
+    assert(rc == success && "RelationManager::createCompositeIndex() should not fail.");
+    rc = rm.dropAttribute(tableName, "Age");
+    assert(rc == success && "RelationManager::dropAttribute() should not fail.");
+    RM_IndexScanIterator rmisi;
+    if (rm.indexPrefixScan(tableName, {"EmpName", "Age"}, NULL, 0, NULL, NULL, true, true, rmisi) == success) {
+        rmisi.close();
+        errors++;
+    }
+
+    rm.deleteTable(tableName);
+    if (errors != 0) {
+        std::cout << "***** [FAIL] Test Case 19 Failed *****" << std::endl << std::endl;
+        return -1;
+    }
+    std::cout << "***** Test Case 19 Finished. The result will be examined. *****" << std::endl << std::endl;
+    return success;
+}
+
+int main() {
+    // Composite index
+    return TEST_RM_19("tbl_composite");
+}
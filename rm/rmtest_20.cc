@@ -0,0 +1,147 @@
+#include "rm_test_util.h"
+
+const int numOfTuples = 5000;
+const int numOfAges = 300;
+
+// tuple i has Age i % numOfAges and Salary i, one tuple in fifty has no Age
+struct Expected {
+    bool present;
+    bool ageIsNull;
+    int age;
+};
+
+RC writeTuple(const std::string &tableName, const std::vector<Attribute> &attrs, int i, const Expected &expected, RID &rid, bool update) {
+    void *tuple = malloc(200);
+    unsigned tupleSize = 0;
+    unsigned char nullsIndicator[1] = {(unsigned char) (expected.ageIsNull ? 1 << 6 : 0)};
+    prepareTuple(attrs.size(), nullsIndicator, 6, "Worker", expected.age, 170.1, i, tuple, &tupleSize);
+    RC rc = update ? rm.updateTuple(tableName, tuple, rid) : rm.insertTuple(tableName, tuple, rid);
+    free(tuple);
+    return rc;
+}
+
+// indexScan on Age between the keys, check that every RID is a tuple with such an Age and return how many there are
+int countIndexScan(const std::string &tableName, const int *lowKey, const int *highKey, const std::vector<Expected> &expected,
+                   const std::vector<RID> &rids, int &errors) {
+    RM_IndexScanIterator rmisi;
+    RC rc = rm.indexScan(tableName, "Age", lowKey, highKey, true, true, rmisi);
+    assert(rc == success && "RelationManager::indexScan() should not fail.");
+    RID rid;
+    int key, count = 0;
+    char *tuple = (char *) malloc(200);
+    while (rmisi.getNextEntry(rid, &key) == success) {
+        // Salary is the last field of the tuple
+        rc = rm.readTuple(tableName, rid, tuple);
+        int i = *(int *) (tuple + 1 + sizeof(int) + 6 + sizeof(int) + sizeof(float));
+        if (rc != success || i < 0 || i >= numOfTuples || !expected[i].present || expected[i].ageIsNull ||
+            expected[i].age != key || rids[i].pageNum != rid.pageNum || rids[i].slotNum != rid.slotNum ||
+            (lowKey != NULL && key < *lowKey) || (highKey != NULL && key > *highKey)) {
+            errors++;
+        }
+        count++;
+    }
+    rmisi.close();
+    free(tuple);
+    return count;
+}
+
+RC TEST_RM_20(const std::string &tableName) {
+    // Functions Tested
+    // 1. Insert tuples, create a hash index ** on Age
+    // 2. Insert, delete and update tuples, the index follows them
+    // 3. indexScan ** for one Age, a range and all of them, indexProbe **
+    // 4. No second index on Age, destroyIndex ** and a B+ tree on Age again
+    std::cout << std::endl << "***** In RM Test Case 20 *****" << std::endl;
+
+    rm.deleteTable(tableName);
+    RC rc = createTable(tableName);
+    assert(rc == success && "Creating a table should not fail.");
+
+    std::vector<Attribute> attrs;
+    rc = rm.getAttributes(tableName, attrs);
+    assert(rc == success && "RelationManager::getAttributes() should not fail.");
+    std::vector<Expected> expected(numOfTuples);
+    std::vector<RID> rids(numOfTuples);
+    for (int i = 0; i < numOfTuples; i++) {
+        if (i == numOfTuples / 2) {
+            rc = rm.createIndex(tableName, "Age", hashIndex);
+            assert(rc == success && "RelationManager::createIndex() should not fail.");
+        }
+        expected[i] = {true, i % 50 == 49, i % numOfAges};
+        rc = writeTuple(tableName, attrs, i, expected[i], rids[i], false);
+        assert(rc == success && "RelationManager::insertTuple() should not fail.");
+    }
+    for (int i = 0; i < numOfTuples; i++) {
+        if (i % 10 == 3) {
+            rc = rm.deleteTuple(tableName, rids[i]);
+            assert(rc == success && "RelationManager::deleteTuple() should not fail.");
+            expected[i].present = false;
+        }
+        else if (i % 10 == 7) {
+            expected[i].age = (expected[i].age + 1) % numOfAges;
+            expected[i].ageIsNull = !expected[i].ageIsNull && i % 20 == 7;
+            rc = writeTuple(tableName, attrs, i, expected[i], rids[i], true);
+            assert(rc == success && "RelationManager::updateTuple() should not fail.");
+        }
+    }
+
+    // one Age, a range and the whole index
+    int errors = 0;
+    int age = 42, low = 10, high = 19;
+    int ageCount = countIndexScan(tableName, &age, &age, expected, rids, errors);
+    int rangeCount = countIndexScan(tableName, &low, &high, expected, rids, errors);
+    int allCount = countIndexScan(tableName, NULL, NULL, expected, rids, errors);
+    int expectedAgeCount = 0, expectedRangeCount = 0, expectedAllCount = 0;
+    for (int i = 0; i < numOfTuples; i++) {
+        bool indexed = expected[i].present && !expected[i].ageIsNull;
+        expectedAgeCount += indexed && expected[i].age == age;
+        expectedRangeCount += indexed && expected[i].age >= low && expected[i].age <= high;
+        expectedAllCount += indexed;
+    }
+    std::cout << "Age 42: " << ageCount << " tuples, 10 <= Age <= 19: " << rangeCount << " tuples, all: " << allCount
+              << " tuples" << std::endl;
+    if (ageCount != expectedAgeCount || rangeCount != expectedRangeCount || allCount != expectedAllCount) {
+        errors++;
+    }
+
+    // look up every Age at once
+    std::vector<std::string> keys;
+    std::vector<std::vector<RID>> probed;
+    for (int key = numOfAges - 1; key >= 0; key--) {
+        keys.emplace_back((char *) &key, sizeof(int));
+    }
+    rc = rm.indexProbe(tableName, "Age", keys, probed);
+    assert(rc == success && "RelationManager::indexProbe() should not fail.");
+    size_t probedCount = 0;
+    for (const std::vector<RID> &keyRids : probed) {
+        probedCount += keyRids.size();
+    }
+    if ((int) probedCount != expectedAllCount || (int) probed[numOfAges - 1 - age].size() != expectedAgeCount) {
+        errors++;
+    }
+
+    // Age has its index, a B+ tree replaces it once it is destroyed
+    if (rm.createIndex(tableName, "Age") == success) {
+        errors++;
+    }
+    rc = rm.destroyIndex(tableName, "Age");
+    assert(rc == success && "RelationManager::destroyIndex() should not fail.");
+    rc = rm.createIndex(tableName, "Age");
+    assert(rc == success && "RelationManager::createIndex() should not fail.");
+    if (countIndexScan(tableName, &age, &age, expected, rids, errors) != expectedAgeCount) {
+        errors++;
+    }
+
+    rm.deleteTable(tableName);
+    if (errors != 0) {
+        std::cout << "***** [FAIL] Test Case 20 Failed *****" << std::endl << std::endl;
+        return -1;
+    }
+    std::cout << "***** Test Case 20 Finished. The result will be examined. *****" << std::endl << std::endl;
+    return success;
+}
+
+int main() {
+    // Hash index
+    return TEST_RM_20("tbl_hash");
+}
@@ -0,0 +1,126 @@
+#include <fstream>
+#include "rm_test_util.h"
+
+const int numOfTuples = 5000;
+const int numOfAges = 1000;             // tuple i has Age 2 * (i % numOfAges), the odd Ages come later
+
+RC insertAge(const std::string &tableName, const std::vector<Attribute> &attrs, int age, int salary) {
+    void *tuple = malloc(200);
+    unsigned tupleSize = 0;
+    unsigned char nullsIndicator[1] = {0};
+    RID rid;
+    prepareTuple(attrs.size(), nullsIndicator, 6, "Worker", age, 170.1, salary, tuple, &tupleSize);
+    RC rc = rm.insertTuple(tableName, tuple, rid);
+    free(tuple);
+    return rc;
+}
+
+// indexProbe on Age for 0, 1, ..., 2 * numOfAges - 1, count[age] gets the number of RIDs of each
+void probeAges(const std::string &tableName, std::vector<int> &count) {
+    std::vector<std::string> keys;
+    for (int age = 0; age < 2 * numOfAges; age++) {
+        keys.emplace_back((char *) &age, sizeof(int));
+    }
+    std::vector<std::vector<RID>> rids;
+    RC rc = rm.indexProbe(tableName, "Age", keys, rids);
+    assert(rc == success && "RelationManager::indexProbe() should not fail.");
+    count.assign(keys.size(), 0);
+    for (size_t i = 0; i < keys.size(); i++) {
+        count[i] = rids[i].size();
+    }
+}
+
+bool fileExists(const std::string &fileName) {
+    std::ifstream f(fileName);
+    return f.good();
+}
+
+RC TEST_RM_21(const std::string &tableName) {
+    // Functions Tested
+    // 1. Insert tuples, create an index on Age and its Bloom filter **
+    // 2. indexProbe ** every Age, the ones present and the ones absent
+    // 3. Insert tuples with the absent Ages, indexProbe ** finds them
+    // 4. clusterTable **, the filter is built again
+    // 5. No filter on a hash index **, destroyIndex ** deletes the filter
+    std::cout << std::endl << "***** In RM Test Case 21 *****" << std::endl;
+
+    rm.deleteTable(tableName);
+    RC rc = createTable(tableName);
+    assert(rc == success && "Creating a table should not fail.");
+    std::vector<Attribute> attrs;
+    rc = rm.getAttributes(tableName, attrs);
+    assert(rc == success && "RelationManager::getAttributes() should not fail.");
+    for (int i = 0; i < numOfTuples; i++) {
+        rc = insertAge(tableName, attrs, 2 * (i % numOfAges), i);
+        assert(rc == success && "RelationManager::insertTuple() should not fail.");
+    }
+    rc = rm.createIndex(tableName, "Age");
+    assert(rc == success && "RelationManager::createIndex() should not fail.");
+    rc = rm.createBloomFilter(tableName, "Age");
+    assert(rc == success && "RelationManager::createBloomFilter() should not fail.");
+    const std::string bloomFileName = tableName + "_Age" + BLOOM_FILE_SUFFIX;
+
+    // the even Ages have their tuples, the odd ones none
+    int errors = 0;
+    std::vector<int> count;
+    probeAges(tableName, count);
+    for (int age = 0; age < 2 * numOfAges; age++) {
+        if (count[age] != (age % 2 == 0 ? numOfTuples / numOfAges : 0)) {
+            errors++;
+        }
+    }
+    if (!fileExists(bloomFileName)) {
+        errors++;
+    }
+
+    // an odd Age inserted is found, the filter has its key
+    for (int age = 1; age < 2 * numOfAges; age += 20) {
+        rc = insertAge(tableName, attrs, age, numOfTuples + age);
+        assert(rc == success && "RelationManager::insertTuple() should not fail.");
+    }
+    for (int round = 0; round < 2; round++) {
+        if (round == 1) {
+            // the index file is built again, and its filter with it
+            rc = rm.clusterTable(tableName, "Age");
+            assert(rc == success && "RelationManager::clusterTable() should not fail.");
+            if (!fileExists(bloomFileName)) {
+                errors++;
+            }
+        }
+        probeAges(tableName, count);
+        int found = 0;
+        for (int age = 1; age < 2 * numOfAges; age += 2) {
+            found += count[age];
+            if (count[age] != (age % 20 == 1 ? 1 : 0)) {
+                errors++;
+            }
+        }
+        std::cout << (round == 0 ? "after the inserts" : "after clusterTable") << ", tuples of odd Ages found: " << found
+                  << std::endl;
+    }
+
+    // a hash index has no filter, destroying the index deletes its filter
+    rc = rm.createIndex(tableName, "Salary", hashIndex);
+    assert(rc == success && "RelationManager::createIndex() should not fail.");
+    if (rm.createBloomFilter(tableName, "Salary") == success || rm.createBloomFilter(tableName, "Height") == success) {
+        errors++;
+    }
+    rc = rm.destroyIndex(tableName, "Age");
+    assert(rc == success && "RelationManager::destroyIndex() should not fail.");
+    if (fileExists(bloomFileName)) {
+        errors++;
+    }
+
+    rm.deleteTable(tableName);
+    if (errors != 0) {
+        std::cout << "***** [FAIL] Test Case 21 Failed *****" << std::endl << std::endl;
+        return -1;
+    }
+    std::cout << "***** Test Case 21 Finished. The result will be examined. *****" << std::endl << std::endl;
+    return success;
+}
+
+int main() {
+    // Bloom filter of an index
+    return TEST_RM_21("tbl_bloom");
+}
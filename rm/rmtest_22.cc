@@ -0,0 +1,171 @@
+#include "rm_test_util.h"
+
+const int numOfTuples = 10000;
+const int numOfAges = 100;              // tuple i has Age i % numOfAges, the tuples inserted later the next numOfAges Ages
+const int numOfNames = 500;
+
+// tuple i: every 4th Salary is NULL, half of the others are 1000
+RC insertTuples(const std::string &tableName, const std::vector<Attribute> &attrs, int start, int count, int ageOffset) {
+    void *tuple = malloc(200);
+    unsigned tupleSize = 0;
+    RID rid;
+    for (int i = start; i < start + count; i++) {
+        unsigned char nullsIndicator[1] = {(unsigned char) (i % 4 == 0 ? 1 << 4 : 0)};
+        std::string name = "Name" + std::to_string(i % numOfNames);
+        prepareTuple(attrs.size(), nullsIndicator, name.size(), name, ageOffset + i % numOfAges, 0.5f * i,
+                     i % 2 == 0 ? 1000 : i, tuple, &tupleSize);
+        RC rc = rm.insertTuple(tableName, tuple, rid);
+        if (rc != success) {
+            free(tuple);
+            return rc;
+        }
+    }
+    free(tuple);
+    return success;
+}
+
+// whether estimate is within tolerance of expected, printed as it goes
+bool near(const std::string &what, double estimate, double expected, double tolerance) {
+    std::cout << what << ": " << estimate << " (expected " << expected << ")" << std::endl;
+    return std::abs(estimate - expected) <= tolerance;
+}
+
+int countStatisticsRows() {
+    RM_ScanIterator rmsi;
+    std::vector<std::string> attributes = {"table-id"};
+    RC rc = rm.scan("Statistics", "", NO_OP, NULL, attributes, rmsi);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+    RID rid;
+    void *data = malloc(PAGE_SIZE);
+    int count = 0;
+    while (rmsi.getNextTuple(rid, data) != RM_EOF) {
+        count++;
+    }
+    rmsi.close();
+    free(data);
+    return count;
+}
+
+RC TEST_RM_22(const std::string &tableName) {
+    // Functions Tested
+    // 1. Insert tuples, no statistics before analyze **, default estimates **
+    // 2. analyze **, the statistics of the table and of each column **
+    // 3. Selectivity of equality and ranges from the histograms and distinct counts **
+    // 4. Insert tuples of new Ages, createIndex ** refreshes the statistics of Age and of the table
+    // 5. dropAttribute ** and deleteTable ** delete the statistics
+    std::cout << std::endl << "***** In RM Test Case 22 *****" << std::endl;
+
+    rm.deleteTable(tableName);
+    int otherRows = countStatisticsRows();
+    RC rc = createTable(tableName);
+    assert(rc == success && "Creating a table should not fail.");
+    std::vector<Attribute> attrs;
+    rc = rm.getAttributes(tableName, attrs);
+    assert(rc == success && "RelationManager::getAttributes() should not fail.");
+    rc = insertTuples(tableName, attrs, 0, numOfTuples, 0);
+    assert(rc == success && "RelationManager::insertTuple() should not fail.");
+
+    int errors = 0;
+    int age = 10;
+    double selectivity;
+    TableStatistics table;
+    ColumnStatistics column;
+    rc = rm.estimateSelectivity(tableName, "Age", EQ_OP, &age, selectivity);
+    if (rm.getTableStatistics(tableName, table) == success || rm.getColumnStatistics(tableName, "Age", column) == success ||
+        rc != success || selectivity != STATS_DEFAULT_EQ_SELECTIVITY) {
+        errors++;
+    }
+
+    // the table and its columns
+    rc = rm.analyze(tableName);
+    assert(rc == success && "RelationManager::analyze() should not fail.");
+    rc = rm.getTableStatistics(tableName, table);
+    assert(rc == success && "RelationManager::getTableStatistics() should not fail.");
+    std::cout << "tuples: " << table.numOfTuples << ", pages: " << table.numOfPages << std::endl;
+    if (table.numOfTuples != numOfTuples || table.numOfPages == 0) {
+        errors++;
+    }
+    rc = rm.getColumnStatistics(tableName, "Age", column);
+    assert(rc == success && "RelationManager::getColumnStatistics() should not fail.");
+    int minAge, maxAge;
+    memcpy(&minAge, column.histogram.front().data(), sizeof(int));
+    memcpy(&maxAge, column.histogram.back().data(), sizeof(int));
+    if (!near("distinct Ages", column.distinctCount, numOfAges, 0.1 * numOfAges) || column.nullCount != 0 ||
+        column.numOfTuples != numOfTuples || minAge != 0 || maxAge != numOfAges - 1 ||
+        column.histogram.size() != STATS_HISTOGRAM_BUCKETS + 1) {
+        errors++;
+    }
+    rc = rm.getColumnStatistics(tableName, "EmpName", column);
+    assert(rc == success && "RelationManager::getColumnStatistics() should not fail.");
+    if (!near("distinct EmpNames", column.distinctCount, numOfNames, 0.1 * numOfNames)) {
+        errors++;
+    }
+    rc = rm.getColumnStatistics(tableName, "Salary", column);
+    assert(rc == success && "RelationManager::getColumnStatistics() should not fail.");
+    if (column.nullCount != numOfTuples / 4 ||
+        !near("distinct Salaries", column.distinctCount, numOfTuples / 2 + 1, 0.1 * numOfTuples / 2)) {
+        errors++;
+    }
+
+    // estimates: Age = 10 and Age < 25, Height >= half of the max, the frequent Salary and a name after the max
+    float height = 0.25f * numOfTuples;
+    int salary = 1000;
+    std::string absentName = "ZZZ";
+    int nameLength = absentName.size();
+    char nameKey[8];
+    memcpy(nameKey, &nameLength, sizeof(int));
+    memcpy(nameKey + sizeof(int), absentName.c_str(), nameLength);
+    rm.estimateSelectivity(tableName, "Age", EQ_OP, &age, selectivity);
+    errors += !near("Age = 10", selectivity, 1.0 / numOfAges, 0.002);
+    age = 25;
+    rm.estimateSelectivity(tableName, "Age", LT_OP, &age, selectivity);
+    errors += !near("Age < 25", selectivity, 0.25, 0.04);
+    rm.estimateSelectivity(tableName, "Height", GE_OP, &height, selectivity);
+    errors += !near("Height >= 2500", selectivity, 0.5, 0.04);
+    rm.estimateSelectivity(tableName, "Salary", EQ_OP, &salary, selectivity);
+    errors += !near("Salary = 1000", selectivity, 0.25, 0.06);
+    rm.estimateSelectivity(tableName, "Salary", NO_OP, &salary, selectivity);
+    errors += selectivity != 1;
+    rm.estimateSelectivity(tableName, "EmpName", EQ_OP, nameKey, selectivity);
+    errors += !near("EmpName = ZZZ", selectivity, 0, 0);
+
+    // new Ages, the index brings the statistics of Age and of the table up to date
+    rc = insertTuples(tableName, attrs, numOfTuples, numOfTuples, numOfAges);
+    assert(rc == success && "RelationManager::insertTuple() should not fail.");
+    rc = rm.createIndex(tableName, "Age");
+    assert(rc == success && "RelationManager::createIndex() should not fail.");
+    rc = rm.getTableStatistics(tableName, table);
+    assert(rc == success && "RelationManager::getTableStatistics() should not fail.");
+    rc = rm.getColumnStatistics(tableName, "Age", column);
+    assert(rc == success && "RelationManager::getColumnStatistics() should not fail.");
+    memcpy(&maxAge, column.histogram.back().data(), sizeof(int));
+    if (table.numOfTuples != 2 * numOfTuples || column.numOfTuples != 2 * numOfTuples || maxAge != 2 * numOfAges - 1 ||
+        !near("distinct Ages after createIndex", column.distinctCount, 2 * numOfAges, 0.1 * 2 * numOfAges)) {
+        errors++;
+    }
+
+    // the statistics of a dropped column and of a deleted table go away
+    int rows = countStatisticsRows();
+    rc = rm.dropAttribute(tableName, "Height");
+    assert(rc == success && "RelationManager::dropAttribute() should not fail.");
+    if (rm.getColumnStatistics(tableName, "Height", column) == success || countStatisticsRows() != rows - 1) {
+        errors++;
+    }
+    rc = rm.deleteTable(tableName);
+    assert(rc == success && "RelationManager::deleteTable() should not fail.");
+    if (countStatisticsRows() != otherRows) {
+        errors++;
+    }
+
+    if (errors != 0) {
+        std::cout << "***** [FAIL] Test Case 22 Failed *****" << std::endl << std::endl;
+        return -1;
+    }
+    std::cout << "***** Test Case 22 Finished. The result will be examined. *****" << std::endl << std::endl;
+    return success;
+}
+
+int main() {
+    // Statistics of a table and their estimates
+    return TEST_RM_22("tbl_statistics");
+}
@@ -0,0 +1,133 @@
+#include <thread>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "rm_test_util.h"
+
+const int numOfTuples = 200;
+const int partialAge = 9999;
+
+off_t logSize() {
+    struct stat info{};
+    return stat(LOG_FILE_NAME, &info) == 0 ? info.st_size : -1;
+}
+
+// Runs in a child process: a checkpoint while a transaction runs, then the process dies.
+void runCheckpoint(const std::string &tableName) {
+    std::vector<Attribute> attrs;
+    rm.getAttributes(tableName, attrs);
+    void *tuple = malloc(200);
+    unsigned tupleSize = 0;
+    unsigned char nullsIndicator[1] = {0};
+    RID rid;
+    for (int age = 0; age < numOfTuples; age++) {
+        prepareTuple(attrs.size(), nullsIndicator, 6, "Worker", age, 170.1, age, tuple, &tupleSize);
+        if (rm.insertTuple(tableName, tuple, rid) != success) {
+            _exit(1);
+        }
+    }
+
+    // not committed: a heap record and its index entry
+    FileHandle fileHandle;
+    IXFileHandle ixFileHandle;
+    int key = partialAge;
+    prepareTuple(attrs.size(), nullsIndicator, 6, "Worker", partialAge, 170.1, partialAge, tuple, &tupleSize);
+    LogManager::instance().beginTransaction();
+    RecordBasedFileManager::instance().openFile(tableName, fileHandle);
+    RecordBasedFileManager::instance().insertRecord(fileHandle, attrs, tuple, rid);
+    IndexManager::instance().openFile(tableName + "_Age", ixFileHandle);
+    IndexManager::instance().insertEntry(ixFileHandle, attrs[1], &key, rid);
+    free(tuple);
+
+    // another thread checkpoints while the transaction is still running
+    off_t before = logSize();
+    RC rc = -1;
+    std::thread checkpointer([&rc]() { rc = LogManager::instance().checkpoint(); });
+    checkpointer.join();
+    off_t after = logSize();
+    std::cout << "log size before the checkpoint: " << before << ", after: " << after << std::endl;
+
+    // the committed inserts are cut off, the records of the running transaction stay
+    _exit(rc == success && after > (off_t) LOG_HEADER_SIZE && after < before / 4 ? 0 : 1);
+}
+
+RC TEST_RM_23_CHECKPOINT(const std::string &tableName, const char *program) {
+    // Functions Tested
+    // 1. a checkpoint does not wait for the running transactions **
+    // 2. it keeps the log from the first record of the oldest running one **
+    std::cout << std::endl << "***** In RM Test Case 23 *****" << std::endl;
+
+    rm.deleteTable(tableName);
+    RC rc = createTable(tableName);
+    assert(rc == success && "Creating a table should not fail.");
+    rc = rm.createIndex(tableName, "Age");
+    assert(rc == success && "RelationManager::createIndex() should not fail.");
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        runCheckpoint(tableName);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0 && "The checkpoint should not fail.");
+
+    // a new process recovers when it constructs RelationManager
+    execl(program, program, "recover", (char *) NULL);
+    std::cout << "***** [FAIL] Test Case 23 Failed *****" << std::endl;
+    return -1;
+}
+
+RC TEST_RM_23_RECOVER(const std::string &tableName) {
+    // 3. recovery rolls back the transaction from the log which is left **
+    std::cout << "***** Recovered, in RM Test Case 23 *****" << std::endl;
+
+    std::set<int> ages;
+    void *returnedData = malloc(200);
+    RM_ScanIterator rmsi;
+    RID rid;
+    std::vector<std::string> projected{"Age"};
+    RC rc = rm.scan(tableName, "", NO_OP, NULL, projected, rmsi);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+    int count = 0;
+    while (rmsi.getNextTuple(rid, returnedData) != RM_EOF) {
+        int age;
+        memcpy(&age, (char *) returnedData + 1, sizeof(int));
+        ages.insert(age);
+        count++;
+    }
+    rmsi.close();
+    free(returnedData);
+
+    int indexCount = 0;
+    bool partialKey = false;
+    RM_IndexScanIterator rmisi;
+    rc = rm.indexScan(tableName, "Age", NULL, NULL, true, true, rmisi);
+    assert(rc == success && "RelationManager::indexScan() should not fail.");
+    int key;
+    while (rmisi.getNextEntry(rid, &key) != RM_EOF) {
+        partialKey = partialKey || key == partialAge;
+        indexCount++;
+    }
+    rmisi.close();
+
+    std::cout << "tuples: " << count << ", index entries: " << indexCount << ", expected: " << numOfTuples << std::endl;
+
+    rc = rm.deleteTable(tableName);
+    assert(rc == success && "RelationManager::deleteTable() should not fail.");
+
+    if (count != numOfTuples || (int) ages.size() != numOfTuples || ages.count(partialAge) != 0
+        || indexCount != numOfTuples || partialKey) {
+        std::cout << "***** [FAIL] Test Case 23 Failed *****" << std::endl;
+        return -1;
+    }
+    std::cout << "***** Test Case 23 Finished. The result will be examined. *****" << std::endl;
+    return success;
+}
+
+int main(int argc, char *argv[]) {
+    // Fuzzy checkpoint of the write-ahead log
+    if (argc > 1 && std::string(argv[1]) == "recover") {
+        return TEST_RM_23_RECOVER("tbl_checkpoint");
+    }
+    return TEST_RM_23_CHECKPOINT("tbl_checkpoint", "/proc/self/exe");
+}
@@ -0,0 +1,151 @@
+#include <random>
+#include "rm_test_util.h"
+
+const int numOfTuples = 2000;
+
+RC scanAges(const std::string &tableName, CompOp compOp, const void *value, std::vector<int> &ages) {
+    ages.clear();
+    void *returnedData = malloc(200);
+    RM_ScanIterator rmsi;
+    RID rid;
+    std::vector<std::string> projected{"Age"};
+    RC rc = rm.scan(tableName, "Age", compOp, value, projected, rmsi);
+    if (rc != success) {
+        free(returnedData);
+        return rc;
+    }
+    while (rmsi.getNextTuple(rid, returnedData) != RM_EOF) {
+        int age;
+        memcpy(&age, (char *) returnedData + 1, sizeof(int));
+        ages.push_back(age);
+    }
+    rmsi.close();
+    free(returnedData);
+    return success;
+}
+
+int readSalary(const std::string &tableName, const RID &rid) {
+    void *returnedData = malloc(200);
+    int salary = -1;
+    if (rm.readTuple(tableName, rid, returnedData) == success) {
+        // EmpName "Worker", then Age, Height and Salary
+        memcpy(&salary, (char *) returnedData + 1 + 4 + 6 + 4 + 4, sizeof(int));
+    }
+    free(returnedData);
+    return salary;
+}
+
+RC TEST_RM_24(const std::string &tableName) {
+    // Functions Tested
+    // 1. createTable with a cluster key **
+    // 2. insertTuple, readTuple, scan of an index-organized table **
+    // 3. updateTuple which moves a row, deleteTuple **
+    // 4. an index on another attribute **
+    std::cout << std::endl << "***** In RM Test Case 24 *****" << std::endl;
+
+    std::vector<Attribute> attrs;
+    attrs.push_back({"EmpName", TypeVarChar, 30});
+    attrs.push_back({"Age", TypeInt, 4});
+    attrs.push_back({"Height", TypeReal, 4});
+    attrs.push_back({"Salary", TypeInt, 4});
+    rm.deleteTable(tableName);
+    RC rc = rm.createTable(tableName, attrs, "Height_unknown");
+    assert(rc != success && "Creating a table on an unknown cluster key should fail.");
+    rc = rm.createTable(tableName, attrs, "Age");
+    assert(rc == success && "Creating an index-organized table should not fail.");
+
+    // insert out of order
+    std::vector<int> order(numOfTuples);
+    for (int i = 0; i < numOfTuples; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(24));
+    std::vector<RID> rids(numOfTuples);
+    void *tuple = malloc(200);
+    unsigned tupleSize = 0;
+    unsigned char nullsIndicator[1] = {0};
+    for (int age : order) {
+        prepareTuple(attrs.size(), nullsIndicator, 6, "Worker", age, 170.1, age * 10, tuple, &tupleSize);
+        rc = rm.insertTuple(tableName, tuple, rids[age]);
+        assert(rc == success && "RelationManager::insertTuple() should not fail.");
+    }
+
+    // a scan returns the tuples in key order, a condition on the key reads its range
+    std::vector<int> ages;
+    rc = scanAges(tableName, NO_OP, NULL, ages);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+    bool sorted = (int) ages.size() == numOfTuples && std::is_sorted(ages.begin(), ages.end());
+    int bound = 200;
+    std::vector<int> range;
+    rc = scanAges(tableName, LT_OP, &bound, range);
+    assert(rc == success && "RelationManager::scan() should not fail.");
+    bool ranged = (int) range.size() == bound && range.front() == 0 && range.back() == bound - 1;
+    rc = scanAges(tableName, EQ_OP, &bound, range);
+    ranged = ranged && rc == success && range.size() == 1 && range[0] == bound;
+
+    // readTuple and readAttribute by rid
+    bool read = readSalary(tableName, rids[123]) == 1230;
+    void *attribute = malloc(200);
+    rc = rm.readAttribute(tableName, rids[456], "Salary", attribute);
+    int salary;
+    memcpy(&salary, (char *) attribute + 1, sizeof(int));
+    read = read && rc == success && salary == 4560;
+
+    // an index on another attribute points to the rids of the rows
+    rc = rm.createIndex(tableName, "Salary");
+    assert(rc == success && "RelationManager::createIndex() should not fail.");
+
+    // a new cluster key moves the row in the tree, its rid stays
+    prepareTuple(attrs.size(), nullsIndicator, 6, "Worker", numOfTuples + 5, 170.1, 50, tuple, &tupleSize);
+    rc = rm.updateTuple(tableName, tuple, rids[5]);
+    assert(rc == success && "RelationManager::updateTuple() should not fail.");
+    rc = scanAges(tableName, NO_OP, NULL, ages);
+    bool updated = rc == success && (int) ages.size() == numOfTuples && ages.back() == numOfTuples + 5 &&
+                   std::find(ages.begin(), ages.end(), 5) == ages.end() && readSalary(tableName, rids[5]) == 50;
+
+    // delete every even age
+    for (int age = 0; age < numOfTuples; age += 2) {
+        rc = rm.deleteTuple(tableName, rids[age]);
+        assert(rc == success && "RelationManager::deleteTuple() should not fail.");
+    }
+    rc = scanAges(tableName, NO_OP, NULL, ages);
+    bool deleted = rc == success && (int) ages.size() == numOfTuples / 2 && std::is_sorted(ages.begin(), ages.end()) &&
+                   rm.readTuple(tableName, rids[2], tuple) != success && readSalary(tableName, rids[3]) == 30;
+
+    int indexCount = 0;
+    RID rid;
+    int key;
+    bool indexed = true;
+    RM_IndexScanIterator rmisi;
+    rc = rm.indexScan(tableName, "Salary", NULL, NULL, true, true, rmisi);
+    assert(rc == success && "RelationManager::indexScan() should not fail.");
+    while (rmisi.getNextEntry(rid, &key) != RM_EOF) {
+        indexed = indexed && readSalary(tableName, rid) == key;
+        indexCount++;
+    }
+    rmisi.close();
+    indexed = indexed && indexCount == numOfTuples / 2;
+
+    // the table stays index-organized
+    bool fixed = rm.clusterTable(tableName, "Salary") != success && rm.dropAttribute(tableName, "Age") != success;
+
+    std::cout << "sorted: " << sorted << ", ranged: " << ranged << ", read: " << read << ", updated: " << updated
+              << ", deleted: " << deleted << ", indexed: " << indexed << ", fixed: " << fixed << std::endl;
+
+    free(tuple);
+    free(attribute);
+    rc = rm.deleteTable(tableName);
+    assert(rc == success && "RelationManager::deleteTable() should not fail.");
+
+    if (!sorted || !ranged || !read || !updated || !deleted || !indexed || !fixed) {
+        std::cout << "***** [FAIL] Test Case 24 Failed *****" << std::endl;
+        return -1;
+    }
+    std::cout << "***** Test Case 24 Finished. The result will be examined. *****" << std::endl;
+    return success;
+}
+
+int main() {
+    // Index-organized table
+    return TEST_RM_24("tbl_clustered");
+}
@@ -0,0 +1,189 @@
+#include <cmath>
+
+#include "stats.h"
+#include "../ix/hash.h"
+
+HyperLogLog::HyperLogLog() : _registers(HLL_REGISTERS, 0) {
+}
+
+void HyperLogLog::add(unsigned hash) {
+    // a 64 bit mix of hash (the finalizer of MurmurHash3): its first HLL_PRECISION bits pick the register, the rank comes
+    // from the others, so there are enough of them for any count of tuples
+    unsigned long long mixed = hash;
+    mixed ^= mixed >> 33;
+    mixed *= 0xff51afd7ed558ccdULL;
+    mixed ^= mixed >> 33;
+    mixed *= 0xc4ceb9fe1a85ec53ULL;
+    mixed ^= mixed >> 33;
+    unsigned index = (unsigned)(mixed >> (64 - HLL_PRECISION));
+    unsigned long long rest = mixed << HLL_PRECISION;
+    unsigned char rank = rest == 0 ? 64 - HLL_PRECISION + 1 : __builtin_clzll(rest) + 1;
+    _registers[index] = std::max(_registers[index], rank);
+}
+
+void HyperLogLog::merge(const HyperLogLog &other) {
+    for(int i = 0; i < HLL_REGISTERS; i++){
+        _registers[i] = std::max(_registers[i], other._registers[i]);
+    }
+}
+
+unsigned HyperLogLog::estimate() const {
+    double sum = 0;
+    int zeros = 0;
+    for(unsigned char rank : _registers){
+        sum += std::ldexp(1.0, -rank);
+        zeros += rank == 0;
+    }
+    double m = HLL_REGISTERS;
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    // few values leave registers empty, counting them (linear counting) is closer then
+    if(estimate <= 2.5 * m && zeros != 0){
+        estimate = m * std::log(m / zeros);
+    }
+    return (unsigned)std::llround(estimate);
+}
+
+std::string HyperLogLog::getRegisters() const {
+    return std::string(_registers.begin(), _registers.end());
+}
+
+RC HyperLogLog::setRegisters(const std::string &registers) {
+    if(registers.size() != HLL_REGISTERS){
+        // std::cout << "[Error]: HyperLogLog::setRegisters -> not a sketch." << std::endl;
+        return -1;
+    }
+    _registers.assign(registers.begin(), registers.end());
+    return 0;
+}
+
+double ColumnStatistics::selectivity(CompOp compOp, const void *value) const {
+    if(compOp == NO_OP){
+        return 1;
+    }
+    if(numOfTuples == 0){
+        return 0;
+    }
+    double fraction = 0;
+    switch(compOp){
+        case EQ_OP: fraction = getEqualFraction(value); break;
+        case LT_OP: fraction = getLessFraction(value); break;
+        case LE_OP: fraction = getLessFraction(value) + getEqualFraction(value); break;
+        case GT_OP: fraction = 1 - getLessFraction(value) - getEqualFraction(value); break;
+        case GE_OP: fraction = 1 - getLessFraction(value); break;
+        case NE_OP: fraction = 1 - getEqualFraction(value); break;
+        default: break;
+    }
+    fraction = std::min(std::max(fraction, 0.0), 1.0);
+    return fraction * (numOfTuples - nullCount) / numOfTuples;
+}
+
+double ColumnStatistics::getLessFraction(const void *value) const {
+    IndexManager &indexManager = IndexManager::instance();
+    if(histogram.empty() || indexManager.compareKey(attribute, value, histogram.front().data()) <= 0){
+        return 0;
+    }
+    size_t numOfBuckets = histogram.size() - 1;
+    if(indexManager.compareKey(attribute, value, histogram.back().data()) > 0){
+        return 1;
+    }
+    // bucket i between the last bound below value and the next one, the buckets before it are below value
+    size_t i = std::lower_bound(histogram.begin(), histogram.end(), value, [&](const std::string &bound, const void *key){
+        return indexManager.compareKey(attribute, bound.data(), key) < 0;
+    }) - histogram.begin() - 1;
+    double inBucket = 0.5;
+    if(attribute.type == TypeInt){
+        int low, high, key;
+        memcpy(&low, histogram[i].data(), sizeof(int));
+        memcpy(&high, histogram[i + 1].data(), sizeof(int));
+        memcpy(&key, value, sizeof(int));
+        inBucket = ((double)key - low) / ((double)high - low);
+    }
+    else if(attribute.type == TypeReal){
+        float low, high, key;
+        memcpy(&low, histogram[i].data(), sizeof(float));
+        memcpy(&high, histogram[i + 1].data(), sizeof(float));
+        memcpy(&key, value, sizeof(float));
+        inBucket = ((double)key - low) / ((double)high - low);
+    }
+    return (i + inBucket) / numOfBuckets;
+}
+
+double ColumnStatistics::getEqualFraction(const void *value) const {
+    IndexManager &indexManager = IndexManager::instance();
+    if(histogram.empty() || indexManager.compareKey(attribute, value, histogram.front().data()) < 0 ||
+       indexManager.compareKey(attribute, value, histogram.back().data()) > 0){
+        return 0;
+    }
+    // a value which is k bounds fills the k - 1 buckets between them and parts of the two around them, k buckets on average
+    size_t numOfBuckets = histogram.size() - 1;
+    size_t numOfBounds = std::count_if(histogram.begin(), histogram.end(), [&](const std::string &bound){
+        return indexManager.compareKey(attribute, bound.data(), value) == 0;
+    });
+    double fraction = 1.0 / std::max(distinctCount, 1u);
+    if(numOfBounds >= 2){
+        fraction = std::max(fraction, std::min((double)numOfBounds / numOfBuckets, 1.0));
+    }
+    return fraction;
+}
+
+StatisticsCollector::StatisticsCollector(const Attribute &attribute) : _attribute(attribute) {
+}
+
+void StatisticsCollector::add(const void *key) {
+    if(key == nullptr){
+        _nullCount++;
+        return;
+    }
+    IndexManager &indexManager = IndexManager::instance();
+    _sketch.add(HashIndexManager::instance().hashKey(_attribute, key));
+
+    // a VARCHAR keeps its first STATS_MAX_VARCHAR_LENGTH bytes, which keeps the order of the values
+    std::string value((const char *)key, indexManager.getKeyLength(_attribute, key));
+    if(_attribute.type == TypeVarChar && value.size() > sizeof(int) + STATS_MAX_VARCHAR_LENGTH){
+        int length = STATS_MAX_VARCHAR_LENGTH;
+        value.resize(sizeof(int) + STATS_MAX_VARCHAR_LENGTH);
+        memcpy(&value[0], &length, sizeof(int));
+    }
+    if(_numOfValues == 0 || indexManager.compareKey(_attribute, value.data(), _minValue.data()) < 0){
+        _minValue = value;
+    }
+    if(_numOfValues == 0 || indexManager.compareKey(_attribute, value.data(), _maxValue.data()) > 0){
+        _maxValue = value;
+    }
+    _numOfValues++;
+
+    // reservoir sampling: the i-th value replaces a value of the sample with probability STATS_SAMPLE_SIZE / i
+    if(_sample.size() < STATS_SAMPLE_SIZE){
+        _sample.push_back(value);
+        return;
+    }
+    unsigned j = std::uniform_int_distribution<unsigned>(0, _numOfValues - 1)(_random);
+    if(j < STATS_SAMPLE_SIZE){
+        _sample[j] = value;
+    }
+}
+
+void StatisticsCollector::getStatistics(ColumnStatistics &statistics) const {
+    IndexManager &indexManager = IndexManager::instance();
+    statistics.attribute = _attribute;
+    statistics.numOfTuples = _numOfValues + _nullCount;
+    statistics.nullCount = _nullCount;
+    statistics.sketch = _sketch;
+    statistics.distinctCount = std::min(_sketch.estimate(), _numOfValues);
+    statistics.histogram.clear();
+    if(_numOfValues == 0){
+        return;
+    }
+    statistics.distinctCount = std::max(statistics.distinctCount, 1u);
+
+    // the bounds split the sorted sample into buckets of as many values, the first and last are the min and max of the column
+    std::vector<std::string> sorted = _sample;
+    std::sort(sorted.begin(), sorted.end(), [&](const std::string &a, const std::string &b){
+        return indexManager.compareKey(_attribute, a.data(), b.data()) < 0;
+    });
+    size_t numOfBuckets = std::min((size_t)STATS_HISTOGRAM_BUCKETS, sorted.size() - 1);
+    for(size_t i = 0; i <= numOfBuckets; i++){
+        statistics.histogram.push_back(i == 0 ? _minValue : i == numOfBuckets ? _maxValue :
+                                       sorted[i * (sorted.size() - 1) / numOfBuckets]);
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef _stats_h_
+#define _stats_h_
+
+#include <string>
+#include <vector>
+#include <random>
+
+#include "../rbf/rbfm.h"
+
+# define HLL_PRECISION 10                   // a sketch has 2^HLL_PRECISION registers, its standard error is 1.04 / 2^(HLL_PRECISION / 2), ~3%
+# define HLL_REGISTERS (1 << HLL_PRECISION)
+# define STATS_HISTOGRAM_BUCKETS 16         // buckets of an equi-depth histogram
+# define STATS_SAMPLE_SIZE 4096             // values sampled for the histogram of a column
+# define STATS_MAX_VARCHAR_LENGTH 50        // a VARCHAR bound of a histogram keeps this many bytes of the value
+
+// selectivities of a column without statistics, those of System R
+# define STATS_DEFAULT_EQ_SELECTIVITY 0.1
+# define STATS_DEFAULT_RANGE_SELECTIVITY (1.0 / 3)
+
+/*
+ * HyperLogLog sketch of the distinct values of a column, by the 32 bit hash of the value (HashIndexManager::hashKey(...)).
+ * Register i keeps the largest rank (position of the first 1 bit) of the hashes it gets.
+ */
+class HyperLogLog {
+public:
+    HyperLogLog();
+
+    void add(unsigned hash);
+
+    // Both sketches together, as if every value of other was added to this one.
+    void merge(const HyperLogLog &other);
+
+    // Estimate of the number of distinct values added, with the correction for small counts.
+    unsigned estimate() const;
+
+    // The registers as HLL_REGISTERS bytes, the format the Statistics catalog keeps them in.
+    std::string getRegisters() const;
+    RC setRegisters(const std::string &registers);
+
+private:
+    std::vector<unsigned char> _registers;
+};
+
+/*
+ * Statistics of a table: its tuples and the pages of its heap file.
+ */
+typedef struct {
+    unsigned numOfTuples;
+    unsigned numOfPages;
+} TableStatistics;
+
+/*
+ * Statistics of one column, values are kept in the format of IndexManager::insertEntry(...).
+ * histogram holds the bounds of an equi-depth histogram, the first is the min and the last the max: each of the
+ * histogram.size() - 1 buckets between two bounds holds as many of the values which are not NULL.
+ * The bounds come from a sample, VARCHAR bounds keep STATS_MAX_VARCHAR_LENGTH bytes of their value.
+ */
+class ColumnStatistics {
+public:
+    Attribute attribute;
+    unsigned numOfTuples = 0;       // tuples of the table when the statistics were collected
+    unsigned nullCount = 0;
+    unsigned distinctCount = 0;
+    std::vector<std::string> histogram;     // empty if every value is NULL
+    HyperLogLog sketch;
+
+    /*
+     * Share of the tuples of the table whose value satisfies "value compOp value" (NULL never does).
+     * Equality takes 1 / distinctCount of the values, or about the share of the histogram of a value which bounds several buckets.
+     * A range is read from the histogram, linear inside a bucket of INT and REAL, half of it for VARCHAR.
+     */
+    double selectivity(CompOp compOp, const void *value) const;
+
+private:
+    // Share of the values (not NULL) below value, and equal to it.
+    double getLessFraction(const void *value) const;
+    double getEqualFraction(const void *value) const;
+};
+
+/*
+ * Collects the statistics of one column in one pass over its values: the NULLs, the sketch and a reservoir sample of
+ * STATS_SAMPLE_SIZE values which getStatistics(...) sorts into the histogram. The sample is seeded, so is the histogram.
+ */
+class StatisticsCollector {
+public:
+    explicit StatisticsCollector(const Attribute &attribute);
+
+    // key in the format of IndexManager::insertEntry(...), nullptr for NULL.
+    void add(const void *key);
+
+    void getStatistics(ColumnStatistics &statistics) const;
+
+private:
+    Attribute _attribute;
+    unsigned _numOfValues = 0;
+    unsigned _nullCount = 0;
+    std::string _minValue;
+    std::string _maxValue;
+    std::vector<std::string> _sample;
+    HyperLogLog _sketch;
+    std::mt19937 _random;
+};
+
+#endif